@@ -0,0 +1,496 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Master Server Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Skulltag Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: loadgen.cpp
+//
+// Description: Load generator for the master server. It registers thousands
+// of fake servers and keeps launchers asking for the server list, and prints
+// how quickly the master answers. Every fake server and launcher gets its own
+// address from 127.0.0.0/8, so this only works on Linux and with a master
+// server running on the same machine.
+//
+// Usage: master-loadgen [-master ip:port] [-servers n] [-launchers n] [-time seconds]
+//
+//-----------------------------------------------------------------------------
+
+#include "../src/networkheaders.h"
+#include "../src/networkshared.h"
+#include "../src/huffman/huffman.h"
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+//*****************************************************************************
+//	DEFINES
+
+// The master server accepts this many servers per IP.
+#define	SERVERS_PER_IP					10
+
+// How often the fake servers tell the master server that they're still there (milliseconds).
+#define	SERVER_HEARTBEAT_TIME			30000
+
+// How long a fake server waits for the master's verification request before
+// it sends the challenge again (milliseconds).
+#define	SERVER_RETRY_TIME				2000
+
+// How many fake servers register with the master per second at the start.
+#define	SERVER_REGISTER_RATE			1000
+
+// How long a launcher waits for the whole list before giving up (milliseconds).
+#define	LAUNCHER_TIMEOUT				3000
+
+// The code revision the fake servers claim to be built with.
+#define	FAKE_SERVER_REVISION			4000
+
+//*****************************************************************************
+//	STRUCTURES
+
+struct FAKESERVER_s
+{
+	SOCKET			Socket;
+
+	std::string		VerificationString;
+
+	// When we last sent the master a challenge.
+	long long		llLastChallenge;
+
+	// Did the master server verify us?
+	bool			bVerified;
+};
+
+struct FAKELAUNCHER_s
+{
+	SOCKET			Socket;
+
+	// When the challenge was sent, or -1 if the launcher isn't waiting for anything.
+	long long		llSentTime;
+
+	// How many packets the list consists of, or 0 if we don't know yet.
+	unsigned int	ulNumParts;
+
+	unsigned int	ulPartsReceived;
+	unsigned int	ulNumServers;
+};
+
+//*****************************************************************************
+//	VARIABLES
+
+static	NETADDRESS_s				g_MasterAddress;
+static	int							g_Epoll;
+static	std::vector<FAKESERVER_s>	g_Servers;
+static	std::vector<FAKELAUNCHER_s>	g_Launchers;
+static	unsigned int				g_ulNextLauncherIP = 0;
+
+static	NETBUFFER_s					g_OutBuffer;
+static	NETBUFFER_s					g_InBuffer;
+static	unsigned char				g_ucHuffmanBuffer[131072];
+
+// Statistics since the last report.
+static	std::vector<double>			g_Latencies;
+static	unsigned int				g_ulIgnored = 0;
+static	unsigned int				g_ulLost = 0;
+static	unsigned int				g_ulListedServers = 0;
+
+//*****************************************************************************
+//	FUNCTIONS
+
+static long long loadgen_GetTime( void )
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now( ).time_since_epoch( )).count( );
+}
+
+//*****************************************************************************
+//
+// Opens a socket that is bound to the given loopback address, and adds it to
+// the epoll set with the given index.
+//
+static SOCKET loadgen_OpenSocket( BYTE b1, BYTE b2, BYTE b3, unsigned int ulIndex )
+{
+	SOCKET Socket = socket( PF_INET, SOCK_DGRAM, IPPROTO_UDP );
+	if ( Socket == INVALID_SOCKET )
+	{
+		perror( "socket" );
+		exit( 1 );
+	}
+
+	struct sockaddr_in address;
+	memset( &address, 0, sizeof( address ));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(( 127 << 24 ) | ( b1 << 16 ) | ( b2 << 8 ) | b3 );
+	address.sin_port = 0;
+
+	if ( bind( Socket, reinterpret_cast<sockaddr *>( &address ), sizeof( address )) != 0 )
+	{
+		perror( "bind" );
+		exit( 1 );
+	}
+
+	struct epoll_event event;
+	event.events = EPOLLIN;
+	event.data.u32 = ulIndex;
+	epoll_ctl( g_Epoll, EPOLL_CTL_ADD, Socket, &event );
+
+	return Socket;
+}
+
+//*****************************************************************************
+//
+static void loadgen_Send( SOCKET Socket )
+{
+	int iNumBytesOut = sizeof( g_ucHuffmanBuffer );
+	struct sockaddr_in address;
+
+	g_OutBuffer.ulCurrentSize = g_OutBuffer.CalcSize( );
+	HUFFMAN_Encode( g_OutBuffer.pbData, g_ucHuffmanBuffer, g_OutBuffer.ulCurrentSize, &iNumBytesOut );
+	g_MasterAddress.ToSocketAddress( reinterpret_cast<sockaddr &>( address ));
+	sendto( Socket, g_ucHuffmanBuffer, iNumBytesOut, 0, reinterpret_cast<sockaddr *>( &address ), sizeof( address ));
+}
+
+//*****************************************************************************
+//
+static bool loadgen_Receive( SOCKET Socket )
+{
+	int iNumBytesOut = g_InBuffer.ulMaxSize;
+	const ssize_t numBytes = recv( Socket, g_ucHuffmanBuffer, sizeof( g_ucHuffmanBuffer ), MSG_DONTWAIT );
+
+	if (( numBytes <= 0 ) || ( numBytes >= static_cast<ssize_t>( g_InBuffer.ulMaxSize )))
+		return false;
+
+	HUFFMAN_Decode( g_ucHuffmanBuffer, g_InBuffer.pbData, numBytes, &iNumBytesOut );
+	g_InBuffer.ulCurrentSize = iNumBytesOut;
+	g_InBuffer.ByteStream.pbStream = g_InBuffer.pbData;
+	g_InBuffer.ByteStream.pbStreamEnd = g_InBuffer.pbData + iNumBytesOut;
+	return true;
+}
+
+//*****************************************************************************
+//
+static void loadgen_SendChallenge( FAKESERVER_s &Server, long long llNow )
+{
+	g_OutBuffer.Clear( );
+	g_OutBuffer.ByteStream.WriteLong( SERVER_MASTER_CHALLENGE );
+	g_OutBuffer.ByteStream.WriteString( Server.VerificationString.c_str( ));
+	g_OutBuffer.ByteStream.WriteByte( 1 );
+	g_OutBuffer.ByteStream.WriteLong( FAKE_SERVER_REVISION );
+	loadgen_Send( Server.Socket );
+
+	Server.llLastChallenge = llNow;
+}
+
+//*****************************************************************************
+//
+static void loadgen_ParseServerPacket( FAKESERVER_s &Server )
+{
+	BYTESTREAM_s &stream = g_InBuffer.ByteStream;
+
+	switch ( stream.ReadByte( ))
+	{
+	case MASTER_SERVER_VERIFICATION:
+		{
+			stream.ReadString( );
+			const int iVerificationNumber = stream.ReadLong( );
+
+			g_OutBuffer.Clear( );
+			g_OutBuffer.ByteStream.WriteLong( SERVER_MASTER_VERIFICATION );
+			g_OutBuffer.ByteStream.WriteString( Server.VerificationString.c_str( ));
+			g_OutBuffer.ByteStream.WriteLong( iVerificationNumber );
+			loadgen_Send( Server.Socket );
+			Server.bVerified = true;
+		}
+		break;
+
+	// Acknowledge the ban list, so that the master doesn't send it again.
+	case MASTER_SERVER_BANLIST:
+	case MASTER_SERVER_BANLISTPART:
+
+		g_OutBuffer.Clear( );
+		g_OutBuffer.ByteStream.WriteLong( SERVER_MASTER_BANLIST_RECEIPT );
+		g_OutBuffer.ByteStream.WriteString( Server.VerificationString.c_str( ));
+		loadgen_Send( Server.Socket );
+		break;
+	}
+}
+
+//*****************************************************************************
+//
+static void loadgen_StartQuery( FAKELAUNCHER_s &Launcher, unsigned int ulIndex, long long llNow )
+{
+	// Every query comes from a new address, so that the master server doesn't
+	// ignore them for flooding.
+	const unsigned int ulIP = g_ulNextLauncherIP;
+	g_ulNextLauncherIP = ( g_ulNextLauncherIP + 1 ) % ( 1 << 16 );
+
+	Launcher.Socket = loadgen_OpenSocket( 2, ulIP >> 8, ulIP & 255, ulIndex );
+	Launcher.llSentTime = llNow;
+	Launcher.ulNumParts = 0;
+	Launcher.ulPartsReceived = 0;
+	Launcher.ulNumServers = 0;
+
+	g_OutBuffer.Clear( );
+	g_OutBuffer.ByteStream.WriteLong( LAUNCHER_MASTER_CHALLENGE );
+	g_OutBuffer.ByteStream.WriteShort( MASTER_SERVER_VERSION );
+	loadgen_Send( Launcher.Socket );
+}
+
+//*****************************************************************************
+//
+static void loadgen_FinishQuery( FAKELAUNCHER_s &Launcher )
+{
+	close( Launcher.Socket );
+	Launcher.Socket = INVALID_SOCKET;
+	Launcher.llSentTime = -1;
+}
+
+//*****************************************************************************
+//
+static void loadgen_ParseLauncherPacket( FAKELAUNCHER_s &Launcher, long long llNow )
+{
+	BYTESTREAM_s &stream = g_InBuffer.ByteStream;
+
+	switch ( stream.ReadLong( ))
+	{
+	case MSC_REQUESTIGNORED:
+
+		g_ulIgnored++;
+		loadgen_FinishQuery( Launcher );
+		return;
+
+	case MSC_BEGINSERVERLISTPART:
+		{
+			const int iPacketNum = stream.ReadByte( );
+
+			while ( stream.ReadByte( ) == MSC_SERVERBLOCK )
+			{
+				int iNumPorts;
+
+				while (( iNumPorts = stream.ReadByte( )) > 0 )
+				{
+					stream.ReadLong( );
+					for ( int i = 0; i < iNumPorts; ++i )
+						stream.ReadShort( );
+					Launcher.ulNumServers += iNumPorts;
+				}
+
+				// The byte after the block tells if this is the last packet.
+				if ( stream.ReadByte( ) == MSC_ENDSERVERLIST )
+					Launcher.ulNumParts = iPacketNum + 1;
+				break;
+			}
+
+			if (( ++Launcher.ulPartsReceived == Launcher.ulNumParts ) && ( Launcher.ulNumParts != 0 ))
+			{
+				g_Latencies.push_back( static_cast<double>( llNow - Launcher.llSentTime ));
+				g_ulListedServers = Launcher.ulNumServers;
+				loadgen_FinishQuery( Launcher );
+			}
+		}
+		return;
+	}
+}
+
+//*****************************************************************************
+//
+static void loadgen_PrintReport( int iSecond )
+{
+	unsigned int ulVerified = 0;
+	double dAverage = 0;
+	double dMax = 0;
+	double dP99 = 0;
+
+	for ( unsigned int i = 0; i < g_Servers.size( ); ++i )
+		ulVerified += g_Servers[i].bVerified;
+
+	if ( g_Latencies.size( ) > 0 )
+	{
+		std::sort( g_Latencies.begin( ), g_Latencies.end( ));
+		for ( unsigned int i = 0; i < g_Latencies.size( ); ++i )
+			dAverage += g_Latencies[i];
+		dAverage /= g_Latencies.size( );
+		dP99 = g_Latencies[g_Latencies.size( ) * 99 / 100];
+		dMax = g_Latencies.back( );
+	}
+
+	printf( "%3ds: %u/%u servers verified, %u listed | %u lists/s, %u ignored, %u lost | %.1f ms avg, %.1f ms p99, %.1f ms max\n",
+		iSecond, ulVerified, static_cast<unsigned int>( g_Servers.size( )), g_ulListedServers,
+		static_cast<unsigned int>( g_Latencies.size( )), g_ulIgnored, g_ulLost, dAverage, dP99, dMax );
+	fflush( stdout );
+
+	g_Latencies.clear( );
+	g_ulIgnored = 0;
+	g_ulLost = 0;
+}
+
+//*****************************************************************************
+//
+int main( int argc, char **argv )
+{
+	const char *pszMaster = "127.0.0.1";
+	unsigned int ulNumServers = 1000;
+	unsigned int ulNumLaunchers = 16;
+	int iSeconds = 30;
+
+	for ( int i = 1; i < argc - 1; i += 2 )
+	{
+		if ( stricmp( argv[i], "-master" ) == 0 )
+			pszMaster = argv[i + 1];
+		else if ( stricmp( argv[i], "-servers" ) == 0 )
+			ulNumServers = atoi( argv[i + 1] );
+		else if ( stricmp( argv[i], "-launchers" ) == 0 )
+			ulNumLaunchers = atoi( argv[i + 1] );
+		else if ( stricmp( argv[i], "-time" ) == 0 )
+			iSeconds = atoi( argv[i + 1] );
+	}
+
+	if ( g_MasterAddress.LoadFromString( pszMaster ) == false )
+	{
+		fprintf( stderr, "Invalid master server address: %s\n", pszMaster );
+		return 1;
+	}
+	if ( g_MasterAddress.usPort == 0 )
+		g_MasterAddress.SetPort( DEFAULT_MASTER_PORT );
+
+	ulNumServers = std::min<unsigned int>( ulNumServers, SERVERS_PER_IP * 65535 );
+
+	// Every server and launcher needs its own socket.
+	struct rlimit limit;
+	if ( getrlimit( RLIMIT_NOFILE, &limit ) == 0 )
+	{
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit( RLIMIT_NOFILE, &limit );
+		if ( limit.rlim_cur < ulNumServers + ulNumLaunchers + 16 )
+			fprintf( stderr, "Warning: only %u sockets can be opened.\n", static_cast<unsigned int>( limit.rlim_cur ));
+	}
+
+	HUFFMAN_Construct( );
+	g_OutBuffer.Init( MAX_UDP_PACKET, BUFFERTYPE_WRITE );
+	g_InBuffer.Init(( MAX_UDP_PACKET * 8 ) / 3 + 1, BUFFERTYPE_READ );
+	g_Epoll = epoll_create1( 0 );
+
+	printf( "Registering %u servers and running %u launchers against %s for %d seconds.\n", ulNumServers, ulNumLaunchers, g_MasterAddress.ToString( ), iSeconds );
+
+	const long long llStart = loadgen_GetTime( );
+
+	g_Servers.resize( ulNumServers );
+	for ( unsigned int i = 0; i < ulNumServers; ++i )
+	{
+		const unsigned int ulIP = i / SERVERS_PER_IP + 1;
+		char szVerification[32];
+
+		snprintf( szVerification, sizeof( szVerification ), "loadgen%u", i );
+		g_Servers[i].Socket = loadgen_OpenSocket( 1, ulIP >> 8, ulIP & 255, i );
+		g_Servers[i].VerificationString = szVerification;
+		g_Servers[i].bVerified = false;
+
+		// Don't register all servers at once, their challenges wouldn't fit into the
+		// master's receive buffer.
+		g_Servers[i].llLastChallenge = llStart - SERVER_RETRY_TIME + static_cast<long long>( i ) * 1000 / SERVER_REGISTER_RATE;
+	}
+
+	g_Launchers.resize( ulNumLaunchers );
+	for ( unsigned int i = 0; i < ulNumLaunchers; ++i )
+	{
+		g_Launchers[i].Socket = INVALID_SOCKET;
+		g_Launchers[i].llSentTime = -1;
+	}
+
+	int iLastReport = 0;
+	struct epoll_event events[256];
+
+	while ( true )
+	{
+		const long long llNow = loadgen_GetTime( );
+		const int iSecond = static_cast<int>(( llNow - llStart ) / 1000 );
+
+		if ( iSecond > iLastReport )
+		{
+			loadgen_PrintReport( iSecond );
+			iLastReport = iSecond;
+
+			if ( iSecond >= iSeconds )
+				break;
+		}
+
+		for ( unsigned int i = 0; i < g_Servers.size( ); ++i )
+		{
+			if ( llNow - g_Servers[i].llLastChallenge >= ( g_Servers[i].bVerified ? SERVER_HEARTBEAT_TIME : SERVER_RETRY_TIME ))
+				loadgen_SendChallenge( g_Servers[i], llNow );
+		}
+
+		// Start a new query on every idle launcher, and give up on the ones that took too long.
+		for ( unsigned int i = 0; i < g_Launchers.size( ); ++i )
+		{
+			if (( g_Launchers[i].llSentTime >= 0 ) && ( llNow - g_Launchers[i].llSentTime > LAUNCHER_TIMEOUT ))
+			{
+				g_ulLost++;
+				loadgen_FinishQuery( g_Launchers[i] );
+			}
+
+			if ( g_Launchers[i].llSentTime < 0 )
+				loadgen_StartQuery( g_Launchers[i], ulNumServers + i, llNow );
+		}
+
+		const int iNumEvents = epoll_wait( g_Epoll, events, 256, 10 );
+
+		for ( int i = 0; i < iNumEvents; ++i )
+		{
+			const unsigned int ulIndex = events[i].data.u32;
+
+			if ( ulIndex < ulNumServers )
+			{
+				while ( loadgen_Receive( g_Servers[ulIndex].Socket ))
+					loadgen_ParseServerPacket( g_Servers[ulIndex] );
+			}
+			else
+			{
+				FAKELAUNCHER_s &launcher = g_Launchers[ulIndex - ulNumServers];
+
+				while (( launcher.llSentTime >= 0 ) && loadgen_Receive( launcher.Socket ))
+					loadgen_ParseLauncherPacket( launcher, loadgen_GetTime( ));
+			}
+		}
+	}
+
+	return 0;
+}
@@ -55,6 +55,11 @@
 #include "main.h"
 #include <sstream>
 #include <set>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 // [BB] Needed for I_GetTime.
 #ifdef _MSC_VER
@@ -71,14 +76,15 @@
 class SERVERCompFunc
 {
 public:
-	bool operator()(SERVER_s s1, SERVER_s s2) const
+	bool operator()( const SERVER_s &s1, const SERVER_s &s2 ) const
 	{
-		// [BB] NETWORK_AddressToString uses a static char array to generate the string, so we
-		// need to cache the string conversion of the first string when comparing to two.
-		// Note: Because we need a "<" comparison and not a "!=" comparison we can't use
-		// NETWORK_CompareAddress.
-		std::string address1 = s1.Address.ToString();
-		return ( stricmp ( address1.c_str(), s2.Address.ToString() ) < 0 );
+		// [dorch] Compare the IPs and then the ports, instead of converting both
+		// addresses to strings. Servers on the same IP are still next to each other.
+		const int result = memcmp( s1.Address.abIP, s2.Address.abIP, sizeof( s1.Address.abIP ));
+		if ( result != 0 )
+			return ( result < 0 );
+
+		return ( ntohs( s1.Address.usPort ) < ntohs( s2.Address.usPort ));
 	}
 };
 
@@ -99,15 +105,39 @@ static	IPList					g_BannedIPExemptions;
 static	IPList					g_MultiServerExceptions;
 
 // IPs of launchers that we've sent full lists to recently.
-static	QueryIPQueue			g_queryIPQueue( 10 );
+static	QueryIPQueue			g_queryIPQueue( QUERY_IGNORE_TIME, QUERY_BURST );
 
 // [RC] IPs that are completely ignored.
 static	QueryIPQueue			g_floodProtectionIPQueue( 10 );
-static	QueryIPQueue			g_ShortFloodQueue( 3 );
+static	QueryIPQueue			g_ShortFloodQueue( SHORT_FLOOD_IGNORE_TIME, SHORT_FLOOD_BURST );
 
 // [BB] Do we want to hide servers that ignore our ban list?
 static	bool					g_bHideBanIgnoringServers = false;
 
+// [dorch] The server list that is sent to launchers, and whether it needs to
+// be rebuilt before it's sent again.
+static	std::shared_ptr<const SERVERLIST_s>	g_ServerList;
+static	bool					g_bServerListChanged = true;
+static	unsigned int			g_ulServerListVersion = 0;
+static	long					g_lServerListBuildTime = 0;
+static	NETBUFFER_s				g_ServerListBuffer;
+
+// [dorch] Launchers that are waiting for a responder thread to send them the list.
+struct LAUNCHERREQUEST_s
+{
+	NETADDRESS_s						Address;
+	std::shared_ptr<const SERVERLIST_s>	List;
+	bool								bParts;
+};
+
+static	std::vector<std::thread>		g_Responders;
+static	std::deque<LAUNCHERREQUEST_s>	g_LauncherRequests;
+static	std::mutex						g_LauncherRequestMutex;
+static	std::condition_variable			g_LauncherRequestReady;
+static	bool							g_bRespondersQuit = false;
+static	unsigned int					g_ulNumListsSent = 0;
+static	unsigned int					g_ulNumListsDropped = 0;
+
 //*****************************************************************************
 //	CLASSES
 
@@ -314,6 +344,220 @@ unsigned long MASTERSERVER_NumServers ( void )
 	return g_Servers.size();
 }
 
+//*****************************************************************************
+//
+// [dorch] Whether a server is put on the list that is sent to launchers.
+//
+bool MASTERSERVER_IsServerListed( const SERVER_s &Server )
+{
+	// [BB] Possibly omit servers that don't enforce our ban list.
+	return (( Server.bEnforcesBanList == true ) || ( g_bHideBanIgnoringServers == false ));
+}
+
+//*****************************************************************************
+//
+unsigned int MASTERSERVER_CountServersOnIP( const NETADDRESS_s &Address )
+{
+	SERVER_s first;
+	unsigned int ulNumServers = 0;
+
+	// [dorch] The servers are sorted by IP, so the ones on this IP are all next to each other.
+	first.Address = Address;
+	first.Address.usPort = 0;
+
+	for ( std::set<SERVER_s, SERVERCompFunc>::const_iterator it = g_Servers.lower_bound( first ); ( it != g_Servers.end() ) && it->Address.CompareNoPort( Address ); ++it )
+		ulNumServers++;
+
+	return ulNumServers;
+}
+
+//*****************************************************************************
+//
+// [dorch] Builds the packets for both kinds of launcher challenges from the
+// current servers. This only happens when a launcher asks for the list after
+// it has changed, instead of for every launcher.
+//
+void MASTERSERVER_BuildServerList( void )
+{
+	std::shared_ptr<SERVERLIST_s> list = std::make_shared<SERVERLIST_s>( );
+	list->ulVersion = ++g_ulServerListVersion;
+	list->ulNumServers = 0;
+
+	// The answer to LAUNCHER_SERVER_CHALLENGE has all servers in one packet.
+	g_ServerListBuffer.Clear();
+	g_ServerListBuffer.ByteStream.WriteLong( MSC_BEGINSERVERLIST );
+	for( std::set<SERVER_s, SERVERCompFunc>::const_iterator it = g_Servers.begin(); it != g_Servers.end(); ++it )
+	{
+		if ( MASTERSERVER_IsServerListed( *it ))
+		{
+			MASTERSERVER_SendServerIPToLauncher ( it->Address, &g_ServerListBuffer.ByteStream );
+			list->ulNumServers++;
+		}
+	}
+
+	// Tell the launcher that we're done sending servers.
+	g_ServerListBuffer.ByteStream.WriteByte( MSC_ENDSERVERLIST );
+	NETWORK_EncodePacket( &g_ServerListBuffer, list->FullList );
+
+	// The answer to LAUNCHER_MASTER_CHALLENGE is split into several packets.
+	const unsigned long ulMaxPacketSize = 1024;
+	unsigned long ulPacketNum = 0;
+
+	std::set<SERVER_s, SERVERCompFunc>::const_iterator it = g_Servers.begin();
+
+	g_ServerListBuffer.Clear();
+	g_ServerListBuffer.ByteStream.WriteLong( MSC_BEGINSERVERLISTPART );
+	g_ServerListBuffer.ByteStream.WriteByte( ulPacketNum );
+	g_ServerListBuffer.ByteStream.WriteByte( MSC_SERVERBLOCK );
+	unsigned long ulSizeOfPacket = 6; // 4 (MSC_BEGINSERVERLISTPART) + 1 (0) + 1 (MSC_SERVERBLOCK)
+
+	while ( it != g_Servers.end() )
+	{
+		NETADDRESS_s serverAddress = it->Address;
+		std::vector<USHORT> serverPortList;
+
+		do {
+			if ( MASTERSERVER_IsServerListed( *it ))
+				serverPortList.push_back ( it->Address.usPort );
+			++it;
+		} while ( ( it != g_Servers.end() ) && it->Address.CompareNoPort( serverAddress ) );
+
+		// [BB] All servers on this IP ignore the list, nothing to send.
+		if ( serverPortList.size() == 0 )
+			continue;
+
+		const unsigned long ulServerBlockNetSize = MASTERSERVER_CalcServerIPBlockNetSize( serverAddress, serverPortList );
+
+		// [BB] If sending this block would cause the current packet to exceed ulMaxPacketSize ...
+		if ( ulSizeOfPacket + ulServerBlockNetSize > ulMaxPacketSize - 1 )
+		{
+			// [BB] ... close the current packet and start a new one.
+			g_ServerListBuffer.ByteStream.WriteByte( 0 ); // [BB] Terminate MSC_SERVERBLOCK by sending 0 ports.
+			g_ServerListBuffer.ByteStream.WriteByte( MSC_ENDSERVERLISTPART );
+			list->Parts.push_back( std::vector<BYTE>( ));
+			NETWORK_EncodePacket( &g_ServerListBuffer, list->Parts.back( ));
+
+			g_ServerListBuffer.Clear();
+			++ulPacketNum;
+			ulSizeOfPacket = 5;
+			g_ServerListBuffer.ByteStream.WriteLong( MSC_BEGINSERVERLISTPART );
+			g_ServerListBuffer.ByteStream.WriteByte( ulPacketNum );
+			g_ServerListBuffer.ByteStream.WriteByte( MSC_SERVERBLOCK );
+		}
+		ulSizeOfPacket += ulServerBlockNetSize;
+		MASTERSERVER_SendServerIPBlockToLauncher ( serverAddress, serverPortList, &g_ServerListBuffer.ByteStream );
+	}
+	g_ServerListBuffer.ByteStream.WriteByte( 0 ); // [BB] Terminate MSC_SERVERBLOCK by sending 0 ports.
+	g_ServerListBuffer.ByteStream.WriteByte( MSC_ENDSERVERLIST );
+	list->Parts.push_back( std::vector<BYTE>( ));
+	NETWORK_EncodePacket( &g_ServerListBuffer, list->Parts.back( ));
+
+	g_ServerList = list;
+	g_bServerListChanged = false;
+	g_lServerListBuildTime = g_lCurrentTime;
+}
+
+//*****************************************************************************
+//
+static void masterserver_SendServerList( const LAUNCHERREQUEST_s &Request )
+{
+	if ( Request.bParts )
+	{
+		for ( unsigned int i = 0; i < Request.List->Parts.size(); ++i )
+			NETWORK_LaunchEncodedPacket( Request.List->Parts[i], Request.Address );
+	}
+	else
+		NETWORK_LaunchEncodedPacket( Request.List->FullList, Request.Address );
+}
+
+//*****************************************************************************
+//
+static void masterserver_ResponderThread( void )
+{
+	std::unique_lock<std::mutex> lock( g_LauncherRequestMutex );
+
+	while ( true )
+	{
+		g_LauncherRequestReady.wait( lock, [] { return g_bRespondersQuit || ( g_LauncherRequests.empty() == false ); } );
+		if ( g_bRespondersQuit )
+			break;
+
+		LAUNCHERREQUEST_s request = g_LauncherRequests.front();
+		g_LauncherRequests.pop_front();
+		g_ulNumListsSent++;
+
+		lock.unlock();
+		masterserver_SendServerList( request );
+		request.List.reset();
+		lock.lock();
+	}
+}
+
+//*****************************************************************************
+//
+static void masterserver_StopResponders( void )
+{
+	{
+		std::lock_guard<std::mutex> lock( g_LauncherRequestMutex );
+		g_bRespondersQuit = true;
+	}
+	g_LauncherRequestReady.notify_all();
+
+	for ( unsigned int i = 0; i < g_Responders.size(); ++i )
+		g_Responders[i].join();
+
+	g_Responders.clear();
+}
+
+//*****************************************************************************
+//
+void MASTERSERVER_StartResponders( unsigned int ulNumThreads )
+{
+	for ( unsigned int i = 0; i < ulNumThreads; ++i )
+		g_Responders.push_back( std::thread( masterserver_ResponderThread ));
+
+	if ( ulNumThreads > 0 )
+		atexit( masterserver_StopResponders );
+}
+
+//*****************************************************************************
+//
+// [dorch] Sends the server list to a launcher. If there are responder threads,
+// one of them sends it, so that the main thread can go on with the next packet.
+//
+void MASTERSERVER_SendServerList( const NETADDRESS_s &Address, const bool bParts )
+{
+	// [dorch] While lots of servers come and go, rebuild the list at most once per second.
+	if (( g_ServerList == NULL ) || ( g_bServerListChanged && ( g_lServerListBuildTime != g_lCurrentTime )))
+		MASTERSERVER_BuildServerList( );
+
+	LAUNCHERREQUEST_s request;
+	request.Address = Address;
+	request.List = g_ServerList;
+	request.bParts = bParts;
+
+	if ( g_Responders.empty() )
+	{
+		masterserver_SendServerList( request );
+		g_ulNumListsSent++;
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( g_LauncherRequestMutex );
+
+		// The responders can't keep up. The launcher will have to ask again.
+		if ( g_LauncherRequests.size() >= MAX_QUEUED_LAUNCHERS )
+		{
+			g_ulNumListsDropped++;
+			return;
+		}
+
+		g_LauncherRequests.push_back( request );
+	}
+	g_LauncherRequestReady.notify_one();
+}
+
 //*****************************************************************************
 //
 bool MASTERSERVER_RefreshIPList( IPList &List, const char *FileName )
@@ -387,6 +631,7 @@ void MASTERSERVER_AddServer( const SERVER_s &Server, std::set<SERVER_s, SERVERCo
 		addedServer->lLastReceived = g_lCurrentTime;						
 		if ( &ServerSet == &g_Servers )
 		{
+			g_bServerListChanged = true;
 			printf( "+ Adding %s (revision %d) to the server list.\n", addedServer->Address.ToString(), addedServer->iServerRevision );
 			MASTERSERVER_SendBanlistToServer( *addedServer );
 		}
@@ -460,14 +705,8 @@ void MASTERSERVER_ParseCommands( BYTESTREAM_s *pByteStream )
 			// This is a new server; add it to the list.
 			if ( currentServer == g_Servers.end() )
 			{
-				unsigned int iNumOtherServers = 0;
-
 				// First count the number of servers from this IP.
-				for( std::set<SERVER_s, SERVERCompFunc>::const_iterator it = g_Servers.begin(); it != g_Servers.end(); ++it )
-				{
-					if ( it->Address.CompareNoPort( AddressFrom ))
-						iNumOtherServers++;
-				}
+				const unsigned int iNumOtherServers = MASTERSERVER_CountServersOnIP( AddressFrom );
 
 				if ( iNumOtherServers >= 10 && !g_MultiServerExceptions.isIPInList( AddressFrom ))
 					printf( "* More than 10 servers received from %s. Ignoring request...\n", AddressFrom.ToString() );
@@ -505,7 +744,11 @@ void MASTERSERVER_ParseCommands( BYTESTREAM_s *pByteStream )
 				{
 					currentServer->lLastReceived = g_lCurrentTime;
 					// [BB] The server possibly changed the ban setting, so update it.
-					currentServer->bEnforcesBanList = newServer.bEnforcesBanList;
+					if ( currentServer->bEnforcesBanList != newServer.bEnforcesBanList )
+					{
+						currentServer->bEnforcesBanList = newServer.bEnforcesBanList;
+						g_bServerListChanged = true;
+					}
 				}
 			}
 
@@ -590,78 +833,9 @@ void MASTERSERVER_ParseCommands( BYTESTREAM_s *pByteStream )
 			// Wait 10 seconds before sending this IP the server list again.
 			g_queryIPQueue.addAddress( AddressFrom, g_lCurrentTime, &std::cerr );
 
-			switch ( lCommand )
-			{
-			case LAUNCHER_SERVER_CHALLENGE:
-				// Send the list of servers.
-				g_MessageBuffer.ByteStream.WriteLong( MSC_BEGINSERVERLIST );
-				for( std::set<SERVER_s, SERVERCompFunc>::const_iterator it = g_Servers.begin(); it != g_Servers.end(); ++it )
-				{
-					// [BB] Possibly omit servers that don't enforce our ban list.
-					if ( ( it->bEnforcesBanList == true ) || ( g_bHideBanIgnoringServers == false ) )
-						MASTERSERVER_SendServerIPToLauncher ( it->Address, &g_MessageBuffer.ByteStream );
-				}
-
-				// Tell the launcher that we're done sending servers.
-				g_MessageBuffer.ByteStream.WriteByte( MSC_ENDSERVERLIST );
-
-				// Send the launcher our packet.
-				NETWORK_LaunchPacket( &g_MessageBuffer, AddressFrom );
-				return;
-
-			case LAUNCHER_MASTER_CHALLENGE:
-
-				const unsigned long ulMaxPacketSize = 1024;
-				unsigned long ulPacketNum = 0;
-
-				std::set<SERVER_s, SERVERCompFunc>::const_iterator it = g_Servers.begin();
-
-				g_MessageBuffer.ByteStream.WriteLong( MSC_BEGINSERVERLISTPART );
-				g_MessageBuffer.ByteStream.WriteByte( ulPacketNum );
-				g_MessageBuffer.ByteStream.WriteByte( MSC_SERVERBLOCK );
-				unsigned long ulSizeOfPacket = 6; // 4 (MSC_BEGINSERVERLISTPART) + 1 (0) + 1 (MSC_SERVERBLOCK)
-
-				while ( it != g_Servers.end() )
-				{
-					NETADDRESS_s serverAddress = it->Address;
-					std::vector<USHORT> serverPortList;
-
-					do {
-						// [BB] Possibly omit servers that don't enforce our ban list.
-						if ( ( it->bEnforcesBanList == true ) || ( g_bHideBanIgnoringServers == false ) )
-							serverPortList.push_back ( it->Address.usPort );
-						++it;
-					} while ( ( it != g_Servers.end() ) && it->Address.CompareNoPort( serverAddress ) );
-
-					// [BB] All servers on this IP ignore the list, nothing to send.
-					if ( serverPortList.size() == 0 )
-						continue;
-
-					const unsigned long ulServerBlockNetSize = MASTERSERVER_CalcServerIPBlockNetSize( serverAddress, serverPortList );
-
-					// [BB] If sending this block would cause the current packet to exceed ulMaxPacketSize ...
-					if ( ulSizeOfPacket + ulServerBlockNetSize > ulMaxPacketSize - 1 )
-					{
-						// [BB] ... close the current packet and start a new one.
-						g_MessageBuffer.ByteStream.WriteByte( 0 ); // [BB] Terminate MSC_SERVERBLOCK by sending 0 ports.
-						g_MessageBuffer.ByteStream.WriteByte( MSC_ENDSERVERLISTPART );
-						NETWORK_LaunchPacket( &g_MessageBuffer, AddressFrom );
-
-						g_MessageBuffer.Clear();
-						++ulPacketNum;
-						ulSizeOfPacket = 5;
-						g_MessageBuffer.ByteStream.WriteLong( MSC_BEGINSERVERLISTPART );
-						g_MessageBuffer.ByteStream.WriteByte( ulPacketNum );
-						g_MessageBuffer.ByteStream.WriteByte( MSC_SERVERBLOCK );
-					}
-					ulSizeOfPacket += ulServerBlockNetSize;
-					MASTERSERVER_SendServerIPBlockToLauncher ( serverAddress, serverPortList, &g_MessageBuffer.ByteStream );
-				}
-				g_MessageBuffer.ByteStream.WriteByte( 0 ); // [BB] Terminate MSC_SERVERBLOCK by sending 0 ports.
-				g_MessageBuffer.ByteStream.WriteByte( MSC_ENDSERVERLIST );
-				NETWORK_LaunchPacket( &g_MessageBuffer, AddressFrom );
-				return;
-			}
+			// [dorch] Send the prebuilt list, LAUNCHER_MASTER_CHALLENGE gets it split into several packets.
+			MASTERSERVER_SendServerList( AddressFrom, lCommand == LAUNCHER_MASTER_CHALLENGE );
+			return;
 		}
 	}
 
@@ -681,6 +855,8 @@ void MASTERSERVER_CheckTimeouts( std::set<SERVER_s, SERVERCompFunc> &ServerSet )
 		if (( g_lCurrentTime - it->lLastReceived ) >= 60 )
 		{
 			printf( "- %server at %s timed out.\n", ( &ServerSet == &g_UnverifiedServers ) ? "Unverified s" : "S", it->Address.ToString() );
+			if ( &ServerSet == &g_Servers )
+				g_bServerListChanged = true;
 			// [BB] The standard does not require set::erase to return the incremented operator,
 			// that's why we must use the post increment operator here.
 			ServerSet.erase ( it++ );
@@ -723,6 +899,7 @@ int main( int argc, char **argv )
 
 	// Initialize the message buffer we send messages to the launcher in.
 	g_MessageBuffer.Init ( MAX_UDP_PACKET, BUFFERTYPE_WRITE );
+	g_ServerListBuffer.Init ( MAX_UDP_PACKET, BUFFERTYPE_WRITE );
 
 	// Initialize the bans subsystem.
 	std::cerr << "Initializing ban list...\n";
@@ -742,6 +919,24 @@ int main( int argc, char **argv )
 		g_bHideBanIgnoringServers = true;
 	}
 
+	// [dorch] Start the threads that send server lists to launchers.
+	unsigned int ulNumResponders = DEFAULT_NUM_RESPONDERS;
+	for ( int i = 1; i < argc - 1; ++i )
+	{
+		if ( stricmp ( argv[i], "-responders" ) == 0 )
+		{
+			char *pszEnd;
+			const long lValue = strtol ( argv[i + 1], &pszEnd, 10 );
+
+			if (( pszEnd == argv[i + 1] ) || ( *pszEnd != '\0' ) || ( lValue < 1 ) || ( lValue > MAX_NUM_RESPONDERS ))
+				std::cerr << "Invalid -responders value \"" << argv[i + 1] << "\", expected 1 to " << MAX_NUM_RESPONDERS << "." << std::endl;
+			else
+				ulNumResponders = static_cast<unsigned int>( lValue );
+		}
+	}
+	std::cerr << "Responder threads: " << ulNumResponders << "." << std::endl;
+	MASTERSERVER_StartResponders( ulNumResponders );
+
 	// Done setting up!
 	std::cerr << "\n=== Master server started! ===\n";
 
@@ -787,6 +982,17 @@ int main( int argc, char **argv )
 		{
 			std::cerr << "~ Reparsing the ban lists...\n";
 			MASTERSERVER_InitializeBans( );
+
+			// [dorch] Report how many packets the flood protection dropped since the start.
+			std::cerr << "~ Ignored packets: " << g_queryIPQueue.getNumRejected( ) << " queries, "
+				<< g_ShortFloodQueue.getNumRejected( ) + g_floodProtectionIPQueue.getNumRejected( ) << " flooding ("
+				<< g_queryIPQueue.size( ) + g_ShortFloodQueue.size( ) + g_floodProtectionIPQueue.size( ) << " IPs stored).\n";
+
+			{
+				std::lock_guard<std::mutex> lock( g_LauncherRequestMutex );
+				std::cerr << "~ Server lists: " << g_ulNumListsSent << " sent, " << g_ulNumListsDropped << " dropped, "
+					<< g_ulServerListVersion << " rebuilt.\n";
+			}
 			lastParsingTime = g_lCurrentTime;
 		}
 	}	
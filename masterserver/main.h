@@ -61,6 +61,22 @@ typedef int32_t __int32;
 // This is the maximum number of servers we can store in our list. Hopefully ST won't grow so big that this number can't hold them all!
 #define	MAX_SERVERS						512
 
+// [dorch] How long (in seconds) an IP has to wait before it gets the server list
+// again, and how many lists it can get in a row before it has to wait.
+#define	QUERY_IGNORE_TIME				10
+#define	QUERY_BURST						1
+
+// [dorch] The same for IPs that keep sending challenges while they're waiting.
+#define	SHORT_FLOOD_IGNORE_TIME			3
+#define	SHORT_FLOOD_BURST				1
+
+// [dorch] Threads that send server lists to launchers, unless -responders is given.
+#define	DEFAULT_NUM_RESPONDERS			2
+#define	MAX_NUM_RESPONDERS				64
+
+// [dorch] Launchers that can wait for a responder before new ones are ignored.
+#define	MAX_QUEUED_LAUNCHERS			4096
+
 //*****************************************************************************
 //	STRUCTURES
 
@@ -99,4 +115,23 @@ typedef struct
 
 } SERVER_s;
 
+//*****************************************************************************
+// [dorch] The server list as it's sent to launchers, already Huffman encoded.
+// It's rebuilt whenever a server is added or removed, and never changed after
+// that, so the responder threads can send it while the next one is built.
+struct SERVERLIST_s
+{
+	// Incremented every time the list is rebuilt.
+	unsigned int					ulVersion;
+
+	// The number of servers on the list.
+	unsigned int					ulNumServers;
+
+	// The answer to LAUNCHER_SERVER_CHALLENGE.
+	std::vector<BYTE>				FullList;
+
+	// The answer to LAUNCHER_MASTER_CHALLENGE.
+	std::vector<std::vector<BYTE> >	Parts;
+};
+
 #endif	// __MAIN_H__
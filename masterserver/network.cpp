@@ -85,6 +85,7 @@ static	UCHAR			g_ucHuffmanBuffer[131072];
 static	void			network_Error( const char *pszError );
 static	SOCKET			network_AllocateSocket( void );
 static	bool			network_BindSocketToPort( SOCKET Socket, ULONG ulInAddr, USHORT usPort, bool bReUse );
+static	void			network_SendTo( const BYTE *pbData, INT iNumBytes, const NETADDRESS_s &Address );
 
 //*****************************************************************************
 //	FUNCTIONS
@@ -274,7 +275,6 @@ NETADDRESS_s NETWORK_GetFromAddress( void )
 //
 void NETWORK_LaunchPacket( NETBUFFER_s *pBuffer, NETADDRESS_s Address )
 {
-	LONG				lNumBytes;
 	INT					iNumBytesOut = sizeof(g_ucHuffmanBuffer);
 
 	pBuffer->ulCurrentSize = pBuffer->CalcSize();
@@ -283,55 +283,39 @@ void NETWORK_LaunchPacket( NETBUFFER_s *pBuffer, NETADDRESS_s Address )
 	if ( pBuffer->ulCurrentSize == 0 )
 		return;
 
-	// Convert the IP address to a socket address.
-	struct sockaddr_in SocketAddress;
-	Address.ToSocketAddress( reinterpret_cast<sockaddr&>(SocketAddress) );
-
 	HUFFMAN_Encode( (unsigned char *)pBuffer->pbData, g_ucHuffmanBuffer, pBuffer->ulCurrentSize, &iNumBytesOut );
 
-	lNumBytes = sendto( g_NetworkSocket, (const char*)g_ucHuffmanBuffer, iNumBytesOut, 0, reinterpret_cast<sockaddr*>(&SocketAddress), sizeof( SocketAddress ));
-
-	// If sendto returns -1, there was an error.
-	if ( lNumBytes == -1 )
-	{
-#ifdef __WIN32__
-		INT	iError = WSAGetLastError( );
-
-		// Wouldblock is silent.
-		if ( iError == WSAEWOULDBLOCK )
-			return;
-
-		switch ( iError )
-		{
-		case WSAEACCES:
-
-			printf( "NETWORK_LaunchPacket: Error #%d, WSAEACCES: Permission denied for address: %s\n", iError, Address.ToString() );
-			return;
-		case WSAEADDRNOTAVAIL:
-
-			printf( "NETWORK_LaunchPacket: Error #%d, WSAEADDRENOTAVAIL: Address %s not available\n", iError, Address.ToString() );
-			return;
-		case WSAEHOSTUNREACH:
+	network_SendTo( g_ucHuffmanBuffer, iNumBytesOut, Address );
+}
 
-			printf( "NETWORK_LaunchPacket: Error #%d, WSAEHOSTUNREACH: Address %s unreachable\n", iError, Address.ToString() );
-			return;				
-		default:
+//*****************************************************************************
+//
+// [dorch] Huffman encodes a packet once, so that it can be sent to any number
+// of addresses with NETWORK_LaunchEncodedPacket.
+//
+void NETWORK_EncodePacket( NETBUFFER_s *pBuffer, std::vector<BYTE> &Packet )
+{
+	INT					iNumBytesOut = sizeof(g_ucHuffmanBuffer);
 
-			printf( "NETWORK_LaunchPacket: Error #%d\n", iError );
-			return;
-		}
-#else
-	if ( errno == EWOULDBLOCK )
-return;
+	pBuffer->ulCurrentSize = pBuffer->CalcSize();
+	Packet.clear();
 
-          if ( errno == ECONNREFUSED )
-              return;
+	if ( pBuffer->ulCurrentSize == 0 )
+		return;
 
-		printf( "NETWORK_LaunchPacket: %s\n", strerror( errno ));
-		printf( "NETWORK_LaunchPacket: Address %s\n", Address.ToString() );
+	HUFFMAN_Encode( (unsigned char *)pBuffer->pbData, g_ucHuffmanBuffer, pBuffer->ulCurrentSize, &iNumBytesOut );
+	Packet.assign( g_ucHuffmanBuffer, g_ucHuffmanBuffer + iNumBytesOut );
+}
 
-#endif
-	}
+//*****************************************************************************
+//
+// [dorch] Unlike NETWORK_LaunchPacket, this doesn't use any shared buffers, so
+// it can be called from several threads at once.
+//
+void NETWORK_LaunchEncodedPacket( const std::vector<BYTE> &Packet, const NETADDRESS_s &Address )
+{
+	if ( Packet.empty() == false )
+		network_SendTo( Packet.data(), static_cast<INT>( Packet.size() ), Address );
 }
 
 //*****************************************************************************
@@ -473,3 +457,65 @@ void I_DoSelect (void)
     stdin_ready = FD_ISSET(0, &fdset);
 #endif
 } 
+
+//*****************************************************************************
+//
+static void network_SendTo( const BYTE *pbData, INT iNumBytes, const NETADDRESS_s &Address )
+{
+	LONG				lNumBytes;
+
+	// Convert the IP address to a socket address.
+	struct sockaddr_in SocketAddress;
+	Address.ToSocketAddress( reinterpret_cast<sockaddr&>(SocketAddress) );
+
+	lNumBytes = sendto( g_NetworkSocket, (const char*)pbData, iNumBytes, 0, reinterpret_cast<sockaddr*>(&SocketAddress), sizeof( SocketAddress ));
+
+	// If sendto returns -1, there was an error.
+	if ( lNumBytes == -1 )
+	{
+		// [dorch] Responder threads send too, so don't use the static buffer
+		// of NETADDRESS_s::ToString.
+		char	szAddress[32];
+
+#ifdef __WIN32__
+		INT	iError = WSAGetLastError( );
+
+		// Wouldblock is silent.
+		if ( iError == WSAEWOULDBLOCK )
+			return;
+
+		sprintf( szAddress, "%i.%i.%i.%i:%i", Address.abIP[0], Address.abIP[1], Address.abIP[2], Address.abIP[3], ntohs( Address.usPort ));
+
+		switch ( iError )
+		{
+		case WSAEACCES:
+
+			printf( "NETWORK_LaunchPacket: Error #%d, WSAEACCES: Permission denied for address: %s\n", iError, szAddress );
+			return;
+		case WSAEADDRNOTAVAIL:
+
+			printf( "NETWORK_LaunchPacket: Error #%d, WSAEADDRENOTAVAIL: Address %s not available\n", iError, szAddress );
+			return;
+		case WSAEHOSTUNREACH:
+
+			printf( "NETWORK_LaunchPacket: Error #%d, WSAEHOSTUNREACH: Address %s unreachable\n", iError, szAddress );
+			return;				
+		default:
+
+			printf( "NETWORK_LaunchPacket: Error #%d\n", iError );
+			return;
+		}
+#else
+	if ( errno == EWOULDBLOCK )
+return;
+
+          if ( errno == ECONNREFUSED )
+              return;
+
+		printf( "NETWORK_LaunchPacket: %s\n", strerror( errno ));
+		sprintf( szAddress, "%i.%i.%i.%i:%i", Address.abIP[0], Address.abIP[1], Address.abIP[2], Address.abIP[3], ntohs( Address.usPort ));
+		printf( "NETWORK_LaunchPacket: Address %s\n", szAddress );
+
+#endif
+	}
+}
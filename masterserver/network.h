@@ -52,6 +52,7 @@
 #define __NETWORK_H__
 
 #include <stdio.h>
+#include <vector>
 //#include "c_cvars.h"
 //#include "d_player.h"
 //#include "i_net.h"
@@ -73,6 +74,8 @@ int				NETWORK_GetPackets( void );
 int				NETWORK_GetLANPackets( void );
 NETADDRESS_s	NETWORK_GetFromAddress( void );
 void			NETWORK_LaunchPacket( NETBUFFER_s *pBuffer, NETADDRESS_s Address );
+void			NETWORK_EncodePacket( NETBUFFER_s *pBuffer, std::vector<BYTE> &Packet );
+void			NETWORK_LaunchEncodedPacket( const std::vector<BYTE> &Packet, const NETADDRESS_s &Address );
 //AActor			*NETWORK_FindThingByNetID( LONG lID );
 NETADDRESS_s	NETWORK_GetLocalAddress( void );
 NETBUFFER_s		*NETWORK_GetNetworkMessageBuffer( void );
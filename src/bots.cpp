@@ -81,6 +81,7 @@
 #include "stats.h"
 #include "sv_commands.h"
 #include "sv_rcon.h"
+#include "sv_demo.h"
 #include "team.h"
 #include "vectors.h"
 #include "version.h"
@@ -569,6 +570,10 @@ ULONG BOTS_FindFreePlayerSlot( void )
 			continue;
 		}
 
+		// [dorch] The server's demo recorder is using this slot.
+		if ( SERVERDEMO_IsRecorderSlot( ulIdx ))
+			continue;
+
 		return ( ulIdx );
 	}
 
@@ -74,30 +74,44 @@
 #include "r_data/r_translate.h"
 #include "m_cheat.h"
 #include "network_enums.h"
+#include "farchive.h"
+#include "g_level.h"
+#include "team.h"
+#include "teaminfo.h"
 
 //*****************************************************************************
-enum 
+// [dorch] A point of the demo that playback can be restarted from. Keyframes
+// are either written into the demo while recording (and listed in the index
+// that follows CLD_DEMOEND), or taken in memory while playing the demo back.
+struct DemoKeyframe
 {
-	// [BC] Message headers with bytes starting with 0 and going sequentially
-	// isn't very distinguishing from other formats (such as normal ZDoom demos),
-	// but does that matter?
-	CLD_DEMOLENGTH = NUM_SERVER_COMMANDS,
-	CLD_DEMOVERSION,
-	CLD_CVARS,
-	CLD_USERINFO,
-	CLD_BODYSTART,
-	CLD_TICCMD,
-	CLD_LOCALCOMMAND, // [Dusk]
-	CLD_DEMOEND,
-	CLD_DEMOWADS, // [Dusk]
-
-	NUM_DEMO_COMMANDS
+	// How many tics had been played back when the keyframe was taken.
+	unsigned int	tic;
+
+	// Where the demo stream continues after the keyframe was restored.
+	LONG			lResumeOffset;
+
+	// Where the snapshot is stored in the demo buffer, or -1 if it's not stored in the demo.
+	LONG			lSnapshotOffset;
+
+	// The snapshot taken during playback, if it's not stored in the demo.
+	// Both are in the format FCompressedMemFile::Open( void * ) expects.
+	BYTE			*pbSnapshot;
 };
 
 //*****************************************************************************
 //	PROTOTYPES
 
 static	void				clientdemo_CheckDemoBuffer( ULONG ulSize );
+static	void				clientdemo_SerializeKeyframe( FArchive &arc );
+static	void				clientdemo_WriteKeyframe( void );
+static	void				clientdemo_CaptureKeyframe( void );
+static	void				clientdemo_RestoreKeyframe( const DemoKeyframe &keyframe );
+static	void				clientdemo_ReadKeyframeIndex( LONG lIndexOffset );
+static	void				clientdemo_ClearKeyframes( void );
+static	int					clientdemo_FindKeyframe( unsigned int tic );
+static	bool				clientdemo_IsKeyframeDue( unsigned int tic );
+static	bool				clientdemo_FinishTiccmd( void );
 
 //*****************************************************************************
 //	VARIABLES
@@ -150,6 +164,23 @@ static	const DWORD			g_demoSignature = MAKE_ID( 'Z', 'C', 'L', 'D' );
 
 static	unsigned int		g_TicsPlayedBack = 0;
 
+// [dorch] Known keyframes of the current demo, sorted by tic.
+static	TArray<DemoKeyframe>	g_Keyframes;
+
+// [dorch] Index into g_Keyframes of the keyframe to restore at the start of the next tic, or -1.
+static	int					g_PendingKeyframe = -1;
+
+// [dorch] How many tics we have recorded so far, and where the header expects the keyframe index.
+static	unsigned int		g_TicsRecorded = 0;
+static	LONG				g_lKeyframeIndexHeaderOffset = 0;
+
+// [dorch] How many seconds apart demo keyframes are taken. 0 disables keyframes.
+CUSTOM_CVAR( Int, demo_keyframeinterval, 15, CVAR_ARCHIVE | CVAR_GLOBALCONFIG )
+{
+	if ( self < 0 )
+		self = 0;
+}
+
 // [Dusk] Should we perform demo authentication?
 CUSTOM_CVAR( Bool, demo_pure, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG )
 {
@@ -182,38 +213,15 @@ void CLIENTDEMO_BeginRecording( const char *pszDemoName )
 	g_ByteStream.pbStreamEnd = g_pbDemoBuffer + g_lMaxDemoLength;
 
 	// Write our header.
-	// [Dusk] Write a static "ZCLD" which is consistent between
-	// different Zandronum versions.
-	g_ByteStream.WriteLong( g_demoSignature );
+	CLIENTDEMO_WriteHeader( &g_ByteStream );
 
-	// Write the length of the demo. Of course, we can't complete this quite yet!
-	g_ByteStream.WriteByte( CLD_DEMOLENGTH );
-	g_ByteStream.pbStream += 4;
-
-	// Write version information helpful for this demo.
-	g_ByteStream.WriteByte( CLD_DEMOVERSION );
-	g_ByteStream.WriteShort( DEMOGAMEVERSION );
-	g_ByteStream.WriteString( GetVersionStringRev() );
-	g_ByteStream.WriteByte( BUILD_ID );
-	g_ByteStream.WriteLong( rngseed );
-
-	// [Dusk] Write the amount of WADs and their names, incl. IWAD
-	g_ByteStream.WriteByte( CLD_DEMOWADS );
-	ULONG ulWADCount = 1 + NETWORK_GetPWADList().Size( ); // 1 for IWAD
-	g_ByteStream.WriteShort( ulWADCount );
-	g_ByteStream.WriteString( NETWORK_GetIWAD ( ) );
-
-	for ( unsigned int i = 0; i < NETWORK_GetPWADList().Size(); ++i )
-		g_ByteStream.WriteString( NETWORK_GetPWADList()[i].name );
-
-	// [Dusk] Write the network authentication string, we need it to
-	// ensure we have the right WADs loaded.
-	g_ByteStream.WriteString( g_lumpsAuthenticationChecksum.GetChars( ) );
-
-	// [Dusk] Also generate and write the map collection checksum so we can
-	// authenticate the maps.
-	NETWORK_MakeMapCollectionChecksum( );
-	g_ByteStream.WriteString( g_MapCollectionChecksum.GetChars( ) );
+	// [dorch] Where the keyframe index starts. Just like the length of the demo,
+	// we can only fill this in once we're done recording.
+	g_ByteStream.WriteByte( CLD_KEYFRAMEINDEX );
+	g_lKeyframeIndexHeaderOffset = g_ByteStream.pbStream - g_pbDemoBuffer;
+	g_ByteStream.WriteLong( 0 );
+	g_TicsRecorded = 0;
+	clientdemo_ClearKeyframes( );
 
 /*
 	// Write cvars chunk.
@@ -235,6 +243,47 @@ void CLIENTDEMO_BeginRecording( const char *pszDemoName )
 	CLIENTDEMO_WriteConsolePlayerUnrestricted( cl_spectatormode == SPECMODE_NO_RESTRICTIONS );
 }
 
+//*****************************************************************************
+//
+// [dorch] Writes the part of the header that doesn't depend on who is recording,
+// so that the server can record demos, too.
+//
+void CLIENTDEMO_WriteHeader( BYTESTREAM_s *pByteStream )
+{
+	// [Dusk] Write a static "ZCLD" which is consistent between
+	// different Zandronum versions.
+	pByteStream->WriteLong( g_demoSignature );
+
+	// Write the length of the demo. Of course, we can't complete this quite yet!
+	pByteStream->WriteByte( CLD_DEMOLENGTH );
+	pByteStream->WriteLong( 0 );
+
+	// Write version information helpful for this demo.
+	pByteStream->WriteByte( CLD_DEMOVERSION );
+	pByteStream->WriteShort( DEMOGAMEVERSION );
+	pByteStream->WriteString( GetVersionStringRev() );
+	pByteStream->WriteByte( BUILD_ID );
+	pByteStream->WriteLong( rngseed );
+
+	// [Dusk] Write the amount of WADs and their names, incl. IWAD
+	pByteStream->WriteByte( CLD_DEMOWADS );
+	ULONG ulWADCount = 1 + NETWORK_GetPWADList().Size( ); // 1 for IWAD
+	pByteStream->WriteShort( ulWADCount );
+	pByteStream->WriteString( NETWORK_GetIWAD ( ) );
+
+	for ( unsigned int i = 0; i < NETWORK_GetPWADList().Size(); ++i )
+		pByteStream->WriteString( NETWORK_GetPWADList()[i].name );
+
+	// [Dusk] Write the network authentication string, we need it to
+	// ensure we have the right WADs loaded.
+	pByteStream->WriteString( g_lumpsAuthenticationChecksum.GetChars( ) );
+
+	// [Dusk] Also generate and write the map collection checksum so we can
+	// authenticate the maps.
+	NETWORK_MakeMapCollectionChecksum( );
+	pByteStream->WriteString( g_MapCollectionChecksum.GetChars( ) );
+}
+
 //*****************************************************************************
 //
 bool CLIENTDEMO_ProcessDemoHeader( void )
@@ -326,6 +375,19 @@ bool CLIENTDEMO_ProcessDemoHeader( void )
 			CLIENTDEMO_ReadDemoWads( );
 			break;
 
+		// [dorch]
+		case CLD_KEYFRAMEINDEX:
+			{
+				const LONG lIndexOffset = g_ByteStream.ReadLong();
+				if ( lIndexOffset > 0 )
+				{
+					BYTE *pbHeaderPosition = g_ByteStream.pbStream;
+					clientdemo_ReadKeyframeIndex( lIndexOffset );
+					g_ByteStream.pbStream = pbHeaderPosition;
+				}
+			}
+			break;
+
 		// [Dusk] Bad headers shouldn't just be ignored, that's just asking for trouble.
 		default:
 			I_Error( "Unknown demo header %ld!\n", lCommand );
@@ -421,6 +483,10 @@ void CLIENTDEMO_WriteTiccmd( ticcmd_t *pCmd )
 	g_ByteStream.WriteShort( pCmd->ucmd.upmove );
 	g_ByteStream.WriteShort( pCmd->ucmd.forwardmove );
 	g_ByteStream.WriteShort( pCmd->ucmd.sidemove );
+
+	// [dorch] Keyframes always directly follow the ticcmd of the tic they were taken on.
+	if ( clientdemo_IsKeyframeDue( ++g_TicsRecorded ))
+		clientdemo_WriteKeyframe( );
 }
 
 //*****************************************************************************
@@ -477,6 +543,15 @@ void CLIENTDEMO_InsertPacketAtMarkedPosition( BYTESTREAM_s *pByteStream )
 		stream.pbStreamEnd = copyBuffer + bytesToCopy;
 		CLIENTDEMO_WritePacket( &stream );
 
+		// [dorch] Keyframes behind the marked position were moved, too.
+		const LONG lMarkedOffset = g_pbMarkedStreamPosition - g_pbDemoBuffer;
+		const LONG lPacketSize = pByteStream->pbStreamEnd - pByteStream->pbStream;
+		for ( unsigned int i = 0; i < g_Keyframes.Size( ); ++i )
+		{
+			if ( g_Keyframes[i].lSnapshotOffset >= lMarkedOffset )
+				g_Keyframes[i].lSnapshotOffset += lPacketSize;
+		}
+
 		delete[] copyBuffer;
 	}
 	else
@@ -497,6 +572,18 @@ void CLIENTDEMO_ReadPacket( void )
 	LONG		lCommand;
 	const char	*pszString;
 
+	// [dorch] If we're seeking, restore the keyframe now. This puts us right
+	// after the ticcmd of the keyframe's tic.
+	if ( g_PendingKeyframe >= 0 )
+	{
+		const int keyframe = g_PendingKeyframe;
+		g_PendingKeyframe = -1;
+		clientdemo_RestoreKeyframe( g_Keyframes[keyframe] );
+
+		if ( clientdemo_FinishTiccmd( ))
+			return;
+	}
+
 	while ( 1 )
 	{  
 		lCommand = g_ByteStream.ReadByte();
@@ -524,20 +611,26 @@ void CLIENTDEMO_ReadPacket( void )
 			CLIENTDEMO_ReadTiccmd( &players[consoleplayer].cmd );
 			++g_TicsPlayedBack;
 
+			// [dorch] Remember this point so that we can come back to it later.
+			if ( clientdemo_IsKeyframeDue( g_TicsPlayedBack ))
+				clientdemo_CaptureKeyframe( );
+
 			// After we write our ticcmd, we're done for this tic.
-			if ( CLIENTDEMO_IsSkipping() == false )
+			if ( clientdemo_FinishTiccmd( ))
 				return;
-			// [BB] If we don't return here, we essentially skip a tic and have to adjust the tic offset.
-			else
+			break;
+		case CLD_KEYFRAME:
+
+			// [dorch] Keyframes are only needed when seeking, skip over them.
+			g_ByteStream.ReadLong();
 			{
-				g_lGameticOffset--;
-				// [BB] If we are supposed to skip over a certain amount of tics, record that we have skipped one now.
-				if ( g_ulTicsToSkip > 0 )
+				const LONG lSize = g_ByteStream.ReadLong();
+				if (( lSize < 0 ) || ( lSize > g_ByteStream.pbStreamEnd - g_ByteStream.pbStream ))
 				{
-					// [BB] When skipping a tic, we still need to process the current ticcmd_t.
-					P_Ticker ();
-					--g_ulTicsToSkip;
+					CLIENTDEMO_FinishPlaying( );
+					return;
 				}
+				g_ByteStream.pbStream += lSize;
 			}
 			break;
 		case CLD_LOCALCOMMAND:
@@ -646,14 +739,30 @@ void CLIENTDEMO_FinishRecording( void )
 	BYTESTREAM_s	ByteStream;
 
 	// Write our header.
+	clientdemo_CheckDemoBuffer( 5 + 8 * g_Keyframes.Size( ));
 	g_ByteStream.WriteByte( CLD_DEMOEND );
 
+	// [dorch] Append the keyframe index after the end of the demo, so that
+	// playback can find the keyframes without parsing the whole demo.
+	const LONG lIndexOffset = g_ByteStream.pbStream - g_pbDemoBuffer;
+	g_ByteStream.WriteLong( g_Keyframes.Size( ));
+	for ( unsigned int i = 0; i < g_Keyframes.Size( ); ++i )
+	{
+		g_ByteStream.WriteLong( g_Keyframes[i].tic );
+		g_ByteStream.WriteLong( g_Keyframes[i].lSnapshotOffset );
+	}
+
 	// Go back real quick and write the length of this demo.
 	lDemoLength = g_ByteStream.pbStream - g_pbDemoBuffer;
 	ByteStream.pbStream = g_pbDemoBuffer + 5;
 	ByteStream.pbStreamEnd = g_ByteStream.pbStreamEnd;
 	ByteStream.WriteLong( lDemoLength );
 
+	// [dorch] Also fill in where the keyframe index is.
+	ByteStream.pbStream = g_pbDemoBuffer + g_lKeyframeIndexHeaderOffset;
+	ByteStream.WriteLong( lIndexOffset );
+	clientdemo_ClearKeyframes( );
+
 	// Write the contents of the buffer to the file, and free the memory we
 	// allocated for the demo.
 	M_WriteFile( g_DemoName.GetChars(), g_pbDemoBuffer, lDemoLength ); 
@@ -695,6 +804,7 @@ void CLIENTDEMO_DoPlayDemo( const char *pszDemoName )
 	g_ByteStream.pbStream = g_pbDemoBuffer;
 	g_ByteStream.pbStreamEnd = g_pbDemoBuffer + lDemoLength;
 	g_TicsPlayedBack = 0;
+	clientdemo_ClearKeyframes( );
 
 	if ( CLIENTDEMO_ProcessDemoHeader( ))
 	{
@@ -721,6 +831,7 @@ void CLIENTDEMO_FinishPlaying( void )
 	// Free our demo buffer.
 	delete[] ( g_pbDemoBuffer );
 	g_pbDemoBuffer = NULL;
+	clientdemo_ClearKeyframes( );
 
 	// We're no longer playing a demo.
 	g_bDemoPlaying = false;
@@ -1080,9 +1191,11 @@ static void clientdemo_CheckDemoBuffer( ULONG ulSize )
 	// We may need to allocate more memory for our demo buffer.
 	if (( g_ByteStream.pbStream + ulSize ) > g_ByteStream.pbStreamEnd )
 	{
-		// Give us another 128KB of memory.
-		g_lMaxDemoLength += 0x20000;
+		// Give us another 128KB of memory. [dorch] Keyframes may need even more than that.
 		lPosition = g_ByteStream.pbStream - g_pbDemoBuffer;
+		do
+			g_lMaxDemoLength += 0x20000;
+		while ( lPosition + static_cast<LONG>( ulSize ) > g_lMaxDemoLength );
 		// [BB] Convert our marked position to an offset.
 		const LONG markedOffset = g_pbMarkedStreamPosition - g_pbDemoBuffer;
 		g_pbDemoBuffer = (BYTE *)M_Realloc( g_pbDemoBuffer, g_lMaxDemoLength );
@@ -1093,6 +1206,293 @@ static void clientdemo_CheckDemoBuffer( ULONG ulSize )
 	}
 }
 
+//*****************************************************************************
+//
+// [dorch] Stores or restores everything needed to continue the demo from the
+// current tic: the map, the level with all its actors and players (keeping
+// their NetIDs and slots) and the game state the server keeps us informed of.
+//
+static void clientdemo_SerializeKeyframe( FArchive &arc )
+{
+	FString mapName = level.mapname;
+	SDWORD playerIndex = consoleplayer;
+	SDWORD demoGametic = gametic - g_lGameticOffset;
+	DWORD lastServerTick = CLIENT_GetLastServerTick( );
+	SDWORD levelTime = level.time;
+
+	arc << mapName << playerIndex << demoGametic << lastServerTick << levelTime;
+
+	if ( arc.IsLoading( ))
+	{
+		// The keyframe may be on a different map than the one we're on.
+		if (( gamestate != GS_LEVEL ) || ( mapName.CompareNoCase( level.mapname ) != 0 ))
+			G_InitNew( mapName, false );
+
+		consoleplayer = playerIndex;
+		g_lGameticOffset = gametic - demoGametic;
+		CLIENT_SetLastServerTick( lastServerTick );
+		level.time = levelTime;
+	}
+
+	for ( unsigned int i = 0; i < teams.Size( ); ++i )
+	{
+		SDWORD counts[4] = { static_cast<SDWORD>( TEAM_GetFragCount( i )), static_cast<SDWORD>( TEAM_GetDeathCount( i )),
+			static_cast<SDWORD>( TEAM_GetWinCount( i )), static_cast<SDWORD>( TEAM_GetPointCount( i )) };
+		arc << counts[0] << counts[1] << counts[2] << counts[3];
+
+		if ( arc.IsLoading( ))
+		{
+			TEAM_SetFragCount( i, counts[0], false );
+			TEAM_SetDeathCount( i, counts[1] );
+			TEAM_SetWinCount( i, counts[2], false );
+			TEAM_SetPointCount( i, counts[3], false, false );
+		}
+	}
+
+	SaveVersion = SAVEVER;
+	G_SerializeLevel( arc, false );
+}
+
+//*****************************************************************************
+//
+// [dorch] Takes a snapshot of the current tic and returns it in the format
+// FCompressedMemFile::Open( void * ) expects. The caller owns the result.
+//
+static BYTE *clientdemo_TakeSnapshot( unsigned int &size )
+{
+	// The free spectator isn't one of the real players. Since it isn't part of
+	// the demo, we just respawn it after a keyframe is restored.
+	APlayerPawn *pFreeSpectator = g_demoCameraPlayer.mo;
+	if ( pFreeSpectator != NULL )
+		pFreeSpectator->player = NULL;
+
+	FCompressedMemFile snapshot;
+	snapshot.Open( );
+	{
+		FArchive arc( snapshot );
+		arc.SetDemoKeyframe( );
+		clientdemo_SerializeKeyframe( arc );
+	}
+
+	if ( pFreeSpectator != NULL )
+		pFreeSpectator->player = &g_demoCameraPlayer;
+
+	unsigned int compressedSize, uncompressedSize;
+	snapshot.GetSizes( compressedSize, uncompressedSize );
+	size = ( compressedSize ? compressedSize : uncompressedSize ) + 8;
+
+	BYTE *pbSnapshot = new BYTE[size];
+	memcpy( pbSnapshot, snapshot.GetImplodedBuffer( ), size );
+	return ( pbSnapshot );
+}
+
+//*****************************************************************************
+//
+// [dorch] Writes a keyframe of the current tic into the demo we're recording.
+//
+static void clientdemo_WriteKeyframe( void )
+{
+	unsigned int size;
+	BYTE *pbSnapshot = clientdemo_TakeSnapshot( size );
+
+	clientdemo_CheckDemoBuffer( 9 + size );
+	g_ByteStream.WriteByte( CLD_KEYFRAME );
+	g_ByteStream.WriteLong( g_TicsRecorded );
+	g_ByteStream.WriteLong( size );
+
+	DemoKeyframe keyframe;
+	keyframe.tic = g_TicsRecorded;
+	keyframe.lSnapshotOffset = g_ByteStream.pbStream - g_pbDemoBuffer;
+	keyframe.lResumeOffset = keyframe.lSnapshotOffset + size;
+	keyframe.pbSnapshot = NULL;
+	g_Keyframes.Push( keyframe );
+
+	g_ByteStream.WriteBuffer( pbSnapshot, size );
+	delete[] pbSnapshot;
+}
+
+//*****************************************************************************
+//
+// [dorch] Remembers the current tic of the demo we're playing, so that we can
+// rewind to it later.
+//
+static void clientdemo_CaptureKeyframe( void )
+{
+	DemoKeyframe keyframe;
+	unsigned int size;
+
+	keyframe.tic = g_TicsPlayedBack;
+	keyframe.lResumeOffset = g_ByteStream.pbStream - g_pbDemoBuffer;
+	keyframe.lSnapshotOffset = -1;
+	keyframe.pbSnapshot = clientdemo_TakeSnapshot( size );
+
+	// Keep the keyframes sorted. We usually capture them at the end.
+	unsigned int index = g_Keyframes.Size( );
+	while (( index > 0 ) && ( g_Keyframes[index - 1].tic > keyframe.tic ))
+		--index;
+	g_Keyframes.Insert( index, keyframe );
+}
+
+//*****************************************************************************
+//
+static void clientdemo_RestoreKeyframe( const DemoKeyframe &keyframe )
+{
+	const bool bFreeSpectating = CLIENTDEMO_IsInFreeSpectateMode( );
+	CLIENTDEMO_ClearFreeSpectatorPlayer( );
+
+	BYTE *pbSnapshot = ( keyframe.pbSnapshot != NULL ) ? keyframe.pbSnapshot : ( g_pbDemoBuffer + keyframe.lSnapshotOffset );
+	FCompressedMemFile snapshot;
+	snapshot.Open( pbSnapshot );
+	{
+		FArchive arc( snapshot );
+		arc.SetDemoKeyframe( );
+		clientdemo_SerializeKeyframe( arc );
+	}
+
+	// [BB] Make sure that the NetID list is valid.
+	g_ActorNetIDList.rebuild( );
+
+	// Just like G_UnSnapshotLevel, get rid of the bodies nobody is using anymore.
+	TThinkerIterator<APlayerPawn> it;
+	APlayerPawn *pawn, *next;
+
+	next = it.Next( );
+	while (( pawn = next ) != NULL )
+	{
+		next = it.Next( );
+		if (( pawn->player == NULL ) || ( pawn->player->mo == NULL ) || ( playeringame[pawn->player - players] == false ))
+		{
+			int i;
+
+			for ( i = 0; i < MAXPLAYERS; ++i )
+			{
+				if ( playeringame[i] && players[i].morphTics && ( players[i].mo->tracer == pawn ))
+					break;
+			}
+			if ( i == MAXPLAYERS )
+				pawn->Destroy( );
+		}
+	}
+
+	if ( StatusBar )
+		StatusBar->AttachToPlayer( &players[consoleplayer] );
+
+	// The ticcmd isn't part of the snapshot, read it again. It's right before
+	// the keyframe in the demo, or where we resume if we took the keyframe.
+	if ( keyframe.pbSnapshot != NULL )
+		g_ByteStream.pbStream = g_pbDemoBuffer + keyframe.lResumeOffset - 13;
+	else
+		g_ByteStream.pbStream = g_pbDemoBuffer + keyframe.lSnapshotOffset - 9 - 13;
+	CLIENTDEMO_ReadTiccmd( &players[consoleplayer].cmd );
+
+	g_ByteStream.pbStream = g_pbDemoBuffer + keyframe.lResumeOffset;
+	g_TicsPlayedBack = keyframe.tic;
+	CLIENT_SetServerLagging( false );
+
+	if ( bFreeSpectating )
+	{
+		CLIENTDEMO_SpawnFreeSpectatorPlayer( );
+		players[consoleplayer].camera = g_demoCameraPlayer.mo;
+	}
+}
+
+//*****************************************************************************
+//
+// [dorch] Reads the keyframe index that was appended to the demo.
+//
+static void clientdemo_ReadKeyframeIndex( LONG lIndexOffset )
+{
+	const LONG lDemoLength = g_ByteStream.pbStreamEnd - g_pbDemoBuffer;
+	if (( lIndexOffset < 0 ) || ( lIndexOffset + 4 > lDemoLength ))
+		return;
+
+	g_ByteStream.pbStream = g_pbDemoBuffer + lIndexOffset;
+	const LONG lNumKeyframes = g_ByteStream.ReadLong( );
+	if (( lNumKeyframes < 0 ) || ( lNumKeyframes > ( lDemoLength - lIndexOffset - 4 ) / 8 ))
+		return;
+
+	for ( LONG i = 0; i < lNumKeyframes; ++i )
+	{
+		DemoKeyframe keyframe;
+		keyframe.tic = g_ByteStream.ReadLong( );
+		keyframe.lSnapshotOffset = g_ByteStream.ReadLong( );
+		keyframe.pbSnapshot = NULL;
+
+		// The size of the snapshot directly precedes the snapshot itself.
+		if (( keyframe.lSnapshotOffset < 9 + 14 ) || ( keyframe.lSnapshotOffset > lIndexOffset ))
+			continue;
+
+		BYTESTREAM_s sizeStream;
+		sizeStream.pbStream = g_pbDemoBuffer + keyframe.lSnapshotOffset - 4;
+		sizeStream.pbStreamEnd = g_pbDemoBuffer + keyframe.lSnapshotOffset;
+		const LONG lSize = sizeStream.ReadLong( );
+		if (( lSize <= 8 ) || ( lSize > lIndexOffset - keyframe.lSnapshotOffset ))
+			continue;
+
+		keyframe.lResumeOffset = keyframe.lSnapshotOffset + lSize;
+		if (( g_Keyframes.Size( ) == 0 ) || ( g_Keyframes.Last( ).tic < keyframe.tic ))
+			g_Keyframes.Push( keyframe );
+	}
+}
+
+//*****************************************************************************
+//
+static void clientdemo_ClearKeyframes( void )
+{
+	for ( unsigned int i = 0; i < g_Keyframes.Size( ); ++i )
+		delete[] g_Keyframes[i].pbSnapshot;
+
+	g_Keyframes.Clear( );
+	g_PendingKeyframe = -1;
+}
+
+//*****************************************************************************
+//
+// [dorch] Returns the index of the last keyframe at or before the given tic, or -1.
+//
+static int clientdemo_FindKeyframe( unsigned int tic )
+{
+	int index = -1;
+
+	for ( unsigned int i = 0; ( i < g_Keyframes.Size( )) && ( g_Keyframes[i].tic <= tic ); ++i )
+		index = i;
+
+	return ( index );
+}
+
+//*****************************************************************************
+//
+static bool clientdemo_IsKeyframeDue( unsigned int tic )
+{
+	if (( demo_keyframeinterval <= 0 ) || ( gamestate != GS_LEVEL ) || ( CLIENT_GetConnectionState( ) != CTS_ACTIVE ))
+		return ( false );
+
+	const int index = clientdemo_FindKeyframe( tic );
+	return (( index < 0 ) || ( tic >= g_Keyframes[index].tic + demo_keyframeinterval * TICRATE ));
+}
+
+//*****************************************************************************
+//
+// [dorch] Called after the ticcmd of a tic was read. Returns whether we're done
+// with the current tic.
+//
+static bool clientdemo_FinishTiccmd( void )
+{
+	if ( CLIENTDEMO_IsSkipping() == false )
+		return ( true );
+
+	// [BB] If we don't return here, we essentially skip a tic and have to adjust the tic offset.
+	g_lGameticOffset--;
+	// [BB] If we are supposed to skip over a certain amount of tics, record that we have skipped one now.
+	if ( g_ulTicsToSkip > 0 )
+	{
+		// [BB] When skipping a tic, we still need to process the current ticcmd_t.
+		P_Ticker ();
+		--g_ulTicsToSkip;
+	}
+	return ( false );
+}
+
 //*****************************************************************************
 //	CONSOLE COMMANDS
 
@@ -1153,13 +1553,22 @@ CCMD( demo_skipto )
 		if ( ticPositionSigned >= 0 )
 		{
 			const unsigned int ticPosition = static_cast<unsigned int>( ticPositionSigned );
-			if ( ticPosition >= g_TicsPlayedBack )
+			const int keyframe = clientdemo_FindKeyframe( ticPosition );
+
+			// [dorch] Jump to the closest keyframe if that gets us there faster.
+			if (( keyframe >= 0 ) && (( ticPosition < g_TicsPlayedBack ) || ( g_Keyframes[keyframe].tic > g_TicsPlayedBack )))
+			{
+				g_PendingKeyframe = keyframe;
+				g_ulTicsToSkip = ticPosition - g_Keyframes[keyframe].tic;
+			}
+			else if ( ticPosition >= g_TicsPlayedBack )
 			{
+				g_PendingKeyframe = -1;
 				g_ulTicsToSkip = ticPosition - g_TicsPlayedBack;
 			}
 			else
 			{
-				Printf( "That position is in the past. You cannot rewind demos.\n" );
+				Printf( "That position is in the past and there is no keyframe before it to rewind to.\n" );
 			}
 		}
 		else
@@ -1181,6 +1590,21 @@ CCMD( demo_ticsplayed )
 	Printf( "Use 'demo_skipto %u' to skip to this point when playing back another time.\n", g_TicsPlayedBack );
 }
 
+// [dorch] Lists the keyframes demo_skipto can jump to.
+CCMD( demo_keyframes )
+{
+	// This command shouldn't do anything if a demo isn't playing.
+	if ( CLIENTDEMO_IsPlaying( ) == false )
+		return;
+
+	for ( unsigned int i = 0; i < g_Keyframes.Size( ); ++i )
+	{
+		const unsigned int tic = g_Keyframes[i].tic;
+		Printf( "%u (%02u:%02u)%s\n", tic, ( tic / TICRATE ) / 60, ( tic / TICRATE ) % 60, ( g_Keyframes[i].pbSnapshot != NULL ) ? " [playback]" : "" );
+	}
+	Printf( "%u keyframes.\n", g_Keyframes.Size( ));
+}
+
 CCMD( demo_spectatefreely )
 {
 	// [Spleen] This command shouldn't do anything if a demo isn't playing.
@@ -51,8 +51,12 @@
 #include "networkheaders.h"
 
 #ifdef DORCH_SPECTATOR
+#include <atomic>
 #include <errno.h>
+#include <random>
 #include <string.h>
+#include <thread>
+#include <vector>
 #endif
 
 // [AK] Including "networkheaders.h" in Windows also includes <wingdi.h> which
@@ -87,6 +91,7 @@
 #include "st_stuff.h"
 #include "m_argv.h"
 #include "m_cheat.h"
+#include "m_misc.h"
 #include "cl_main.h"
 #include "p_effect.h"
 #include "p_lnspec.h"
@@ -139,6 +144,7 @@
 #include "voicechat.h"
 #include "gameconfigfile.h"
 #include "wi_stuff.h"
+#include "profiler.h"
 
 #ifdef DORCH_SPECTATOR
 #include "p_trace.h"
@@ -659,8 +665,7 @@ void CLIENT_Destruct( void )
 static bool g_bDorchSpectatorInitialized = false;
 static int g_iDorchSpectatorNextCycleTic = 0;
 static int g_iDorchSpectatorPendingShotTic = -1;
-static char g_szDorchSpectatorShotPathFinal[] = "/screenshot.png";
-static char g_szDorchSpectatorShotPathTmp[] = "/screenshot.png.tmp";
+static char g_szDorchSpectatorShotPath[] = "/screenshot.png";
 
 // [dorch] When one or more players are present, cycle the spy target periodically.
 static int g_iDorchSpectatorNextSpySwitchTic = 0;
@@ -686,6 +691,16 @@ static fixed_t g_DorchSpectatorLastRoamZ = 0;
 // Clustering:
 // - 2D k-means on (x, y) fixed_t coordinates.
 // - K is chosen in [min(n, 8), min(n, 16)] when n>=8, else K=n.
+// - K-means runs on a worker thread so a map change doesn't stall the stream.
+//   The resulting centers are cached on disk by map checksum, and later visits
+//   to the same map only assign points to the cached centers.
+//
+// Updates:
+// - Points remember the NetID of their actor. Every roam step, dead monsters and
+//   picked up items are dropped from the zone scores and moved actors are
+//   followed, so zones that have been cleared out stop being picked.
+// - Camera heights are clamped into the sector's floor/ceiling when a point is
+//   collected, so teleports rarely fail.
 //
 // Selection rules:
 // - Prefer a zone that is not the same (or adjacent) to the last zone.
@@ -699,7 +714,15 @@ struct DorchRoamPoint
 	fixed_t x;
 	fixed_t y;
 	fixed_t z;
-	int interestWeight; // 1 for item, 2 for monster
+	int interestWeight; // 1 for item, 2 for monster, 0 once gone
+	unsigned short netID; // 0 if the actor can't be tracked
+	bool isMonster;
+};
+
+struct DorchRoamCenter
+{
+	fixed_t x;
+	fixed_t y;
 };
 
 struct DorchRoamZone
@@ -719,28 +742,33 @@ static int g_iDorchRecentRoamZones[4] = { -1, -1, -1, -1 };
 static int g_iDorchRecentRoamZonesPos = 0;
 static char g_szDorchLastRoamMapName[9] = { 0 };
 
+// Zone centers of the current map, kept so that points can be reassigned when
+// they are recollected.
+static TArray<DorchRoamCenter> g_DorchRoamCenters;
+
+// K-means worker. While g_bDorchRoamZonesPending is set, the job variables belong
+// to the worker thread, which sets g_bDorchRoamJobDone when it's finished.
+// The worker only uses std::vector, since TArray's M_Malloc isn't thread safe.
+static std::thread g_DorchRoamZoneThread;
+static std::atomic<bool> g_bDorchRoamJobDone( false );
+static bool g_bDorchRoamZonesPending = false;
+static bool g_bDorchRoamZoneShutdownRegistered = false;
+static TArray<DorchRoamPoint> g_DorchRoamJobPoints;
+static std::vector<DorchRoamCenter> g_DorchRoamJobCenters;
+static unsigned int g_DorchRoamJobSeed = 0;
+static FString g_DorchRoamJobCachePath;
+
+// Where the centers of the current map are cached.
+static FString g_DorchRoamCachePath;
+
 static void DORCH_WriteSpectatorScreenshot( void )
 {
-	// Write to a temp path first, then atomically move into place so external
+	// The frame is copied here and encoded on a background thread, which writes
+	// to a temp path first and then atomically moves it into place, so external
 	// readers never observe a partially-written PNG.
-	fprintf( stderr, "[dorch] writing screenshot to %s\n", g_szDorchSpectatorShotPathTmp );
-	G_ScreenShot( g_szDorchSpectatorShotPathTmp );
-
-	// POSIX rename() is atomic and replaces the destination if it exists.
-	if ( rename( g_szDorchSpectatorShotPathTmp, g_szDorchSpectatorShotPathFinal ) == -1 )
-	{
-		#ifdef _WIN32
-		// Windows rename() fails if destination exists; remove then retry.
-		remove( g_szDorchSpectatorShotPathFinal );
-		if ( rename( g_szDorchSpectatorShotPathTmp, g_szDorchSpectatorShotPathFinal ) == 0 )
-			return;
-		#endif
-		
-		fprintf( stderr, "[dorch] failed to move screenshot into place (%s -> %s): %s\n",
-			g_szDorchSpectatorShotPathTmp,
-			g_szDorchSpectatorShotPathFinal,
-			strerror( errno ) );
-	}
+	fprintf( stderr, "[dorch] writing screenshot to %s\n", g_szDorchSpectatorShotPath );
+	if ( M_ScreenShotAsync( g_szDorchSpectatorShotPath ) == false )
+		fprintf( stderr, "[dorch] screenshot skipped\n" );
 }
 
 static bool DORCH_HasAnyNonSpectatorPlayers( void )
@@ -826,11 +854,23 @@ static void DORCH_AimRoamCameraTowardOpenSpace( AActor *camera )
 	camera->pitch = 0;
 }
 
+static void DORCH_FinishRoamZoneWorker( void )
+{
+	// K-means on a few hundred points is quick, so this only waits briefly if
+	// the map changed while the worker was still busy.
+	if ( g_DorchRoamZoneThread.joinable( ))
+		g_DorchRoamZoneThread.join( );
+}
+
 static void DORCH_ResetRoamZones( void )
 {
+	DORCH_FinishRoamZoneWorker( );
+	g_bDorchRoamZonesPending = false;
 	g_bDorchRoamZonesReady = false;
 	g_DorchRoamPoints.Clear( );
 	g_DorchRoamZones.Clear( );
+	g_DorchRoamCenters.Clear( );
+	g_DorchRoamCachePath = "";
 	g_iDorchLastRoamZone = -1;
 	for ( int i = 0; i < 4; ++i )
 		g_iDorchRecentRoamZones[i] = -1;
@@ -973,57 +1013,83 @@ static int DORCH_ChooseKForZones( const int numPoints )
 	return k;
 }
 
-static void DORCH_BuildRoamZones_KMeans( void )
+static bool DORCH_IsRoamInterest( AActor *actor, bool &isMonster )
 {
-	// Collect points of interest from the current map.
-	g_DorchRoamPoints.Clear( );
-	g_DorchRoamZones.Clear( );
+	if ( actor->ObjectFlags & OF_EuthanizeMe )
+		return false;
+	if ( actor->player != NULL )
+		return false;
+
+	const bool isItem = actor->IsKindOf( RUNTIME_CLASS( AInventory )) && ( actor->flags & MF_SPECIAL );
+	isMonster = ( actor->flags3 & MF3_ISMONSTER ) || ( actor->flags & MF_COUNTKILL );
+	if (( isItem == false ) && ( isMonster == false ))
+		return false;
+	if ( isMonster && (( actor->health <= 0 ) || ( actor->flags & MF_CORPSE )))
+		return false;
+
+	return true;
+}
+
+// Places a camera spot above the actor, clamped into the sector it's in.
+// Returns false if there isn't enough room for the camera there.
+static bool DORCH_PlaceRoamPoint( DorchRoamPoint &p, AActor *actor )
+{
+	sector_t *sector = P_PointInSector( actor->x, actor->y );
+	if ( sector == NULL )
+		return false;
+
+	const fixed_t floorZ = sector->floorplane.ZatPoint( actor->x, actor->y );
+	const fixed_t ceilingZ = sector->ceilingplane.ZatPoint( actor->x, actor->y );
+	if ( ceilingZ - floorZ < 32 * FRACUNIT )
+		return false;
+
+	p.x = actor->x;
+	p.y = actor->y;
+	p.z = clamp<fixed_t>( actor->z + actor->height + ( 16 * FRACUNIT ), floorZ + ( 8 * FRACUNIT ), ceilingZ - ( 16 * FRACUNIT ));
+	return true;
+}
+
+static void DORCH_CollectRoamPoints( TArray<DorchRoamPoint> &points )
+{
+	points.Clear( );
 
 	TThinkerIterator<AActor> iterator;
 	AActor *actor = NULL;
 	while (( actor = iterator.Next( )))
 	{
-		if ( actor->ObjectFlags & OF_EuthanizeMe )
-			continue;
-		if ( actor->player != NULL )
+		bool isMonster = false;
+		if ( DORCH_IsRoamInterest( actor, isMonster ) == false )
 			continue;
 
-		const bool isItem = actor->IsKindOf( RUNTIME_CLASS( AInventory )) && ( actor->flags & MF_SPECIAL );
-		const bool isMonster = ( actor->flags3 & MF3_ISMONSTER ) || ( actor->flags & MF_COUNTKILL );
-		if (( isItem == false ) && ( isMonster == false ))
-			continue;
-		if ( isMonster && ( actor->health <= 0 ))
+		DorchRoamPoint p;
+		if ( DORCH_PlaceRoamPoint( p, actor ) == false )
 			continue;
 
-		DorchRoamPoint p;
-		p.x = actor->x;
-		p.y = actor->y;
-		p.z = actor->z + actor->height + ( 16 * FRACUNIT );
 		p.interestWeight = isMonster ? 2 : 1;
-		g_DorchRoamPoints.Push( p );
+		p.netID = actor->NetID;
+		p.isMonster = isMonster;
+		points.Push( p );
 	}
+}
 
-	const int n = static_cast<int>( g_DorchRoamPoints.Size( ));
-	const int k = DORCH_ChooseKForZones( n );
+// Runs on the worker thread, so it must only touch its arguments.
+static void DORCH_RunRoamKMeans( const TArray<DorchRoamPoint> &points, const int k, const unsigned int seed, std::vector<DorchRoamCenter> &centers )
+{
+	const int n = static_cast<int>( points.Size( ));
+	centers.clear( );
 	if (( n <= 0 ) || ( k <= 0 ))
-	{
-		g_bDorchRoamZonesReady = true;
 		return;
-	}
 
-	// --- K-means (2D) ---
-	struct Center { fixed_t x; fixed_t y; };
-	TArray<Center> centers;
-	centers.Reserve( k );
+	std::mt19937 random( seed );
 
 	// Initialize centers by sampling unique points.
-	TArray<unsigned int> chosen;
-	chosen.Reserve( k );
-	while ( centers.Size( ) < static_cast<unsigned int>( k ))
+	std::vector<unsigned int> chosen;
+	chosen.reserve( k );
+	while ( centers.size( ) < static_cast<unsigned int>( k ))
 	{
-		const unsigned int idx = static_cast<unsigned int>( M_Random( ) % n );
+		const unsigned int idx = static_cast<unsigned int>( random( ) % n );
 		bool already = false;
-		for ( unsigned int j = 0; j < chosen.Size( ); ++j )
+		for ( unsigned int j = 0; j < chosen.size( ); ++j )
 		{
 			if ( chosen[j] == idx )
 			{
@@ -1033,15 +1099,14 @@ static void DORCH_BuildRoamZones_KMeans( void )
 		}
 		if ( already )
 			continue;
-		chosen.Push( idx );
-		Center c;
-		c.x = g_DorchRoamPoints[idx].x;
-		c.y = g_DorchRoamPoints[idx].y;
-		centers.Push( c );
+		chosen.push_back( idx );
+		DorchRoamCenter c;
+		c.x = points[idx].x;
+		c.y = points[idx].y;
+		centers.push_back( c );
 	}
 
-	TArray<int> assignment;
-	assignment.Resize( n );
+	std::vector<int> assignment( n );
 
 	for ( int iter = 0; iter < 10; ++iter )
 	{
@@ -1052,8 +1117,8 @@ static void DORCH_BuildRoamZones_KMeans( void )
 			int64_t bestDist = 0x7fffffffffffffffLL;
 			for ( int c = 0; c < k; ++c )
 			{
-				const int64_t dx = static_cast<int64_t>( g_DorchRoamPoints[i].x ) - static_cast<int64_t>( centers[c].x );
-				const int64_t dy = static_cast<int64_t>( g_DorchRoamPoints[i].y ) - static_cast<int64_t>( centers[c].y );
+				const int64_t dx = static_cast<int64_t>( points[i].x ) - static_cast<int64_t>( centers[c].x );
+				const int64_t dy = static_cast<int64_t>( points[i].y ) - static_cast<int64_t>( centers[c].y );
 				const int64_t d = ( dx * dx ) + ( dy * dy );
 				if ( d < bestDist )
 				{
@@ -1065,16 +1130,15 @@ static void DORCH_BuildRoamZones_KMeans( void )
 		}
 
 		// Recompute centers.
-		TArray<int64_t> sumX; sumX.Resize( k );
-		TArray<int64_t> sumY; sumY.Resize( k );
-		TArray<int> count; count.Resize( k );
-		for ( int c = 0; c < k; ++c ) { sumX[c] = 0; sumY[c] = 0; count[c] = 0; }
+		std::vector<int64_t> sumX( k, 0 );
+		std::vector<int64_t> sumY( k, 0 );
+		std::vector<int> count( k, 0 );
 
 		for ( int i = 0; i < n; ++i )
 		{
 			const int c = assignment[i];
-			sumX[c] += static_cast<int64_t>( g_DorchRoamPoints[i].x );
-			sumY[c] += static_cast<int64_t>( g_DorchRoamPoints[i].y );
+			sumX[c] += static_cast<int64_t>( points[i].x );
+			sumY[c] += static_cast<int64_t>( points[i].y );
 			count[c] += 1;
 		}
 
@@ -1083,17 +1147,104 @@ static void DORCH_BuildRoamZones_KMeans( void )
 			if ( count[c] <= 0 )
 			{
 				// Empty cluster: re-seed to a random point.
-				const int i = M_Random( ) % n;
-				centers[c].x = g_DorchRoamPoints[i].x;
-				centers[c].y = g_DorchRoamPoints[i].y;
+				const int i = random( ) % n;
+				centers[c].x = points[i].x;
+				centers[c].y = points[i].y;
 				continue;
 			}
 			centers[c].x = static_cast<fixed_t>( sumX[c] / count[c] );
 			centers[c].y = static_cast<fixed_t>( sumY[c] / count[c] );
 		}
 	}
+}
+
+// The cache holds the zone centers of a map: "ZRZC", the number of centers and
+// then the x/y pairs, all as little endian 32-bit values.
+static bool DORCH_LoadRoamZoneCache( const FString &path, TArray<DorchRoamCenter> &centers )
+{
+	centers.Clear( );
+	if ( path.IsEmpty( ))
+		return false;
+
+	FILE *file = fopen( path.GetChars( ), "rb" );
+	if ( file == NULL )
+		return false;
+
+	DWORD header[2];
+	bool ok = ( fread( header, sizeof( DWORD ), 2, file ) == 2 ) && ( header[0] == MAKE_ID( 'Z', 'R', 'Z', 'C' ));
+	const DWORD count = ok ? LittleLong( header[1] ) : 0;
+	if ( ok && ( count > 0 ) && ( count <= 16 ))
+	{
+		for ( DWORD i = 0; i < count; ++i )
+		{
+			DWORD xy[2];
+			if ( fread( xy, sizeof( DWORD ), 2, file ) != 2 )
+			{
+				ok = false;
+				break;
+			}
+			DorchRoamCenter c;
+			c.x = static_cast<fixed_t>( LittleLong( xy[0] ));
+			c.y = static_cast<fixed_t>( LittleLong( xy[1] ));
+			centers.Push( c );
+		}
+	}
+	else
+		ok = false;
+
+	fclose( file );
+	if ( ok == false )
+		centers.Clear( );
+	return ok;
+}
+
+static void DORCH_SaveRoamZoneCache( const FString &path, const std::vector<DorchRoamCenter> &centers )
+{
+	if ( path.IsEmpty( ) || centers.empty( ))
+		return;
+
+	// Write to a temp file first, another spectator could be reading the cache.
+	const FString tempPath = path + ".tmp";
+	FILE *file = fopen( tempPath.GetChars( ), "wb" );
+	if ( file == NULL )
+		return;
+
+	bool ok = true;
+	const DWORD header[2] = { MAKE_ID( 'Z', 'R', 'Z', 'C' ), LittleLong( static_cast<DWORD>( centers.size( ))) };
+	ok = ( fwrite( header, sizeof( DWORD ), 2, file ) == 2 );
+	for ( unsigned int i = 0; ok && ( i < centers.size( )); ++i )
+	{
+		const DWORD xy[2] = { LittleLong( static_cast<DWORD>( centers[i].x )), LittleLong( static_cast<DWORD>( centers[i].y )) };
+		ok = ( fwrite( xy, sizeof( DWORD ), 2, file ) == 2 );
+	}
+	ok = ( fclose( file ) == 0 ) && ok;
+
+	if (( ok == false ) || ( rename( tempPath.GetChars( ), path.GetChars( )) != 0 ))
+		remove( tempPath.GetChars( ));
+}
 
-	// Build zones from final assignments.
+static void DORCH_RoamZoneWorker( void )
+{
+	const int k = DORCH_ChooseKForZones( static_cast<int>( g_DorchRoamJobPoints.Size( )));
+	DORCH_RunRoamKMeans( g_DorchRoamJobPoints, k, g_DorchRoamJobSeed, g_DorchRoamJobCenters );
+	DORCH_SaveRoamZoneCache( g_DorchRoamJobCachePath, g_DorchRoamJobCenters );
+	g_bDorchRoamJobDone.store( true, std::memory_order_release );
+}
+
+static void DORCH_ShutdownRoamZones( void )
+{
+	DORCH_FinishRoamZoneWorker( );
+	g_bDorchRoamZonesPending = false;
+}
+
+// Builds the zones from g_DorchRoamPoints by assigning every point to its nearest
+// center. Zone ids follow the order of the centers.
+static void DORCH_AssignRoamZones( const TArray<DorchRoamCenter> &centers, const bool dropEmptyZones )
+{
+	const int n = static_cast<int>( g_DorchRoamPoints.Size( ));
+	const int k = static_cast<int>( centers.Size( ));
+
+	g_DorchRoamZones.Clear( );
 	g_DorchRoamZones.Resize( k );
 	for ( int c = 0; c < k; ++c )
 	{
@@ -1104,24 +1255,175 @@ static void DORCH_BuildRoamZones_KMeans( void )
 		g_DorchRoamZones[c].interestScore = 0;
 	}
 
-	for ( int i = 0; i < n; ++i )
+	for ( int i = 0; ( k > 0 ) && ( i < n ); ++i )
 	{
-		const int c = assignment[i];
-		g_DorchRoamZones[c].pointIndices.Push( static_cast<unsigned int>( i ));
-		g_DorchRoamZones[c].interestScore += g_DorchRoamPoints[i].interestWeight;
+		int best = 0;
+		int64_t bestDist = 0x7fffffffffffffffLL;
+		for ( int c = 0; c < k; ++c )
+		{
+			const int64_t dx = static_cast<int64_t>( g_DorchRoamPoints[i].x ) - static_cast<int64_t>( centers[c].x );
+			const int64_t dy = static_cast<int64_t>( g_DorchRoamPoints[i].y ) - static_cast<int64_t>( centers[c].y );
+			const int64_t d = ( dx * dx ) + ( dy * dy );
+			if ( d < bestDist )
+			{
+				bestDist = d;
+				best = c;
+			}
+		}
+		g_DorchRoamZones[best].pointIndices.Push( static_cast<unsigned int>( i ));
+		g_DorchRoamZones[best].interestScore += g_DorchRoamPoints[i].interestWeight;
+	}
+
+	// Drop empty zones (can happen after reseeding + reassignment). When points
+	// are only reassigned, keep them so that zone ids stay the same.
+	if ( dropEmptyZones )
+	{
+		for ( int c = static_cast<int>( g_DorchRoamZones.Size( )) - 1; c >= 0; --c )
+		{
+			if ( g_DorchRoamZones[c].pointIndices.Size( ) == 0 )
+				g_DorchRoamZones.Delete( c );
+		}
 	}
 
-	// Drop empty zones (can happen after reseeding + reassignment).
-	for ( int c = static_cast<int>( g_DorchRoamZones.Size( )) - 1; c >= 0; --c )
+	g_DorchRoamCenters.Clear( );
+	for ( unsigned int c = 0; c < g_DorchRoamZones.Size( ); ++c )
 	{
-		if ( g_DorchRoamZones[c].pointIndices.Size( ) == 0 )
-			g_DorchRoamZones.Delete( c );
+		DorchRoamCenter center;
+		center.x = g_DorchRoamZones[c].cx;
+		center.y = g_DorchRoamZones[c].cy;
+		g_DorchRoamCenters.Push( center );
 	}
 
 	DORCH_ComputeZoneAdjacency( );
 	g_bDorchRoamZonesReady = true;
 }
 
+static void DORCH_BeginBuildRoamZones( void )
+{
+	DORCH_FinishRoamZoneWorker( );
+	g_bDorchRoamZonesPending = false;
+	g_bDorchRoamZonesReady = false;
+
+	// Collect points of interest from the current map.
+	DORCH_CollectRoamPoints( g_DorchRoamPoints );
+	g_DorchRoamZones.Clear( );
+
+	if ( g_DorchRoamPoints.Size( ) == 0 )
+	{
+		g_bDorchRoamZonesReady = true;
+		return;
+	}
+
+	// Look for centers computed on an earlier visit to this map.
+	g_DorchRoamCachePath = "";
+	MapData *map = P_OpenMapData( level.mapname, false );
+	if ( map != NULL )
+	{
+		BYTE checksum[16];
+		map->GetChecksum( checksum );
+		delete map;
+
+		FString path = M_GetCachePath( true );
+		path << "/roamzones";
+		CreatePath( path );
+		path << '/';
+		for ( unsigned int i = 0; i < sizeof( checksum ); ++i )
+			path.AppendFormat( "%02x", checksum[i] );
+		g_DorchRoamCachePath = path << ".zrz";
+	}
+
+	TArray<DorchRoamCenter> cachedCenters;
+	if ( DORCH_LoadRoamZoneCache( g_DorchRoamCachePath, cachedCenters ))
+	{
+		DORCH_AssignRoamZones( cachedCenters, true );
+		return;
+	}
+
+	if ( g_bDorchRoamZoneShutdownRegistered == false )
+	{
+		g_bDorchRoamZoneShutdownRegistered = true;
+		atterm( DORCH_ShutdownRoamZones );
+	}
+
+	// Hand a copy of the points to the worker.
+	g_DorchRoamJobPoints = g_DorchRoamPoints;
+	g_DorchRoamJobCenters.clear( );
+	g_DorchRoamJobSeed = ( static_cast<unsigned int>( M_Random( )) << 8 ) | M_Random( );
+	g_DorchRoamJobCachePath = g_DorchRoamCachePath;
+	g_bDorchRoamJobDone.store( false, std::memory_order_relaxed );
+	g_bDorchRoamZonesPending = true;
+	g_DorchRoamZoneThread = std::thread( DORCH_RoamZoneWorker );
+}
+
+static void DORCH_PollRoamZones( void )
+{
+	if (( g_bDorchRoamZonesPending == false ) || ( g_bDorchRoamJobDone.load( std::memory_order_acquire ) == false ))
+		return;
+
+	DORCH_FinishRoamZoneWorker( );
+	g_bDorchRoamZonesPending = false;
+
+	TArray<DorchRoamCenter> centers;
+	for ( unsigned int i = 0; i < g_DorchRoamJobCenters.size( ); ++i )
+		centers.Push( g_DorchRoamJobCenters[i] );
+	DORCH_AssignRoamZones( centers, true );
+}
+
+// Follows the tracked actors: drops the weight of dead monsters and picked up
+// items, and moves the points of monsters that walked away. Once most points
+// are gone, the map is rescanned (e.g. for respawned items) and the new points
+// are assigned to the existing zones, which doesn't need another k-means run.
+static void DORCH_RefreshRoamPoints( void )
+{
+	if (( g_bDorchRoamZonesReady == false ) || ( g_DorchRoamCenters.Size( ) == 0 ))
+		return;
+
+	unsigned int numLive = 0;
+	for ( unsigned int i = 0; i < g_DorchRoamPoints.Size( ); ++i )
+	{
+		DorchRoamPoint &p = g_DorchRoamPoints[i];
+		if ( p.netID == 0 )
+		{
+			numLive += ( p.interestWeight > 0 ) ? 1 : 0;
+			continue;
+		}
+
+		AActor *actor = g_ActorNetIDList.findPointerByID( p.netID );
+		bool isMonster = false;
+		if (( actor == NULL ) || ( DORCH_IsRoamInterest( actor, isMonster ) == false ) || ( isMonster != p.isMonster ))
+		{
+			p.interestWeight = 0;
+			continue;
+		}
+
+		if ( p.isMonster && (( actor->x != p.x ) || ( actor->y != p.y )))
+		{
+			// Keep the old spot if there's no room for the camera where it went.
+			DorchRoamPoint moved = p;
+			if ( DORCH_PlaceRoamPoint( moved, actor ))
+				p = moved;
+		}
+
+		p.interestWeight = p.isMonster ? 2 : 1;
+		numLive++;
+	}
+
+	if ( numLive * 2 < g_DorchRoamPoints.Size( ))
+	{
+		DORCH_CollectRoamPoints( g_DorchRoamPoints );
+		const TArray<DorchRoamCenter> centers = g_DorchRoamCenters;
+		DORCH_AssignRoamZones( centers, false );
+		return;
+	}
+
+	for ( unsigned int z = 0; z < g_DorchRoamZones.Size( ); ++z )
+	{
+		g_DorchRoamZones[z].interestScore = 0;
+		for ( unsigned int i = 0; i < g_DorchRoamZones[z].pointIndices.Size( ); ++i )
+			g_DorchRoamZones[z].interestScore += g_DorchRoamPoints[g_DorchRoamZones[z].pointIndices[i]].interestWeight;
+	}
+}
+
 static int DORCH_PickNextRoamZoneId( void )
 {
 	if ( g_DorchRoamZones.Size( ) == 0 )
@@ -1134,6 +1436,11 @@ static int DORCH_PickNextRoamZoneId( void )
 	for ( unsigned int i = 0; i < g_DorchRoamZones.Size( ); ++i )
 	{
 		const int zid = static_cast<int>( i );
+
+		// Skip zones that have been cleared out.
+		if ( g_DorchRoamZones[i].interestScore <= 0 )
+			continue;
+
 		any.Push( zid );
 
 		const bool adjacentToLast = ( g_iDorchLastRoamZone >= 0 ) && ( zid == g_iDorchLastRoamZone || DORCH_AreZonesAdjacent( zid, g_iDorchLastRoamZone ));
@@ -1171,6 +1478,8 @@ static bool DORCH_PickRoamPointFromZone( const int zoneId, const fixed_t minDist
 		if ( pick >= g_DorchRoamPoints.Size( ) )
 			continue;
 		const DorchRoamPoint &p = g_DorchRoamPoints[pick];
+		if ( p.interestWeight <= 0 )
+			continue;
 		if ( DORCH_IsTooCloseToLastRoamPosXY( p.x, p.y, minDist ) )
 			continue;
 		out = p;
@@ -1204,10 +1513,15 @@ static bool DORCH_PickFarthestPointOverall( const fixed_t fromX, const fixed_t f
 	int64_t bestDist = -1;
 	for ( unsigned int i = 0; i < g_DorchRoamPoints.Size( ); ++i )
 	{
+		// Prefer points that are still around, but fall back to any point.
+		if (( g_DorchRoamPoints[i].interestWeight <= 0 ) && ( bestDist >= 0 ) && ( g_DorchRoamPoints[bestIdx].interestWeight > 0 ))
+			continue;
+
 		const int64_t dx = static_cast<int64_t>( g_DorchRoamPoints[i].x ) - static_cast<int64_t>( fromX );
 		const int64_t dy = static_cast<int64_t>( g_DorchRoamPoints[i].y ) - static_cast<int64_t>( fromY );
 		const int64_t d = ( dx * dx ) + ( dy * dy );
-		if ( d > bestDist )
+		const bool replacesDead = ( bestDist >= 0 ) && ( g_DorchRoamPoints[bestIdx].interestWeight <= 0 ) && ( g_DorchRoamPoints[i].interestWeight > 0 );
+		if (( d > bestDist ) || replacesDead )
 		{
 			bestDist = d;
 			bestIdx = i;
@@ -1220,7 +1534,7 @@ static bool DORCH_PickFarthestPointOverall( const fixed_t fromX, const fixed_t f
 static bool DORCH_PickNextRoamLocation( const fixed_t minDist, int &outZoneId, DorchRoamPoint &outPoint )
 {
 	if ( g_bDorchRoamZonesReady == false )
-		DORCH_BuildRoamZones_KMeans( );
+		return false;
 
 	if ( g_DorchRoamZones.Size( ) == 0 )
 		return false;
@@ -1308,10 +1622,16 @@ static void DORCH_RoamTick( void )
 	if ( gametic < g_iDorchSpectatorNextRoamTic )
 		return;
 
-	// Rebuild zones if the map changed.
+	// Rebuild zones if the map changed. Until the worker is done, keep the
+	// camera where it is and check again next tic.
 	DORCH_MaybeResetRoamZonesForMapChange( );
+	if (( g_bDorchRoamZonesReady == false ) && ( g_bDorchRoamZonesPending == false ))
+		DORCH_BeginBuildRoamZones( );
+	DORCH_PollRoamZones( );
 	if ( g_bDorchRoamZonesReady == false )
-		DORCH_BuildRoamZones_KMeans( );
+		return;
+
+	DORCH_RefreshRoamPoints( );
 
 	const fixed_t minDist = 512 * FRACUNIT;
 	bool teleported = false;
@@ -1382,7 +1702,7 @@ static void DORCH_SpectatorTick( void )
 		strncpy( g_szDorchLastRoamMapName, level.mapname, 8 );
 		g_szDorchLastRoamMapName[8] = '\0';
 		DORCH_ResetRoamZones( );
-		DORCH_BuildRoamZones_KMeans( );
+		DORCH_BeginBuildRoamZones( );
 
 		// Ensure the rendered view is clean (no status bar, no weapon sprites).
 		UCVarValue cleanVal;
@@ -1933,6 +2253,7 @@ bool CLIENT_GetNextPacket( void )
 void CLIENT_GetPackets( void )
 {
 	LONG lSize;
+	PROF_ZONE( "Net receive" );
 #ifdef	_DEBUG
 	static	ULONG	s_ulEmulatingPacketLoss = 0;
 #endif
@@ -3472,6 +3793,8 @@ void CLIENT_QuitNetworkGame( const char *pszString )
 //
 void CLIENT_SendCmd( void )
 {		
+	PROF_ZONE( "Net send" );
+
 	if (( gametic < 1 ) ||
 		( players[consoleplayer].mo == NULL ) ||
 		(( gamestate != GS_LEVEL ) && ( gamestate != GS_INTERMISSION )))
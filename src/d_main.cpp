@@ -140,6 +140,7 @@
 #include "compatibility.h"
 #include "m_joy.h"
 #include "sc_man.h"
+#include "sc_thread.h"
 #include "po_man.h"
 #include "resourcefiles/resourcefile.h"
 #include "r_renderer.h"
@@ -152,6 +153,7 @@
 
 // [ZZ] PWO header file
 #include "g_shared/pwo.h"
+#include "profiler.h"
 
 #include "win32/g15/g15.h"
 EXTERN_CVAR(Bool, hud_althud)
@@ -871,6 +873,7 @@ void D_Display ()
 {
 	bool wipe;
 	bool hw2d;
+	PROF_ZONE ("D_Display");
 
 	// [BC] No need for servers to do this.
 	if ( NETWORK_GetState( ) == NETSTATE_SERVER )
@@ -1376,6 +1379,10 @@ static void D_DoomLoop_Tick()
 			D_Display ();
 			break;
 		}
+
+		// [dorch] The server collects its profile once per tic instead.
+		if ( NETWORK_GetState( ) != NETSTATE_SERVER )
+			PROF_Frame( );
 	}
 	catch (CRecoverableError &error)
 	{
@@ -1500,6 +1507,10 @@ void D_DoomLoop ()
 				D_Display ();
 				break;
 			}
+
+			// [dorch] The server collects its profile once per tic instead.
+			if ( NETWORK_GetState( ) != NETSTATE_SERVER )
+				PROF_Frame( );
 		}
 		catch (CRecoverableError &error)
 		{
@@ -3001,6 +3012,10 @@ void D_DoomMain (void)
 		// Now that wads are loaded, define mod-specific cvars.
 		ParseCVarInfo();
 
+		// [dorch] Start tokenizing the big script lumps on worker threads
+		// while the ones before them are parsed.
+		SC_PretokenizeStartupLumps( );
+
 		// Actually exec command line commands and exec files.
 		if (exec != NULL)
 		{
@@ -3132,6 +3147,10 @@ void D_DoomMain (void)
 
 		FActorInfo::StaticInit ();
 
+		// [dorch] DECORATE was the last of the lumps that were tokenized
+		// ahead of time.
+		SC_FinishPretokenizing( );
+
 		// [GRB] Initialize player class list
 		SetupPlayerClasses ();
 
@@ -3224,6 +3243,10 @@ void D_DoomMain (void)
 		// [AK] Parse any SCORINFO lumps.
 		SCOREBOARD_Construct( );
 
+		// [dorch] Show how long each kind of script lump took to parse.
+		if ( Args->CheckParm( "-parsetimes" ))
+			SC_PrintParseTimes( );
+
 		// [RH] User-configurable startup strings. Because BOOM does.
 		static const char *startupString[5] = {
 			"STARTUP1", "STARTUP2", "STARTUP3", "STARTUP4", "STARTUP5"
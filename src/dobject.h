@@ -267,6 +267,37 @@ namespace GC
 	// Size of GC steps.
 	extern int StepMul;
 
+	// [dorch] If not 0, a step runs for this many microseconds instead of
+	// covering a StepMul based amount of memory.
+	extern int StepBudget;
+
+	// [dorch] If not 0, steps are put off to the next tic once the collector
+	// ran for this many microseconds in the current one.
+	extern int TicBudget;
+
+	// [dorch] What the collector did since startup (or "gc resetstats").
+	struct FStats
+	{
+		double StateMS[4];		// Time spent in each state.
+		double FullMS;			// Time spent in FullGC.
+		double LastStepMS;
+		double MaxStepMS;
+		double LastTicMS;		// Time spent in the last tic that had steps.
+		double MaxTicMS;
+		QWORD Steps;
+		QWORD DeferredSteps;	// Steps put off because of TicBudget.
+		QWORD Cycles;
+		QWORD FullCollections;
+		QWORD FreedObjects;
+		QWORD FreedBytes;
+		size_t LastFreedObjects;	// Freed by the last step.
+		size_t LastFreedBytes;
+	};
+	extern FStats Stats;
+
+	// [dorch] Clears the statistics.
+	void ResetStats();
+
 	// Current white value for known-dead objects.
 	static inline uint32 OtherWhite()
 	{
@@ -341,6 +372,23 @@ namespace GC
 	template<class T> void Mark(TObjPtr<T> &obj);
 }
 
+// [dorch] Where the memory for objects comes from. Objects of about the same
+// size share slabs of equally sized blocks. Memory is counted in
+// GC::AllocBytes just like with M_Malloc.
+namespace ObjectPool
+{
+	void *Alloc(size_t size);
+	void Free(void *mem);
+
+	// Memory the slabs take up, including unused blocks.
+	size_t GetReservedBytes();
+
+	void PrintStats();
+
+	// Prints the classes that had the most objects created.
+	void PrintClassStats(unsigned int count);
+}
+
 // A template class to help with handling read barriers. It does not
 // handle write barriers, because those can be handled more efficiently
 // with knowledge of the object that holds the pointer.
@@ -497,12 +545,12 @@ public:
 
 	void *operator new(size_t len)
 	{
-		return M_Malloc(len);
+		return ObjectPool::Alloc(len);
 	}
 
 	void operator delete (void *mem)
 	{
-		M_Free(mem);
+		ObjectPool::Free(mem);
 	}
 
 	// GC fiddling
@@ -569,7 +617,7 @@ protected:
 
 	void operator delete (void *mem, EInPlace *)
 	{
-		M_Free (mem);
+		ObjectPool::Free (mem);
 	}
 };
 
@@ -56,6 +56,8 @@
 
 // HEADER FILES ------------------------------------------------------------
 
+#include <chrono>
+
 #include "dobject.h"
 #include "templates.h"
 //#include "b_bot.h"
@@ -106,6 +108,10 @@
 #define GCSWEEPCOST		10
 #define GCFINALIZECOST	100
 
+// [dorch] How many single steps a time budgeted step does between looking at
+// the clock.
+#define GCBUDGETCHECK	16
+
 // TYPES -------------------------------------------------------------------
 
 // This object is responsible for marking sectors during the propagate
@@ -150,11 +156,18 @@ int Pause = DEFAULT_GCPAUSE;
 int StepMul = DEFAULT_GCMUL;
 int StepCount;
 size_t Dept;
+int StepBudget;
+int TicBudget;
+FStats Stats;
 
 // PRIVATE DATA DEFINITIONS ------------------------------------------------
 
 static DSectorMarker *SectorMarker;
 
+// [dorch] The tic TicTime belongs to, and how long the collector ran in it.
+static int BudgetTic = -1;
+static double TicTime;
+
 // CODE --------------------------------------------------------------------
 
 //==========================================================================
@@ -417,12 +430,15 @@ static size_t SingleStep()
 		}
 		assert(old >= AllocBytes);
 		Estimate -= old - AllocBytes;
+		Stats.FreedObjects += finalize_count;
+		Stats.FreedBytes += old - AllocBytes;
 		return (GCSWEEPMAX - finalize_count) * GCSWEEPCOST + finalize_count * GCFINALIZECOST;
 	  }
 
 	case GCS_Finalize:
 		State = GCS_Pause;		// end collection
 		Dept = 0;
+		Stats.Cycles++;
 		return 0;
 
 	default:
@@ -431,12 +447,34 @@ static size_t SingleStep()
 	}
 }
 
+//==========================================================================
+//
+// NowMS
+//
+//==========================================================================
+
+static inline double NowMS()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//==========================================================================
+//
+// ResetStats
+//
+//==========================================================================
+
+void ResetStats()
+{
+	memset(&Stats, 0, sizeof(Stats));
+}
+
 //==========================================================================
 //
 // Step
 //
 // Performs enough single steps to cover GCSTEPSIZE * StepMul% bytes of
-// memory.
+// memory, or to take StepBudget microseconds if that is set.
 //
 //==========================================================================
 
@@ -444,16 +482,70 @@ void Step()
 {
 	size_t lim = (GCSTEPSIZE/100) * StepMul;
 	size_t olim;
-	if (lim == 0)
+	if (lim == 0 || StepBudget > 0)
 	{
 		lim = (~(size_t)0) / 2;		// no limit
 	}
 	Dept += AllocBytes - Threshold;
+
+	// [dorch] Keep track of how long the collector runs in each tic.
+	const double start = NowMS();
+	if (BudgetTic != gametic)
+	{
+		if (TicTime > 0)
+		{
+			Stats.LastTicMS = TicTime;
+			Stats.MaxTicMS = MAX(Stats.MaxTicMS, TicTime);
+		}
+		BudgetTic = gametic;
+		TicTime = 0;
+	}
+
+	// [dorch] Put the step off to the next tic if this one's budget is used
+	// up, unless the collector fell so far behind that it owes more than all
+	// the memory that was alive after the last collection.
+	if (TicBudget > 0 && TicTime * 1000 >= TicBudget && Dept < Estimate)
+	{
+		Dept += GCSTEPSIZE;
+		Threshold = AllocBytes + GCSTEPSIZE;
+		Stats.DeferredSteps++;
+		return;
+	}
+
+	const QWORD freedObjects = Stats.FreedObjects;
+	const QWORD freedBytes = Stats.FreedBytes;
+	const double budgetEnd = start + StepBudget / 1000.;
+	double stateStart = start;
+	EGCState state = State;
+	int count = 0;
 	do
 	{
 		olim = lim;
 		lim -= SingleStep();
+
+		// [dorch] Charge the time to the state it was spent in.
+		if (State != state)
+		{
+			const double now = NowMS();
+			Stats.StateMS[state] += now - stateStart;
+			stateStart = now;
+			state = State;
+		}
+		if (StepBudget > 0 && ++count % GCBUDGETCHECK == 0 && NowMS() >= budgetEnd)
+		{
+			break;
+		}
 	} while (olim > lim && State != GCS_Pause);
+
+	const double end = NowMS();
+	Stats.StateMS[state] += end - stateStart;
+	Stats.LastStepMS = end - start;
+	Stats.MaxStepMS = MAX(Stats.MaxStepMS, Stats.LastStepMS);
+	Stats.LastFreedObjects = size_t(Stats.FreedObjects - freedObjects);
+	Stats.LastFreedBytes = size_t(Stats.FreedBytes - freedBytes);
+	Stats.Steps++;
+	TicTime += end - start;
+
 	if (State != GCS_Pause)
 	{
 		if (Dept < GCSTEPSIZE)
@@ -484,6 +576,8 @@ void Step()
 
 void FullGC()
 {
+	const double start = NowMS();
+
 	if (State <= GCS_Propagate)
 	{
 		// Reset sweep mark to sweep all elements (returning them to white)
@@ -503,6 +597,9 @@ void FullGC()
 		SingleStep();
 	}
 	SetThreshold();
+
+	Stats.FullMS += NowMS() - start;
+	Stats.FullCollections++;
 }
 
 //==========================================================================
@@ -721,6 +818,10 @@ ADD_STAT(gc)
 	{
 		out.AppendFormat("  %zuK", (GC::Dept + 1023) >> 10);
 	}
+	out.AppendFormat("\nStep:%6.3fms (max%7.3f)  Tic:%6.3fms (max%7.3f)  Freed:%5zu / %5zuK",
+		GC::Stats.LastStepMS, GC::Stats.MaxStepMS,
+		GC::Stats.LastTicMS, GC::Stats.MaxTicMS,
+		GC::Stats.LastFreedObjects, (GC::Stats.LastFreedBytes + 1023) >> 10);
 	return out;
 }
 
@@ -736,7 +837,7 @@ CCMD(gc)
 {
 	if (argv.argc() == 1)
 	{
-		Printf ("Usage: gc stop|now|full|pause [size]|stepmul [size]\n");
+		Printf ("Usage: gc stop|now|full|pause [size]|stepmul [size]|stepbudget [usec]|ticbudget [usec]|stats|resetstats|pools|classes [count]\n");
 		return;
 	}
 	if (stricmp(argv[1], "stop") == 0)
@@ -773,4 +874,56 @@ CCMD(gc)
 			GC::StepMul = MAX(100, atoi(argv[2]));
 		}
 	}
+	else if (stricmp(argv[1], "stepbudget") == 0)
+	{
+		if (argv.argc() == 2)
+		{
+			Printf ("Current GC step budget is %d usec\n", GC::StepBudget);
+		}
+		else
+		{
+			GC::StepBudget = MAX(0, atoi(argv[2]));
+		}
+	}
+	else if (stricmp(argv[1], "ticbudget") == 0)
+	{
+		if (argv.argc() == 2)
+		{
+			Printf ("Current GC tic budget is %d usec\n", GC::TicBudget);
+		}
+		else
+		{
+			GC::TicBudget = MAX(0, atoi(argv[2]));
+		}
+	}
+	else if (stricmp(argv[1], "stats") == 0)
+	{
+		static const char *StateNames[] = { "mark roots", "propagate", "sweep", "finalize" };
+		const GC::FStats &stats = GC::Stats;
+
+		Printf ("%llu steps, %llu put off, %llu cycles, %llu full collections\n",
+			(unsigned long long)stats.Steps, (unsigned long long)stats.DeferredSteps,
+			(unsigned long long)stats.Cycles, (unsigned long long)stats.FullCollections);
+		for (int i = 0; i < 4; i++)
+		{
+			Printf ("  %-10s %10.3f ms\n", StateNames[i], stats.StateMS[i]);
+		}
+		Printf ("  %-10s %10.3f ms\n", "full", stats.FullMS);
+		Printf ("Step: last %.3f ms, max %.3f ms. Tic: last %.3f ms, max %.3f ms\n",
+			stats.LastStepMS, stats.MaxStepMS, stats.LastTicMS, stats.MaxTicMS);
+		Printf ("Freed %llu objects, %lluK\n",
+			(unsigned long long)stats.FreedObjects, (unsigned long long)((stats.FreedBytes + 1023) >> 10));
+	}
+	else if (stricmp(argv[1], "resetstats") == 0)
+	{
+		GC::ResetStats();
+	}
+	else if (stricmp(argv[1], "pools") == 0)
+	{
+		ObjectPool::PrintStats();
+	}
+	else if (stricmp(argv[1], "classes") == 0)
+	{
+		ObjectPool::PrintClassStats(argv.argc() > 2 ? MAX(1, atoi(argv[2])) : 20);
+	}
 }
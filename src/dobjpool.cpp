@@ -0,0 +1,405 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Zandronum Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: dobjpool.cpp
+//
+//
+// Description: Memory for DObjects. Objects of about the same size share
+// slabs of equally sized, cache line aligned blocks, so that spawning and
+// freeing lots of actors doesn't have to go through malloc every time.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#include "dobject.h"
+#include "i_system.h"
+#include "templates.h"
+
+// MACROS ------------------------------------------------------------------
+
+// Slabs are aligned to their size, so the slab an object belongs to can be
+// found by masking off the low bits of its address.
+#define SLAB_SIZE			65536
+
+// Block sizes are multiples of this, so every block starts a cache line.
+#define BLOCK_ALIGN			64
+
+// Objects that are bigger than this get a slab of their own.
+#define MAX_BLOCK_SIZE		8192
+
+#define NUM_SIZE_CLASSES	(MAX_BLOCK_SIZE / BLOCK_ALIGN)
+
+// TYPES -------------------------------------------------------------------
+
+struct FObjectSlab
+{
+	FObjectSlab *Prev, *Next;	// Slabs of the size class with free blocks.
+	void *FreeList;				// Blocks that were freed.
+	BYTE *Unused;				// Blocks that were never used start here.
+	BYTE *End;
+	unsigned int BlockSize;
+	unsigned int NumUsed;
+	int SizeClass;				// -1 if the slab holds a single big object.
+};
+
+struct FSizeClass
+{
+	FObjectSlab *Partial;		// Slabs that have free blocks.
+	unsigned int NumSlabs;
+	unsigned int NumEmpty;		// Slabs without any used blocks.
+	unsigned int NumUsed;
+	QWORD NumAllocs;
+};
+
+// The header takes up the first blocks' worth of cache lines.
+#define SLAB_HEADER_SIZE	((sizeof(FObjectSlab) + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1))
+
+// PRIVATE DATA DEFINITIONS ------------------------------------------------
+
+static FSizeClass SizeClasses[NUM_SIZE_CLASSES];
+static size_t ReservedBytes;
+static unsigned int NumBigObjects;
+static QWORD NumBigAllocs;
+
+// CODE --------------------------------------------------------------------
+
+namespace ObjectPool
+{
+
+//==========================================================================
+//
+// AllocSlab
+//
+//==========================================================================
+
+static FObjectSlab *AllocSlab(size_t size)
+{
+	void *mem;
+
+#ifdef _WIN32
+	mem = _aligned_malloc(size, SLAB_SIZE);
+#else
+	if (posix_memalign(&mem, SLAB_SIZE, size) != 0)
+	{
+		mem = NULL;
+	}
+#endif
+	if (mem == NULL)
+	{
+		I_FatalError("Could not allocate %zu bytes for objects", size);
+	}
+	ReservedBytes += size;
+	return (FObjectSlab *)mem;
+}
+
+//==========================================================================
+//
+// FreeSlab
+//
+//==========================================================================
+
+static void FreeSlab(FObjectSlab *slab)
+{
+	ReservedBytes -= slab->End - (BYTE *)slab;
+#ifdef _WIN32
+	_aligned_free(slab);
+#else
+	free(slab);
+#endif
+}
+
+//==========================================================================
+//
+// Unlink
+//
+// Removes a slab from its size class's list of slabs with free blocks.
+//
+//==========================================================================
+
+static void Unlink(FSizeClass &sc, FObjectSlab *slab)
+{
+	if (slab->Prev != NULL)
+	{
+		slab->Prev->Next = slab->Next;
+	}
+	else
+	{
+		sc.Partial = slab->Next;
+	}
+	if (slab->Next != NULL)
+	{
+		slab->Next->Prev = slab->Prev;
+	}
+	slab->Prev = slab->Next = NULL;
+}
+
+//==========================================================================
+//
+// Link
+//
+//==========================================================================
+
+static void Link(FSizeClass &sc, FObjectSlab *slab)
+{
+	slab->Prev = NULL;
+	slab->Next = sc.Partial;
+	if (sc.Partial != NULL)
+	{
+		sc.Partial->Prev = slab;
+	}
+	sc.Partial = slab;
+}
+
+//==========================================================================
+//
+// Alloc
+//
+// Returns a block of at least the given size. Like the rest of the object
+// code, this may only be used from the main thread.
+//
+//==========================================================================
+
+void *Alloc(size_t size)
+{
+	const size_t blocksize = (MAX<size_t>(size, 1) + BLOCK_ALIGN - 1) & ~(size_t)(BLOCK_ALIGN - 1);
+	FObjectSlab *slab;
+
+	if (blocksize > MAX_BLOCK_SIZE)
+	{
+		slab = AllocSlab(SLAB_HEADER_SIZE + blocksize);
+		slab->Prev = slab->Next = NULL;
+		slab->FreeList = NULL;
+		slab->End = slab->Unused = (BYTE *)slab + SLAB_HEADER_SIZE + blocksize;
+		slab->BlockSize = (unsigned int)blocksize;
+		slab->NumUsed = 1;
+		slab->SizeClass = -1;
+		NumBigObjects++;
+		NumBigAllocs++;
+		GC::AllocBytes += blocksize;
+		return (BYTE *)slab + SLAB_HEADER_SIZE;
+	}
+
+	const int sizeclass = int(blocksize / BLOCK_ALIGN) - 1;
+	FSizeClass &sc = SizeClasses[sizeclass];
+
+	slab = sc.Partial;
+	if (slab == NULL)
+	{
+		slab = AllocSlab(SLAB_SIZE);
+		slab->Prev = slab->Next = NULL;
+		slab->FreeList = NULL;
+		slab->Unused = (BYTE *)slab + SLAB_HEADER_SIZE;
+		slab->End = (BYTE *)slab + SLAB_SIZE;
+		slab->BlockSize = (unsigned int)blocksize;
+		slab->NumUsed = 0;
+		slab->SizeClass = sizeclass;
+		sc.NumSlabs++;
+		sc.NumEmpty++;
+		Link(sc, slab);
+	}
+
+	void *block;
+	if (slab->FreeList != NULL)
+	{
+		block = slab->FreeList;
+		slab->FreeList = *(void **)block;
+	}
+	else
+	{
+		block = slab->Unused;
+		slab->Unused += blocksize;
+	}
+
+	if (slab->NumUsed++ == 0)
+	{
+		sc.NumEmpty--;
+	}
+	if (slab->FreeList == NULL && slab->Unused + blocksize > slab->End)
+	{
+		Unlink(sc, slab);
+	}
+	sc.NumUsed++;
+	sc.NumAllocs++;
+	GC::AllocBytes += blocksize;
+	return block;
+}
+
+//==========================================================================
+//
+// Free
+//
+// Returns a block to its slab. One empty slab is kept around for every
+// size class, so that an object that is spawned and freed over and over
+// doesn't allocate a new slab every time.
+//
+//==========================================================================
+
+void Free(void *mem)
+{
+	if (mem == NULL)
+	{
+		return;
+	}
+
+	FObjectSlab *slab = (FObjectSlab *)((size_t)mem & ~(size_t)(SLAB_SIZE - 1));
+
+	GC::AllocBytes -= slab->BlockSize;
+	if (slab->SizeClass < 0)
+	{
+		NumBigObjects--;
+		FreeSlab(slab);
+		return;
+	}
+
+	FSizeClass &sc = SizeClasses[slab->SizeClass];
+	const bool wasfull = (slab->FreeList == NULL && slab->Unused + slab->BlockSize > slab->End);
+
+	*(void **)mem = slab->FreeList;
+	slab->FreeList = mem;
+	sc.NumUsed--;
+
+	if (wasfull)
+	{
+		Link(sc, slab);
+	}
+	if (--slab->NumUsed == 0)
+	{
+		if (sc.NumEmpty > 0)
+		{
+			Unlink(sc, slab);
+			sc.NumSlabs--;
+			FreeSlab(slab);
+		}
+		else
+		{
+			sc.NumEmpty++;
+		}
+	}
+}
+
+//==========================================================================
+//
+// GetReservedBytes
+//
+// Returns how much memory the slabs take up, including free blocks.
+//
+//==========================================================================
+
+size_t GetReservedBytes()
+{
+	return ReservedBytes;
+}
+
+//==========================================================================
+//
+// PrintStats
+//
+//==========================================================================
+
+void PrintStats()
+{
+	size_t usedbytes = 0;
+
+	Printf("%5s %6s %8s %8s %12s\n", "Size", "Slabs", "Used", "Free", "Allocs");
+	for (int i = 0; i < NUM_SIZE_CLASSES; i++)
+	{
+		const FSizeClass &sc = SizeClasses[i];
+		if (sc.NumAllocs == 0)
+		{
+			continue;
+		}
+
+		const unsigned int blocksize = (i + 1) * BLOCK_ALIGN;
+		const unsigned int capacity = sc.NumSlabs * ((SLAB_SIZE - SLAB_HEADER_SIZE) / blocksize);
+
+		Printf("%5u %6u %8u %8u %12llu\n", blocksize, sc.NumSlabs, sc.NumUsed, capacity - sc.NumUsed,
+			(unsigned long long)sc.NumAllocs);
+		usedbytes += (size_t)sc.NumUsed * blocksize;
+	}
+	Printf("%u big objects (%llu allocated)\n", NumBigObjects, (unsigned long long)NumBigAllocs);
+	Printf("%zuK in slabs, %zuK of them used by small objects\n", (ReservedBytes + 1023) >> 10, (usedbytes + 1023) >> 10);
+}
+
+//==========================================================================
+//
+// PrintClassStats
+//
+// Lists the classes that had the most objects created through
+// PClass::CreateNew, which is how every actor is spawned.
+//
+//==========================================================================
+
+void PrintClassStats(unsigned int count)
+{
+	TArray<const PClass *> classes;
+
+	for (unsigned int i = 0; i < PClass::m_Types.Size(); i++)
+	{
+		if (PClass::m_Types[i]->NumAllocs > 0)
+		{
+			classes.Push(PClass::m_Types[i]);
+		}
+	}
+
+	// Only the first few are needed, so a partial selection sort will do.
+	count = MIN(count, classes.Size());
+	for (unsigned int i = 0; i < count; i++)
+	{
+		unsigned int best = i;
+		for (unsigned int j = i + 1; j < classes.Size(); j++)
+		{
+			if (classes[j]->NumAllocs > classes[best]->NumAllocs)
+			{
+				best = j;
+			}
+		}
+		swapvalues(classes[i], classes[best]);
+		Printf("%12llu %5u %s\n", (unsigned long long)classes[i]->NumAllocs, classes[i]->Size,
+			classes[i]->TypeName.GetChars());
+	}
+}
+
+}
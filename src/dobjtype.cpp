@@ -255,8 +255,9 @@ const PClass *PClass::FindClass (FName zaname)
 // Create a new object that this class represents
 DObject *PClass::CreateNew () const
 {
-	BYTE *mem = (BYTE *)M_Malloc (Size);
+	BYTE *mem = (BYTE *)ObjectPool::Alloc (Size);
 	assert (mem != NULL);
+	NumAllocs++;
 
 	// Set this object's defaults before constructing it.
 	if (Defaults != NULL)
@@ -300,6 +301,7 @@ PClass *PClass::CreateDerivedClass (FName name, unsigned int size)
 	type->Size = size;
 	type->Pointers = NULL;
 	type->ConstructNative = ConstructNative;
+	type->NumAllocs = 0;
 	if (!notnew)
 	{
 		type->ClassIndex = m_Types.Push (type);
@@ -392,6 +394,7 @@ const PClass *PClass::FindClassTentative (FName name)
 	type->Size = -1;
 	type->Pointers = NULL;
 	type->ConstructNative = NULL;
+	type->NumAllocs = 0;
 	type->ClassIndex = m_Types.Push (type);
 	type->Defaults = NULL;
 	type->FlatPointers = NULL;
@@ -149,6 +149,9 @@ struct PClass
 
 	void (*ConstructNative)(void *);
 
+	// [dorch] How many objects CreateNew created.
+	mutable QWORD		 NumAllocs;
+
 	// The rest are all functions and static data ----------------
 	void InsertIntoHash ();
 	DObject *CreateNew () const;
@@ -46,6 +46,7 @@
 // [BB] New #includes.
 #include "cl_demo.h"
 #include "doomstat.h"
+#include "profiler.h"
 
 
 static cycle_t ThinkCycles;
@@ -409,6 +410,8 @@ void DThinker::RunThinkers ()
 {
 	int i, count;
 
+	PROF_ZONE( "Thinkers" );
+
 	ThinkCycles.Reset();
 
 	ThinkCycles.Clock();
@@ -469,6 +472,8 @@ int DThinker::TickThinkers (FThinkerList *list, FThinkerList *dest)
 				( node->IsKindOf( RUNTIME_CLASS( AActor )) == false ) ||
 				( static_cast<AActor *>( node ) != players[consoleplayer].mo ))
 			{
+				// [dorch] Profile the thinkers by class.
+				FProfileScope profScope( node->GetClass() );
 				node->Tick();
 			}
 			node->ObjectFlags &= ~OF_JustSpawned;
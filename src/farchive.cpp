@@ -665,6 +665,7 @@ void FArchive::AttachToFile (FFile &file)
 	unsigned int i;
 
 	m_HubTravel = false;
+	m_DemoKeyframe = false;
 	m_File = &file;
 	m_MaxObjectCount = m_ObjectCount = 0;
 	m_ObjectMap = NULL;
@@ -125,6 +125,8 @@ public:
 	void Close ();
 	bool IsOpen () const;
 	void GetSizes(unsigned int &one, unsigned int &two) const;
+	// [dorch] The imploded data in the format Open (void *memblock) expects.
+	const unsigned char *GetImplodedBuffer () const { return m_ImplodedBuffer; }
 
 	void Serialize (FArchive &arc);
 
@@ -159,6 +161,9 @@ public:
 		inline bool IsPeristent () const { return m_Persistent; }
 		
 		void SetHubTravel () { m_HubTravel = true; }
+		// [dorch] Demo keyframes keep the network IDs and the player slots of the client.
+		void SetDemoKeyframe () { m_DemoKeyframe = true; }
+		inline bool IsDemoKeyframe () const { return m_DemoKeyframe; }
 
 		void Close ();
 
@@ -221,6 +226,7 @@ protected:
 		bool m_Loading;			// extracting objects?
 		bool m_Storing;			// inserting objects?
 		bool m_HubTravel;		// travelling inside a hub?
+		bool m_DemoKeyframe;	// [dorch] snapshot for client demo seeking?
 		FFile *m_File;			// unerlying file object
 		DWORD m_ObjectCount;	// # of objects currently serialized
 		DWORD m_MaxObjectCount;
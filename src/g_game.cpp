@@ -113,10 +113,12 @@
 #include "a_lightning.h"
 #include "po_man.h"
 #include "voicechat.h"
+#include "za_database.h"
 
 #include <zlib.h>
 
 #include "g_hub.h"
+#include "profiler.h"
 
 static FRandom pr_dmspawn ("DMSpawn");
 static FRandom pr_pspawn ("PlayerSpawn");
@@ -1523,6 +1525,8 @@ void G_Ticker ()
 	ticcmd_t*	cmd;
 	LONG		lSize;
 
+	PROF_ZONE( "G_Ticker" );
+
 	// Client's don't spawn players until instructed by the server.
 	if ( NETWORK_InClientMode() == false )
 	{
@@ -1547,6 +1551,9 @@ void G_Ticker ()
 		CLIENTSTATISTICS_Tick( );
 	}
 
+	// [dorch] Keep loading the database rank index that was asked for.
+	DATABASE_Tick( );
+
 	if (ToggleFullscreen)
 	{
 		static char toggle_fullscreen[] = "toggle fullscreen";
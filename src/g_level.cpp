@@ -97,6 +97,8 @@
 #include "campaign.h"
 #include "joinqueue.h"
 #include "sv_save.h"
+#include "sv_demo.h"
+#include "za_database.h"
 #include "cooperative.h"
 #include "invasion.h"
 #include "possession.h"
@@ -1096,6 +1098,14 @@ void G_DoLoadLevel (int position, bool autosave)
 	CAMPAIGNINFO_s		*pInfo;
 	UCVarValue			Val;
 
+	// [dorch] Let the server's demo recorder know that the level changes.
+	if ( NETWORK_GetState( ) == NETSTATE_SERVER )
+		SERVERDEMO_NewLevel( );
+
+	// [dorch] Write what the last level stored in the database and forget the
+	// cached entries.
+	DATABASE_Flush( true );
+
 	// [BB] Make sure that dead spectators are respawned before moving to the next map.
 	if ( GAMEMODE_GetCurrentFlags() & GMF_DEADSPECTATORS )
 		GAMEMODE_RespawnDeadPlayersAndPopQueue( );
@@ -2206,7 +2216,8 @@ void G_SerializeLevel (FArchive &arc, bool hubLoad)
 	int i = level.totaltime;
 	
 	// [BC] In client mode, we just want to save the lines we've seen.
-	if ( NETWORK_InClientMode() )
+	// [dorch] Unless this is a demo keyframe, which needs the whole level.
+	if ( NETWORK_InClientMode() && ( arc.IsDemoKeyframe() == false ))
 	{
 		P_SerializeWorld( arc );
 		return;
@@ -2329,7 +2340,11 @@ void G_SerializeLevel (FArchive &arc, bool hubLoad)
 	FCanvasTextureInfo::Serialize (arc);
 	AM_SerializeMarkers(arc);
 
-	P_SerializePlayers (arc, hubLoad);
+	// [dorch] Demo keyframes restore the players into their original slots.
+	if ( arc.IsDemoKeyframe() )
+		P_SerializePlayerSlots (arc);
+	else
+		P_SerializePlayers (arc, hubLoad);
 	CHAT_SerializeMessages (arc); // [AK]
 	P_SerializeSounds (arc);
 	if (arc.IsLoading())
@@ -419,13 +419,13 @@ static void DoSubsector(subsector_t * sub)
 
 		//if (!gl_multithreading)
 		{
-			for (i = ParticlesInSubsec[DWORD(sub-subsectors)]; i != NO_PARTICLE; i = Particles[i].snext)
+			for (i = ParticlesInSubsec[DWORD(sub-subsectors)]; i < ParticlesInSubsec[DWORD(sub-subsectors)+1]; i++)
 			{
 				GLRenderer->ProcessParticle(&Particles[i], fakesector);
 			}
 		}
 		/*
-		else if (ParticlesInSubsec[DWORD(sub-subsectors)] != NO_PARTICLE)
+		else if (ParticlesInSubsec[DWORD(sub-subsectors)] != ParticlesInSubsec[DWORD(sub-subsectors)+1])
 		{
 			FJob job = new FGLJobProcessParticles(sub);
 			GLRenderer->mThreadManager->AddJob(job);
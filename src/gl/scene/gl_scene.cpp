@@ -55,6 +55,7 @@
 #include "r_utility.h"
 #include "a_hexenglobal.h"
 #include "p_local.h"
+#include "profiler.h"
 #include "gl/gl_functions.h"
 
 #include "gl/system/gl_interface.h"
@@ -343,6 +344,8 @@ void FGLRenderer::SetupView(fixed_t viewx, fixed_t viewy, fixed_t viewz, angle_t
 
 void FGLRenderer::CreateScene()
 {
+	PROF_ZONE("GL CreateScene");
+
 	// reset the portal manager
 	GLPortal::StartFrame();
 	PO_LinkToSubsectors();
@@ -377,6 +380,7 @@ void FGLRenderer::CreateScene()
 
 void FGLRenderer::RenderScene(int recursion)
 {
+	PROF_ZONE("GL RenderScene");
 	RenderAll.Clock();
 
 	glDepthMask(true);
@@ -577,6 +581,7 @@ void FGLRenderer::RenderScene(int recursion)
 
 void FGLRenderer::RenderTranslucent()
 {
+	PROF_ZONE("GL RenderTranslucent");
 	RenderAll.Clock();
 
 	glDepthMask(false);
@@ -38,11 +38,23 @@
 #include "gl/system/gl_interface.h"
 #include "gl/renderer/gl_renderer.h"
 #include "gl/textures/gl_texture.h"
+#include "gl/textures/gl_bitmap.h"
 #include "c_cvars.h"
+#include "c_dispatch.h"
+#include "cmdlib.h"
+#include "m_misc.h"
+#include "md5.h"
+#include "m_swap.h"
+#include "r_thread.h"
+#include "stats.h"
+#include "templates.h"
+#include "v_text.h"
+#include "textures/textures.h"
 #include "gl/hqnx/hqx.h"
 #ifdef _MSC_VER
 #include "gl/hqnx_asm/hqnx_asm.h"
 #endif
+#include <zlib.h>
 
 CUSTOM_CVAR(Int, gl_texture_hqresize, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG | CVAR_NOINITCALL)
 {
@@ -66,13 +78,27 @@ CVAR (Flag, gl_texture_hqresize_textures, gl_texture_hqresize_targets, 1);
 CVAR (Flag, gl_texture_hqresize_sprites, gl_texture_hqresize_targets, 2);
 CVAR (Flag, gl_texture_hqresize_fonts, gl_texture_hqresize_targets, 4);
 
+// [dorch] Threads that share the upscaling of one texture. 0 uses one per CPU.
+CUSTOM_CVAR(Int, gl_texture_hqresize_threads, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	if (self < 0) self = 0;
+	else if (self > MAX_RENDER_THREADS) self = MAX_RENDER_THREADS;
+}
+
+// [dorch] Keep upscaled textures in the cache directory so that they don't
+// have to be made again the next time.
+CVAR(Bool, gl_texture_hqresize_cache, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 
-static void scale2x ( uint32* inputBuffer, uint32* outputBuffer, int inWidth, int inHeight )
+
+// [dorch] The scaleNx functions only fill the output made from the input
+// columns [firstCol, lastCol), so that an image can be split up between
+// threads.
+static void scale2x ( uint32* inputBuffer, uint32* outputBuffer, int inWidth, int inHeight, int firstCol, int lastCol )
 {
 	const int width = 2* inWidth;
 	const int height = 2 * inHeight;
 
-	for ( int i = 0; i < inWidth; ++i )
+	for ( int i = firstCol; i < lastCol; ++i )
 	{
 		const int iMinus = (i > 0) ? (i-1) : 0;
 		const int iPlus = (i < inWidth - 1 ) ? (i+1) : i;
@@ -104,12 +130,12 @@ static void scale2x ( uint32* inputBuffer, uint32* outputBuffer, int inWidth, in
 	}
 }
 
-static void scale3x ( uint32* inputBuffer, uint32* outputBuffer, int inWidth, int inHeight )
+static void scale3x ( uint32* inputBuffer, uint32* outputBuffer, int inWidth, int inHeight, int firstCol, int lastCol )
 {
 	const int width = 3* inWidth;
 	const int height = 3 * inHeight;
 
-	for ( int i = 0; i < inWidth; ++i )
+	for ( int i = firstCol; i < lastCol; ++i )
 	{
 		const int iMinus = (i > 0) ? (i-1) : 0;
 		const int iPlus = (i < inWidth - 1 ) ? (i+1) : i;
@@ -151,35 +177,81 @@ static void scale3x ( uint32* inputBuffer, uint32* outputBuffer, int inWidth, in
 	}
 }
 
-static void scale4x ( uint32* inputBuffer, uint32* outputBuffer, int inWidth, int inHeight )
+//===========================================================================
+//
+// [dorch] Multithreaded upscaling
+//
+// The image is split into column (scaleNx) or row (hqNx) ranges that are
+// filtered on the render thread pool. Each range reads its neighbors from
+// the whole input, so the output is the same as with one thread.
+//
+//===========================================================================
+
+struct FUpscaleJob
 {
-	int width = 2* inWidth;
-	int height = 2 * inHeight;
-	uint32 * buffer2x = new uint32[width*height];
-
-	scale2x ( reinterpret_cast<uint32*> ( inputBuffer ), reinterpret_cast<uint32*> ( buffer2x ), inWidth, inHeight );
-	width *= 2;
-	height *= 2;
-	scale2x ( reinterpret_cast<uint32*> ( buffer2x ), reinterpret_cast<uint32*> ( outputBuffer ), 2*inWidth, 2*inHeight );
-	delete[] buffer2x;
-}
+	int Type;
+	uint32 *Input;
+	uint32 *Output;
+	int Width, Height;
+};
 
+static void UpscaleSlice (int slice, int numslices, void *data)
+{
+	const FUpscaleJob *job = (const FUpscaleJob *)data;
+	const int w = job->Width;
+	const int h = job->Height;
+	int first, last;
 
-static unsigned char *scaleNxHelper( void (*scaleNxFunction) ( uint32* , uint32* , int , int),
-							  const int N,
-							  unsigned char *inputBuffer,
-							  const int inWidth,
-							  const int inHeight,
-							  int &outWidth,
-							  int &outHeight )
+	switch (job->Type)
+	{
+	case 1:
+		R_GetSliceBounds (slice, numslices, w, first, last);
+		scale2x (job->Input, job->Output, w, h, first, last + 1);
+		break;
+	case 2:
+		R_GetSliceBounds (slice, numslices, w, first, last);
+		scale3x (job->Input, job->Output, w, h, first, last + 1);
+		break;
+	case 4:
+		R_GetSliceBounds (slice, numslices, h, first, last);
+		hq2x_32_rows (job->Input, w * 4, job->Output, w * 4 * 2, w, h, first, last + 1);
+		break;
+	case 5:
+		R_GetSliceBounds (slice, numslices, h, first, last);
+		hq3x_32_rows (job->Input, w * 4, job->Output, w * 4 * 3, w, h, first, last + 1);
+		break;
+	case 6:
+		R_GetSliceBounds (slice, numslices, h, first, last);
+		hq4x_32_rows (job->Input, w * 4, job->Output, w * 4 * 4, w, h, first, last + 1);
+		break;
+	}
+}
+
+// threads is a thread count override, so -1 means one per CPU.
+static void RunUpscaleJob (FUpscaleJob &job, int threads)
 {
-	outWidth = N * inWidth;
-	outHeight = N *inHeight;
-	unsigned char * newBuffer = new unsigned char[outWidth*outHeight*4];
+	// Small textures aren't worth waking up the other threads for.
+	if (threads != 1 && job.Width * job.Height >= 64*64)
+	{
+		R_SetRenderThreadOverride (threads);
+		R_RunSlices (R_GetRenderThreadCount() * 2, UpscaleSlice, &job);
+		R_SetRenderThreadOverride (0);
+	}
+	else
+	{
+		UpscaleSlice (0, 1, &job);
+	}
+}
 
-	scaleNxFunction ( reinterpret_cast<uint32*> ( inputBuffer ), reinterpret_cast<uint32*> ( newBuffer ), inWidth, inHeight );
-	delete[] inputBuffer;
-	return newBuffer;
+static int GetUpscaleFactor (int type)
+{
+	switch (type)
+	{
+	case 1: case 4: case 7:	return 2;
+	case 2: case 5: case 8:	return 3;
+	case 3: case 6: case 9:	return 4;
+	}
+	return 1;
 }
 
 // [BB] hqnx scaling is only supported with the MS compiler.
@@ -209,33 +281,174 @@ static unsigned char *hqNxAsmHelper( void (*hqNxFunction) ( int*, unsigned char*
 
 	unsigned char * newBuffer = new unsigned char[outWidth*outHeight*4];
 	hqNxFunction( reinterpret_cast<int*>(cImageIn.m_pBitmap), newBuffer, cImageIn.m_Xres, cImageIn.m_Yres, outWidth*4 );
-	delete[] inputBuffer;
 	return newBuffer;
 }
 #endif
 
-static unsigned char *hqNxHelper( void (*hqNxFunction) ( unsigned*, unsigned*, int, int ),
-							  const int N,
-							  unsigned char *inputBuffer,
-							  const int inWidth,
-							  const int inHeight,
-							  int &outWidth,
-							  int &outHeight )
+//===========================================================================
+//
+// UpscaleBuffer
+//
+// [dorch] Upscales inputBuffer with the given gl_texture_hqresize type and
+// returns a new buffer. Unlike gl_CreateUpsampledTextureBuffer, this does
+// not free the input.
+//
+//===========================================================================
+
+static unsigned char *UpscaleBuffer (int type, unsigned char *inputBuffer, int inWidth, int inHeight, int &outWidth, int &outHeight, int threads)
 {
-	static int initdone = false;
+	static bool hqxinitdone = false;
+	const int N = GetUpscaleFactor (type);
 
-	if (!initdone)
+	outWidth = N * inWidth;
+	outHeight = N * inHeight;
+
+	if (type >= 4 && type <= 6 && !hqxinitdone)
 	{
 		hqxInit();
-		initdone = true;
+		hqxinitdone = true;
 	}
-	outWidth = N * inWidth;
-	outHeight = N *inHeight;
 
-	unsigned char * newBuffer = new unsigned char[outWidth*outHeight*4];
-	hqNxFunction( reinterpret_cast<unsigned*>(inputBuffer), reinterpret_cast<unsigned*>(newBuffer), inWidth, inHeight );
-	delete[] inputBuffer;
-	return newBuffer;
+	unsigned char *newBuffer;
+	FUpscaleJob job = { type, reinterpret_cast<uint32*>(inputBuffer), NULL, inWidth, inHeight };
+
+	switch (type)
+	{
+	case 1: case 2: case 4: case 5: case 6:
+		newBuffer = new unsigned char[outWidth*outHeight*4];
+		job.Output = reinterpret_cast<uint32*>(newBuffer);
+		RunUpscaleJob (job, threads);
+		return newBuffer;
+
+	case 3:
+	{
+		// scale4x is scale2x done twice.
+		unsigned char *buffer2x = new unsigned char[inWidth*inHeight*4*4];
+		job.Type = 1;
+		job.Output = reinterpret_cast<uint32*>(buffer2x);
+		RunUpscaleJob (job, threads);
+
+		newBuffer = new unsigned char[outWidth*outHeight*4];
+		job.Input = job.Output;
+		job.Output = reinterpret_cast<uint32*>(newBuffer);
+		job.Width *= 2;
+		job.Height *= 2;
+		RunUpscaleJob (job, threads);
+		delete[] buffer2x;
+		return newBuffer;
+	}
+
+#ifdef _MSC_VER
+	case 7:
+		return hqNxAsmHelper( &HQnX_asm::hq2x_32, 2, inputBuffer, inWidth, inHeight, outWidth, outHeight );
+	case 8:
+		return hqNxAsmHelper( &HQnX_asm::hq3x_32, 3, inputBuffer, inWidth, inHeight, outWidth, outHeight );
+	case 9:
+		return hqNxAsmHelper( &HQnX_asm::hq4x_32, 4, inputBuffer, inWidth, inHeight, outWidth, outHeight );
+#endif
+	}
+
+	outWidth = inWidth;
+	outHeight = inHeight;
+	return NULL;
+}
+
+static int GetUpscaleThreads ()
+{
+	return gl_texture_hqresize_threads > 0 ? *gl_texture_hqresize_threads : -1;
+}
+
+//===========================================================================
+//
+// Upscale cache
+//
+// [dorch] Upscaled textures are stored zlib-compressed in the cache
+// directory, named after the MD5 of the scaling type, the size and the
+// input pixels, so any change to the texture or the settings misses.
+//
+//===========================================================================
+
+static void GetUpscaleCacheKey (int type, const unsigned char *inputBuffer, int inWidth, int inHeight, BYTE digest[16])
+{
+	MD5Context md5;
+	DWORD header[3] = { LittleLong(DWORD(type)), LittleLong(DWORD(inWidth)), LittleLong(DWORD(inHeight)) };
+
+	md5.Update ((const BYTE *)header, sizeof(header));
+	md5.Update (inputBuffer, inWidth * inHeight * 4);
+	md5.Final (digest);
+}
+
+static FString GetUpscaleCacheName (const BYTE digest[16], bool create)
+{
+	FString path = M_GetCachePath(create);
+	path << "/hqresize";
+	if (create) CreatePath(path);
+
+	path << '/';
+	for (int i = 0; i < 16; ++i)
+	{
+		path.AppendFormat ("%02x", digest[i]);
+	}
+	path << ".hqc";
+	return path;
+}
+
+static unsigned char *ReadUpscaleCache (const BYTE digest[16], int outWidth, int outHeight)
+{
+	FString path = GetUpscaleCacheName (digest, false);
+	FILE *f = fopen (path, "rb");
+	if (f == NULL) return NULL;
+
+	char magic[4];
+	DWORD header[3];
+	unsigned char *compressed = NULL;
+	unsigned char *buffer = NULL;
+
+	if (fread (magic, 1, 4, f) != 4 || memcmp (magic, "HQC1", 4) != 0 ||
+		fread (header, 4, 3, f) != 3 ||
+		LittleLong(header[0]) != DWORD(outWidth) || LittleLong(header[1]) != DWORD(outHeight))
+	{
+		fclose (f);
+		return NULL;
+	}
+
+	const DWORD complen = LittleLong(header[2]);
+	uLongf outlen = outWidth * outHeight * 4;
+
+	compressed = new unsigned char[complen];
+	buffer = new unsigned char[outlen];
+	if (fread (compressed, 1, complen, f) != complen ||
+		uncompress (buffer, &outlen, compressed, complen) != Z_OK ||
+		outlen != uLongf(outWidth * outHeight * 4))
+	{
+		delete[] buffer;
+		buffer = NULL;
+	}
+	delete[] compressed;
+	fclose (f);
+	return buffer;
+}
+
+static void WriteUpscaleCache (const BYTE digest[16], const unsigned char *buffer, int outWidth, int outHeight)
+{
+	const uLong size = outWidth * outHeight * 4;
+	uLongf complen = compressBound (size);
+	unsigned char *compressed = new unsigned char[complen];
+
+	if (compress2 (compressed, &complen, buffer, size, Z_BEST_SPEED) == Z_OK)
+	{
+		FString path = GetUpscaleCacheName (digest, true);
+		FILE *f = fopen (path, "wb");
+		if (f != NULL)
+		{
+			DWORD header[3] = { LittleLong(DWORD(outWidth)), LittleLong(DWORD(outHeight)), LittleLong(DWORD(complen)) };
+			fwrite ("HQC1", 1, 4, f);
+			fwrite (header, 4, 3, f);
+			fwrite (compressed, 1, complen, f);
+			fclose (f);
+		}
+	}
+	delete[] compressed;
 }
 
 
@@ -293,29 +506,136 @@ unsigned char *gl_CreateUpsampledTextureBuffer ( const FTexture *inputTexture, u
 		}
 #endif
 
-		switch (type)
+		// [dorch] Try the disk cache before doing the work.
+		BYTE digest[16];
+		const bool usecache = gl_texture_hqresize_cache && GetUpscaleFactor (type) > 1;
+		unsigned char *newBuffer = NULL;
+
+		if (usecache)
 		{
-		case 1:
-			return scaleNxHelper( &scale2x, 2, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-		case 2:
-			return scaleNxHelper( &scale3x, 3, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-		case 3:
-			return scaleNxHelper( &scale4x, 4, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-		case 4:
-			return hqNxHelper( &hq2x_32, 2, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-		case 5:
-			return hqNxHelper( &hq3x_32, 3, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-		case 6:
-			return hqNxHelper( &hq4x_32, 4, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-#ifdef _MSC_VER
-		case 7:
-			return hqNxAsmHelper( &HQnX_asm::hq2x_32, 2, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-		case 8:
-			return hqNxAsmHelper( &HQnX_asm::hq3x_32, 3, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-		case 9:
-			return hqNxAsmHelper( &HQnX_asm::hq4x_32, 4, inputBuffer, inWidth, inHeight, outWidth, outHeight );
-#endif
+			const int N = GetUpscaleFactor (type);
+			GetUpscaleCacheKey (type, inputBuffer, inWidth, inHeight, digest);
+			newBuffer = ReadUpscaleCache (digest, N * inWidth, N * inHeight);
+			if (newBuffer != NULL)
+			{
+				outWidth = N * inWidth;
+				outHeight = N * inHeight;
+			}
+		}
+		if (newBuffer == NULL)
+		{
+			newBuffer = UpscaleBuffer (type, inputBuffer, inWidth, inHeight, outWidth, outHeight, GetUpscaleThreads ());
+			if (newBuffer != NULL && usecache)
+			{
+				WriteUpscaleCache (digest, newBuffer, outWidth, outHeight);
+			}
+		}
+		if (newBuffer != NULL)
+		{
+			delete[] inputBuffer;
+			return newBuffer;
 		}
 	}
 	return inputBuffer;
 }
+
+//===========================================================================
+//
+// CCMD gl_benchhqresize
+//
+// [dorch] Upscales every wall texture, flat and sprite that is loaded with
+// one thread and with gl_texture_hqresize_threads, checks that both give
+// the same result and also times reading them back from the disk cache.
+// Usage: gl_benchhqresize [type], type defaults to gl_texture_hqresize.
+//
+//===========================================================================
+
+CCMD (gl_benchhqresize)
+{
+	const int type = argv.argc() > 1 ? atoi (argv[1]) : *gl_texture_hqresize;
+
+	if (type < 1 || type > 6)
+	{
+		Printf ("Usage: gl_benchhqresize [1-6]\n");
+		return;
+	}
+
+	cycle_t serialtime, threadtime, cachetime;
+	double inpixels = 0;
+	int numtextures = 0, mismatches = 0, cachehits = 0;
+
+	serialtime.Reset();
+	threadtime.Reset();
+	cachetime.Reset();
+
+	for (int i = 0; i < TexMan.NumTextures(); ++i)
+	{
+		FTexture *tex = TexMan.ByIndex(i);
+
+		if (tex == NULL || tex->bHasCanvas || tex->bWarped)
+			continue;
+		if (tex->UseType != FTexture::TEX_Wall && tex->UseType != FTexture::TEX_Flat &&
+			tex->UseType != FTexture::TEX_Sprite && tex->UseType != FTexture::TEX_Override)
+			continue;
+
+		const int w = tex->GetWidth();
+		const int h = tex->GetHeight();
+		if (w <= 0 || h <= 0 || w > gl_texture_hqresize_maxinputsize || h > gl_texture_hqresize_maxinputsize)
+			continue;
+
+		unsigned char *input = new unsigned char[w*h*4];
+		memset (input, 0, w*h*4);
+		FGLBitmap bmp(input, w*4, w, h);
+		tex->CopyTrueColorPixels (&bmp, 0, 0);
+
+		int ow, oh;
+		serialtime.Clock();
+		unsigned char *serial = UpscaleBuffer (type, input, w, h, ow, oh, 1);
+		serialtime.Unclock();
+
+		threadtime.Clock();
+		unsigned char *threaded = UpscaleBuffer (type, input, w, h, ow, oh, GetUpscaleThreads ());
+		threadtime.Unclock();
+
+		if (memcmp (serial, threaded, ow*oh*4) != 0)
+		{
+			mismatches++;
+		}
+
+		if (gl_texture_hqresize_cache)
+		{
+			BYTE digest[16];
+			GetUpscaleCacheKey (type, input, w, h, digest);
+			WriteUpscaleCache (digest, threaded, ow, oh);
+
+			cachetime.Clock();
+			unsigned char *cached = ReadUpscaleCache (digest, ow, oh);
+			cachetime.Unclock();
+			if (cached != NULL)
+			{
+				cachehits++;
+				delete[] cached;
+			}
+		}
+
+		inpixels += w * h;
+		numtextures++;
+		delete[] input;
+		delete[] serial;
+		delete[] threaded;
+	}
+
+	R_SetRenderThreadOverride (GetUpscaleThreads ());
+	const int threads = R_GetRenderThreadCount();
+	R_SetRenderThreadOverride (0);
+
+	Printf ("Upscaled %d textures (%.2f Mpixels) with type %d:\n", numtextures, inpixels / 1e6, type);
+	Printf ("  1 thread:   %8.1f ms\n", serialtime.TimeMS());
+	Printf ("  %2d threads: %8.1f ms (%.2fx)%s\n", threads, threadtime.TimeMS(),
+		threadtime.TimeMS() > 0 ? serialtime.TimeMS() / threadtime.TimeMS() : 0.,
+		mismatches ? TEXTCOLOR_RED " MISMATCH" TEXTCOLOR_NORMAL : "");
+	if (gl_texture_hqresize_cache)
+	{
+		Printf ("  disk cache: %8.1f ms (%d of %d read back)\n", cachetime.TimeMS(), cachehits, numtextures);
+	}
+}
@@ -31,6 +31,11 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <time.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "doomtype.h"
 #include "version.h"
@@ -84,6 +89,7 @@ CVAR(Bool, screenshot_quiet, false, CVAR_ARCHIVE|CVAR_GLOBALCONFIG);
 CVAR(String, screenshot_type, "png", CVAR_ARCHIVE|CVAR_GLOBALCONFIG);
 CVAR(String, screenshot_dir, "", CVAR_ARCHIVE|CVAR_GLOBALCONFIG);
 EXTERN_CVAR(Bool, longsavemessages);
+EXTERN_CVAR(Float, png_gamma);
 
 static long ParseCommandLine (const char *args, int *argc, char **argv);
 
@@ -788,6 +794,221 @@ CCMD (screenshot)
 		G_ScreenShot (argv[1]);
 }
 
+//==========================================================================
+//
+// [dorch] Asynchronous screenshots
+//
+// M_ScreenShotAsync only copies the current frame into a pooled buffer on
+// the calling thread. Compressing and writing the PNG happen on a
+// background thread, so taking periodic screenshots doesn't stall the
+// game. The PNG is written to <filename>.tmp first and then renamed into
+// place, so readers never see a partially written file.
+//
+//==========================================================================
+
+CUSTOM_CVAR(Int, screenshot_async_level, 1, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+{
+	if (self < 0)
+		self = 0;
+	else if (self > 9)
+		self = 9;
+}
+
+// How many frames may be waiting for or being encoded at the same time.
+// Once they're all in use, further screenshots are dropped instead of
+// making the game wait for the encoder.
+enum { MAX_ASYNC_SHOTS = 2 };
+
+struct FAsyncShot
+{
+	FString Filename;
+	std::vector<BYTE> Pixels;
+	PalEntry Palette[256];
+	ESSType ColorType;
+	int Width, Height, Pitch;
+	int Level;
+	float Gamma;
+};
+
+static std::mutex AsyncShotMutex;
+static std::condition_variable AsyncShotCond;
+static std::thread AsyncShotThread;
+static std::deque<FAsyncShot *> AsyncShotQueue;
+static std::vector<FAsyncShot *> AsyncShotPool;
+static int AsyncShotsAllocated;
+static bool AsyncShotQuit;
+static FString AsyncShotError;
+
+static bool WriteAsyncShot (const FAsyncShot *shot, FString &error)
+{
+	FString tmpname = shot->Filename + ".tmp";
+	FILE *file = fopen (tmpname, "wb");
+	if (file == NULL)
+	{
+		error.Format ("Could not open %s: %s", tmpname.GetChars(), strerror (errno));
+		return false;
+	}
+
+	char software[100];
+	mysnprintf(software, countof(software), GAMENAME " %s", GetVersionString());
+	bool ok = M_CreatePNG (file, &shot->Pixels[0], shot->Palette, shot->ColorType,
+			shot->Width, shot->Height, shot->Pitch, shot->Level, shot->Gamma) &&
+		M_AppendPNGText (file, "Software", software) &&
+		M_FinishPNG (file);
+	ok = (fclose (file) == 0) && ok;
+
+	if (!ok)
+	{
+		error.Format ("Could not write %s", tmpname.GetChars());
+		remove (tmpname);
+		return false;
+	}
+
+#ifdef _WIN32
+	// Windows rename() fails if destination exists.
+	remove (shot->Filename);
+#endif
+	if (rename (tmpname, shot->Filename) != 0)
+	{
+		error.Format ("Could not move %s into place: %s", shot->Filename.GetChars(), strerror (errno));
+		remove (tmpname);
+		return false;
+	}
+	return true;
+}
+
+static void AsyncShotWorker ()
+{
+	std::unique_lock<std::mutex> lock (AsyncShotMutex);
+
+	for (;;)
+	{
+		AsyncShotCond.wait (lock, [] { return AsyncShotQuit || !AsyncShotQueue.empty(); });
+		if (AsyncShotQueue.empty())
+		{
+			break;
+		}
+		FAsyncShot *shot = AsyncShotQueue.front();
+		AsyncShotQueue.pop_front();
+
+		lock.unlock();
+		FString error;
+		bool ok = WriteAsyncShot (shot, error);
+		lock.lock();
+
+		if (!ok)
+		{
+			AsyncShotError = error;
+		}
+		AsyncShotPool.push_back (shot);
+	}
+}
+
+static void M_ShutdownAsyncScreenShots ()
+{
+	{
+		std::lock_guard<std::mutex> lock (AsyncShotMutex);
+		AsyncShotQuit = true;
+	}
+	AsyncShotCond.notify_one();
+
+	// Let the worker finish whatever was already captured.
+	if (AsyncShotThread.joinable())
+	{
+		AsyncShotThread.join();
+	}
+	for (FAsyncShot *shot : AsyncShotPool)
+	{
+		delete shot;
+	}
+	AsyncShotPool.clear();
+	AsyncShotsAllocated = 0;
+}
+
+bool M_ScreenShotAsync (const char *filename)
+{
+	FAsyncShot *shot = NULL;
+	FString error;
+
+	{
+		std::lock_guard<std::mutex> lock (AsyncShotMutex);
+		error = AsyncShotError;
+		AsyncShotError = "";
+
+		if (!AsyncShotPool.empty())
+		{
+			shot = AsyncShotPool.back();
+			AsyncShotPool.pop_back();
+		}
+		else if (AsyncShotsAllocated < MAX_ASYNC_SHOTS)
+		{
+			shot = new FAsyncShot;
+			AsyncShotsAllocated++;
+		}
+	}
+
+	if (error.IsNotEmpty())
+	{
+		Printf ("%s\n", error.GetChars());
+	}
+	if (shot == NULL)
+	{
+		DPrintf ("M_ScreenShotAsync: Encoder is busy, skipping %s\n", filename);
+		return false;
+	}
+
+	const BYTE *buffer;
+	int pitch;
+	ESSType color_type;
+
+	screen->GetScreenshotBuffer(buffer, pitch, color_type);
+	if (buffer == NULL)
+	{
+		std::lock_guard<std::mutex> lock (AsyncShotMutex);
+		AsyncShotPool.push_back (shot);
+		return false;
+	}
+
+	const int bpp = (color_type == SS_PAL) ? 1 : (color_type == SS_RGB) ? 3 : 4;
+	const int width = screen->GetWidth();
+	const int height = screen->GetHeight();
+	const int rowsize = width * bpp;
+
+	// The buffer keeps its allocation between shots, so this is just a copy
+	// unless the resolution went up.
+	shot->Pixels.resize (rowsize * height);
+	for (int y = 0; y < height; ++y)
+	{
+		memcpy (&shot->Pixels[y * rowsize], buffer + y * pitch, rowsize);
+	}
+	if (color_type == SS_PAL)
+	{
+		screen->GetFlashedPalette(shot->Palette);
+	}
+	screen->ReleaseScreenshotBuffer();
+
+	shot->Filename = filename;
+	shot->ColorType = color_type;
+	shot->Width = width;
+	shot->Height = height;
+	shot->Pitch = rowsize;
+	shot->Level = screenshot_async_level;
+	shot->Gamma = (png_gamma == 0.f ? Gamma : png_gamma);
+
+	{
+		std::lock_guard<std::mutex> lock (AsyncShotMutex);
+		AsyncShotQueue.push_back (shot);
+		if (!AsyncShotThread.joinable())
+		{
+			AsyncShotQuit = false;
+			AsyncShotThread = std::thread (AsyncShotWorker);
+			atterm (M_ShutdownAsyncScreenShots);
+		}
+	}
+	AsyncShotCond.notify_one();
+	return true;
+}
+
 //
 // M_ZlibError
 //
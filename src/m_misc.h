@@ -42,6 +42,10 @@ void M_FindResponseFile (void);
 //		Pass a NULL to get the original behavior.
 void M_ScreenShot (const char *filename);
 
+// [dorch] Copies the current frame and writes it as a PNG to filename on a
+// background thread. Returns false if the frame was dropped.
+bool M_ScreenShotAsync (const char *filename);
+
 void M_LoadDefaults ();
 
 bool M_SaveDefaults (const char *filename);
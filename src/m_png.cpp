@@ -132,7 +132,8 @@ CVAR(Float, png_gamma, 0.f, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 //==========================================================================
 
 bool M_CreatePNG (FILE *file, const BYTE *buffer, const PalEntry *palette,
-				  ESSType color_type, int width, int height, int pitch)
+				  ESSType color_type, int width, int height, int pitch,
+				  int level, float gamma)
 {
 	BYTE work[8 +				// signature
 			  12+2*4+5 +		// IHDR
@@ -157,7 +158,11 @@ bool M_CreatePNG (FILE *file, const BYTE *buffer, const PalEntry *palette,
 	MakeChunk (ihdr, MAKE_ID('I','H','D','R'), 2*4+5);
 
 	// Assume a display exponent of 2.2 (100000/2.2 ~= 45454.5)
-	*gama = BigLong (int (45454.5f * (png_gamma == 0.f ? Gamma : png_gamma)));
+	if (gamma < 0.f)
+	{
+		gamma = (png_gamma == 0.f ? Gamma : png_gamma);
+	}
+	*gama = BigLong (int (45454.5f * gamma));
 	MakeChunk (gama, MAKE_ID('g','A','M','A'), 4);
 
 	if (color_type == SS_PAL)
@@ -174,7 +179,7 @@ bool M_CreatePNG (FILE *file, const BYTE *buffer, const PalEntry *palette,
 	if (fwrite (work, 1, work_len, file) != work_len)
 		return false;
 
-	return M_SaveBitmap (buffer, color_type, width, height, pitch, file);
+	return M_SaveBitmap (buffer, color_type, width, height, pitch, file, level);
 }
 
 //==========================================================================
@@ -900,7 +905,7 @@ static int SelectFilter(Byte row[5][1 + MAXWIDTH*3], Byte prior[MAXWIDTH*3], int
 //
 //==========================================================================
 
-bool M_SaveBitmap(const BYTE *from, ESSType color_type, int width, int height, int pitch, FILE *file)
+bool M_SaveBitmap(const BYTE *from, ESSType color_type, int width, int height, int pitch, FILE *file, int level)
 {
 #if USE_FILTER_HEURISTIC
 	Byte prior[MAXWIDTH*3];
@@ -917,7 +922,7 @@ bool M_SaveBitmap(const BYTE *from, ESSType color_type, int width, int height, i
 	stream.avail_in = 0;
 	stream.zalloc = Z_NULL;
 	stream.zfree = Z_NULL;
-	err = deflateInit (&stream, png_level);
+	err = deflateInit (&stream, (level < 0) ? *png_level : clamp (level, 0, 9));
 
 	if (err != Z_OK)
 	{
@@ -43,8 +43,11 @@
 // The passed file should be a newly created file.
 // This function writes the PNG signature and the IHDR, gAMA, PLTE, and IDAT
 // chunks.
+// [dorch] A negative level or gamma uses png_level and png_gamma. Pass them
+// explicitly when writing from another thread than the game's.
 bool M_CreatePNG (FILE *file, const BYTE *buffer, const PalEntry *pal,
-				  ESSType color_type, int width, int height, int pitch);
+				  ESSType color_type, int width, int height, int pitch,
+				  int level = -1, float gamma = -1.f);
 
 // Creates a grayscale 1x1 PNG file. Used for savegames without savepics.
 bool M_CreateDummyPNG (FILE *file);
@@ -58,7 +61,7 @@ bool M_AppendPNGText (FILE *file, const char *keyword, const char *text);
 // Appends the IEND chunk to a PNG file.
 bool M_FinishPNG (FILE *file);
 
-bool M_SaveBitmap(const BYTE *from, ESSType color_type, int width, int height, int pitch, FILE *file);
+bool M_SaveBitmap(const BYTE *from, ESSType color_type, int width, int height, int pitch, FILE *file, int level = -1);
 
 // PNG Reading --------------------------------------------------------------
 
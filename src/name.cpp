@@ -44,9 +44,14 @@
 // that is just large enough to hold it.
 #define BLOCK_SIZE			4096
 
-// How many entries to grow the NameArray by when it needs to grow.
+// How many entries to grow the NameArray by the first time it needs to
+// grow. After that, it grows by half its size.
 #define NAME_GROW_AMOUNT	256
 
+// [dorch] The size the name hash table starts at. It doubles whenever it
+// gets more than half full.
+#define INITIAL_SLOTS		4096
+
 // TYPES -------------------------------------------------------------------
 
 // Name text is stored in a linked list of NameBlock structures. This
@@ -80,47 +85,69 @@ static const char *PredefinedNames[] =
 
 //==========================================================================
 //
-// FName :: NameManager :: FindName
-//
-// Returns the index of a name. If the name does not exist and noCreate is
-// true, then it returns false. If the name does not exist and noCreate is
-// false, then the name is added to the table and its new index is returned.
+// FName :: MakeHash
 //
 //==========================================================================
 
-int FName::NameManager::FindName (const char *text, bool noCreate)
+static inline unsigned int HashChar (unsigned int hash, unsigned char c)
 {
-	if (!Inited)
+	if ((unsigned)(c - 'A') < 26u)
 	{
-		InitBuckets ();
+		c += 'a' - 'A';
 	}
+	return (hash ^ c) * 16777619u;
+}
 
-	if (text == NULL)
+unsigned int FName::MakeHash (const char *text, size_t textlen)
+{
+	unsigned int hash = 2166136261u;
+
+	for (size_t i = 0; i < textlen; ++i)
 	{
-		return 0;
+		hash = HashChar (hash, text[i]);
 	}
+	return hash;
+}
+
+//==========================================================================
+//
+// FName :: MakeHashAndLength
+//
+//==========================================================================
 
-	unsigned int hash = MakeKey (text);
-	unsigned int bucket = hash % HASH_SIZE;
-	int scanner = Buckets[bucket];
+unsigned int FName::MakeHashAndLength (const char *text, size_t &textlen)
+{
+	const char *p = text;
+	unsigned int hash = 2166136261u;
 
-	// See if the name already exists.
-	while (scanner >= 0)
+	for (; *p != '\0'; ++p)
 	{
-		if (NameArray[scanner].Hash == hash && stricmp (NameArray[scanner].Text, text) == 0)
-		{
-			return scanner;
-		}
-		scanner = NameArray[scanner].NextHash;
+		hash = HashChar (hash, *p);
 	}
+	textlen = p - text;
+	return hash;
+}
 
-	// If we get here, then the name does not exist.
-	if (noCreate)
+//==========================================================================
+//
+// FName :: NameManager :: FindName
+//
+// Returns the index of a name. If the name does not exist and noCreate is
+// true, then it returns false. If the name does not exist and noCreate is
+// false, then the name is added to the table and its new index is returned.
+//
+//==========================================================================
+
+int FName::NameManager::FindName (const char *text, bool noCreate)
+{
+	if (text == NULL)
 	{
 		return 0;
 	}
 
-	return AddName (text, hash, bucket);
+	size_t textLen;
+	unsigned int hash = MakeHashAndLength (text, textLen);
+	return FindName (text, textLen, hash, noCreate);
 }
 
 //==========================================================================
@@ -131,6 +158,23 @@ int FName::NameManager::FindName (const char *text, bool noCreate)
 //==========================================================================
 
 int FName::NameManager::FindName (const char *text, size_t textLen, bool noCreate)
+{
+	if (text == NULL)
+	{
+		return 0;
+	}
+
+	return FindName (text, textLen, MakeHash (text, textLen), noCreate);
+}
+
+//==========================================================================
+//
+// The same as above, but the hash is also passed, for names from string
+// literals whose hashes are known when compiling.
+//
+//==========================================================================
+
+int FName::NameManager::FindName (const char *text, size_t textLen, unsigned int hash, bool noCreate)
 {
 	if (!Inited)
 	{
@@ -142,20 +186,21 @@ int FName::NameManager::FindName (const char *text, size_t textLen, bool noCreat
 		return 0;
 	}
 
-	unsigned int hash = MakeKey (text, textLen);
-	unsigned int bucket = hash % HASH_SIZE;
-	int scanner = Buckets[bucket];
+	// [dorch] Probe the table until the name or a free slot turns up. The
+	// table is never more than half full, so that doesn't take long.
+	const unsigned int mask = NumSlots - 1;
+	unsigned int slot = HomeSlot (hash);
+	int scanner;
 
-	// See if the name already exists.
-	while (scanner >= 0)
+	while ((scanner = Slots[slot].Index) >= 0)
 	{
-		if (NameArray[scanner].Hash == hash &&
+		if (Slots[slot].Hash == hash &&
 			strnicmp (NameArray[scanner].Text, text, textLen) == 0 &&
 			NameArray[scanner].Text[textLen] == '\0')
 		{
 			return scanner;
 		}
-		scanner = NameArray[scanner].NextHash;
+		slot = (slot + 1) & mask;
 	}
 
 	// If we get here, then the name does not exist.
@@ -164,7 +209,7 @@ int FName::NameManager::FindName (const char *text, size_t textLen, bool noCreat
 		return 0;
 	}
 
-	return AddName (text, hash, bucket);
+	return AddName (text, textLen, hash, slot);
 }
 
 //==========================================================================
@@ -178,7 +223,8 @@ int FName::NameManager::FindName (const char *text, size_t textLen, bool noCreat
 void FName::NameManager::InitBuckets ()
 {
 	Inited = true;
-	memset (Buckets, -1, sizeof(Buckets));
+	NumSlots = 0;
+	GrowSlots ();
 
 	// Register built-in names. 'None' must be name 0.
 	for (size_t i = 0; i < countof(PredefinedNames); ++i)
@@ -187,19 +233,60 @@ void FName::NameManager::InitBuckets ()
 	}
 }
 
+//==========================================================================
+//
+// FName :: NameManager :: GrowSlots
+//
+// Doubles the size of the hash table, or creates it, and puts every name
+// back into it.
+//
+//==========================================================================
+
+void FName::NameManager::GrowSlots ()
+{
+	unsigned int newsize = NumSlots == 0 ? INITIAL_SLOTS : NumSlots * 2;
+
+	if (Slots != NULL)
+	{
+		M_Free (Slots);
+	}
+	Slots = (NameSlot *)M_Malloc (newsize * sizeof(NameSlot));
+	NumSlots = newsize;
+	for (SlotShift = 32; newsize > 1; newsize >>= 1)
+	{
+		SlotShift--;
+	}
+
+	for (unsigned int i = 0; i < NumSlots; ++i)
+	{
+		Slots[i].Index = -1;
+	}
+	for (int i = 0; i < NumNames; ++i)
+	{
+		unsigned int slot = HomeSlot (NameArray[i].Hash);
+		while (Slots[slot].Index >= 0)
+		{
+			slot = (slot + 1) & (NumSlots - 1);
+		}
+		Slots[slot].Hash = NameArray[i].Hash;
+		Slots[slot].Index = i;
+	}
+}
+
 //==========================================================================
 //
 // FName :: NameManager :: AddName
 //
-// Adds a new name to the name table.
+// Adds a new name to the name table. slot is the free slot the lookup for
+// the name ended at.
 //
 //==========================================================================
 
-int FName::NameManager::AddName (const char *text, unsigned int hash, unsigned int bucket)
+int FName::NameManager::AddName (const char *text, size_t textLen, unsigned int hash, unsigned int slot)
 {
 	char *textstore;
 	NameBlock *block = Blocks;
-	size_t len = strlen (text) + 1;
+	size_t len = textLen + 1;
 
 	// Get a block large enough for the name. Only the first block in the
 	// list is ever considered for name storage.
@@ -210,7 +297,8 @@ int FName::NameManager::AddName (const char *text, unsigned int hash, unsigned i
 
 	// Copy the string into the block.
 	textstore = (char *)block + block->NextAlloc;
-	strcpy (textstore, text);
+	memcpy (textstore, text, textLen);
+	textstore[textLen] = '\0';
 	block->NextAlloc += len;
 
 	// Add an entry for the name to the NameArray
@@ -218,16 +306,24 @@ int FName::NameManager::AddName (const char *text, unsigned int hash, unsigned i
 	{
 		// If no names have been defined yet, make the first allocation
 		// large enough to hold all the predefined names.
-		MaxNames += MaxNames == 0 ? countof(PredefinedNames) + NAME_GROW_AMOUNT : NAME_GROW_AMOUNT;
+		MaxNames += MaxNames == 0 ? countof(PredefinedNames) + NAME_GROW_AMOUNT : MaxNames / 2;
 
 		NameArray = (NameEntry *)M_Realloc (NameArray, MaxNames * sizeof(NameEntry));
 	}
 
 	NameArray[NumNames].Text = textstore;
 	NameArray[NumNames].Hash = hash;
-	NameArray[NumNames].NextHash = Buckets[bucket];
-	Buckets[bucket] = NumNames;
 
+	// [dorch] Keep the table at most half full.
+	if ((unsigned int)(NumNames + 1) * 2 > NumSlots)
+	{
+		NumNames++;
+		GrowSlots ();
+		return NumNames - 1;
+	}
+
+	Slots[slot].Hash = hash;
+	Slots[slot].Index = NumNames;
 	return NumNames++;
 }
 
@@ -282,8 +378,14 @@ FName::NameManager::~NameManager()
 		M_Free (NameArray);
 		NameArray = NULL;
 	}
+	if (Slots != NULL)
+	{
+		M_Free (Slots);
+		Slots = NULL;
+	}
 	NumNames = MaxNames = 0;
-	memset (Buckets, -1, sizeof(Buckets));
+	NumSlots = 0;
+	Inited = false;
 }
 
 //==========================================================================
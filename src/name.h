@@ -34,6 +34,8 @@
 #ifndef NAME_H
 #define NAME_H
 
+#include <type_traits>
+
 enum ENamedName
 {
 #define xx(n) NAME_##n,
@@ -50,6 +52,7 @@ public:
 	FName (const char *text) { Index = NameData.FindName (text, false); }
 	FName (const char *text, bool noCreate) { Index = NameData.FindName (text, noCreate); }
 	FName (const char *text, size_t textlen, bool noCreate) { Index = NameData.FindName (text, textlen, noCreate); }
+	FName (const char *text, size_t textlen, unsigned int hash, bool noCreate) { Index = NameData.FindName (text, textlen, hash, noCreate); }
 	FName (const FString &text);
 	FName (const FString &text, bool noCreate);
 	FName (const FName &other) { Index = other.Index; }
@@ -89,6 +92,22 @@ public:
 	// [TP]
 	bool IsPredefined() const;
 
+	// [dorch] Case insensitive FNV-1a hash of a name's text. Only ASCII letters
+	// are folded, as with stricmp in the C locale.
+	static unsigned int MakeHash (const char *text, size_t textlen);
+
+	// [dorch] The same, for a null-terminated string whose length is also
+	// counted while hashing it.
+	static unsigned int MakeHashAndLength (const char *text, size_t &textlen);
+
+	// [dorch] The same again, but constexpr so that the hash of a string
+	// literal can be worked out by the compiler. See LITERAL_NAME.
+	static constexpr unsigned int LiteralHash (const char *text, size_t textlen, unsigned int hash = 2166136261u)
+	{
+		return textlen == 0 ? hash : LiteralHash (text + 1, textlen - 1,
+			(hash ^ (unsigned char)((*text >= 'A' && *text <= 'Z') ? *text + ('a' - 'A') : *text)) * 16777619u);
+	}
+
 protected:
 	int Index;
 
@@ -96,7 +115,13 @@ protected:
 	{
 		char *Text;
 		unsigned int Hash;
-		int NextHash;
+	};
+
+	// [dorch] A slot in the open-addressed table that finds names by hash.
+	struct NameSlot
+	{
+		unsigned int Hash;
+		int Index;			// -1 if the slot is free.
 	};
 
 	struct NameManager
@@ -106,18 +131,22 @@ protected:
 		// means this struct must only exist in the program's BSS section.
 		~NameManager();
 
-		enum { HASH_SIZE = 1024 };
 		struct NameBlock;
 
 		NameBlock *Blocks;
 		NameEntry *NameArray;
 		int NumNames, MaxNames;
-		int Buckets[HASH_SIZE];
+		NameSlot *Slots;
+		unsigned int NumSlots;		// Always a power of 2.
+		unsigned int SlotShift;		// 32 - log2(NumSlots)
 
 		int FindName (const char *text, bool noCreate);
 		int FindName (const char *text, size_t textlen, bool noCreate);
-		int AddName (const char *text, unsigned int hash, unsigned int bucket);
+		int FindName (const char *text, size_t textlen, unsigned int hash, bool noCreate);
+		int AddName (const char *text, size_t textlen, unsigned int hash, unsigned int slot);
 		NameBlock *AddBlock (size_t len);
+		void GrowSlots ();
+		unsigned int HomeSlot (unsigned int hash) const { return (hash * 0x9E3779B1u) >> SlotShift; }
 		void InitBuckets ();
 		static bool Inited;
 	};
@@ -128,6 +157,12 @@ protected:
 	FName (EDummy) {}
 };
 
+// [dorch] Looks up the name of a string literal, with the hash worked out by
+// the compiler. Use this instead of passing literals to functions that take
+// names in code that runs often.
+#define LITERAL_NAME(text, noCreate) \
+	FName (text, sizeof(text) - 1, std::integral_constant<unsigned int, FName::LiteralHash (text, sizeof(text) - 1)>::value, noCreate)
+
 class FNameNoInit : public FName
 {
 public:
@@ -47,6 +47,7 @@
 //-----------------------------------------------------------------------------
 
 #include "netcommand.h"
+#include "sv_demo.h"
 
 //*****************************************************************************
 //
@@ -61,7 +62,11 @@ ClientIterator::ClientIterator ( const ULONG ulPlayerExtra, const ServerCommandF
 //*****************************************************************************
 //
 bool ClientIterator::isCurrentValid ( ) const {
-	if ( SERVER_IsValidClient( _current ) == false )
+	// [dorch] The server's demo recorder isn't in the game, but receives everything
+	// a client with connection type 1 would.
+	const bool bRecorder = SERVERDEMO_IsRecorderClient( _current );
+
+	if (( bRecorder == false ) && ( SERVER_IsValidClient( _current ) == false ))
 		return false;
 
 	if ((( _flags & SVCF_SKIPTHISCLIENT ) && ( _ulPlayerExtra == _current )) ||
@@ -70,6 +75,9 @@ bool ClientIterator::isCurrentValid ( ) const {
 		return false;
 	}
 
+	if ( bRecorder )
+		return (( _flags & SVCF_ONLY_CONNECTIONTYPE_0 ) == false );
+
 	if ( ( _flags & SVCF_ONLY_CONNECTIONTYPE_0 ) && ( players[_current].userinfo.GetConnectionType() != 0 ) )
 		return false;
 
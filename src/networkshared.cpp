@@ -1098,6 +1098,11 @@ bool IPList::clearAndLoadFromFile( const char *Filename )
 	if ( !success )
 		_error = parser.getErrorMessage();
 
+	// [dorch] Compile the new list right away instead of on the first lookup.
+	// It replaces the old one in one go.
+	_matcher = std::make_shared<IPListMatcher>( _ipVector );
+	_nextExpirationKnown = false;
+
 	return success;
 }
 
@@ -1109,6 +1114,11 @@ void IPList::removeExpiredEntries( void )
 	time_t		tNow;
 
 	time ( &tNow );
+
+	// [dorch] Nothing can have expired yet.
+	if ( _nextExpirationKnown && (( _nextExpiration == 0 ) || ( tNow < _nextExpiration )))
+		return;
+
 	for ( ULONG ulIdx = 0; ulIdx < _ipVector.size(); )
 	{
 		// If this entry isn't infinite, and expires in the past (or now), remove it.
@@ -1142,12 +1152,35 @@ void IPList::removeExpiredEntries( void )
 		else
 			ulIdx++;
 	}
+
+	_nextExpiration = 0;
+	for ( ULONG ulIdx = 0; ulIdx < _ipVector.size(); ulIdx++ )
+	{
+		if (( _ipVector[ulIdx].tExpirationDate != 0 ) && (( _nextExpiration == 0 ) || ( _ipVector[ulIdx].tExpirationDate < _nextExpiration )))
+			_nextExpiration = _ipVector[ulIdx].tExpirationDate;
+	}
+	_nextExpirationKnown = true;
 }
 
 //*****************************************************************************
 //
 ULONG IPList::getFirstMatchingEntryIndex( const IPStringArray &szAddress ) const
 {
+	BYTE	abIP[4];
+	int		i;
+
+	// [dorch] Only addresses that are written the way SetFrom writes them can
+	// be looked up in the matcher. Anything else has to be compared to every
+	// entry, like before.
+	for ( i = 0; i < 4; i++ )
+	{
+		if ( IPListMatcher::parseOctet( szAddress[i], abIP[i] ) == false )
+			break;
+	}
+
+	if ( i == 4 )
+		return ( getMatcher( ).getFirstMatchingEntryIndex( abIP, size( )));
+
 	for ( ULONG ulIdx = 0; ulIdx < _ipVector.size(); ulIdx++ )
 	{
 		if ( szAddress.Matches ( _ipVector[ulIdx].szIP ) )
@@ -1163,9 +1196,17 @@ ULONG IPList::getFirstMatchingEntryIndex( const IPStringArray &szAddress ) const
 //
 ULONG IPList::getFirstMatchingEntryIndex( const NETADDRESS_s &Address ) const
 {
-	IPStringArray szAddress;
-	szAddress.SetFrom ( Address );
-	return getFirstMatchingEntryIndex( szAddress );
+	return ( getMatcher( ).getFirstMatchingEntryIndex( Address.abIP, size( )));
+}
+
+//*****************************************************************************
+//
+const IPListMatcher &IPList::getMatcher( ) const
+{
+	if ( _matcher == nullptr )
+		_matcher = std::make_shared<IPListMatcher>( _ipVector );
+
+	return ( *_matcher );
 }
 
 //*****************************************************************************
@@ -1317,6 +1358,8 @@ void IPList::addEntry( const IPStringArray &szAddress, const char *pszPlayerName
 			_ipVector[ulIdx].tExpirationDate = tExpiration;
 			strncpy( _ipVector[ulIdx].szComment, PlayerNameAndComment.c_str(), 127 );
 			_ipVector[ulIdx].szComment[127] = 0;
+			// [dorch] The next expiration may have changed.
+			entriesChanged( );
 			rewriteListToFile();
 		}
 		else
@@ -1333,6 +1376,7 @@ void IPList::addEntry( const IPStringArray &szAddress, const char *pszPlayerName
 	newIPEntry.szComment[127] = 0;
 	newIPEntry.tExpirationDate = tExpiration;
 	_ipVector.push_back( newIPEntry );
+	entriesChanged( );
 
 	// Finally, append the IP to the file.
 	if ( (pFile = fopen( _filename.c_str(), "a" )) )
@@ -1402,6 +1446,7 @@ void IPList::removeEntry( ULONG ulEntryIdx )
 			_ipVector[ulIdx] = _ipVector[ulIdx+1];
 
 	_ipVector.pop_back();
+	entriesChanged( );
 	rewriteListToFile ();
 }
 
@@ -1488,12 +1533,118 @@ struct ASCENDINGIPSORT_S
 void IPList::sort()
 {
 	std::sort( _ipVector.begin(), _ipVector.end(), ASCENDINGIPSORT_S() );
+	entriesChanged( );
+}
+
+//=============================================================================
+// IPListMatcher
+//=============================================================================
+
+//*****************************************************************************
+//
+IPListMatcher::IPListMatcher( const std::vector<IPADDRESSBAN_s> &Entries )
+{
+	for ( ULONG ulIdx = 0; ulIdx < Entries.size( ); ulIdx++ )
+	{
+		unsigned int	ulGroup = 0;
+		DWORD			ulKey = 0;
+		int				i;
+
+		for ( i = 0; i < 4; i++ )
+		{
+			const char	*pszOctet = Entries[ulIdx].szIP[i];
+			BYTE		bOctet = 0;
+
+			// Like IPStringArray::Matches, an octet that starts with '*' matches anything.
+			if ( pszOctet[0] == '*' )
+				ulGroup |= 1 << i;
+			else if ( parseOctet( pszOctet, bOctet ) == false )
+				break;
+
+			ulKey |= static_cast<DWORD>( bOctet ) << ( 8 * i );
+		}
+
+		// This entry can't match any valid address.
+		if ( i < 4 )
+			continue;
+
+		if ( _groups[ulGroup].empty( ))
+			_usedGroups.push_back( ulGroup );
+
+		// Keep the first entry if there are duplicates.
+		_groups[ulGroup].insert( std::make_pair( ulKey, ulIdx ));
+	}
+}
+
+//*****************************************************************************
+//
+ULONG IPListMatcher::getFirstMatchingEntryIndex( const BYTE *pbIP, ULONG ulNotFound ) const
+{
+	ULONG ulFirst = ulNotFound;
+
+	for ( unsigned int i = 0; i < _usedGroups.size( ); i++ )
+	{
+		const unsigned int ulGroup = _usedGroups[i];
+		DWORD ulKey = 0;
+
+		for ( int j = 0; j < 4; j++ )
+		{
+			if (( ulGroup & ( 1 << j )) == 0 )
+				ulKey |= static_cast<DWORD>( pbIP[j] ) << ( 8 * j );
+		}
+
+		std::unordered_map<DWORD, ULONG>::const_iterator it = _groups[ulGroup].find( ulKey );
+		if (( it != _groups[ulGroup].end( )) && ( it->second < ulFirst ))
+			ulFirst = it->second;
+	}
+
+	return ( ulFirst );
+}
+
+//*****************************************************************************
+//
+// Reads an octet that is written like SetFrom writes it: a number from 0 to
+// 255 without leading zeroes.
+//
+bool IPListMatcher::parseOctet( const char *pszOctet, BYTE &bOctet )
+{
+	unsigned int ulValue = 0;
+	int i;
+
+	for ( i = 0; pszOctet[i] != '\0'; i++ )
+	{
+		if (( pszOctet[i] < '0' ) || ( pszOctet[i] > '9' ) || ( i >= 3 ) || (( i > 0 ) && ( ulValue == 0 )))
+			return ( false );
+
+		ulValue = ulValue * 10 + ( pszOctet[i] - '0' );
+	}
+
+	if (( i == 0 ) || ( ulValue > 255 ))
+		return ( false );
+
+	bOctet = static_cast<BYTE>( ulValue );
+	return ( true );
 }
 
 //=============================================================================
 // QueryIPQueue
 //=============================================================================
 
+//=============================================================================
+//
+// setLimits
+//
+// Sets how long it takes until an IP can be added again, and how many times in
+// a row it can be added before it's in the queue.
+//
+//=============================================================================
+
+void QueryIPQueue::setLimits( int entryLength, int burst )
+{
+	_entryLength = ( entryLength > 0 ) ? entryLength : 1;
+	_burst = ( burst > 0 ) ? burst : 1;
+}
+
 //=============================================================================
 //
 // adjustHead
@@ -1504,8 +1655,38 @@ void IPList::sort()
 
 void QueryIPQueue::adjustHead( const unsigned long currentTime )
 {
-	while (( _queueHead != _queueTail ) && ( currentTime >= _IPQueue[_queueHead].nextAllowedTime ))
-		_queueHead = ( _queueHead + 1 ) % MAX_QUERY_IPS;
+	_currentTime = currentTime;
+
+	if ( currentTime <= _lastAdjustTime )
+		return;
+
+	// [dorch] Go through the slots of the time wheel that have passed since
+	// the last call, and remove the IPs whose buckets are full again.
+	const unsigned long numSlots = ( currentTime - _lastAdjustTime < WHEEL_SIZE ) ? currentTime - _lastAdjustTime : WHEEL_SIZE;
+	std::vector<DWORD> addresses;
+
+	for ( unsigned long i = 1; i <= numSlots; i++ )
+	{
+		const unsigned int wheelIdx = ( _lastAdjustTime + i ) % WHEEL_SIZE;
+		addresses.swap( _timeWheel[wheelIdx] );
+
+		for ( unsigned int j = 0; j < addresses.size(); j++ )
+		{
+			const unsigned int slot = findSlot( addresses[j] );
+
+			if ( _IPTable[slot].fullTime <= currentTime )
+				removeSlot( slot );
+			// The IP was added again since, so it needs to wait longer.
+			else
+				_timeWheel[_IPTable[slot].fullTime % WHEEL_SIZE].push_back( addresses[j] );
+		}
+
+		addresses.clear();
+		if ( _timeWheel[wheelIdx].empty() )
+			addresses.swap( _timeWheel[wheelIdx] );
+	}
+
+	_lastAdjustTime = currentTime;
 }
 
 //=============================================================================
@@ -1518,15 +1699,17 @@ void QueryIPQueue::adjustHead( const unsigned long currentTime )
 
 bool QueryIPQueue::addressInQueue( const NETADDRESS_s AddressFrom ) const
 {
-	// Search through the queue.
-	for ( unsigned int i = _queueHead; i != _queueTail; i = ( i + 1 ) % MAX_QUERY_IPS )
-	{
-		if ( AddressFrom.CompareNoPort( _IPQueue[i].Address ))
-			return true;
-	}
+	if ( _numEntries == 0 )
+		return false;
+
+	const STORED_QUERY_IP_t &entry = _IPTable[findSlot( getKey( AddressFrom ))];
+
+	// [dorch] Not found, or there are tokens left.
+	if (( entry.fullTime == 0 ) || ( entry.fullTime <= _currentTime + ( _burst - 1 ) * _entryLength ))
+		return false;
 
-	// Not found, or the queue is empty.
-	return false;
+	_numRejected++;
+	return true;
 }
 
 //=============================================================================
@@ -1540,7 +1723,7 @@ bool QueryIPQueue::addressInQueue( const NETADDRESS_s AddressFrom ) const
 
 bool QueryIPQueue::isFull( ) const
 {
-	return ((( _queueTail + 1 ) % MAX_QUERY_IPS ) == _queueHead );
+	return ( _numEntries >= MAX_QUERY_IPS );
 }
 
 //=============================================================================
@@ -1553,17 +1736,125 @@ bool QueryIPQueue::isFull( ) const
 
 void QueryIPQueue::addAddress( const NETADDRESS_s AddressFrom, const unsigned long currentTime, std::ostream *errorOut )
 {
-	// Add and advance the tail.
-	_IPQueue[_queueTail].Address = AddressFrom;
-	_IPQueue[_queueTail].nextAllowedTime = currentTime + _entryLength;
-	_queueTail = ( _queueTail + 1 ) % MAX_QUERY_IPS;
+	const DWORD address = getKey( AddressFrom );
+	_currentTime = currentTime;
 
-	// Is the queue full?
-	if ( _queueTail == _queueHead )
+	if (( _numEntries + 1 ) * 2 > _IPTable.size() )
 	{
-		if ( errorOut )
-			*errorOut << "WARNING! The IP flood queue is full.\n";
+		// Is the queue full?
+		if ( isFull( ))
+		{
+			if ( errorOut )
+				*errorOut << "WARNING! The IP flood queue is full.\n";
+
+			return;
+		}
 
-		_queueHead = ( _queueHead + 1 ) % MAX_QUERY_IPS; // [RC] Start removing older entries.
+		resize( _IPTable.empty() ? 64 : _IPTable.size() * 2 );
 	}
+
+	STORED_QUERY_IP_t &entry = _IPTable[findSlot( address )];
+
+	// [dorch] Take a token from the bucket. New IPs start with a full one.
+	if ( entry.fullTime == 0 )
+	{
+		entry.address = address;
+		entry.fullTime = currentTime + _entryLength;
+		_numEntries++;
+		_timeWheel[entry.fullTime % WHEEL_SIZE].push_back( address );
+	}
+	else
+		entry.fullTime = (( entry.fullTime > currentTime ) ? entry.fullTime : currentTime ) + _entryLength;
+}
+
+//=============================================================================
+//
+// findSlot
+//
+// Returns the slot of the table that holds the given IP, or the empty slot
+// where it would go.
+//
+//=============================================================================
+
+unsigned int QueryIPQueue::findSlot( const DWORD address ) const
+{
+	const unsigned int mask = _IPTable.size() - 1;
+	unsigned int slot = getHome( address, mask );
+
+	while (( _IPTable[slot].fullTime != 0 ) && ( _IPTable[slot].address != address ))
+		slot = ( slot + 1 ) & mask;
+
+	return slot;
+}
+
+//=============================================================================
+//
+// removeSlot
+//
+// Empties the given slot, and moves the entries after it back so that they
+// can still be found.
+//
+//=============================================================================
+
+void QueryIPQueue::removeSlot( unsigned int slot )
+{
+	const unsigned int mask = _IPTable.size() - 1;
+
+	for ( unsigned int next = ( slot + 1 ) & mask; _IPTable[next].fullTime != 0; next = ( next + 1 ) & mask )
+	{
+		// The entry can't be moved in front of the slot it belongs in.
+		if ((( next - getHome( _IPTable[next].address, mask )) & mask ) < (( next - slot ) & mask ))
+			continue;
+
+		_IPTable[slot] = _IPTable[next];
+		slot = next;
+	}
+
+	_IPTable[slot].fullTime = 0;
+	_numEntries--;
+}
+
+//=============================================================================
+//
+// resize
+//
+//=============================================================================
+
+void QueryIPQueue::resize( const unsigned int newSize )
+{
+	std::vector<STORED_QUERY_IP_t> oldTable( newSize );
+	oldTable.swap( _IPTable );
+
+	for ( unsigned int i = 0; i < _IPTable.size(); i++ )
+		_IPTable[i].fullTime = 0;
+
+	for ( unsigned int i = 0; i < oldTable.size(); i++ )
+	{
+		if ( oldTable[i].fullTime != 0 )
+			_IPTable[findSlot( oldTable[i].address )] = oldTable[i];
+	}
+}
+
+//=============================================================================
+//
+// getKey
+//
+//=============================================================================
+
+DWORD QueryIPQueue::getKey( const NETADDRESS_s &Address )
+{
+	return ( Address.abIP[0] << 24 ) | ( Address.abIP[1] << 16 ) | ( Address.abIP[2] << 8 ) | Address.abIP[3];
+}
+
+//=============================================================================
+//
+// getHome
+//
+// Returns the slot the given IP goes in if it's not taken yet.
+//
+//=============================================================================
+
+unsigned int QueryIPQueue::getHome( const DWORD address, const unsigned int mask )
+{
+	return (( address * 0x9E3779B1u ) >> 12 ) & mask;
 }
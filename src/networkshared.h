@@ -57,6 +57,8 @@
 #include <iostream>
 #include <vector>
 #include <list>
+#include <memory>
+#include <unordered_map>
 #include <time.h>
 #include <ctype.h>
 #include <math.h>
@@ -453,6 +455,31 @@ private:
 	bool		parseNextLine( FILE *pFile, IPADDRESSBAN_s &IP, ULONG &BanIdx );
 };
 
+//==========================================================================
+//
+// IPListMatcher
+//
+// [dorch] Finds the first entry of an IP list that matches an address without
+// comparing the address to every entry. The entries are grouped by which of
+// their octets are wildcards, and every group is a hash table of the octets
+// that aren't. A lookup takes one probe per group, so at most 16.
+//
+//==========================================================================
+
+class IPListMatcher
+{
+	std::unordered_map<DWORD, ULONG>	_groups[16];
+	std::vector<unsigned int>			_usedGroups;
+
+//*************************************************************************
+public:
+	IPListMatcher( const std::vector<IPADDRESSBAN_s> &Entries );
+
+	ULONG			getFirstMatchingEntryIndex( const BYTE *pbIP, ULONG ulNotFound ) const;
+
+	static bool		parseOctet( const char *pszOctet, BYTE &bOctet );
+};
+
 //==========================================================================
 //
 // IPList
@@ -468,6 +495,16 @@ class IPList
 	std::string						_filename;
 	std::string						_error;
 
+	// [dorch] Built from _ipVector when it's needed, and thrown away whenever
+	// _ipVector changes. It's never changed once built, so copies of the list
+	// can share it.
+	mutable std::shared_ptr<const IPListMatcher>	_matcher;
+
+	// [dorch] When the first temporary entry expires, so that
+	// removeExpiredEntries doesn't have to check every entry every tic.
+	time_t							_nextExpiration = 0;
+	bool							_nextExpirationKnown = false;
+
 //*************************************************************************
 public:
 	bool			clearAndLoadFromFile( const char *Filename );
@@ -491,16 +528,21 @@ public:
 	void			removeExpiredEntries( void ); // [RC]
 
 	unsigned int	size() const { return static_cast<unsigned int>( _ipVector.size( )); }
-	void			clear() { _ipVector.clear(); }
-	void			push_back ( IPADDRESSBAN_s &IP ) { _ipVector.push_back(IP); }
+	void			clear() { _ipVector.clear(); entriesChanged(); }
+	void			push_back ( IPADDRESSBAN_s &IP ) { _ipVector.push_back(IP); entriesChanged(); }
 	const char		*getErrorMessage() const { return _error.c_str(); }
 	const char		*getFilename() const { return _filename.c_str(); } // [AK]
 
-	std::vector<IPADDRESSBAN_s>&	getVector() { return _ipVector; }
+	const std::vector<IPADDRESSBAN_s>&	getVector() const { return _ipVector; }
+
+	// [dorch] The caller may change the entries, so the matcher is thrown away.
+	std::vector<IPADDRESSBAN_s>&	getMutableVector() { entriesChanged(); return _ipVector; }
 
 //*************************************************************************
 private:
 	bool rewriteListToFile ();
+	const IPListMatcher &getMatcher () const;
+	void entriesChanged () { _matcher.reset(); _nextExpirationKnown = false; }
 };
 
 //==========================================================================
@@ -510,6 +552,12 @@ private:
 // Stores IPs that have recently queried us to prevent flooding.
 // @author Benjamin Berkels, Rivecoder
 //
+// [dorch] Every IP has a token bucket that holds up to "burst" tokens and
+// gets a new one every "entryLength" time units. An IP is in the queue while
+// its bucket is empty. The buckets are kept in a hash table, and a time wheel
+// finds the ones that are full again, so neither adding nor looking up an IP
+// depends on how many IPs are stored.
+//
 //==========================================================================
 
 class QueryIPQueue
@@ -518,36 +566,64 @@ class QueryIPQueue
 	struct STORED_QUERY_IP_t
 	{
 		// The IP address.
-		NETADDRESS_s		Address;
+		DWORD				address;
 
-		// Expiration date.
-		unsigned long		nextAllowedTime;
+		// [dorch] When the bucket will be full again. Zero if the slot is empty.
+		unsigned long		fullTime;
 
 	};
 
 	// The maximum number of entries that we can store.
-	static const unsigned int	MAX_QUERY_IPS = 512;
+	static const unsigned int	MAX_QUERY_IPS = 1 << 18;
 
-	// The array of IPs.
-	STORED_QUERY_IP_t			_IPQueue[MAX_QUERY_IPS];
+	// [dorch] The number of time units the time wheel covers.
+	static const unsigned int	WHEEL_SIZE = 64;
 
-	// Head and tail of the queue.
-	unsigned int				_queueHead;
-	unsigned int				_queueTail;
+	// The hash table of IPs, using linear probing. Its size is a power of two.
+	std::vector<STORED_QUERY_IP_t>	_IPTable;
+	unsigned int				_numEntries;
+
+	// [dorch] The IPs whose buckets are full at the time of every slot, or
+	// later, in which case they're moved to a later slot.
+	std::vector<DWORD>			_timeWheel[WHEEL_SIZE];
+	unsigned long				_lastAdjustTime;
+
+	// The time passed to adjustHead or addAddress most recently.
+	unsigned long				_currentTime;
 
 	// How long entries will last (seconds).
 	unsigned int				_entryLength;
 
+	// [dorch] How many times in a row an IP can be added before it's in the queue.
+	unsigned int				_burst;
+
+	// [dorch] How often addressInQueue found an IP in the queue.
+	mutable unsigned int		_numRejected;
+
 //*************************************************************************
 public:
-	QueryIPQueue( int entryLength ) : _queueHead( 0 ), _queueTail( 0 ), _entryLength( entryLength )
+	QueryIPQueue( int entryLength, int burst = 1 ) : _numEntries( 0 ), _lastAdjustTime( 0 ), _currentTime( 0 ), _numRejected( 0 )
 	{
+		setLimits( entryLength, burst );
 	}
 
+	void	setLimits( int entryLength, int burst );
 	void	adjustHead( const unsigned long currentTime );
 	bool	addressInQueue( const NETADDRESS_s AddressFrom ) const;
 	void	addAddress( const NETADDRESS_s AddressFrom, const unsigned long currentTime, std::ostream *errorOut = NULL );
 	bool	isFull( ) const;
+
+	unsigned int	size( ) const { return _numEntries; }
+	unsigned int	getNumRejected( ) const { return _numRejected; }
+
+//*************************************************************************
+private:
+	unsigned int	findSlot( const DWORD address ) const;
+	void			removeSlot( unsigned int slot );
+	void			resize( const unsigned int newSize );
+
+	static DWORD	getKey( const NETADDRESS_s &Address );
+	static unsigned int	getHome( const DWORD address, const unsigned int mask );
 };
 
 //==========================================================================
@@ -65,6 +65,7 @@
 #include "gstrings.h"
 #include "gi.h"
 #include "sc_man.h"
+#include "sc_thread.h"
 #include "c_bind.h"
 #include "info.h"
 #include "r_data/r_translate.h"
@@ -96,6 +97,8 @@
 #include "sv_ban.h"
 #include "joinqueue.h"
 #include "domination.h" // [TRSR]
+#include "profiler.h"
+#include "sv_watchdog.h"
 
 #include "g_shared/a_pickups.h"
 
@@ -2063,7 +2066,30 @@ FBehavior *FBehavior::StaticLoadModule (int lumpnum, FileReader *fr, int len)
 		}
 	}
 
-	return new FBehavior (lumpnum, fr, len);
+	// [dorch] Time loading ACS modules like the script lumps. Libraries
+	// loaded by this module count for it.
+	static int nesting = 0;
+	const double start = SC_GetTimeMS();
+
+	FBehavior *module;
+
+	nesting++;
+	try
+	{
+		module = new FBehavior (lumpnum, fr, len);
+	}
+	catch (...)
+	{
+		nesting--;
+		throw;
+	}
+	nesting--;
+
+	if (nesting == 0)
+	{
+		SC_AddParseTime ("ACS", SC_GetTimeMS() - start, 1, lumpnum >= 0 ? Wads.LumpLength (lumpnum) : len);
+	}
+	return module;
 }
 
 bool FBehavior::StaticCheckAllGood ()
@@ -3600,10 +3626,16 @@ void DACSThinker::Tick ()
 {
 	DLevelScript *script = Scripts;
 
+	PROF_ZONE( "ACS" );
+
 	while (script)
 	{
 		DLevelScript *next = script->next;
+		// [dorch] Time the script for the server's slow tic reports.
+		const int scriptnum = script->script;
+		const QWORD start = SERVERWATCHDOG_BeginScript ();
 		script->RunScript ();
+		SERVERWATCHDOG_EndScript (scriptnum, start);
 		script = next;
 	}
 
@@ -51,6 +51,10 @@
 #include "gi.h"
 #include "v_palette.h"
 #include "colormatcher.h"
+#include "c_dispatch.h"
+#include "m_alloc.h"
+#include "r_thread.h"
+#include "stats.h"
 // [BB] New #includes.
 #include "deathmatch.h"
 #include "network.h"
@@ -74,11 +78,42 @@ FRandom pr_railtrail("RailTrail");
 #define FADEFROMTTL(a)	(255/(a))
 
 // [RH] particle globals
-WORD			NumParticles;
-WORD			ActiveParticles;
-WORD			InactiveParticles;
+DWORD			NumParticles;
 particle_t		*Particles;
-TArray<WORD>	ParticlesInSubsec;
+TArray<DWORD>	ParticlesInSubsec;
+
+// [dorch] The particles are simulated in a structure-of-arrays pool that keeps
+// the live ones packed at the front, so P_ThinkParticles can update them with
+// straight loops over each field. Spawners still fill in a particle_t. Those
+// are collected in ParticleSpawns and moved into the pool when the batch is
+// full, when the particles think and when they are sorted into subsectors,
+// so a spawner must be done with one particle before it asks for the next.
+struct FParticlePool
+{
+	fixed_t		*X, *Y, *Z;
+	fixed_t		*VelX, *VelY, *VelZ;
+	fixed_t		*AccX, *AccY, *AccZ;
+	int			*Color;
+	DWORD		*Subsector;
+	BYTE		*TTL, *Trans, *Fade, *Size, *Dead;
+	DWORD		Count;
+	BYTE		*Memory;
+};
+
+#define PARTICLE_SPAWN_BATCH	256
+
+static FParticlePool	ParticlePool;
+static particle_t		ParticleSpawns[PARTICLE_SPAWN_BATCH];
+static DWORD			NumParticleSpawns;
+
+static cycle_t			ParticleThinkCycles, ParticleSortCycles;
+
+// The update loops use SSE2 whenever the compiler may. It is part of every
+// x86-64 CPU, so there is no need to check for it at run time.
+#if defined(__SSE2__) || defined(_M_X64)
+#define PARTICLE_SIMD
+#include <emmintrin.h>
+#endif
 
 static int grey1, grey2, grey3, grey4, red, red2, red3, red4, green, blue, yellow, black,
 		   red1, green1, blue1, yellow1, yellow2, yellow3, purple, purple1, purple2, purple3, white,
@@ -148,16 +183,20 @@ static int* g_rainbowParticleColors[] =
 	&purple3,
 };
 
+static void P_FlushParticleSpawns ();
+
 inline particle_t *NewParticle (void)
 {
-	particle_t *result = NULL;
-	if (InactiveParticles != NO_PARTICLE)
+	if (ParticlePool.Count + NumParticleSpawns >= NumParticles)
 	{
-		result = Particles + InactiveParticles;
-		InactiveParticles = result->tnext;
-		result->tnext = ActiveParticles;
-		ActiveParticles = WORD(result - Particles);
+		return NULL;
 	}
+	if (NumParticleSpawns == PARTICLE_SPAWN_BATCH)
+	{
+		P_FlushParticleSpawns ();
+	}
+	particle_t *result = &ParticleSpawns[NumParticleSpawns++];
+	memset (result, 0, sizeof(particle_t));
 	return result;
 }
 
@@ -175,6 +214,8 @@ CUSTOM_CVAR( Int, r_maxparticles, 4000, CVAR_ARCHIVE )
 		self = 4000;
 	else if ( self < 100 )
 		self = 100;
+	else if ( self > static_cast<int>( MAX_PARTICLES ))
+		self = MAX_PARTICLES;
 
 	if ( gamestate != GS_STARTUP )
 	{
@@ -186,17 +227,45 @@ CUSTOM_CVAR( Int, r_maxparticles, 4000, CVAR_ARCHIVE )
 void P_InitParticles ()
 {
 	const char *i;
+	int num;
 
 	if ((i = Args->CheckValue ("-numparticles")))
-		NumParticles = atoi (i);
+		num = atoi (i);
 	// [BC] Use r_maxparticles now.
 	else
-		NumParticles = r_maxparticles;
+		num = r_maxparticles;
 
 	// This should be good, but eh...
-	NumParticles = clamp<WORD>(NumParticles, 100, 65535);
+	NumParticles = clamp<int>(num, 100, MAX_PARTICLES);
 
 	P_DeinitParticles();
+
+	// [dorch] All of the pool's arrays share one block. Each one starts on a
+	// 16 byte boundary and is padded to a multiple of 16 particles, so the
+	// update loops can always work on whole vectors.
+	const size_t padded = (NumParticles + 15) & ~15;
+	const size_t fieldbytes = 11 * sizeof(DWORD) + 5 * sizeof(BYTE);
+	BYTE *mem = (BYTE *)M_Malloc (padded * fieldbytes + 16);
+	BYTE *p = (BYTE *)(((size_t)mem + 15) & ~(size_t)15);
+
+	ParticlePool.Memory = mem;
+	fixed_t **fixedfields[] = { &ParticlePool.X, &ParticlePool.Y, &ParticlePool.Z,
+		&ParticlePool.VelX, &ParticlePool.VelY, &ParticlePool.VelZ,
+		&ParticlePool.AccX, &ParticlePool.AccY, &ParticlePool.AccZ };
+	for (size_t f = 0; f < countof(fixedfields); f++, p += padded * sizeof(fixed_t))
+	{
+		*fixedfields[f] = (fixed_t *)p;
+	}
+	ParticlePool.Color = (int *)p;			p += padded * sizeof(int);
+	ParticlePool.Subsector = (DWORD *)p;	p += padded * sizeof(DWORD);
+	BYTE **bytefields[] = { &ParticlePool.TTL, &ParticlePool.Trans, &ParticlePool.Fade,
+		&ParticlePool.Size, &ParticlePool.Dead };
+	for (size_t f = 0; f < countof(bytefields); f++, p += padded)
+	{
+		*bytefields[f] = p;
+	}
+	memset (ParticlePool.Memory, 0, padded * fieldbytes + 16);
+
 	Particles = new particle_t[NumParticles];
 	P_ClearParticles ();
 	atterm (P_DeinitParticles);
@@ -209,45 +278,137 @@ void P_DeinitParticles()
 		delete[] Particles;
 		Particles = NULL;
 	}
+	if (ParticlePool.Memory != NULL)
+	{
+		M_Free (ParticlePool.Memory);
+		memset (&ParticlePool, 0, sizeof(ParticlePool));
+	}
 }
 
 void P_ClearParticles ()
 {
-	int i;
+	ParticlePool.Count = 0;
+	NumParticleSpawns = 0;
+	ParticlesInSubsec.Clear ();
+}
+
+// [dorch] Moves the batch of newly spawned particles into the pool.
+static void P_FlushParticleSpawns ()
+{
+	FParticlePool &pool = ParticlePool;
+
+	for (DWORD i = 0; i < NumParticleSpawns; i++)
+	{
+		const particle_t &spawn = ParticleSpawns[i];
+		const DWORD n = pool.Count++;
+
+		pool.X[n] = spawn.x;
+		pool.Y[n] = spawn.y;
+		pool.Z[n] = spawn.z;
+		pool.VelX[n] = spawn.velx;
+		pool.VelY[n] = spawn.vely;
+		pool.VelZ[n] = spawn.velz;
+		pool.AccX[n] = spawn.accx;
+		pool.AccY[n] = spawn.accy;
+		pool.AccZ[n] = spawn.accz;
+		pool.Color[n] = spawn.color;
+		pool.TTL[n] = spawn.ttl;
+		pool.Trans[n] = spawn.trans;
+		pool.Fade[n] = spawn.fade;
+		pool.Size[n] = spawn.size | (spawn.bright << 7);
+	}
+	NumParticleSpawns = 0;
+}
+
+// [dorch] Finds the subsector of every particle in [first, last].
+static void P_LocateParticles (DWORD first, DWORD last)
+{
+	const FParticlePool &pool = ParticlePool;
+
+	for (DWORD i = first; i <= last; i++)
+	{
+		pool.Subsector[i] = DWORD(R_PointInSubsector (pool.X[i], pool.Y[i]) - subsectors);
+	}
+}
+
+static void P_LocateParticleSlice (int slice, int numslices, void *data)
+{
+	int first, last;
 
-	memset (Particles, 0, NumParticles * sizeof(particle_t));
-	ActiveParticles = NO_PARTICLE;
-	InactiveParticles = 0;
-	for (i = 0; i < NumParticles-1; i++)
-		Particles[i].tnext = i + 1;
-	Particles[i].tnext = NO_PARTICLE;
+	R_GetSliceBounds (slice, numslices, ParticlePool.Count, first, last);
+	if (first <= last)
+	{
+		P_LocateParticles (first, last);
+	}
 }
 
 // Group particles by subsectors. Because particles are always
 // in motion, there is little benefit to caching this information
 // from one frame to the next.
+//
+// [dorch] This is a counting sort: the particles are counted per subsector,
+// the counts are turned into the start of each subsector's range and then
+// every particle is copied to its place in Particles. Finding the subsectors
+// is the expensive part and is split across the render threads when there
+// are enough particles to make it worthwhile.
 
 void P_FindParticleSubsectors ()
 {
-	if (ParticlesInSubsec.Size() < (size_t)numsubsectors)
+	FParticlePool &pool = ParticlePool;
+
+	ParticleSortCycles.Reset ();
+	ParticleSortCycles.Clock ();
+
+	P_FlushParticleSpawns ();
+
+	ParticlesInSubsec.Resize (numsubsectors + 2);
+	memset (&ParticlesInSubsec[0], 0, (numsubsectors + 2) * sizeof(DWORD));
+
+	if (!r_particles || pool.Count == 0)
 	{
-		ParticlesInSubsec.Reserve (numsubsectors - ParticlesInSubsec.Size());
+		ParticleSortCycles.Unclock ();
+		return;
+	}
+
+	const int threads = R_GetRenderThreadCount ();
+	if (threads > 1 && pool.Count >= 8192)
+	{
+		R_RunSlices (threads * 2, P_LocateParticleSlice, NULL);
+	}
+	else
+	{
+		P_LocateParticles (0, pool.Count - 1);
 	}
 
-	clearbufshort (&ParticlesInSubsec[0], numsubsectors, NO_PARTICLE);
+	DWORD *start = &ParticlesInSubsec[0];
+	DWORD i;
 
-	if (!r_particles)
+	for (i = 0; i < pool.Count; i++)
 	{
-		return;
+		start[pool.Subsector[i] + 2]++;
+	}
+	for (i = 2; i < (DWORD)numsubsectors + 2; i++)
+	{
+		start[i] += start[i - 1];
 	}
-	for (WORD i = ActiveParticles; i != NO_PARTICLE; i = Particles[i].tnext)
+	// start[n+1] is now where subsector n begins. Placing the particles moves
+	// it to where subsector n ends, which is where subsector n+1 begins.
+	for (i = 0; i < pool.Count; i++)
 	{
-		subsector_t *ssec = R_PointInSubsector (Particles[i].x, Particles[i].y);
-		int ssnum = int(ssec-subsectors);
-		Particles[i].subsector = ssec;
-		Particles[i].snext = ParticlesInSubsec[ssnum];
-		ParticlesInSubsec[ssnum] = i;
+		const DWORD ssnum = pool.Subsector[i];
+		particle_t *particle = &Particles[start[ssnum + 1]++];
+
+		particle->x = pool.X[i];
+		particle->y = pool.Y[i];
+		particle->z = pool.Z[i];
+		particle->trans = pool.Trans[i];
+		particle->size = pool.Size[i] & 127;
+		particle->bright = pool.Size[i] >> 7;
+		particle->color = pool.Color[i];
+		particle->subsector = &subsectors[ssnum];
 	}
+
+	ParticleSortCycles.Unclock ();
 }
 
 static TMap<int, int> ColorSaver;
@@ -288,41 +449,143 @@ void P_InitEffects ()
 	blood2 = ParticleColor(RPART(kind)/3, GPART(kind)/3, BPART(kind)/3);
 }
 
+// [dorch] Fades and ages the first count particles in the pool and flags the
+// ones that expire in Dead. A particle expires when its translucency would
+// wrap around below zero or its ttl runs out. A ttl of 0 wraps to 255 and
+// lives on, the same as it always did.
+static void P_AgeParticles (DWORD count)
+{
+	FParticlePool &pool = ParticlePool;
+	DWORD i = 0;
 
-void P_ThinkParticles ()
+#ifdef PARTICLE_SIMD
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i one = _mm_set1_epi8 (1);
+
+	for (; i < count; i += 16)
+	{
+		const __m128i trans = _mm_load_si128 ((const __m128i *)(pool.Trans + i));
+		const __m128i fade = _mm_load_si128 ((const __m128i *)(pool.Fade + i));
+		const __m128i ttl = _mm_load_si128 ((const __m128i *)(pool.TTL + i));
+
+		// fade > trans is the same as the saturated fade - trans not being 0.
+		const __m128i faded = _mm_andnot_si128 (_mm_cmpeq_epi8 (_mm_subs_epu8 (fade, trans), zero), one);
+		const __m128i expired = _mm_and_si128 (_mm_cmpeq_epi8 (ttl, one), one);
+
+		_mm_store_si128 ((__m128i *)(pool.Dead + i), _mm_or_si128 (faded, expired));
+		_mm_store_si128 ((__m128i *)(pool.Trans + i), _mm_sub_epi8 (trans, fade));
+		_mm_store_si128 ((__m128i *)(pool.TTL + i), _mm_sub_epi8 (ttl, one));
+	}
+#else
+	for (; i < count; i++)
+	{
+		const BYTE trans = pool.Trans[i];
+		const BYTE fade = pool.Fade[i];
+
+		pool.Dead[i] = (fade > trans) | (pool.TTL[i] == 1);
+		pool.Trans[i] = trans - fade;
+		pool.TTL[i]--;
+	}
+#endif
+}
+
+// [dorch] Moves the first count particles in the pool by their velocity and
+// then changes their velocity by their acceleration.
+static void P_MoveParticles (DWORD count)
 {
-	int i;
-	particle_t *particle, *prev;
-
-	i = ActiveParticles;
-	prev = NULL;
-	while (i != NO_PARTICLE)
-	{
-		BYTE oldtrans;
-
-		particle = Particles + i;
-		i = particle->tnext;
-		oldtrans = particle->trans;
-		particle->trans -= particle->fade;
-		if (oldtrans < particle->trans || --particle->ttl == 0)
-		{ // The particle has expired, so free it
-			memset (particle, 0, sizeof(particle_t));
-			if (prev)
-				prev->tnext = i;
-			else
-				ActiveParticles = i;
-			particle->tnext = InactiveParticles;
-			InactiveParticles = (int)(particle - Particles);
+	FParticlePool &pool = ParticlePool;
+	DWORD i = 0;
+
+#ifdef PARTICLE_SIMD
+	fixed_t *pos[3] = { pool.X, pool.Y, pool.Z };
+	fixed_t *vel[3] = { pool.VelX, pool.VelY, pool.VelZ };
+	const fixed_t *acc[3] = { pool.AccX, pool.AccY, pool.AccZ };
+
+	for (; i < count; i += 4)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			__m128i *p = (__m128i *)(pos[axis] + i);
+			__m128i *v = (__m128i *)(vel[axis] + i);
+			const __m128i velocity = _mm_load_si128 (v);
+
+			_mm_store_si128 (p, _mm_add_epi32 (_mm_load_si128 (p), velocity));
+			_mm_store_si128 (v, _mm_add_epi32 (velocity, _mm_load_si128 ((const __m128i *)(acc[axis] + i))));
+		}
+	}
+#else
+	for (; i < count; i++)
+	{
+		pool.X[i] += pool.VelX[i];
+		pool.Y[i] += pool.VelY[i];
+		pool.Z[i] += pool.VelZ[i];
+		pool.VelX[i] += pool.AccX[i];
+		pool.VelY[i] += pool.AccY[i];
+		pool.VelZ[i] += pool.AccZ[i];
+	}
+#endif
+}
+
+// [dorch] Removes the particles flagged in Dead by moving the last live
+// particle into each hole, so only as many particles are copied as died.
+static void P_RemoveDeadParticles ()
+{
+	FParticlePool &pool = ParticlePool;
+	const BYTE *dead = (const BYTE *)memchr (pool.Dead, 1, pool.Count);
+
+	if (dead == NULL)
+	{
+		return;
+	}
+
+	DWORD count = pool.Count;
+	for (DWORD i = DWORD(dead - pool.Dead); i < count; i++)
+	{
+		if (!pool.Dead[i])
+		{
 			continue;
 		}
-		particle->x += particle->velx;
-		particle->y += particle->vely;
-		particle->z += particle->velz;
-		particle->velx += particle->accx;
-		particle->vely += particle->accy;
-		particle->velz += particle->accz;
-		prev = particle;
+		do
+		{
+			count--;
+		} while (count > i && pool.Dead[count]);
+
+		if (count == i)
+		{
+			break;
+		}
+		pool.X[i] = pool.X[count];
+		pool.Y[i] = pool.Y[count];
+		pool.Z[i] = pool.Z[count];
+		pool.VelX[i] = pool.VelX[count];
+		pool.VelY[i] = pool.VelY[count];
+		pool.VelZ[i] = pool.VelZ[count];
+		pool.AccX[i] = pool.AccX[count];
+		pool.AccY[i] = pool.AccY[count];
+		pool.AccZ[i] = pool.AccZ[count];
+		pool.Color[i] = pool.Color[count];
+		pool.TTL[i] = pool.TTL[count];
+		pool.Trans[i] = pool.Trans[count];
+		pool.Fade[i] = pool.Fade[count];
+		pool.Size[i] = pool.Size[count];
 	}
+	pool.Count = count;
+}
+
+void P_ThinkParticles ()
+{
+	ParticleThinkCycles.Reset ();
+	ParticleThinkCycles.Clock ();
+
+	P_FlushParticleSpawns ();
+
+	// Expired particles get moved as well. That is cheaper than skipping
+	// them and they are removed right after.
+	P_AgeParticles (ParticlePool.Count);
+	P_MoveParticles (ParticlePool.Count);
+	P_RemoveDeadParticles ();
+
+	ParticleThinkCycles.Unclock ();
 }
 
 // [CK] Refactored code to generate a fountain.
@@ -482,6 +745,57 @@ static void MakeFountain (AActor *actor, int color1, int color2)
 	MakeFountain(actor->x, actor->y, actor->z, actor->radius, actor->height, color1, color2);
 }
 
+// [dorch] The rocket trail of P_RunEffect, taking the position and movement
+// of the rocket instead of the actor so r_benchparticles can draw it too.
+static void MakeRocketTrail (fixed_t x, fixed_t y, fixed_t z, fixed_t velx, fixed_t vely, fixed_t velz,
+	fixed_t radius, fixed_t height, angle_t moveangle)
+{
+	particle_t *particle;
+	int i;
+
+	fixed_t backx = x - FixedMul (finecosine[(moveangle)>>ANGLETOFINESHIFT], radius*2);
+	fixed_t backy = y - FixedMul (finesine[(moveangle)>>ANGLETOFINESHIFT], radius*2);
+	fixed_t backz = z - (height>>3) * (velz>>16) + (2*height)/3;
+
+	angle_t an = (moveangle + ANG90) >> ANGLETOFINESHIFT;
+	int speed;
+
+	particle = JitterParticle (3 + (M_Random() & 31));
+	if (particle) {
+		fixed_t pathdist = M_Random()<<8;
+		particle->x = backx - FixedMul(velx, pathdist);
+		particle->y = backy - FixedMul(vely, pathdist);
+		particle->z = backz - FixedMul(velz, pathdist);
+		speed = (M_Random () - 128) * (FRACUNIT/200);
+		particle->velx += FixedMul (speed, finecosine[an]);
+		particle->vely += FixedMul (speed, finesine[an]);
+		particle->velz -= FRACUNIT/36;
+		particle->accz -= FRACUNIT/20;
+		particle->color = yellow;
+		particle->size = 2;
+	}
+	for (i = 6; i; i--) {
+		particle_t *particle = JitterParticle (3 + (M_Random() & 31));
+		if (particle) {
+			fixed_t pathdist = M_Random()<<8;
+			particle->x = backx - FixedMul(velx, pathdist);
+			particle->y = backy - FixedMul(vely, pathdist);
+			particle->z = backz - FixedMul(velz, pathdist) + (M_Random() << 10);
+			speed = (M_Random () - 128) * (FRACUNIT/200);
+			particle->velx += FixedMul (speed, finecosine[an]);
+			particle->vely += FixedMul (speed, finesine[an]);
+			particle->velz += FRACUNIT/80;
+			particle->accz += FRACUNIT/40;
+			if (M_Random () & 7)
+				particle->color = grey2;
+			else
+				particle->color = grey1;
+			particle->size = 3;
+		} else
+			break;
+	}
+}
+
 void P_RunEffect (AActor *actor, int effects)
 {
 	angle_t moveangle;
@@ -502,48 +816,8 @@ void P_RunEffect (AActor *actor, int effects)
 	if ((effects & FX_ROCKET) && (cl_rockettrails & 1))
 	{
 		// Rocket trail
-
-		fixed_t backx = actor->x - FixedMul (finecosine[(moveangle)>>ANGLETOFINESHIFT], actor->radius*2);
-		fixed_t backy = actor->y - FixedMul (finesine[(moveangle)>>ANGLETOFINESHIFT], actor->radius*2);
-		fixed_t backz = actor->z - (actor->height>>3) * (actor->velz>>16) + (2*actor->height)/3;
-
-		angle_t an = (moveangle + ANG90) >> ANGLETOFINESHIFT;
-		int speed;
-
-		particle = JitterParticle (3 + (M_Random() & 31));
-		if (particle) {
-			fixed_t pathdist = M_Random()<<8;
-			particle->x = backx - FixedMul(actor->velx, pathdist);
-			particle->y = backy - FixedMul(actor->vely, pathdist);
-			particle->z = backz - FixedMul(actor->velz, pathdist);
-			speed = (M_Random () - 128) * (FRACUNIT/200);
-			particle->velx += FixedMul (speed, finecosine[an]);
-			particle->vely += FixedMul (speed, finesine[an]);
-			particle->velz -= FRACUNIT/36;
-			particle->accz -= FRACUNIT/20;
-			particle->color = yellow;
-			particle->size = 2;
-		}
-		for (i = 6; i; i--) {
-			particle_t *particle = JitterParticle (3 + (M_Random() & 31));
-			if (particle) {
-				fixed_t pathdist = M_Random()<<8;
-				particle->x = backx - FixedMul(actor->velx, pathdist);
-				particle->y = backy - FixedMul(actor->vely, pathdist);
-				particle->z = backz - FixedMul(actor->velz, pathdist) + (M_Random() << 10);
-				speed = (M_Random () - 128) * (FRACUNIT/200);
-				particle->velx += FixedMul (speed, finecosine[an]);
-				particle->vely += FixedMul (speed, finesine[an]);
-				particle->velz += FRACUNIT/80;
-				particle->accz += FRACUNIT/40;
-				if (M_Random () & 7)
-					particle->color = grey2;
-				else
-					particle->color = grey1;
-				particle->size = 3;
-			} else
-				break;
-		}
+		MakeRocketTrail (actor->x, actor->y, actor->z, actor->velx, actor->vely, actor->velz,
+			actor->radius, actor->height, moveangle);
 	}
 	if ((effects & FX_GRENADE) && (cl_rockettrails & 1))
 	{
@@ -985,3 +1259,109 @@ void P_DisconnectEffect (AActor *actor)
 		p->size = 4;
 	}
 }
+
+//===========================================================================
+//
+// [dorch] Particle statistics and benchmark
+//
+//===========================================================================
+
+ADD_STAT (particles)
+{
+	FString out;
+	out.Format ("%u/%u particles  think=%04.2f ms  sort=%04.2f ms",
+		ParticlePool.Count, NumParticles, ParticleThinkCycles.TimeMS(), ParticleSortCycles.TimeMS());
+	return out;
+}
+
+// Fires rails and rockets in every direction from the console player for a
+// number of tics and times spawning, thinking and sorting the particles.
+// Raise r_maxparticles first to see how the pool scales.
+// Usage: r_benchparticles [tics] [rails per tic] [rockets]
+CCMD (r_benchparticles)
+{
+	if (gamestate != GS_LEVEL || players[consoleplayer].mo == NULL)
+	{
+		Printf ("r_benchparticles can only be used in a level.\n");
+		return;
+	}
+	if (NETWORK_GetState() == NETSTATE_SERVER)
+	{
+		Printf ("r_benchparticles can't be used on a server.\n");
+		return;
+	}
+
+	const int tics = (argv.argc() > 1) ? clamp (atoi (argv[1]), 1, 10000) : 350;
+	const int rails = (argv.argc() > 2) ? clamp (atoi (argv[2]), 0, 1000) : 8;
+	const int rockets = (argv.argc() > 3) ? clamp (atoi (argv[3]), 0, 10000) : 64;
+
+	AActor *mo = players[consoleplayer].mo;
+	const FVector3 origin (FIXED2FLOAT(mo->x), FIXED2FLOAT(mo->y), FIXED2FLOAT(mo->z + mo->height/2));
+	const bool particles = r_particles;
+	DWORD seed = 1;
+	cycle_t spawncycles, thinkcycles, sortcycles;
+	DWORD peak = 0;
+	double live = 0;
+
+	spawncycles.Reset();
+	thinkcycles.Reset();
+	sortcycles.Reset();
+	P_ClearParticles ();
+	r_particles = true;
+
+	for (int tic = 0; tic < tics; tic++)
+	{
+		spawncycles.Clock();
+		for (int i = 0; i < rails; i++)
+		{
+			seed = seed * 1664525 + 1013904223;
+			const angle_t an = seed;
+			const float length = 256.f + (seed >> 22);
+			const FVector3 end = origin + FVector3 (
+				length * FIXED2FLOAT(finecosine[an >> ANGLETOFINESHIFT]),
+				length * FIXED2FLOAT(finesine[an >> ANGLETOFINESHIFT]), 0);
+
+			P_DrawRailTrail (mo, origin, end, 0, 0, 0, RAF_SILENT);
+		}
+		// The rockets fly out from the player at the speed of a Doom rocket
+		// and start over after two seconds.
+		for (int i = 0; i < rockets; i++)
+		{
+			const angle_t an = angle_t(i) * (ANGLE_MAX / rockets);
+			const fixed_t velx = 20 * finecosine[an >> ANGLETOFINESHIFT];
+			const fixed_t vely = 20 * finesine[an >> ANGLETOFINESHIFT];
+			const int age = (tic + i) % (2 * TICRATE);
+
+			MakeRocketTrail (mo->x + age * velx, mo->y + age * vely, mo->z + mo->height/2,
+				velx, vely, 0, 11*FRACUNIT, 8*FRACUNIT, an);
+		}
+		spawncycles.Unclock();
+
+		thinkcycles.Clock();
+		P_ThinkParticles ();
+		thinkcycles.Unclock();
+
+		sortcycles.Clock();
+		P_FindParticleSubsectors ();
+		sortcycles.Unclock();
+
+		peak = MAX (peak, ParticlePool.Count);
+		live += ParticlePool.Count;
+	}
+
+	r_particles = particles;
+	live /= tics;
+
+	const double spawnms = spawncycles.TimeMS() / tics;
+	const double thinkms = thinkcycles.TimeMS() / tics;
+	const double sortms = sortcycles.TimeMS() / tics;
+
+	Printf ("%d tics, %d rails and %d rocket trails per tic, %u particle pool, %d thread%s:\n",
+		tics, rails, rockets, NumParticles, R_GetRenderThreadCount(), R_GetRenderThreadCount() == 1 ? "" : "s");
+	Printf ("  live particles: %.0f average, %u peak\n", live, peak);
+	Printf ("  spawn: %7.3f ms/tic\n", spawnms);
+	Printf ("  think: %7.3f ms/tic (%.1f ns/particle)\n", thinkms, live > 0 ? thinkms * 1e6 / live : 0.);
+	Printf ("  sort:  %7.3f ms/tic (%.1f ns/particle)\n", sortms, live > 0 ? sortms * 1e6 / live : 0.);
+
+	P_ClearParticles ();
+}
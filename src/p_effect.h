@@ -64,15 +64,17 @@ struct particle_t
 	BYTE	bright:1;
 	BYTE	fade;
 	int		color;
-	WORD	tnext;
-	WORD	snext;
 	subsector_t * subsector;
 };
 
+// [dorch] Particles sorted by subsector by P_FindParticleSubsectors. The
+// particles in subsector n are Particles[ParticlesInSubsec[n]] up to but not
+// including Particles[ParticlesInSubsec[n+1]].
 extern particle_t *Particles;
-extern TArray<WORD>		ParticlesInSubsec;
+extern TArray<DWORD>	ParticlesInSubsec;
 
-const WORD NO_PARTICLE = 0xffff;
+// [dorch] Upper limit for r_maxparticles and -numparticles.
+const DWORD MAX_PARTICLES = 1 << 20;
 
 void P_ClearParticles ();
 void P_FindParticleSubsectors ();
@@ -6107,7 +6107,7 @@ void P_DoCrunch(AActor *thing, FChangePosition *cpos)
 		}
 
 		// [BC] Do the same thing, except for the white flag.
-		if ( thing->IsKindOf( PClass::FindClass( "WhiteFlag" ) ))
+		if ( thing->IsKindOf( PClass::FindClass( LITERAL_NAME( "WhiteFlag", true )) ))
 		{
 			if ( thing->flags & MF_DROPPED )
 				TEAM_ExecuteReturnRoutine( teams.Size( ), NULL );
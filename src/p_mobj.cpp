@@ -372,6 +372,11 @@ void AActor::Serialize (FArchive &arc)
 		<< pPickupSpot
 		<< Rune;
 
+	// [dorch] The rest of a client demo refers to actors by their NetIDs, so
+	// demo keyframes have to restore them exactly.
+	if (arc.IsDemoKeyframe())
+		arc << NetID;
+
 	{
 		FString tagstr;
 		if (arc.IsStoring() && Tag != NULL && Tag->Len() > 0) tagstr = *Tag;
@@ -386,7 +391,12 @@ void AActor::Serialize (FArchive &arc)
 	if (arc.IsLoading ())
 	{
 		// [BB] If the the actor needs one, generate a new netID.
-		if ( !( NetworkFlags & NETFL_NONETID ) && !( NetworkFlags & NETFL_SERVERSIDEONLY ) )
+		if ( arc.IsDemoKeyframe() )
+		{
+			if ( NetID != 0 )
+				g_ActorNetIDList.useID ( NetID, this );
+		}
+		else if ( !( NetworkFlags & NETFL_NONETID ) && !( NetworkFlags & NETFL_SERVERSIDEONLY ) )
 		{
 			NetID = g_ActorNetIDList.getNewID( );
 			g_ActorNetIDList.useID ( NetID, this );
@@ -638,7 +648,7 @@ void AActor::HideOrDestroyIfSafe ()
 		// [BB] The dormant flag stops removed invasion spawners from spawning things when hidden.
 		flags2 |= MF2_DORMANT;
 		flags &= ~MF_SOLID;
-		SetState( RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HideIndefinitely") );
+		SetState( RUNTIME_CLASS ( AInventory )->ActorInfo->FindState( LITERAL_NAME( "HideIndefinitely", false )) );
 
 		// [BB] Remember that this was hidden. These things sometimes have to be explicitly excluded, e.g. in CheckBossDeath.
 		STFlags |= STFL_HIDDEN_INSTEAD_OF_DESTROYED;
@@ -1039,7 +1049,7 @@ AInventory *AActor::GiveInventoryTypeRespectingReplacements (const PClass *type,
 	const PClass *pReplacementClass = type->ActorInfo->GetReplacement( )->Class;
 	// [BB] Special handling for DehackedPickup: In this case the original actor is
 	// already modified and we need to give it to him instead of the replacement.
-	if ( pReplacementClass->IsDescendantOf ( PClass::FindClass( "DehackedPickup" ) ) )
+	if ( pReplacementClass->IsDescendantOf ( PClass::FindClass( LITERAL_NAME( "DehackedPickup", true )) ) )
 		return GiveInventoryType ( type, checkNoLMSFlag );
 	// [BB] If the replacement is something, that is not of type AInventory, we
 	// can't give it to the actor.
@@ -1411,7 +1421,7 @@ bool AActor::Grind(bool items)
 				CALL_ACTION(A_BossDeath, this);
 			}
 
-			const PClass *i = PClass::FindClass("RealGibs");
+			const PClass *i = PClass::FindClass( LITERAL_NAME( "RealGibs", true ));
 
 			if (i != NULL)
 			{
@@ -3523,7 +3533,7 @@ void P_NightmareRespawn (AActor *mobj)
 	}
 
 	// spawn a teleport fog at old spot because of removal of the body?
-	mo = Spawn ("TeleportFog", mobj->x, mobj->y, mobj->z, ALLOW_REPLACE);
+	mo = Spawn( LITERAL_NAME( "TeleportFog", true ), mobj->x, mobj->y, mobj->z, ALLOW_REPLACE);
 	if (mo != NULL)
 	{
 		mo->z += TELEFOGHEIGHT;
@@ -3534,7 +3544,7 @@ void P_NightmareRespawn (AActor *mobj)
 	}
 
 	// spawn a teleport fog at the new spot
-	mo = Spawn ("TeleportFog", x, y, z, ALLOW_REPLACE);
+	mo = Spawn( LITERAL_NAME( "TeleportFog", true ), x, y, z, ALLOW_REPLACE);
 	if (mo != NULL)
 	{
 		mo->z += TELEFOGHEIGHT;
@@ -3854,7 +3864,7 @@ bool AActor::IsOkayToAttack (AActor *link)
 {
 	// [BB] Don't do this in client mode for MinotaurFriend.
 	// That's the only actor that is adapted such that the server handles this check.
-	if ( NETWORK_InClientMode() && this->IsKindOf( PClass::FindClass("MinotaurFriend") ) )
+	if ( NETWORK_InClientMode() && this->IsKindOf( PClass::FindClass( LITERAL_NAME( "MinotaurFriend", true )) ) )
 		return ( false );
 
 	if (!(player							// Original AActor::IsOkayToAttack was only for players
@@ -4078,7 +4088,7 @@ void AActor::Tick ()
 			{
 				// add some smoke behind the rocket 
 				smokecounter = 0;
-				AActor *th = Spawn("RocketSmokeTrail", x-velx, y-vely, z-velz, ALLOW_REPLACE);
+				AActor *th = Spawn( LITERAL_NAME( "RocketSmokeTrail", true ), x-velx, y-vely, z-velz, ALLOW_REPLACE);
 				if (th)
 				{
 					th->tics -= pr_rockettrail()&3;
@@ -4093,7 +4103,7 @@ void AActor::Tick ()
 			{
 				smokecounter = 0;
 				angle_t moveangle = R_PointToAngle2(0,0,velx,vely);
-				AActor * th = Spawn("GrenadeSmokeTrail", 
+				AActor * th = Spawn( LITERAL_NAME( "GrenadeSmokeTrail", true ), 
 					x - FixedMul (finecosine[(moveangle)>>ANGLETOFINESHIFT], radius*2) + (pr_rockettrail()<<10),
 					y - FixedMul (finesine[(moveangle)>>ANGLETOFINESHIFT], radius*2) + (pr_rockettrail()<<10),
 					z - (height>>3) * (velz>>16) + (2*height)/3, ALLOW_REPLACE);
@@ -5070,7 +5080,7 @@ AActor *AActor::StaticSpawn (const PClass *type, fixed_t ix, fixed_t iy, fixed_t
 				TEAM_ExecuteReturnRoutine( i, NULL );
 		}
 
-		if (( oneflagctf ) && ( actor->IsKindOf( PClass::FindClass( "WhiteFlag" ) )))
+		if (( oneflagctf ) && ( actor->IsKindOf( PClass::FindClass( LITERAL_NAME( "WhiteFlag", true )) )))
 			TEAM_ExecuteReturnRoutine( teams.Size( ), NULL );
 	}
 
@@ -5717,7 +5727,7 @@ APlayerPawn *P_SpawnPlayer (FPlayerStart *mthing, int playernum, int flags)
 	{
 		unsigned an = mobj->angle >> ANGLETOFINESHIFT;
 		// [BB] Save the pointer.
-		AActor *pFog = Spawn ("TeleportFog", mobj->x+20*finecosine[an], mobj->y+20*finesine[an], mobj->z + TELEFOGHEIGHT, ALLOW_REPLACE);
+		AActor *pFog = Spawn( LITERAL_NAME( "TeleportFog", true ), mobj->x+20*finecosine[an], mobj->y+20*finesine[an], mobj->z + TELEFOGHEIGHT, ALLOW_REPLACE);
 		// [BB] Clients spawn the fog on their own. Giving the fog the NETFL_ALLOWCLIENTSPAWN flag will prevent
 		// the server from telling the clients to spawn the fog again during a full update.
 		if ( pFog && ( NETWORK_GetState( ) == NETSTATE_SERVER ) )
@@ -6102,7 +6112,7 @@ AActor *P_SpawnMapThing (FMapThing *mthing, int position)
 		Printf ("Unknown type %i at (%i, %i)\n",
 				 mthing->type,
 				 mthing->x>>FRACBITS, mthing->y>>FRACBITS);
-		i = PClass::FindClass("Unknown");
+		i = PClass::FindClass( LITERAL_NAME( "Unknown", true ));
 	}
 	// [RH] If the thing's corresponding sprite has no frames, also map
 	//		it to the unknown thing.
@@ -6124,7 +6134,7 @@ AActor *P_SpawnMapThing (FMapThing *mthing, int position)
 
 			Printf ("%s at (%i, %i) has no frames\n",
 					i->TypeName.GetChars(), mthing->x>>FRACBITS, mthing->y>>FRACBITS);
-			i = PClass::FindClass("Unknown");
+			i = PClass::FindClass( LITERAL_NAME( "Unknown", true ));
 		}
 	}
 
@@ -8127,9 +8137,9 @@ CCMD( respawnactors )
 
 	while ( (pActor = Iterator.Next( )))
 	{
-		if (( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HideDoomish") ) ||
-			( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HideSpecial") ) ||
-			( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HideIndefinitely") ))
+		if (( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState( LITERAL_NAME( "HideDoomish", false )) ) ||
+			( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState( LITERAL_NAME( "HideSpecial", false )) ) ||
+			( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState( LITERAL_NAME( "HideIndefinitely", false )) ))
 		{
 //			CLIENT_RestoreSpecialPosition( pActor );
 //			CLIENT_RestoreSpecialDoomThing( pActor, true );
@@ -147,6 +147,46 @@ void P_SerializePlayers (FArchive &arc, bool skipload)
 	}
 }
 
+//*****************************************************************************
+//
+// [dorch] Demo keyframes must put every player back into exactly the slot it
+// was saved from, because the rest of the demo refers to players by their
+// index. The per-player scores that player_t::Serialize leaves out are kept
+// here as well.
+//
+void P_SerializePlayerSlots (FArchive &arc)
+{
+	for (int i = 0; i < MAXPLAYERS; ++i)
+	{
+		arc << playeringame[i];
+
+		if (playeringame[i] == false)
+		{
+			if (arc.IsLoading())
+				players[i].mo = NULL;
+			continue;
+		}
+
+		// LONG and ULONG aren't 32 bits everywhere, so go through DWORDs.
+		DWORD scores[4] = { static_cast<DWORD>(players[i].lPointCount), static_cast<DWORD>(players[i].ulDeathCount),
+			static_cast<DWORD>(players[i].ulWins), static_cast<DWORD>(players[i].ulTime) };
+
+		players[i].Serialize (arc);
+		arc << scores[0] << scores[1] << scores[2] << scores[3];
+
+		if (arc.IsLoading())
+		{
+			players[i].lPointCount = static_cast<SDWORD>(scores[0]);
+			players[i].ulDeathCount = scores[1];
+			players[i].ulWins = scores[2];
+			players[i].ulTime = scores[3];
+
+			if (players[i].mo != NULL)
+				players[i].mo->player = &players[i];
+		}
+	}
+}
+
 static void ReadOnePlayer (FArchive &arc, bool skipload)
 {
 	int i;
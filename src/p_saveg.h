@@ -41,6 +41,7 @@ struct PNGHandle;
 // These are the load / save game routines.
 // Also see farchive.(h|cpp)
 void P_SerializePlayers (FArchive &arc, bool fakeload);
+void P_SerializePlayerSlots (FArchive &arc); // [dorch]
 void P_SerializeWorld (FArchive &arc);
 void P_SerializeThinkers (FArchive &arc, bool);
 void P_SerializePolyobjs (FArchive &arc);
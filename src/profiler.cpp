@@ -0,0 +1,755 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Zandronum Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: profiler.cpp
+//
+// Description: A small hierarchical profiler. Scoped zones write their times
+// to a ring buffer owned by the thread they run on. The main thread collects
+// them once per frame into per zone histograms.
+//
+//-----------------------------------------------------------------------------
+
+#include <chrono>
+#include <mutex>
+#include <time.h>
+#include <vector>
+
+#include "profiler.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "cmdlib.h"
+#include "dobject.h"
+#include "i_system.h"
+#include "templates.h"
+#include "v_text.h"
+
+//*****************************************************************************
+//	DEFINES
+
+enum
+{
+	// Events each thread can hold until the next PROF_Frame. Must be a power
+	// of two.
+	PROF_RING_SIZE = 1 << 16,
+
+	// Zones nested deeper than this are not timed.
+	PROF_MAX_DEPTH = 32,
+
+	// The histograms have 8 buckets for every power of two from 64 ns up to
+	// about a minute, so a percentile is off by at most 1/8 of its value.
+	PROF_BUCKETS_PER_OCTAVE = 8,
+	PROF_FIRST_OCTAVE = 6,
+	PROF_NUM_OCTAVES = 30,
+	PROF_NUM_BUCKETS = PROF_BUCKETS_PER_OCTAVE * PROF_NUM_OCTAVES,
+
+	// Most events a single prof_trace keeps.
+	PROF_MAX_TRACE_EVENTS = 4 << 20,
+
+	PROF_NO_ZONE = 0xffff,
+};
+
+//*****************************************************************************
+struct ProfileEvent
+{
+	QWORD	qwStart;
+	DWORD	ulDuration;
+	WORD	usZone;
+	WORD	usParent;
+};
+
+//*****************************************************************************
+// The events of one thread. Only the owning thread writes events and moves
+// ulHead, only PROF_Frame reads them and moves ulTail.
+struct ProfileThread
+{
+	ProfileEvent				Events[PROF_RING_SIZE];
+	std::atomic<unsigned int>	ulHead;
+	std::atomic<unsigned int>	ulTail;
+	std::atomic<unsigned int>	ulDropped;
+	std::atomic<bool>			bInUse;
+	int							lIndex;
+
+	int							lDepth;
+	WORD						usStack[PROF_MAX_DEPTH];
+	QWORD						qwStackStart[PROF_MAX_DEPTH];
+};
+
+//*****************************************************************************
+// Frees the thread's buffer for the next thread when the thread exits.
+struct ProfileThreadHandle
+{
+	ProfileThread	*pThread;
+
+	~ProfileThreadHandle( )
+	{
+		if ( pThread )
+			pThread->bInUse = false;
+	}
+};
+
+//*****************************************************************************
+// How long a zone took per frame, over the frames it ran in.
+struct ProfileStats
+{
+	DWORD	ulHistogram[PROF_NUM_BUCKETS];
+	DWORD	ulFrames;
+	QWORD	qwCalls;
+	QWORD	qwTime;
+	QWORD	qwMax;
+
+	void Clear( )
+	{
+		memset( this, 0, sizeof( *this ));
+	}
+
+	void Add( QWORD qwFrameTime, DWORD ulCalls );
+	double PercentileMS( double dFraction ) const;
+};
+
+//*****************************************************************************
+struct ProfileZone
+{
+	FString			Name;
+
+	// The zone this one ran inside the first time it was seen. -1 if it was
+	// outermost, -2 if it hasn't run yet.
+	int				lParent;
+
+	QWORD			qwFrameTime;
+	DWORD			ulFrameCalls;
+
+	// Since prof_reset and since the last periodic dump.
+	ProfileStats	Total;
+	ProfileStats	Interval;
+};
+
+//*****************************************************************************
+struct ProfileTraceEvent
+{
+	QWORD	qwStart;
+	DWORD	ulDuration;
+	WORD	usZone;
+	WORD	usThread;
+};
+
+//*****************************************************************************
+//	VARIABLES
+
+std::atomic<bool>	g_bProfilerActive( false );
+
+// Guards g_ProfileZones and g_ProfileThreads. Both are added to by any
+// thread, so they can't be TArrays, which allocate with M_Malloc.
+static	std::mutex						g_ProfileMutex;
+static	std::vector<ProfileZone *>		g_ProfileZones;
+static	std::vector<ProfileThread *>	g_ProfileThreads;
+static	thread_local ProfileThreadHandle	g_ThisProfileThread = { NULL };
+
+// Zone of every thinker class, indexed by the class's name.
+static	TArray<int>						g_ProfileClassZones;
+
+static	bool							g_bProfilerWasActive = false;
+static	int								g_lMainProfileThread = -1;
+static	DWORD							g_ulProfileFrames = 0;
+static	DWORD							g_ulProfileIntervalFrames = 0;
+static	QWORD							g_qwLastProfileDump = 0;
+
+static	bool							g_bProfileTracing = false;
+static	QWORD							g_qwTraceStart;
+static	QWORD							g_qwTraceEnd;
+static	FString							g_TraceFile;
+static	TArray<ProfileTraceEvent>		g_TraceEvents;
+static	DWORD							g_ulTraceDropped;
+
+//*****************************************************************************
+//	PROTOTYPES
+
+static	void	prof_UpdateActive( void );
+
+//*****************************************************************************
+//	CONSOLE VARIABLES
+
+// [dorch] Profile the zones marked with PROF_ZONE. See prof_stats.
+CUSTOM_CVAR( Bool, prof_enable, false, CVAR_GLOBALCONFIG )
+{
+	prof_UpdateActive( );
+}
+
+// Seconds between writing the profile of the last interval as one line of
+// JSON. 0 turns this off.
+CUSTOM_CVAR( Int, prof_dumpinterval, 0, CVAR_ARCHIVE|CVAR_GLOBALCONFIG )
+{
+	if ( self < 0 )
+		self = 0;
+}
+
+// File the periodic dumps are appended to. Empty prints them to the console
+// instead, prefixed with "PROFILE ".
+CVAR( String, prof_dumpfile, "", CVAR_ARCHIVE|CVAR_GLOBALCONFIG )
+
+//*****************************************************************************
+//	FUNCTIONS
+
+static QWORD prof_Now( void )
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now( ).time_since_epoch( )).count( );
+}
+
+//*****************************************************************************
+//
+static void prof_UpdateActive( void )
+{
+	g_bProfilerActive = prof_enable || g_bProfileTracing;
+}
+
+//*****************************************************************************
+//
+static int prof_GetBucket( QWORD qwTime )
+{
+	if ( qwTime < ( 1u << PROF_FIRST_OCTAVE ))
+		return 0;
+
+	int lOctave = 0;
+	while (( qwTime >> ( lOctave + 1 )) != 0 )
+		lOctave++;
+
+	// The three bits below the top bit pick the bucket inside the octave.
+	const int lSub = static_cast<int>( qwTime >> ( lOctave - 3 )) & ( PROF_BUCKETS_PER_OCTAVE - 1 );
+	return MIN<int>(( lOctave - PROF_FIRST_OCTAVE ) * PROF_BUCKETS_PER_OCTAVE + lSub, PROF_NUM_BUCKETS - 1 );
+}
+
+//*****************************************************************************
+//
+void ProfileStats::Add( QWORD qwFrameTime, DWORD ulCalls )
+{
+	ulHistogram[prof_GetBucket( qwFrameTime )]++;
+	ulFrames++;
+	qwCalls += ulCalls;
+	qwTime += qwFrameTime;
+	qwMax = MAX( qwMax, qwFrameTime );
+}
+
+//*****************************************************************************
+//
+// Returns the middle of the bucket the percentile falls in, but never more
+// than the longest time that was seen.
+//
+double ProfileStats::PercentileMS( double dFraction ) const
+{
+	if ( ulFrames == 0 )
+		return 0;
+
+	const double dWanted = dFraction * ulFrames;
+	double dSeen = 0;
+
+	for ( int i = 0; i < PROF_NUM_BUCKETS; i++ )
+	{
+		dSeen += ulHistogram[i];
+		if ( dSeen >= dWanted )
+		{
+			const int lOctave = i / PROF_BUCKETS_PER_OCTAVE + PROF_FIRST_OCTAVE;
+			const int lSub = i % PROF_BUCKETS_PER_OCTAVE;
+			const double dLow = ldexp( 1. + lSub / 8., lOctave );
+			const double dHigh = ldexp( 1. + ( lSub + 1 ) / 8., lOctave );
+
+			return MIN( ( dLow + dHigh ) / 2, static_cast<double>( qwMax )) * 1e-6;
+		}
+	}
+
+	return qwMax * 1e-6;
+}
+
+//*****************************************************************************
+//
+int PROF_RegisterZone( const char *pszName )
+{
+	std::lock_guard<std::mutex> lock( g_ProfileMutex );
+
+	for ( unsigned int i = 0; i < g_ProfileZones.size( ); i++ )
+	{
+		if ( g_ProfileZones[i]->Name.Compare( pszName ) == 0 )
+			return i;
+	}
+
+	if ( g_ProfileZones.size( ) >= PROF_NO_ZONE )
+		return PROF_NO_ZONE;
+
+	ProfileZone *pZone = new ProfileZone;
+	pZone->Name = pszName;
+	pZone->lParent = -2;
+	pZone->qwFrameTime = 0;
+	pZone->ulFrameCalls = 0;
+	pZone->Total.Clear( );
+	pZone->Interval.Clear( );
+
+	g_ProfileZones.push_back( pZone );
+	return static_cast<int>( g_ProfileZones.size( )) - 1;
+}
+
+//*****************************************************************************
+//
+// Returns the zone of the Tick of a thinker class. Must be called from the
+// main thread.
+//
+int PROF_GetClassZone( const PClass *pType )
+{
+	const int lIndex = pType->TypeName.GetIndex( );
+
+	if ( lIndex >= static_cast<int>( g_ProfileClassZones.Size( )))
+	{
+		const unsigned int ulOldSize = g_ProfileClassZones.Size( );
+		g_ProfileClassZones.Resize( lIndex + 1 );
+		for ( unsigned int i = ulOldSize; i < g_ProfileClassZones.Size( ); i++ )
+			g_ProfileClassZones[i] = -1;
+	}
+
+	if ( g_ProfileClassZones[lIndex] == -1 )
+	{
+		FString name;
+		name.Format( "%s::Tick", pType->TypeName.GetChars( ));
+		g_ProfileClassZones[lIndex] = PROF_RegisterZone( name );
+	}
+
+	return g_ProfileClassZones[lIndex];
+}
+
+//*****************************************************************************
+//
+static ProfileThread *prof_GetThread( void )
+{
+	if ( g_ThisProfileThread.pThread )
+		return g_ThisProfileThread.pThread;
+
+	std::lock_guard<std::mutex> lock( g_ProfileMutex );
+	ProfileThread *pThread = NULL;
+
+	// Reuse the buffer of a thread that has exited.
+	for ( unsigned int i = 0; i < g_ProfileThreads.size( ); i++ )
+	{
+		if ( g_ProfileThreads[i]->bInUse == false )
+		{
+			pThread = g_ProfileThreads[i];
+			break;
+		}
+	}
+
+	if ( pThread == NULL )
+	{
+		pThread = new ProfileThread;
+		pThread->ulHead = 0;
+		pThread->ulTail = 0;
+		pThread->ulDropped = 0;
+		pThread->lIndex = static_cast<int>( g_ProfileThreads.size( ));
+		g_ProfileThreads.push_back( pThread );
+	}
+
+	pThread->lDepth = 0;
+	pThread->bInUse = true;
+	g_ThisProfileThread.pThread = pThread;
+	return pThread;
+}
+
+//*****************************************************************************
+//
+void PROF_BeginZone( int lZone )
+{
+	ProfileThread *pThread = prof_GetThread( );
+
+	if ( pThread->lDepth < PROF_MAX_DEPTH )
+	{
+		pThread->usStack[pThread->lDepth] = static_cast<WORD>( lZone );
+		pThread->qwStackStart[pThread->lDepth] = prof_Now( );
+	}
+	pThread->lDepth++;
+}
+
+//*****************************************************************************
+//
+void PROF_EndZone( void )
+{
+	const QWORD qwEnd = prof_Now( );
+	ProfileThread *pThread = prof_GetThread( );
+
+	if (( pThread->lDepth <= 0 ) || ( --pThread->lDepth >= PROF_MAX_DEPTH ))
+		return;
+
+	const int lDepth = pThread->lDepth;
+	const unsigned int ulHead = pThread->ulHead.load( std::memory_order_relaxed );
+
+	if ( ulHead - pThread->ulTail.load( std::memory_order_acquire ) >= PROF_RING_SIZE )
+	{
+		pThread->ulDropped++;
+		return;
+	}
+
+	ProfileEvent &event = pThread->Events[ulHead & ( PROF_RING_SIZE - 1 )];
+	event.qwStart = pThread->qwStackStart[lDepth];
+	event.ulDuration = static_cast<DWORD>( MIN<QWORD>( qwEnd - event.qwStart, 0xffffffffu ));
+	event.usZone = pThread->usStack[lDepth];
+	event.usParent = ( lDepth > 0 ) ? pThread->usStack[lDepth - 1] : static_cast<WORD>( PROF_NO_ZONE );
+	pThread->ulHead.store( ulHead + 1, std::memory_order_release );
+}
+
+//*****************************************************************************
+//
+static void prof_WriteJSONString( FString &out, const char *pszText )
+{
+	out += '"';
+	for ( ; *pszText; pszText++ )
+	{
+		if (( *pszText == '"' ) || ( *pszText == '\\' ))
+			out += '\\';
+		out += *pszText;
+	}
+	out += '"';
+}
+
+//*****************************************************************************
+//
+static void prof_DumpInterval( void )
+{
+	FString out;
+
+	out.Format( "{\"time\":%lld,\"frames\":%u,\"zones\":[", static_cast<long long>( time( NULL )), g_ulProfileIntervalFrames );
+
+	bool bFirst = true;
+	for ( unsigned int i = 0; i < g_ProfileZones.size( ); i++ )
+	{
+		ProfileZone *pZone = g_ProfileZones[i];
+		const ProfileStats &stats = pZone->Interval;
+
+		if ( stats.ulFrames == 0 )
+			continue;
+
+		if ( bFirst == false )
+			out += ',';
+		bFirst = false;
+
+		out += "{\"name\":";
+		prof_WriteJSONString( out, pZone->Name );
+		if ( pZone->lParent >= 0 )
+		{
+			out += ",\"parent\":";
+			prof_WriteJSONString( out, g_ProfileZones[pZone->lParent]->Name );
+		}
+		out.AppendFormat( ",\"frames\":%u,\"calls\":%llu,\"mean_ms\":%.4f,\"p50_ms\":%.4f,\"p95_ms\":%.4f,\"p99_ms\":%.4f,\"max_ms\":%.4f}",
+			stats.ulFrames, static_cast<unsigned long long>( stats.qwCalls ), stats.qwTime * 1e-6 / stats.ulFrames,
+			stats.PercentileMS( 0.5 ), stats.PercentileMS( 0.95 ), stats.PercentileMS( 0.99 ), stats.qwMax * 1e-6 );
+	}
+	out += "]}";
+
+	if ( strlen( prof_dumpfile ) > 0 )
+	{
+		FILE *pFile = fopen( prof_dumpfile, "a" );
+		if ( pFile == NULL )
+		{
+			Printf( "Couldn't open %s to write the profile.\n", *prof_dumpfile );
+			prof_dumpinterval = 0;
+			return;
+		}
+		fprintf( pFile, "%s\n", out.GetChars( ));
+		fclose( pFile );
+	}
+	else
+		Printf( "PROFILE %s\n", out.GetChars( ));
+
+	for ( unsigned int i = 0; i < g_ProfileZones.size( ); i++ )
+		g_ProfileZones[i]->Interval.Clear( );
+	g_ulProfileIntervalFrames = 0;
+}
+
+//*****************************************************************************
+//
+static void prof_WriteTrace( void )
+{
+	FILE *pFile = fopen( g_TraceFile, "w" );
+
+	g_bProfileTracing = false;
+	prof_UpdateActive( );
+
+	if ( pFile == NULL )
+	{
+		Printf( "Couldn't open %s to write the trace.\n", g_TraceFile.GetChars( ));
+		g_TraceEvents.Clear( );
+		return;
+	}
+
+	fprintf( pFile, "{\"traceEvents\":[\n" );
+	for ( unsigned int i = 0; i < g_ProfileThreads.size( ); i++ )
+	{
+		fprintf( pFile, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}},\n",
+			i, ( static_cast<int>( i ) == g_lMainProfileThread ) ? "Main" : "Worker", i );
+	}
+
+	for ( unsigned int i = 0; i < g_TraceEvents.Size( ); i++ )
+	{
+		const ProfileTraceEvent &event = g_TraceEvents[i];
+		FString name;
+
+		prof_WriteJSONString( name, g_ProfileZones[event.usZone]->Name );
+		fprintf( pFile, "{\"name\":%s,\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}%s\n",
+			name.GetChars( ), ( event.qwStart - g_qwTraceStart ) * 1e-3, event.ulDuration * 1e-3, event.usThread,
+			( i + 1 < g_TraceEvents.Size( )) ? "," : "" );
+	}
+
+	fprintf( pFile, "],\"displayTimeUnit\":\"ms\"}\n" );
+	fclose( pFile );
+
+	Printf( "Wrote %u events to %s.", g_TraceEvents.Size( ), g_TraceFile.GetChars( ));
+	if ( g_ulTraceDropped > 0 )
+		Printf( " " TEXTCOLOR_RED "%u events did not fit." TEXTCOLOR_NORMAL, g_ulTraceDropped );
+	Printf( "\n" );
+
+	g_TraceEvents.Clear( );
+}
+
+//*****************************************************************************
+//
+// Collects the events every thread recorded since the last call. Called by
+// the main loop once per frame and by the server once per tic.
+//
+void PROF_Frame( void )
+{
+	const bool bActive = g_bProfilerActive;
+
+	// Collect once more after the profiler is turned off.
+	if (( bActive == false ) && ( g_bProfilerWasActive == false ))
+		return;
+	g_bProfilerWasActive = bActive;
+
+	std::lock_guard<std::mutex> lock( g_ProfileMutex );
+
+	if ( g_ThisProfileThread.pThread )
+		g_lMainProfileThread = g_ThisProfileThread.pThread->lIndex;
+
+	for ( unsigned int i = 0; i < g_ProfileThreads.size( ); i++ )
+	{
+		ProfileThread *pThread = g_ProfileThreads[i];
+		const unsigned int ulHead = pThread->ulHead.load( std::memory_order_acquire );
+		unsigned int ulTail = pThread->ulTail.load( std::memory_order_relaxed );
+
+		for ( ; ulTail != ulHead; ulTail++ )
+		{
+			const ProfileEvent &event = pThread->Events[ulTail & ( PROF_RING_SIZE - 1 )];
+
+			// Zones past the 65535th weren't registered.
+			if ( event.usZone >= g_ProfileZones.size( ))
+				continue;
+
+			ProfileZone *pZone = g_ProfileZones[event.usZone];
+
+			pZone->qwFrameTime += event.ulDuration;
+			pZone->ulFrameCalls++;
+			if ( pZone->lParent == -2 )
+				pZone->lParent = ( event.usParent == PROF_NO_ZONE ) ? -1 : event.usParent;
+
+			if ( g_bProfileTracing && ( event.qwStart >= g_qwTraceStart ))
+			{
+				if ( g_TraceEvents.Size( ) < PROF_MAX_TRACE_EVENTS )
+				{
+					ProfileTraceEvent traceEvent = { event.qwStart, event.ulDuration, event.usZone, static_cast<WORD>( i ) };
+					g_TraceEvents.Push( traceEvent );
+				}
+				else
+					g_ulTraceDropped++;
+			}
+		}
+
+		pThread->ulTail.store( ulTail, std::memory_order_release );
+		if ( g_bProfileTracing )
+			g_ulTraceDropped += pThread->ulDropped.exchange( 0 );
+	}
+
+	for ( unsigned int i = 0; i < g_ProfileZones.size( ); i++ )
+	{
+		ProfileZone *pZone = g_ProfileZones[i];
+
+		if ( pZone->ulFrameCalls == 0 )
+			continue;
+
+		pZone->Total.Add( pZone->qwFrameTime, pZone->ulFrameCalls );
+		pZone->Interval.Add( pZone->qwFrameTime, pZone->ulFrameCalls );
+		pZone->qwFrameTime = 0;
+		pZone->ulFrameCalls = 0;
+	}
+	g_ulProfileFrames++;
+	g_ulProfileIntervalFrames++;
+
+	const QWORD qwNow = prof_Now( );
+
+	if (( prof_dumpinterval > 0 ) && ( bActive ))
+	{
+		if ( g_qwLastProfileDump == 0 )
+			g_qwLastProfileDump = qwNow;
+		else if ( qwNow - g_qwLastProfileDump >= static_cast<QWORD>( *prof_dumpinterval ) * 1000000000 )
+		{
+			prof_DumpInterval( );
+			g_qwLastProfileDump = qwNow;
+		}
+	}
+
+	if ( g_bProfileTracing && ( qwNow >= g_qwTraceEnd ))
+		prof_WriteTrace( );
+}
+
+//*****************************************************************************
+//
+static void prof_PrintZone( int lZone, int lDepth, const char *pszFilter )
+{
+	const ProfileZone *pZone = g_ProfileZones[lZone];
+	const ProfileStats &stats = pZone->Total;
+
+	if (( stats.ulFrames > 0 ) && (( pszFilter == NULL ) || ( pZone->Name.IndexOf( pszFilter ) >= 0 )))
+	{
+		FString name;
+		name.Format( "%*s%s", lDepth * 2, "", pZone->Name.GetChars( ));
+
+		Printf( "%-36s %7u %6.1f %8.3f %8.3f %8.3f %8.3f %8.3f\n", name.GetChars( ), stats.ulFrames,
+			static_cast<double>( stats.qwCalls ) / stats.ulFrames, stats.qwTime * 1e-6 / stats.ulFrames,
+			stats.PercentileMS( 0.5 ), stats.PercentileMS( 0.95 ), stats.PercentileMS( 0.99 ), stats.qwMax * 1e-6 );
+	}
+
+	// Children, the ones that took the longest first.
+	TArray<int> children;
+	for ( unsigned int i = 0; i < g_ProfileZones.size( ); i++ )
+	{
+		if (( g_ProfileZones[i]->lParent == lZone ) && ( static_cast<int>( i ) != lZone ))
+			children.Push( i );
+	}
+
+	for ( unsigned int i = 1; i < children.Size( ); i++ )
+	{
+		const int lChild = children[i];
+		unsigned int j = i;
+
+		for ( ; ( j > 0 ) && ( g_ProfileZones[children[j - 1]]->Total.qwTime < g_ProfileZones[lChild]->Total.qwTime ); j-- )
+			children[j] = children[j - 1];
+		children[j] = lChild;
+	}
+
+	if ( lDepth < PROF_MAX_DEPTH )
+	{
+		for ( unsigned int i = 0; i < children.Size( ); i++ )
+			prof_PrintZone( children[i], lDepth + 1, pszFilter );
+	}
+}
+
+//*****************************************************************************
+//	CONSOLE COMMANDS
+
+// [dorch] Prints how long each zone took per frame it ran in, as a tree of
+// the zones each one ran inside. Times are in ms.
+// Usage: prof_stats [filter]
+CCMD( prof_stats )
+{
+	if (( g_bProfilerActive == false ) && ( g_ulProfileFrames == 0 ))
+	{
+		Printf( "Nothing has been profiled yet. Set prof_enable to 1 first.\n" );
+		return;
+	}
+
+	const char *pszFilter = ( argv.argc( ) > 1 ) ? argv[1] : NULL;
+
+	std::lock_guard<std::mutex> lock( g_ProfileMutex );
+
+	Printf( "%u frames profiled.\n", g_ulProfileFrames );
+	Printf( "%-36s %7s %6s %8s %8s %8s %8s %8s\n", "zone", "frames", "calls", "mean", "p50", "p95", "p99", "max" );
+
+	unsigned int ulDropped = 0;
+	for ( unsigned int i = 0; i < g_ProfileThreads.size( ); i++ )
+		ulDropped += g_ProfileThreads[i]->ulDropped;
+
+	for ( unsigned int i = 0; i < g_ProfileZones.size( ); i++ )
+	{
+		if ( g_ProfileZones[i]->lParent == -1 )
+			prof_PrintZone( i, 0, pszFilter );
+	}
+
+	if ( ulDropped > 0 )
+		Printf( TEXTCOLOR_RED "%u events were dropped because a thread's buffer was full.\n" TEXTCOLOR_NORMAL, ulDropped );
+}
+
+//*****************************************************************************
+//
+CCMD( prof_reset )
+{
+	std::lock_guard<std::mutex> lock( g_ProfileMutex );
+
+	for ( unsigned int i = 0; i < g_ProfileZones.size( ); i++ )
+	{
+		g_ProfileZones[i]->Total.Clear( );
+		g_ProfileZones[i]->Interval.Clear( );
+	}
+	for ( unsigned int i = 0; i < g_ProfileThreads.size( ); i++ )
+		g_ProfileThreads[i]->ulDropped = 0;
+
+	g_ulProfileFrames = 0;
+	g_ulProfileIntervalFrames = 0;
+}
+
+//*****************************************************************************
+//
+// [dorch] Records every zone for a number of seconds and writes them in the
+// Chrome trace event format, for chrome://tracing or Perfetto.
+// Usage: prof_trace [seconds] [filename]
+CCMD( prof_trace )
+{
+	if ( g_bProfileTracing )
+	{
+		Printf( "A trace is already being recorded to %s.\n", g_TraceFile.GetChars( ));
+		return;
+	}
+
+	const double dSeconds = ( argv.argc( ) > 1 ) ? clamp( atof( argv[1] ), 0.1, 600. ) : 5.;
+
+	g_TraceFile = ( argv.argc( ) > 2 ) ? argv[2] : "trace.json";
+	FixPathSeperator( g_TraceFile );
+	DefaultExtension( g_TraceFile, ".json" );
+
+	g_TraceEvents.Clear( );
+	g_ulTraceDropped = 0;
+	g_qwTraceStart = prof_Now( );
+	g_qwTraceEnd = g_qwTraceStart + static_cast<QWORD>( dSeconds * 1e9 );
+	g_bProfileTracing = true;
+	prof_UpdateActive( );
+
+	Printf( "Recording a trace for %g seconds.\n", dSeconds );
+}
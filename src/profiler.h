@@ -0,0 +1,119 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Zandronum Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: profiler.h
+//
+// Description: A small hierarchical profiler. Scoped zones write their times
+// to a ring buffer owned by the thread they run on. The main thread collects
+// them once per frame into per zone histograms.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <atomic>
+
+class PClass;
+
+//*****************************************************************************
+//	PROTOTYPES
+
+int		PROF_RegisterZone( const char *pszName );
+int		PROF_GetClassZone( const PClass *pType );
+void	PROF_BeginZone( int lZone );
+void	PROF_EndZone( void );
+void	PROF_Frame( void );
+
+//*****************************************************************************
+//	VARIABLES
+
+// True while anything is being profiled, either because prof_enable is on or
+// because prof_trace is capturing.
+extern	std::atomic<bool>	g_bProfilerActive;
+
+//*****************************************************************************
+//	CLASSES
+
+// Times everything from its construction to the end of its scope. Does
+// nothing but check g_bProfilerActive while the profiler is off.
+class FProfileScope
+{
+public:
+	explicit FProfileScope( int lZone )
+	{
+		m_bActive = g_bProfilerActive.load( std::memory_order_relaxed );
+		if ( m_bActive )
+			PROF_BeginZone( lZone );
+	}
+
+	// Times the Tick of a thinker of this class.
+	explicit FProfileScope( const PClass *pType )
+	{
+		m_bActive = g_bProfilerActive.load( std::memory_order_relaxed );
+		if ( m_bActive )
+			PROF_BeginZone( PROF_GetClassZone( pType ));
+	}
+
+	~FProfileScope( )
+	{
+		if ( m_bActive )
+			PROF_EndZone( );
+	}
+
+private:
+	bool	m_bActive;
+};
+
+//*****************************************************************************
+//	DEFINES
+
+#define PROF_CONCAT2( a, b )	a##b
+#define PROF_CONCAT( a, b )		PROF_CONCAT2( a, b )
+
+// Profiles the rest of the enclosing scope as the zone called name. The zone
+// is registered the first time the line is reached.
+#define PROF_ZONE( name ) \
+	static const int PROF_CONCAT( s_lProfZone, __LINE__ ) = PROF_RegisterZone( name ); \
+	FProfileScope PROF_CONCAT( profScope, __LINE__ )( PROF_CONCAT( s_lProfZone, __LINE__ ))
+
+#endif // __PROFILER_H__
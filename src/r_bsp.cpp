@@ -1298,7 +1298,8 @@ void R_Subsector (subsector_t *sub)
 	if ((unsigned int)(sub - subsectors) < (unsigned int)numsubsectors)
 	{ // Only do it for the main BSP.
 		int shade = LIGHT2SHADE((floorlightlevel + ceilinglightlevel)/2 + r_actualextralight);
-		for (WORD i = ParticlesInSubsec[(unsigned int)(sub-subsectors)]; i != NO_PARTICLE; i = Particles[i].snext)
+		const unsigned int ssnum = (unsigned int)(sub-subsectors);
+		for (DWORD i = ParticlesInSubsec[ssnum]; i < ParticlesInSubsec[ssnum+1]; i++)
 		{
 			R_ProjectParticle (Particles + i, subsectors[sub-subsectors].sector, shade, FakeSide);
 		}
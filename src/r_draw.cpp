@@ -85,6 +85,10 @@ void (*R_DrawSpanMaskedTranslucent)(void);
 void (*R_DrawSpanAddClamp)(void);
 void (*R_DrawSpanMaskedAddClamp)(void);
 void (STACK_ARGS *rt_map4cols)(int,int,int);
+#ifndef X86_ASM
+void (STACK_ARGS *rt_add4cols)(int,int,int);
+void (STACK_ARGS *rt_addclamp4cols)(int,int,int);
+#endif
 
 //
 // R_DrawColumn
@@ -102,8 +106,8 @@ fixed_t 		dc_texturemid;
 fixed_t			dc_texturefrac;
 int				dc_color;				// [RH] Color for column filler
 DWORD			dc_srccolor;
-DWORD			*dc_srcblend;			// [RH] Source and destination
-DWORD			*dc_destblend;			// blending lookups
+R_THREADLOCAL DWORD	*dc_srcblend;		// [RH] Source and destination
+R_THREADLOCAL DWORD	*dc_destblend;		// blending lookups
 
 // first pixel in a column (possibly virtual) 
 const BYTE*		dc_source;				
@@ -967,21 +971,22 @@ void R_DrawRevSubClampTranslatedColumnP_C ()
 extern "C" {
 int						ds_color;				// [RH] color for non-textured spans
 
-int 					ds_y;
-int 					ds_x1;
-int 					ds_x2;
+// [dorch] Span state is per thread, see r_thread.h.
+R_THREADLOCAL int 		ds_y;
+R_THREADLOCAL int 		ds_x1;
+R_THREADLOCAL int 		ds_x2;
 
-lighttable_t*			ds_colormap;
+R_THREADLOCAL lighttable_t*	ds_colormap;
 
-dsfixed_t 				ds_xfrac;
-dsfixed_t 				ds_yfrac;
-dsfixed_t 				ds_xstep;
-dsfixed_t 				ds_ystep;
-int						ds_xbits;
-int						ds_ybits;
+R_THREADLOCAL dsfixed_t	ds_xfrac;
+R_THREADLOCAL dsfixed_t	ds_yfrac;
+R_THREADLOCAL dsfixed_t	ds_xstep;
+R_THREADLOCAL dsfixed_t	ds_ystep;
+R_THREADLOCAL int		ds_xbits;
+R_THREADLOCAL int		ds_ybits;
 
 // start of a floor/ceiling tile image 
-const BYTE*				ds_source;
+R_THREADLOCAL const BYTE*	ds_source;
 
 // just for profiling
 int 					dscount;
@@ -1760,7 +1765,7 @@ void STACK_ARGS mvlinec4 ()
 }
 #endif
 
-extern "C" short spanend[MAXHEIGHT];
+extern "C" R_THREADLOCAL short spanend[MAXHEIGHT];
 extern fixed_t rw_light;
 extern fixed_t rw_lightstep;
 extern int wallshade;
@@ -2196,13 +2201,79 @@ void R_InitColumnDrawers ()
 	R_DrawSpan					= R_DrawSpanP_C;
 	R_DrawSpanMasked			= R_DrawSpanMaskedP_C;
 	rt_map4cols					= rt_map4cols_c;
+	rt_add4cols					= rt_add4cols_c;
+	rt_addclamp4cols			= rt_addclamp4cols_c;
 #endif
 	R_DrawSpanTranslucent		= R_DrawSpanTranslucentP_C;
 	R_DrawSpanMaskedTranslucent = R_DrawSpanMaskedTranslucentP_C;
 	R_DrawSpanAddClamp			= R_DrawSpanAddClampP_C;
 	R_DrawSpanMaskedAddClamp	= R_DrawSpanMaskedAddClampP_C;
+#ifdef R_SIMD_DRAWERS
+	R_SelectSIMDDrawers (R_GetSIMDDrawerLevel ());
+#endif
+}
+
+#ifdef R_SIMD_DRAWERS
+// [dorch] Highest instruction set the drawers may use: 0 = plain C,
+// 1 = SSE2, 2 = AVX2 (falls back to SSE2 if the CPU doesn't have it).
+CUSTOM_CVAR (Int, r_simddrawers, SIMD_DRAWERS_AVX2, CVAR_ARCHIVE|CVAR_GLOBALCONFIG|CVAR_NOINITCALL)
+{
+	if (self < SIMD_DRAWERS_NONE)
+	{
+		self = SIMD_DRAWERS_NONE;
+	}
+	else if (self > SIMD_DRAWERS_AVX2)
+	{
+		self = SIMD_DRAWERS_AVX2;
+	}
+	else
+	{
+		R_InitColumnDrawers ();
+	}
+}
+
+int R_GetSIMDDrawerLevel ()
+{
+	int level = r_simddrawers;
+
+	if (level >= SIMD_DRAWERS_AVX2 && !CPU.bAVX2)
+	{
+		level = SIMD_DRAWERS_SSE2;
+	}
+	return level;
 }
 
+// [dorch] Switches the drawers that have SIMD versions. Also used by
+// r_benchdrawers to compare them against each other.
+void R_SelectSIMDDrawers (int level)
+{
+	if (level >= SIMD_DRAWERS_AVX2 && CPU.bAVX2)
+	{
+		R_DrawSpan					= R_DrawSpanP_AVX2;
+		R_DrawSpanTranslucent		= R_DrawSpanTranslucentP_AVX2;
+		R_DrawSpanAddClamp			= R_DrawSpanAddClampP_AVX2;
+		rt_add4cols					= rt_add4cols_avx2;
+		rt_addclamp4cols			= rt_addclamp4cols_avx2;
+	}
+	else if (level >= SIMD_DRAWERS_SSE2)
+	{
+		R_DrawSpan					= R_DrawSpanP_SSE2;
+		R_DrawSpanTranslucent		= R_DrawSpanTranslucentP_SSE2;
+		R_DrawSpanAddClamp			= R_DrawSpanAddClampP_SSE2;
+		rt_add4cols					= rt_add4cols_sse2;
+		rt_addclamp4cols			= rt_addclamp4cols_sse2;
+	}
+	else
+	{
+		R_DrawSpan					= R_DrawSpanP_C;
+		R_DrawSpanTranslucent		= R_DrawSpanTranslucentP_C;
+		R_DrawSpanAddClamp			= R_DrawSpanAddClampP_C;
+		rt_add4cols					= rt_add4cols_c;
+		rt_addclamp4cols			= rt_addclamp4cols_c;
+	}
+}
+#endif
+
 // [RH] Choose column drawers in a single place
 EXTERN_CVAR (Int, r_drawfuzz)
 EXTERN_CVAR (Bool, r_drawtrans)
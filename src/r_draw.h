@@ -24,6 +24,7 @@
 #define __R_DRAW__
 
 #include "r_defs.h"
+#include "r_thread.h"
 
 extern "C" int			ylookup[MAXHEIGHT];
 
@@ -38,8 +39,8 @@ extern "C" fixed_t		dc_texturemid;
 extern "C" fixed_t		dc_texturefrac;
 extern "C" int			dc_color;		// [RH] For flat colors (no texturing)
 extern "C" DWORD		dc_srccolor;
-extern "C" DWORD		*dc_srcblend;
-extern "C" DWORD		*dc_destblend;
+extern "C" R_THREADLOCAL DWORD	*dc_srcblend;
+extern "C" R_THREADLOCAL DWORD	*dc_destblend;
 
 // first pixel in a column
 extern "C" const BYTE*	dc_source;
@@ -177,8 +178,9 @@ extern void (STACK_ARGS *rt_map4cols)(int sx, int yl, int yh);
 #define rt_copy4cols		rt_copy4cols_c
 #define rt_map1col			rt_map1col_c
 #define rt_shaded4cols		rt_shaded4cols_c
-#define rt_add4cols			rt_add4cols_c
-#define rt_addclamp4cols	rt_addclamp4cols_c
+// [dorch] Picked by R_InitColumnDrawers, see R_SIMD_DRAWERS below.
+extern void (STACK_ARGS *rt_add4cols)(int sx, int yl, int yh);
+extern void (STACK_ARGS *rt_addclamp4cols)(int sx, int yl, int yh);
 #endif
 
 void rt_draw4cols (int sx);
@@ -214,6 +216,40 @@ void	R_DrawSpanMaskedP_C (void);
 
 void	R_DrawSpanTranslucentP_C (void);
 void	R_DrawSpanMaskedTranslucentP_C (void);
+void	R_DrawSpanAddClampP_C (void);
+void	R_DrawSpanMaskedAddClampP_C (void);
+
+// [dorch] SSE2 and AVX2 versions of the busiest span and rt_ drawers
+// (r_drawsimd.cpp). They produce the same pixels as the C drawers. Only
+// built when the compiler targets SSE2 and the x86 assembly isn't used.
+#if !defined(X86_ASM) && (defined(__SSE2__) || defined(_M_X64))
+#define R_SIMD_DRAWERS
+
+enum
+{
+	SIMD_DRAWERS_NONE,
+	SIMD_DRAWERS_SSE2,
+	SIMD_DRAWERS_AVX2,
+};
+
+void	R_DrawSpanP_SSE2 (void);
+void	R_DrawSpanTranslucentP_SSE2 (void);
+void	R_DrawSpanAddClampP_SSE2 (void);
+void	R_DrawSpanP_AVX2 (void);
+void	R_DrawSpanTranslucentP_AVX2 (void);
+void	R_DrawSpanAddClampP_AVX2 (void);
+
+extern "C"
+{
+void STACK_ARGS rt_add4cols_sse2 (int sx, int yl, int yh);
+void STACK_ARGS rt_addclamp4cols_sse2 (int sx, int yl, int yh);
+void STACK_ARGS rt_add4cols_avx2 (int sx, int yl, int yh);
+void STACK_ARGS rt_addclamp4cols_avx2 (int sx, int yl, int yh);
+}
+
+int		R_GetSIMDDrawerLevel ();
+void	R_SelectSIMDDrawers (int level);
+#endif
 
 void	R_DrawTlatedLucentColumnP_C (void);
 #define R_DrawTlatedLucentColumn R_DrawTlatedLucentColumnP_C
@@ -233,22 +269,22 @@ void	R_FillSpan (void);
 extern "C" void			   R_SetupDrawSlab(const BYTE *colormap);
 extern "C" void STACK_ARGS R_DrawSlab(int dx, fixed_t v, int dy, fixed_t vi, const BYTE *vptr, BYTE *p);
 
-extern "C" int				ds_y;
-extern "C" int				ds_x1;
-extern "C" int				ds_x2;
+extern "C" R_THREADLOCAL int			ds_y;
+extern "C" R_THREADLOCAL int			ds_x1;
+extern "C" R_THREADLOCAL int			ds_x2;
 
-extern "C" lighttable_t*	ds_colormap;
+extern "C" R_THREADLOCAL lighttable_t*	ds_colormap;
 
-extern "C" dsfixed_t		ds_xfrac;
-extern "C" dsfixed_t		ds_yfrac;
-extern "C" dsfixed_t		ds_xstep;
-extern "C" dsfixed_t		ds_ystep;
-extern "C" int				ds_xbits;
-extern "C" int				ds_ybits;
+extern "C" R_THREADLOCAL dsfixed_t	ds_xfrac;
+extern "C" R_THREADLOCAL dsfixed_t	ds_yfrac;
+extern "C" R_THREADLOCAL dsfixed_t	ds_xstep;
+extern "C" R_THREADLOCAL dsfixed_t	ds_ystep;
+extern "C" R_THREADLOCAL int			ds_xbits;
+extern "C" R_THREADLOCAL int			ds_ybits;
 extern "C" fixed_t			ds_alpha;
 
 // start of a 64*64 tile image
-extern "C" const BYTE*		ds_source;
+extern "C" R_THREADLOCAL const BYTE*	ds_source;
 
 extern "C" int				ds_color;		// [RH] For flat color (no texturing)
 
@@ -0,0 +1,872 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Zandronum Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: r_drawsimd.cpp
+//
+// Description: SSE2 and AVX2 versions of the span drawers and the rt_ four
+// column translucency drawers. They produce exactly the same pixels as the C
+// drawers in r_draw.cpp and r_drawt.cpp.
+//
+//-----------------------------------------------------------------------------
+
+#include <string.h>
+
+#include "templates.h"
+#include "doomdef.h"
+#include "r_local.h"
+#include "r_draw.h"
+#include "r_main.h"
+#include "v_video.h"
+#include "c_dispatch.h"
+#include "doomstat.h"
+#include "stats.h"
+#include "x86.h"
+#include "r_data/colormaps.h"
+
+#ifdef R_SIMD_DRAWERS
+
+#include <emmintrin.h>
+#include <immintrin.h>
+
+// The AVX2 functions are compiled for AVX2 regardless of the compiler flags
+// and are only called when CPUID says the CPU has it.
+#if defined(__GNUC__) || defined(__clang__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+
+//==========================================================================
+//
+// Blend operations
+//
+// Each takes the Col2RGB8 values of the source and the destination and
+// returns the RGB32k index, using the same arithmetic as the C drawers.
+//
+//==========================================================================
+
+struct FLucentBlend
+{
+	static inline DWORD Blend (DWORD fg, DWORD bg)
+	{
+		fg = (fg + bg) | 0x1f07c1f;
+		return fg & (fg >> 15);
+	}
+
+	static inline __m128i Blend4 (__m128i fg, __m128i bg)
+	{
+		__m128i c = _mm_or_si128 (_mm_add_epi32 (fg, bg), _mm_set1_epi32 (0x1f07c1f));
+		return _mm_and_si128 (c, _mm_srli_epi32 (c, 15));
+	}
+
+	static inline AVX2_TARGET __m256i Blend8 (__m256i fg, __m256i bg)
+	{
+		__m256i c = _mm256_or_si256 (_mm256_add_epi32 (fg, bg), _mm256_set1_epi32 (0x1f07c1f));
+		return _mm256_and_si256 (c, _mm256_srli_epi32 (c, 15));
+	}
+};
+
+struct FAddClampBlend
+{
+	static inline DWORD Blend (DWORD fg, DWORD bg)
+	{
+		DWORD a = fg + bg;
+		DWORD b = a;
+
+		a |= 0x01f07c1f;
+		b &= 0x40100400;
+		a &= 0x3fffffff;
+		b = b - (b >> 5);
+		a |= b;
+		return a & (a >> 15);
+	}
+
+	static inline __m128i Blend4 (__m128i fg, __m128i bg)
+	{
+		__m128i a = _mm_add_epi32 (fg, bg);
+		__m128i b = _mm_and_si128 (a, _mm_set1_epi32 (0x40100400));
+		a = _mm_and_si128 (_mm_or_si128 (a, _mm_set1_epi32 (0x01f07c1f)), _mm_set1_epi32 (0x3fffffff));
+		b = _mm_sub_epi32 (b, _mm_srli_epi32 (b, 5));
+		a = _mm_or_si128 (a, b);
+		return _mm_and_si128 (a, _mm_srli_epi32 (a, 15));
+	}
+
+	static inline AVX2_TARGET __m256i Blend8 (__m256i fg, __m256i bg)
+	{
+		__m256i a = _mm256_add_epi32 (fg, bg);
+		__m256i b = _mm256_and_si256 (a, _mm256_set1_epi32 (0x40100400));
+		a = _mm256_and_si256 (_mm256_or_si256 (a, _mm256_set1_epi32 (0x01f07c1f)), _mm256_set1_epi32 (0x3fffffff));
+		b = _mm256_sub_epi32 (b, _mm256_srli_epi32 (b, 5));
+		a = _mm256_or_si256 (a, b);
+		return _mm256_and_si256 (a, _mm256_srli_epi32 (a, 15));
+	}
+};
+
+//==========================================================================
+//
+// FSpanCoords
+//
+// Steps the texture coordinates of a span and computes the texel offsets,
+// like the general case of the C span drawers. The 64x64 special case of
+// those drawers is the same formula with constant shifts.
+//
+//==========================================================================
+
+struct FSpanCoords
+{
+	DWORD xfrac, yfrac, xstep, ystep;
+	int xshift, yshift, xmask;
+
+	FSpanCoords ()
+	{
+		xfrac = ds_xfrac;
+		yfrac = ds_yfrac;
+		xstep = ds_xstep;
+		ystep = ds_ystep;
+		yshift = 32 - ds_ybits;
+		xshift = yshift - ds_xbits;
+		xmask = ((1 << ds_xbits) - 1) << ds_ybits;
+	}
+
+	inline int Spot () const
+	{
+		return ((xfrac >> xshift) & xmask) + (yfrac >> yshift);
+	}
+
+	inline void Step ()
+	{
+		xfrac += xstep;
+		yfrac += ystep;
+	}
+
+	// Skips count pixels after they have been drawn by the vector code.
+	inline void Skip (int count)
+	{
+		xfrac += xstep * count;
+		yfrac += ystep * count;
+	}
+};
+
+// Texel offsets of the next four pixels.
+struct FSpanCoords4
+{
+	__m128i xfrac, yfrac, xstep, ystep, xmask, xshift, yshift;
+
+	FSpanCoords4 (const FSpanCoords &c)
+	{
+		xfrac = _mm_setr_epi32 (c.xfrac, c.xfrac + c.xstep, c.xfrac + c.xstep*2, c.xfrac + c.xstep*3);
+		yfrac = _mm_setr_epi32 (c.yfrac, c.yfrac + c.ystep, c.yfrac + c.ystep*2, c.yfrac + c.ystep*3);
+		xstep = _mm_set1_epi32 (c.xstep * 4);
+		ystep = _mm_set1_epi32 (c.ystep * 4);
+		xmask = _mm_set1_epi32 (c.xmask);
+		xshift = _mm_cvtsi32_si128 (c.xshift);
+		yshift = _mm_cvtsi32_si128 (c.yshift);
+	}
+
+	inline __m128i Spots ()
+	{
+		__m128i spots = _mm_add_epi32 (_mm_and_si128 (_mm_srl_epi32 (xfrac, xshift), xmask), _mm_srl_epi32 (yfrac, yshift));
+		xfrac = _mm_add_epi32 (xfrac, xstep);
+		yfrac = _mm_add_epi32 (yfrac, ystep);
+		return spots;
+	}
+};
+
+// Texel offsets of the next eight pixels.
+struct FSpanCoords8
+{
+	__m256i xfrac, yfrac, xstep, ystep, xmask;
+	__m128i xshift, yshift;
+
+	AVX2_TARGET FSpanCoords8 (const FSpanCoords &c)
+	{
+		const __m256i steps = _mm256_setr_epi32 (0, 1, 2, 3, 4, 5, 6, 7);
+
+		xfrac = _mm256_add_epi32 (_mm256_set1_epi32 (c.xfrac), _mm256_mullo_epi32 (_mm256_set1_epi32 (c.xstep), steps));
+		yfrac = _mm256_add_epi32 (_mm256_set1_epi32 (c.yfrac), _mm256_mullo_epi32 (_mm256_set1_epi32 (c.ystep), steps));
+		xstep = _mm256_set1_epi32 (c.xstep * 8);
+		ystep = _mm256_set1_epi32 (c.ystep * 8);
+		xmask = _mm256_set1_epi32 (c.xmask);
+		xshift = _mm_cvtsi32_si128 (c.xshift);
+		yshift = _mm_cvtsi32_si128 (c.yshift);
+	}
+
+	inline AVX2_TARGET __m256i Spots ()
+	{
+		__m256i spots = _mm256_add_epi32 (_mm256_and_si256 (_mm256_srl_epi32 (xfrac, xshift), xmask), _mm256_srl_epi32 (yfrac, yshift));
+		xfrac = _mm256_add_epi32 (xfrac, xstep);
+		yfrac = _mm256_add_epi32 (yfrac, ystep);
+		return spots;
+	}
+};
+
+//==========================================================================
+//
+// R_DrawSpanP_SSE2
+//
+// The texel offsets are computed four at a time. Fetching the texels and
+// looking them up in the colormap are still scalar loads.
+//
+//==========================================================================
+
+void R_DrawSpanP_SSE2 (void)
+{
+	// A shift by 32 gives 0 in SSE but is undefined in C. Leave those
+	// one texel high flats to the C drawer so that both agree.
+	if (ds_ybits == 0)
+	{
+		R_DrawSpanP_C ();
+		return;
+	}
+
+	const BYTE *source = ds_source;
+	const BYTE *colormap = ds_colormap;
+	BYTE *dest = ylookup[ds_y] + ds_x1 + dc_destorg;
+	int count = ds_x2 - ds_x1 + 1;
+	FSpanCoords coords;
+
+	if (count >= 4)
+	{
+		FSpanCoords4 coords4 (coords);
+		alignas(16) int spots[4];
+		const int vectorcount = count & ~3;
+
+		for (int i = 0; i < vectorcount; i += 4)
+		{
+			_mm_store_si128 ((__m128i *)spots, coords4.Spots ());
+			dest[0] = colormap[source[spots[0]]];
+			dest[1] = colormap[source[spots[1]]];
+			dest[2] = colormap[source[spots[2]]];
+			dest[3] = colormap[source[spots[3]]];
+			dest += 4;
+		}
+		coords.Skip (vectorcount);
+		count -= vectorcount;
+	}
+
+	for (; count > 0; --count)
+	{
+		*dest++ = colormap[source[coords.Spot ()]];
+		coords.Step ();
+	}
+}
+
+//==========================================================================
+//
+// R_DrawSpanBlend_SSE2
+//
+// Translucent and additive spans. The blending arithmetic is done four
+// pixels at a time; the table lookups are scalar.
+//
+//==========================================================================
+
+template<class Op>
+static void R_DrawSpanBlend_SSE2 (void (*cfunc)(void))
+{
+	if (ds_ybits == 0)
+	{
+		cfunc ();
+		return;
+	}
+
+	const BYTE *source = ds_source;
+	const BYTE *colormap = ds_colormap;
+	const DWORD *fg2rgb = dc_srcblend;
+	const DWORD *bg2rgb = dc_destblend;
+	BYTE *dest = ylookup[ds_y] + ds_x1 + dc_destorg;
+	int count = ds_x2 - ds_x1 + 1;
+	FSpanCoords coords;
+
+	if (count >= 4)
+	{
+		FSpanCoords4 coords4 (coords);
+		alignas(16) int spots[4];
+		const int vectorcount = count & ~3;
+
+		for (int i = 0; i < vectorcount; i += 4)
+		{
+			_mm_store_si128 ((__m128i *)spots, coords4.Spots ());
+			__m128i fg = _mm_setr_epi32 (
+				fg2rgb[colormap[source[spots[0]]]], fg2rgb[colormap[source[spots[1]]]],
+				fg2rgb[colormap[source[spots[2]]]], fg2rgb[colormap[source[spots[3]]]]);
+			__m128i bg = _mm_setr_epi32 (bg2rgb[dest[0]], bg2rgb[dest[1]], bg2rgb[dest[2]], bg2rgb[dest[3]]);
+
+			_mm_store_si128 ((__m128i *)spots, Op::Blend4 (fg, bg));
+			dest[0] = RGB32k[0][0][spots[0]];
+			dest[1] = RGB32k[0][0][spots[1]];
+			dest[2] = RGB32k[0][0][spots[2]];
+			dest[3] = RGB32k[0][0][spots[3]];
+			dest += 4;
+		}
+		coords.Skip (vectorcount);
+		count -= vectorcount;
+	}
+
+	for (; count > 0; --count)
+	{
+		*dest = RGB32k[0][0][Op::Blend (fg2rgb[colormap[source[coords.Spot ()]]], bg2rgb[*dest])];
+		dest++;
+		coords.Step ();
+	}
+}
+
+void R_DrawSpanTranslucentP_SSE2 (void)
+{
+	R_DrawSpanBlend_SSE2<FLucentBlend> (R_DrawSpanTranslucentP_C);
+}
+
+void R_DrawSpanAddClampP_SSE2 (void)
+{
+	R_DrawSpanBlend_SSE2<FAddClampBlend> (R_DrawSpanAddClampP_C);
+}
+
+//==========================================================================
+//
+// R_DrawSpanP_AVX2
+//
+//==========================================================================
+
+AVX2_TARGET void R_DrawSpanP_AVX2 (void)
+{
+	if (ds_ybits == 0)
+	{
+		R_DrawSpanP_C ();
+		return;
+	}
+
+	const BYTE *source = ds_source;
+	const BYTE *colormap = ds_colormap;
+	BYTE *dest = ylookup[ds_y] + ds_x1 + dc_destorg;
+	int count = ds_x2 - ds_x1 + 1;
+	FSpanCoords coords;
+
+	if (count >= 8)
+	{
+		FSpanCoords8 coords8 (coords);
+		alignas(32) int spots[8];
+		const int vectorcount = count & ~7;
+
+		for (int i = 0; i < vectorcount; i += 8)
+		{
+			_mm256_store_si256 ((__m256i *)spots, coords8.Spots ());
+			dest[0] = colormap[source[spots[0]]];
+			dest[1] = colormap[source[spots[1]]];
+			dest[2] = colormap[source[spots[2]]];
+			dest[3] = colormap[source[spots[3]]];
+			dest[4] = colormap[source[spots[4]]];
+			dest[5] = colormap[source[spots[5]]];
+			dest[6] = colormap[source[spots[6]]];
+			dest[7] = colormap[source[spots[7]]];
+			dest += 8;
+		}
+		coords.Skip (vectorcount);
+		count -= vectorcount;
+	}
+
+	for (; count > 0; --count)
+	{
+		*dest++ = colormap[source[coords.Spot ()]];
+		coords.Step ();
+	}
+}
+
+//==========================================================================
+//
+// R_DrawSpanBlend_AVX2
+//
+// Like the SSE2 version, but eight pixels at a time. The Col2RGB8 values are
+// still fetched with scalar loads; vpgatherdd turned out to be slower than
+// that on current CPUs.
+//
+//==========================================================================
+
+template<class Op>
+static AVX2_TARGET void R_DrawSpanBlend_AVX2 (void (*cfunc)(void))
+{
+	if (ds_ybits == 0)
+	{
+		cfunc ();
+		return;
+	}
+
+	const BYTE *source = ds_source;
+	const BYTE *colormap = ds_colormap;
+	const DWORD *fg2rgb = dc_srcblend;
+	const DWORD *bg2rgb = dc_destblend;
+	BYTE *dest = ylookup[ds_y] + ds_x1 + dc_destorg;
+	int count = ds_x2 - ds_x1 + 1;
+	FSpanCoords coords;
+
+	if (count >= 8)
+	{
+		FSpanCoords8 coords8 (coords);
+		alignas(32) int spots[8];
+		const int vectorcount = count & ~7;
+
+		for (int i = 0; i < vectorcount; i += 8)
+		{
+			_mm256_store_si256 ((__m256i *)spots, coords8.Spots ());
+			__m256i fg = _mm256_setr_epi32 (
+				fg2rgb[colormap[source[spots[0]]]], fg2rgb[colormap[source[spots[1]]]],
+				fg2rgb[colormap[source[spots[2]]]], fg2rgb[colormap[source[spots[3]]]],
+				fg2rgb[colormap[source[spots[4]]]], fg2rgb[colormap[source[spots[5]]]],
+				fg2rgb[colormap[source[spots[6]]]], fg2rgb[colormap[source[spots[7]]]]);
+			__m256i bg = _mm256_setr_epi32 (
+				bg2rgb[dest[0]], bg2rgb[dest[1]], bg2rgb[dest[2]], bg2rgb[dest[3]],
+				bg2rgb[dest[4]], bg2rgb[dest[5]], bg2rgb[dest[6]], bg2rgb[dest[7]]);
+
+			_mm256_store_si256 ((__m256i *)spots, Op::Blend8 (fg, bg));
+			for (int j = 0; j < 8; ++j)
+			{
+				dest[j] = RGB32k[0][0][spots[j]];
+			}
+			dest += 8;
+		}
+		coords.Skip (vectorcount);
+		count -= vectorcount;
+	}
+
+	for (; count > 0; --count)
+	{
+		*dest = RGB32k[0][0][Op::Blend (fg2rgb[colormap[source[coords.Spot ()]]], bg2rgb[*dest])];
+		dest++;
+		coords.Step ();
+	}
+}
+
+AVX2_TARGET void R_DrawSpanTranslucentP_AVX2 (void)
+{
+	R_DrawSpanBlend_AVX2<FLucentBlend> (R_DrawSpanTranslucentP_C);
+}
+
+AVX2_TARGET void R_DrawSpanAddClampP_AVX2 (void)
+{
+	R_DrawSpanBlend_AVX2<FAddClampBlend> (R_DrawSpanAddClampP_C);
+}
+
+//==========================================================================
+//
+// rt_Blend4cols_SSE2
+//
+// The four columns in dc_temp are exactly one SSE register wide. Two rows
+// are done per iteration to keep more loads in flight.
+//
+//==========================================================================
+
+template<class Op>
+static void rt_Blend4cols_SSE2 (int sx, int yl, int yh)
+{
+	int count = yh - yl;
+	if (count < 0)
+		return;
+	count++;
+
+	const DWORD *fg2rgb = dc_srcblend;
+	const DWORD *bg2rgb = dc_destblend;
+	const BYTE *colormap = dc_colormap;
+	const BYTE *source = &dc_temp[yl*4];
+	BYTE *dest = ylookup[yl] + sx + dc_destorg;
+	const int pitch = dc_pitch;
+	alignas(16) int index[8];
+
+	for (; count >= 2; count -= 2)
+	{
+		BYTE *dest2 = dest + pitch;
+		__m128i fg0 = _mm_setr_epi32 (fg2rgb[colormap[source[0]]], fg2rgb[colormap[source[1]]],
+			fg2rgb[colormap[source[2]]], fg2rgb[colormap[source[3]]]);
+		__m128i fg1 = _mm_setr_epi32 (fg2rgb[colormap[source[4]]], fg2rgb[colormap[source[5]]],
+			fg2rgb[colormap[source[6]]], fg2rgb[colormap[source[7]]]);
+		__m128i bg0 = _mm_setr_epi32 (bg2rgb[dest[0]], bg2rgb[dest[1]], bg2rgb[dest[2]], bg2rgb[dest[3]]);
+		__m128i bg1 = _mm_setr_epi32 (bg2rgb[dest2[0]], bg2rgb[dest2[1]], bg2rgb[dest2[2]], bg2rgb[dest2[3]]);
+
+		_mm_store_si128 ((__m128i *)index, Op::Blend4 (fg0, bg0));
+		_mm_store_si128 ((__m128i *)index + 1, Op::Blend4 (fg1, bg1));
+		dest[0] = RGB32k[0][0][index[0]];
+		dest[1] = RGB32k[0][0][index[1]];
+		dest[2] = RGB32k[0][0][index[2]];
+		dest[3] = RGB32k[0][0][index[3]];
+		dest2[0] = RGB32k[0][0][index[4]];
+		dest2[1] = RGB32k[0][0][index[5]];
+		dest2[2] = RGB32k[0][0][index[6]];
+		dest2[3] = RGB32k[0][0][index[7]];
+
+		source += 8;
+		dest += pitch * 2;
+	}
+
+	if (count > 0)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			dest[j] = RGB32k[0][0][Op::Blend (fg2rgb[colormap[source[j]]], bg2rgb[dest[j]])];
+		}
+	}
+}
+
+void STACK_ARGS rt_add4cols_sse2 (int sx, int yl, int yh)
+{
+	rt_Blend4cols_SSE2<FLucentBlend> (sx, yl, yh);
+}
+
+void STACK_ARGS rt_addclamp4cols_sse2 (int sx, int yl, int yh)
+{
+	rt_Blend4cols_SSE2<FAddClampBlend> (sx, yl, yh);
+}
+
+//==========================================================================
+//
+// rt_Blend4cols_AVX2
+//
+// Both rows of an iteration in one AVX register.
+//
+//==========================================================================
+
+template<class Op>
+static AVX2_TARGET void rt_Blend4cols_AVX2 (int sx, int yl, int yh)
+{
+	int count = yh - yl;
+	if (count < 0)
+		return;
+	count++;
+
+	const DWORD *fg2rgb = dc_srcblend;
+	const DWORD *bg2rgb = dc_destblend;
+	const BYTE *colormap = dc_colormap;
+	const BYTE *source = &dc_temp[yl*4];
+	BYTE *dest = ylookup[yl] + sx + dc_destorg;
+	const int pitch = dc_pitch;
+	alignas(32) int index[8];
+
+	for (; count >= 2; count -= 2)
+	{
+		__m256i fg = _mm256_setr_epi32 (
+			fg2rgb[colormap[source[0]]], fg2rgb[colormap[source[1]]],
+			fg2rgb[colormap[source[2]]], fg2rgb[colormap[source[3]]],
+			fg2rgb[colormap[source[4]]], fg2rgb[colormap[source[5]]],
+			fg2rgb[colormap[source[6]]], fg2rgb[colormap[source[7]]]);
+		__m256i bg = _mm256_setr_epi32 (
+			bg2rgb[dest[0]], bg2rgb[dest[1]], bg2rgb[dest[2]], bg2rgb[dest[3]],
+			bg2rgb[dest[pitch+0]], bg2rgb[dest[pitch+1]], bg2rgb[dest[pitch+2]], bg2rgb[dest[pitch+3]]);
+
+		_mm256_store_si256 ((__m256i *)index, Op::Blend8 (fg, bg));
+		dest[0] = RGB32k[0][0][index[0]];
+		dest[1] = RGB32k[0][0][index[1]];
+		dest[2] = RGB32k[0][0][index[2]];
+		dest[3] = RGB32k[0][0][index[3]];
+		dest[pitch+0] = RGB32k[0][0][index[4]];
+		dest[pitch+1] = RGB32k[0][0][index[5]];
+		dest[pitch+2] = RGB32k[0][0][index[6]];
+		dest[pitch+3] = RGB32k[0][0][index[7]];
+
+		source += 8;
+		dest += pitch * 2;
+	}
+
+	if (count > 0)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			dest[j] = RGB32k[0][0][Op::Blend (fg2rgb[colormap[source[j]]], bg2rgb[dest[j]])];
+		}
+	}
+}
+
+AVX2_TARGET void STACK_ARGS rt_add4cols_avx2 (int sx, int yl, int yh)
+{
+	rt_Blend4cols_AVX2<FLucentBlend> (sx, yl, yh);
+}
+
+AVX2_TARGET void STACK_ARGS rt_addclamp4cols_avx2 (int sx, int yl, int yh)
+{
+	rt_Blend4cols_AVX2<FAddClampBlend> (sx, yl, yh);
+}
+
+//==========================================================================
+//
+// r_benchdrawers
+//
+// [dorch] Draws the same random spans and columns into an offscreen buffer
+// with every version of each drawer, checks that they all produce the same
+// pixels as the C drawer and prints how long they took. When a level is
+// loaded, the whole view is then rendered with each set of drawers too.
+//
+// Usage: r_benchdrawers [iterations] [frames]
+//
+//==========================================================================
+
+enum
+{
+	BENCH_WIDTH = 640,
+	BENCH_HEIGHT = 200,
+	BENCH_TEXTURE = 1 << 15,
+};
+
+struct FDrawerBench
+{
+	const char *Name;
+	bool AddClamp;
+	void (*Span[3]) (void);
+	void (STACK_ARGS *Cols[3]) (int sx, int yl, int yh);
+};
+
+static const FDrawerBench DrawerBenches[] =
+{
+	{ "span",				false,	{ R_DrawSpanP_C, R_DrawSpanP_SSE2, R_DrawSpanP_AVX2 },									{ NULL, NULL, NULL } },
+	{ "span translucent",	false,	{ R_DrawSpanTranslucentP_C, R_DrawSpanTranslucentP_SSE2, R_DrawSpanTranslucentP_AVX2 },	{ NULL, NULL, NULL } },
+	{ "span addclamp",		true,	{ R_DrawSpanAddClampP_C, R_DrawSpanAddClampP_SSE2, R_DrawSpanAddClampP_AVX2 },			{ NULL, NULL, NULL } },
+	{ "rt_add4cols",		false,	{ NULL, NULL, NULL },	{ rt_add4cols_c, rt_add4cols_sse2, rt_add4cols_avx2 } },
+	{ "rt_addclamp4cols",	true,	{ NULL, NULL, NULL },	{ rt_addclamp4cols_c, rt_addclamp4cols_sse2, rt_addclamp4cols_avx2 } },
+};
+
+static const char *SIMDLevelNames[3] = { "C", "SSE2", "AVX2" };
+
+struct FBenchSpan
+{
+	DWORD xfrac, yfrac, xstep, ystep;
+	int xbits, ybits;
+	int x1, x2;
+};
+
+static BYTE BenchDest[BENCH_WIDTH * BENCH_HEIGHT];
+static BYTE BenchStart[BENCH_WIDTH * BENCH_HEIGHT];
+static BYTE BenchResult[BENCH_WIDTH * BENCH_HEIGHT];
+static BYTE BenchTexture[BENCH_TEXTURE];
+static BYTE BenchTemp[4 * BENCH_HEIGHT];
+static FBenchSpan BenchSpans[BENCH_HEIGHT];
+
+static void R_RunDrawerBench (const FDrawerBench &bench, int level)
+{
+	if (bench.Span[level] != NULL)
+	{
+		for (int y = 0; y < BENCH_HEIGHT; ++y)
+		{
+			const FBenchSpan &span = BenchSpans[y];
+
+			ds_y = y;
+			ds_x1 = span.x1;
+			ds_x2 = span.x2;
+			ds_xfrac = span.xfrac;
+			ds_yfrac = span.yfrac;
+			ds_xstep = span.xstep;
+			ds_ystep = span.ystep;
+			ds_xbits = span.xbits;
+			ds_ybits = span.ybits;
+			ds_colormap = NormalLight.Maps + (y & 31) * 256;
+			bench.Span[level] ();
+		}
+	}
+	else
+	{
+		for (int sx = 0; sx < BENCH_WIDTH; sx += 4)
+		{
+			// Vary the column heights a bit, so that both the paired rows
+			// and the odd one at the end get used.
+			bench.Cols[level] (sx, (sx / 4) & 7, BENCH_HEIGHT - 1);
+		}
+	}
+}
+
+CCMD (r_benchdrawers)
+{
+	const int iterations = argv.argc() > 1 ? clamp (atoi (argv[1]), 1, 100000) : 200;
+	const int frames = argv.argc() > 2 ? clamp (atoi (argv[2]), 1, 10000) : 100;
+	const int numlevels = CPU.bAVX2 ? 3 : 2;
+	DWORD seed = 0x1d872b41;
+	int i;
+
+	// Random but repeatable inputs.
+	for (i = 0; i < BENCH_TEXTURE; ++i)
+	{
+		BenchTexture[i] = (seed = seed * 1664525 + 1013904223) >> 24;
+	}
+	for (i = 0; i < BENCH_WIDTH * BENCH_HEIGHT; ++i)
+	{
+		BenchStart[i] = (seed = seed * 1664525 + 1013904223) >> 24;
+	}
+	for (i = 0; i < 4 * BENCH_HEIGHT; ++i)
+	{
+		BenchTemp[i] = (seed = seed * 1664525 + 1013904223) >> 24;
+	}
+	for (i = 0; i < BENCH_HEIGHT; ++i)
+	{
+		FBenchSpan &span = BenchSpans[i];
+
+		span.xfrac = seed = seed * 1664525 + 1013904223;
+		span.yfrac = seed = seed * 1664525 + 1013904223;
+		span.xstep = (seed = seed * 1664525 + 1013904223) >> 6;
+		span.ystep = (seed = seed * 1664525 + 1013904223) >> 6;
+		// Mostly the common 64x64 case, with some other sizes.
+		span.xbits = (i & 3) == 3 ? 7 : 6;
+		span.ybits = (i & 3) == 3 ? 8 : 6;
+		span.x1 = (seed = seed * 1664525 + 1013904223) >> 29;
+		span.x2 = BENCH_WIDTH - 1 - ((seed = seed * 1664525 + 1013904223) >> 29);
+	}
+
+	// Point the drawers at the offscreen buffer.
+	int savedylookup[BENCH_HEIGHT];
+	BYTE *saveddestorg = dc_destorg;
+	int savedpitch = dc_pitch;
+	BYTE *savedtemp = dc_temp;
+	lighttable_t *savedcolormap = dc_colormap;
+	DWORD *savedsrcblend = dc_srcblend;
+	DWORD *saveddestblend = dc_destblend;
+	const int savedy = ds_y, savedx1 = ds_x1, savedx2 = ds_x2;
+	const dsfixed_t savedxfrac = ds_xfrac, savedyfrac = ds_yfrac, savedxstep = ds_xstep, savedystep = ds_ystep;
+	const int savedxbits = ds_xbits, savedybits = ds_ybits;
+	lighttable_t *savedspancolormap = ds_colormap;
+	const BYTE *savedsource = ds_source;
+
+	memcpy (savedylookup, ylookup, sizeof(savedylookup));
+	for (i = 0; i < BENCH_HEIGHT; ++i)
+	{
+		ylookup[i] = i * BENCH_WIDTH;
+	}
+	dc_destorg = BenchDest;
+	dc_pitch = BENCH_WIDTH;
+	dc_temp = BenchTemp;
+	dc_colormap = NormalLight.Maps + 8 * 256;
+	ds_source = BenchTexture;
+
+	const fixed_t alpha = FRACUNIT * 2 / 3;
+
+	Printf ("Drawing %d times into a %dx%d buffer:\n", iterations, BENCH_WIDTH, BENCH_HEIGHT);
+	for (unsigned int b = 0; b < countof(DrawerBenches); ++b)
+	{
+		const FDrawerBench &bench = DrawerBenches[b];
+		FString line;
+		double basems = 0;
+
+		if (bench.AddClamp)
+		{
+			dc_srcblend = Col2RGB8_LessPrecision[alpha>>10];
+			dc_destblend = Col2RGB8_LessPrecision[FRACUNIT>>10];
+		}
+		else
+		{
+			dc_srcblend = Col2RGB8[alpha>>10];
+			dc_destblend = Col2RGB8[(FRACUNIT-alpha)>>10];
+		}
+
+		line.Format ("%-18s", bench.Name);
+		for (int level = 0; level < numlevels; ++level)
+		{
+			cycle_t cycles;
+
+			memcpy (BenchDest, BenchStart, sizeof(BenchDest));
+			R_RunDrawerBench (bench, level);
+
+			bool match = true;
+			if (level == 0)
+			{
+				memcpy (BenchResult, BenchDest, sizeof(BenchResult));
+			}
+			else
+			{
+				match = memcmp (BenchResult, BenchDest, sizeof(BenchResult)) == 0;
+			}
+
+			memcpy (BenchDest, BenchStart, sizeof(BenchDest));
+			cycles.Reset ();
+			cycles.Clock ();
+			for (i = 0; i < iterations; ++i)
+			{
+				R_RunDrawerBench (bench, level);
+			}
+			cycles.Unclock ();
+
+			const double ms = cycles.TimeMS ();
+			if (level == 0)
+			{
+				basems = ms;
+			}
+			line.AppendFormat ("  %s %8.2f ms", SIMDLevelNames[level], ms);
+			if (level > 0)
+			{
+				line.AppendFormat (" (%.2fx)%s", ms > 0 ? basems / ms : 0., match ? "" : TEXTCOLOR_RED " MISMATCH" TEXTCOLOR_NORMAL);
+			}
+		}
+		Printf ("%s\n", line.GetChars());
+	}
+
+	memcpy (ylookup, savedylookup, sizeof(savedylookup));
+	dc_destorg = saveddestorg;
+	dc_pitch = savedpitch;
+	dc_temp = savedtemp;
+	dc_colormap = savedcolormap;
+	dc_srcblend = savedsrcblend;
+	dc_destblend = saveddestblend;
+	ds_y = savedy;
+	ds_x1 = savedx1;
+	ds_x2 = savedx2;
+	ds_xfrac = savedxfrac;
+	ds_yfrac = savedyfrac;
+	ds_xstep = savedxstep;
+	ds_ystep = savedystep;
+	ds_xbits = savedxbits;
+	ds_ybits = savedybits;
+	ds_colormap = savedspancolormap;
+	ds_source = savedsource;
+
+	// Frame time with each set of drawers.
+	if (gamestate == GS_LEVEL && R_CanBenchmarkView ("r_benchdrawers"))
+	{
+		DSimpleCanvas *canvas = new DSimpleCanvas (SCREENWIDTH, SCREENHEIGHT);
+		double basems = 0;
+
+		Printf ("Rendering %d frames at %dx%d:\n", frames, SCREENWIDTH, SCREENHEIGHT);
+		for (int level = 0; level < numlevels; ++level)
+		{
+			R_SelectSIMDDrawers (level);
+			const double ms = R_BenchmarkView (canvas, frames);
+			if (level == 0)
+			{
+				basems = ms;
+			}
+			Printf ("%-5s %7.2f ms/frame %7.1f fps %5.2fx\n", SIMDLevelNames[level], ms,
+				ms > 0 ? 1000. / ms : 0., ms > 0 ? basems / ms : 0.);
+		}
+		R_SelectSIMDDrawers (R_GetSIMDDrawerLevel ());
+		canvas->Destroy ();
+	}
+}
+
+#endif // R_SIMD_DRAWERS
@@ -63,6 +63,7 @@
 #include "farchive.h"
 // [BC] New #includes.
 #include "sv_commands.h"
+#include "profiler.h"
 
 
 // MACROS ------------------------------------------------------------------
@@ -119,12 +120,12 @@ fixed_t			r_SpriteVisibility;
 fixed_t			r_ParticleVisibility;
 fixed_t			r_SkyVisibility;
 
-fixed_t			GlobVis;
+R_THREADLOCAL fixed_t	GlobVis;
 fixed_t			viewingrangerecip;
 fixed_t			FocalLengthX;
 fixed_t			FocalLengthY;
 float			FocalLengthXfloat;
-FDynamicColormap*basecolormap;		// [RH] colormap currently drawing with
+R_THREADLOCAL FDynamicColormap*basecolormap;	// [RH] colormap currently drawing with
 int				fixedlightlev;
 lighttable_t	*fixedcolormap;
 FSpecialColormap *realfixedcolormap;
@@ -162,7 +163,7 @@ void (*colfunc) (void);
 void (*basecolfunc) (void);
 void (*fuzzcolfunc) (void);
 void (*transcolfunc) (void);
-void (*spanfunc) (void);
+R_THREADLOCAL void (*spanfunc) (void);
 
 void (*hcolfunc_pre) (void);
 void (*hcolfunc_post1) (int hx, int sx, int yl, int yh);
@@ -843,6 +844,7 @@ void R_RenderActorView (AActor *actor, bool dontmaplines)
 	PO_LinkToSubsectors();
 	if (r_polymost < 2)
 	{
+		PROF_ZONE ("R_RenderBSPNode");
 		R_RenderBSPNode (nodes + numnodes - 1);	// The head node is the last node output.
 		R_3D_ResetClip(); // reset clips (floor/ceiling)
 	}
@@ -928,6 +930,69 @@ void R_RenderViewToCanvas (AActor *actor, DCanvas *canvas,
 	viewactive = savedviewactive;
 }
 
+//==========================================================================
+//
+// R_CanBenchmarkView
+//
+// [dorch] Checks that there is a view to render with the software renderer.
+//
+//==========================================================================
+
+bool R_CanBenchmarkView (const char *command)
+{
+	if (gamestate != GS_LEVEL || players[consoleplayer].camera == NULL)
+	{
+		Printf ("%s can only be used in a level.\n", command);
+		return false;
+	}
+	if (currentrenderer != 0)
+	{
+		Printf ("%s needs the software renderer.\n", command);
+		return false;
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// R_BenchmarkView
+//
+// [dorch] Renders the console player's view into canvas frames times, after
+// one untimed frame to warm up the caches. Returns the average time of a
+// frame in ms and optionally the average time spent drawing planes.
+//
+//==========================================================================
+
+double R_BenchmarkView (DSimpleCanvas *canvas, int frames, double *planems)
+{
+	AActor *camera = players[consoleplayer].camera;
+	double totalms = 0, totalplanems = 0;
+
+	for (int i = 0; i <= frames; i++)
+	{
+		cycle_t cycles;
+
+		cycles.Reset ();
+		cycles.Clock ();
+		canvas->Lock ();
+		R_RenderViewToCanvas (camera, canvas, 0, 0, canvas->GetWidth (), canvas->GetHeight ());
+		canvas->Unlock ();
+		cycles.Unclock ();
+
+		if (i > 0)
+		{
+			totalms += cycles.TimeMS ();
+			totalplanems += PlaneCycles.TimeMS ();
+		}
+	}
+
+	if (planems != NULL)
+	{
+		*planems = frames > 0 ? totalplanems / frames : 0;
+	}
+	return frames > 0 ? totalms / frames : 0;
+}
+
 //==========================================================================
 //
 // R_MultiresInit
@@ -27,6 +27,7 @@
 #include "d_player.h"
 #include "v_palette.h"
 #include "r_data/colormaps.h"
+#include "r_thread.h"
 
 
 typedef BYTE lighttable_t;	// This could be wider for >8 bit display.
@@ -53,7 +54,7 @@ extern fixed_t			centeryfrac;
 extern fixed_t			yaspectmul;
 extern float			iyaspectmulfloat;
 
-extern FDynamicColormap*basecolormap;	// [RH] Colormap for sector currently being drawn
+extern R_THREADLOCAL FDynamicColormap*basecolormap;	// [RH] Colormap for sector currently being drawn
 
 extern int				linecount;
 extern int				loopcount;
@@ -84,7 +85,7 @@ extern bool				r_dontmaplines;
 // Change R_CalcTiltedLighting() when this changes.
 #define GETPALOOKUP(vis,shade)	(clamp<int> (((shade)-MIN(MAXLIGHTVIS,(vis)))>>FRACBITS, 0, NUMCOLORMAPS-1))
 
-extern fixed_t			GlobVis;
+extern R_THREADLOCAL fixed_t	GlobVis;
 
 void R_SetVisibility (float visibility);
 float R_GetVisibility ();
@@ -112,7 +113,7 @@ extern void 			(*basecolfunc) (void);
 extern void 			(*fuzzcolfunc) (void);
 extern void				(*transcolfunc) (void);
 // No shadow effects on floors.
-extern void 			(*spanfunc) (void);
+extern R_THREADLOCAL void	(*spanfunc) (void);
 
 // [RH] Function pointers for the horizontal column drawers.
 extern void (*hcolfunc_pre) (void);
@@ -134,6 +135,11 @@ void R_SetupBuffer ();
 
 void R_RenderViewToCanvas (AActor *actor, DCanvas *canvas, int x, int y, int width, int height, bool dontmaplines = false);
 
+// [dorch] Helpers for the renderer benchmarks (r_benchthreads, r_benchdrawers).
+class DSimpleCanvas;
+bool R_CanBenchmarkView (const char *command);
+double R_BenchmarkView (DSimpleCanvas *canvas, int frames, double *planems = NULL);
+
 // [RH] Initialize multires stuff for renderer
 void R_MultiresInit (void);
 
@@ -62,6 +62,7 @@
 #include "r_3dfloors.h"
 #include "v_palette.h"
 #include "r_data/colormaps.h"
+#include "profiler.h"
 // [BC] New #includes.
 #include "sv_commands.h"
 
@@ -73,29 +74,64 @@
 //EXTERN_CVAR (Int, ty)
 
 static void R_DrawSkyStriped (visplane_t *pl);
+static void R_SetVisplaneBuckets (unsigned int buckets);
 
 planefunction_t 		floorfunc;
 planefunction_t 		ceilingfunc;
 
 // Here comes the obnoxious "visplane".
-#define MAXVISPLANES 128    /* must be a power of 2 */
+// [dorch] The hash is resized at the start of each frame to fit the number
+// of visplanes the previous frame used, between these two sizes.
+#define MINVISPLANES 128		/* must be a power of 2 */
+#define MAXVISPLANES 16384		/* must be a power of 2 */
 
 // Avoid infinite recursion with stacked sectors by limiting them.
 #define MAX_SKYBOX_PLANES 1000
 
 // [RH] Allocate one extra for sky box planes.
-static visplane_t		*visplanes[MAXVISPLANES+1];	// killough
+// [dorch] That is visplanes[VisplaneBuckets].
+static visplane_t		**visplanes;				// killough
+static unsigned int		VisplaneBuckets;
+static unsigned int		VisplaneHashShift;
 static visplane_t		*freetail;					// killough
 static visplane_t		**freehead = &freetail;		// killough
 
+// [dorch] Visplanes and their top/bottom arrays are carved out of large
+// blocks instead of being allocated one at a time. A full R_ClearPlanes
+// hands every one of them back at once by rewinding VisplaneArenaUsed.
+#define VISPLANES_PER_BLOCK 32
+
+static TArray<BYTE *>	VisplaneBlocks;
+static unsigned int		VisplaneArenaUsed;
+
+// [dorch] Counters for the visplanes stat. They cover one view and are
+// copied to LastVisplaneStats when the next one starts.
+struct FVisplaneStats
+{
+	int			Planes;			// visplanes handed out
+	int			Lookups;		// R_FindPlane calls
+	int			Probes;			// hash chain entries looked at by them
+	int			MaxChain;		// longest chain walked by one lookup
+	unsigned	Buckets;
+	cycle_t		FindCycles;		// time in R_FindPlane and R_CheckPlane
+};
+
+static FVisplaneStats	VisplaneStats, LastVisplaneStats;
+static bool				VisplaneTiming, VisplaneStatShown;
+
 visplane_t 				*floorplane;
 visplane_t 				*ceilingplane;
 
 // killough -- hash function for visplanes
 // Empirically verified to be fairly uniform:
+// [dorch] Only with 128 buckets. Heights are usually whole map units, which
+// leaves the low 16 bits of height.d*7 at zero, so the sum is spread out
+// with a multiply and the top bits are used for any table size.
 
-#define visplane_hash(picnum,lightlevel,height) \
-  ((unsigned)((picnum)*3+(lightlevel)+((height).d)*7) & (MAXVISPLANES-1))
+static inline unsigned visplane_hash (int picnum, int lightlevel, const secplane_t &height)
+{
+	return ((unsigned)(picnum*3 + lightlevel + height.d*7) * 2654435769u) >> VisplaneHashShift;
+}
 
 // These are copies of the main parameters used when drawing stacked sectors.
 // When you change the main parameters, you should copy them here too *unless*
@@ -127,28 +163,46 @@ short					ceilingclip[MAXWIDTH];
 // texture mapping
 //
 
-static fixed_t			planeheight;
+// [dorch] Everything used to map a flat plane is per thread, so that
+// R_DrawPlanes can split the screen into slices (see r_thread.h).
+static R_THREADLOCAL fixed_t	planeheight;
 
 extern "C" {
 //
 // spanend holds the end of a plane span in each screen row
 //
-short					spanend[MAXHEIGHT];
+R_THREADLOCAL short		spanend[MAXHEIGHT];
 BYTE					*tiltlighting[MAXWIDTH];
 
-int						planeshade;
+R_THREADLOCAL int		planeshade;
 FVector3				plane_sz, plane_su, plane_sv;
 float					planelightfloat;
-bool					plane_shade;
-fixed_t					pviewx, pviewy;
+R_THREADLOCAL bool		plane_shade;
+R_THREADLOCAL fixed_t	pviewx, pviewy;
 
 void R_DrawTiltedPlane_ASM (int y, int x1);
 }
 
 fixed_t 				yslope[MAXHEIGHT];
-static fixed_t			xscale, yscale;
-static DWORD			xstepscale, ystepscale;
-static DWORD			basexfrac, baseyfrac;
+static R_THREADLOCAL fixed_t	xscale, yscale;
+static R_THREADLOCAL DWORD		xstepscale, ystepscale;
+static R_THREADLOCAL DWORD		basexfrac, baseyfrac;
+
+// [dorch] Columns outside of [planeclipleft, planeclipright] are left alone
+// by R_MapVisPlane. Only narrowed while drawing a screen slice.
+static R_THREADLOCAL int		planeclipleft = 0;
+static R_THREADLOCAL int		planeclipright = MAXWIDTH;
+
+// [dorch] A regular flat whose texture has been looked up on the main thread
+// and that can be drawn by any render thread.
+struct FPreparedPlane
+{
+	visplane_t	*pl;
+	FTexture	*tex;
+	const BYTE	*pixels;
+};
+
+static TArray<FPreparedPlane>	PreparedPlanes;
 
 #ifdef X86_ASM
 extern "C" void R_SetSpanSource_ASM (const BYTE *flat);
@@ -158,6 +212,8 @@ extern "C" void R_SetTiltedSpanSource_ASM (const BYTE *flat);
 extern "C" BYTE *ds_curcolormap, *ds_cursource, *ds_curtiltedsource;
 #endif
 void					R_DrawSinglePlane (visplane_t *, fixed_t alpha, bool additive, bool masked);
+static FTexture			*R_PreparePlaneTexture (visplane_t *pl);
+static void				R_DrawPreparedPlane (visplane_t *pl, FTexture *tex, const BYTE *pixels, fixed_t alpha, bool additive, bool masked);
 
 //==========================================================================
 //
@@ -169,6 +225,60 @@ void					R_DrawSinglePlane (visplane_t *, fixed_t alpha, bool additive, bool mas
 
 void R_InitPlanes ()
 {
+	R_SetVisplaneBuckets (MINVISPLANES);
+}
+
+//==========================================================================
+//
+// R_SetVisplaneBuckets
+//
+// [dorch] Replaces the hash table with an empty one of the given size.
+// Only called when no visplanes are in it.
+//
+//==========================================================================
+
+static void R_SetVisplaneBuckets (unsigned int buckets)
+{
+	if (visplanes != NULL && buckets == VisplaneBuckets)
+	{
+		return;
+	}
+	delete[] visplanes;
+	visplanes = new visplane_t *[buckets + 1];
+	memset (visplanes, 0, sizeof(*visplanes) * (buckets + 1));
+	VisplaneBuckets = buckets;
+	for (VisplaneHashShift = 32; buckets > 1; buckets >>= 1)
+	{
+		VisplaneHashShift--;
+	}
+}
+
+//==========================================================================
+//
+// R_ResizeVisplaneHash
+//
+// [dorch] Aims for about one visplane per bucket. Grows as soon as a frame
+// needs more, but only shrinks once the table is four times too big, so
+// that the size doesn't flip back and forth.
+//
+//==========================================================================
+
+static void R_ResizeVisplaneHash (int numplanes)
+{
+	unsigned int want = MINVISPLANES;
+
+	while (want < MAXVISPLANES && want < (unsigned int)numplanes)
+	{
+		want <<= 1;
+	}
+	if (want > VisplaneBuckets || want * 4 <= VisplaneBuckets)
+	{
+		R_SetVisplaneBuckets (want);
+	}
+	else
+	{
+		memset (visplanes, 0, sizeof(*visplanes) * (VisplaneBuckets + 1));
+	}
 }
 
 //==========================================================================
@@ -182,19 +292,18 @@ void R_DeinitPlanes ()
 	fakeActive = 0;
 
 	// do not use R_ClearPlanes because at this point the screen pointer is no longer valid.
-	for (int i = 0; i <= MAXVISPLANES; i++)	// new code -- killough
-	{
-		for (*freehead = visplanes[i], visplanes[i] = NULL; *freehead; )
-		{
-			freehead = &(*freehead)->next;
-		}
-	}
-	for (visplane_t *pl = freetail; pl != NULL; )
+	// [dorch] All visplanes live in VisplaneBlocks, so just free those.
+	for (unsigned int i = 0; i < VisplaneBlocks.Size(); i++)
 	{
-		visplane_t *next = pl->next;
-		free (pl);
-		pl = next;
+		M_Free (VisplaneBlocks[i]);
 	}
+	VisplaneBlocks.Clear();
+	VisplaneArenaUsed = 0;
+	freetail = NULL;
+	freehead = &freetail;
+	delete[] visplanes;
+	visplanes = NULL;
+	VisplaneBuckets = 0;
 }
 
 //==========================================================================
@@ -509,7 +618,7 @@ void R_ClearPlanes (bool fullclear)
 	// Don't clear fake planes if not doing a full clear.
 	if (!fullclear)
 	{
-		for (i = 0; i <= MAXVISPLANES-1; i++)	// new code -- killough
+		for (i = 0; i < (int)VisplaneBuckets; i++)	// new code -- killough
 		{
 			for (visplane_t **probe = &visplanes[i]; *probe != NULL; )
 			{
@@ -530,13 +639,23 @@ void R_ClearPlanes (bool fullclear)
 	}
 	else
 	{
-		for (i = 0; i <= MAXVISPLANES; i++)	// new code -- killough
-		{
-			for (*freehead = visplanes[i], visplanes[i] = NULL; *freehead; )
-			{
-				freehead = &(*freehead)->next;
-			}
-		}
+		// [dorch] Every visplane is either in the hash or on the freelist
+		// here, so instead of moving them all to the freelist, empty both and
+		// start handing out the arena from the beginning again.
+		freetail = NULL;
+		freehead = &freetail;
+		VisplaneArenaUsed = 0;
+
+		VisplaneStats.Buckets = VisplaneBuckets;
+		LastVisplaneStats = VisplaneStats;
+		R_ResizeVisplaneHash (VisplaneStats.Planes);
+		VisplaneStats.Planes = 0;
+		VisplaneStats.Lookups = 0;
+		VisplaneStats.Probes = 0;
+		VisplaneStats.MaxChain = 0;
+		VisplaneStats.FindCycles.Reset();
+		VisplaneTiming = VisplaneStatShown;
+		VisplaneStatShown = false;
 
 		// opening / clipping determination
 		clearbufshort (floorclip, viewwidth, viewheight);
@@ -555,30 +674,67 @@ void R_ClearPlanes (bool fullclear)
 //
 // New function, by Lee Killough
 // [RH] top and bottom buffers get allocated immediately after the visplane.
+// [dorch] Takes visplanes from the freelist first, then from the arena.
 //
 //==========================================================================
 
 static visplane_t *new_visplane (unsigned hash)
 {
 	visplane_t *check = freetail;
+	// Keep every visplane 16-byte aligned within its block.
+	const size_t planesize = (sizeof(*check) + 3 + sizeof(*check->top)*(MAXWIDTH*2) + 15) & ~(size_t)15;
 
 	if (check == NULL)
 	{
-		check = (visplane_t *)M_Malloc (sizeof(*check) + 3 + sizeof(*check->top)*(MAXWIDTH*2));
-		memset(check, 0, sizeof(*check) + 3 + sizeof(*check->top)*(MAXWIDTH*2));
-		check->bottom = check->top + MAXWIDTH+2;
+		unsigned int block = VisplaneArenaUsed / VISPLANES_PER_BLOCK;
+
+		if (block == VisplaneBlocks.Size())
+		{
+			BYTE *mem = (BYTE *)M_Malloc (planesize * VISPLANES_PER_BLOCK);
+			memset (mem, 0, planesize * VISPLANES_PER_BLOCK);
+			for (int i = 0; i < VISPLANES_PER_BLOCK; i++)
+			{
+				visplane_t *pl = (visplane_t *)(mem + i * planesize);
+				pl->bottom = pl->top + MAXWIDTH+2;
+			}
+			VisplaneBlocks.Push (mem);
+		}
+		check = (visplane_t *)(VisplaneBlocks[block] + (VisplaneArenaUsed % VISPLANES_PER_BLOCK) * planesize);
+		VisplaneArenaUsed++;
 	}
 	else if (NULL == (freetail = freetail->next))
 	{
 		freehead = &freetail;
 	}
 
+	VisplaneStats.Planes++;
 	check->next = visplanes[hash];
 	visplanes[hash] = check;
 	return check;
 }
 
 
+//==========================================================================
+//
+// R_EndFindPlane
+//
+// [dorch] Updates the visplanes stat at the end of R_FindPlane.
+//
+//==========================================================================
+
+static inline void R_EndFindPlane (int chain)
+{
+	VisplaneStats.Probes += chain;
+	if (chain > VisplaneStats.MaxChain)
+	{
+		VisplaneStats.MaxChain = chain;
+	}
+	if (VisplaneTiming)
+	{
+		VisplaneStats.FindCycles.Unclock();
+	}
+}
+
 //==========================================================================
 //
 // R_FindPlane
@@ -633,11 +789,19 @@ visplane_t *R_FindPlane (const secplane_t &height, FTextureID picnum, int lightl
 		alpha = FRACUNIT;
 	}
 
+	if (VisplaneTiming)
+	{
+		VisplaneStats.FindCycles.Clock();
+	}
+
 	// New visplane algorithm uses hash table -- killough
-	hash = isskybox ? MAXVISPLANES : visplane_hash (picnum.GetIndex(), lightlevel, height);
+	hash = isskybox ? VisplaneBuckets : visplane_hash (picnum.GetIndex(), lightlevel, height);
 
+	int chain = 0;
+	VisplaneStats.Lookups++;
 	for (check = visplanes[hash]; check; check = check->next)	// killough
 	{
+		chain++;
 		if (isskybox)
 		{
 			if (skybox == check->skybox && plane == check->height)
@@ -673,11 +837,13 @@ visplane_t *R_FindPlane (const secplane_t &height, FTextureID picnum, int lightl
 						)
 					   )
 					{
+						R_EndFindPlane (chain);
 						return check;
 					}
 				}
 				else
 				{
+					R_EndFindPlane (chain);
 					return check;
 				}
 			}
@@ -698,6 +864,7 @@ visplane_t *R_FindPlane (const secplane_t &height, FTextureID picnum, int lightl
 			CurrentSkybox == check->CurrentSkybox
 			)
 		{
+		  R_EndFindPlane (chain);
 		  return check;
 		}
 	}
@@ -731,6 +898,7 @@ visplane_t *R_FindPlane (const secplane_t &height, FTextureID picnum, int lightl
 
 	clearbufshort (check->top, viewwidth, 0x7fff);
 
+	R_EndFindPlane (chain);
 	return check;
 }
 
@@ -749,6 +917,11 @@ visplane_t *R_CheckPlane (visplane_t *pl, int start, int stop)
 	assert (start >= 0 && start < viewwidth);
 	assert (stop >= start && stop < viewwidth);
 
+	if (VisplaneTiming)
+	{
+		VisplaneStats.FindCycles.Clock();
+	}
+
 	if (start < pl->minx)
 	{
 		intrl = pl->minx;
@@ -787,7 +960,7 @@ visplane_t *R_CheckPlane (visplane_t *pl, int start, int stop)
 
 		if (pl->skybox != NULL && !pl->skybox->bInSkybox && (pl->picnum == skyflatnum || pl->skybox->bAlways) && viewactive)
 		{
-			hash = MAXVISPLANES;
+			hash = VisplaneBuckets;
 		}
 		else
 		{
@@ -822,6 +995,10 @@ visplane_t *R_CheckPlane (visplane_t *pl, int start, int stop)
 		pl->maxx = stop;
 		clearbufshort (pl->top, viewwidth, 0x7fff);
 	}
+	if (VisplaneTiming)
+	{
+		VisplaneStats.FindCycles.Unclock();
+	}
 	return pl;
 }
 
@@ -1037,15 +1214,128 @@ static void R_DrawSkyStriped (visplane_t *pl)
 CVAR (Bool, tilt, false, 0);
 //CVAR (Int, pa, 0, 0)
 
+#ifdef R_HAS_THREADS
+//==========================================================================
+//
+// R_DrawPlaneSlice
+//
+// [dorch] Draws the part of every prepared plane that lies within one
+// vertical slice of the view. Called from the render threads.
+//
+//==========================================================================
+
+static void R_DrawPlaneSlice (int slice, int numslices, void *data)
+{
+	int x1, x2;
+	PROF_ZONE ("R_DrawPlaneSlice");
+
+	R_GetSliceBounds (slice, numslices, viewwidth, x1, x2);
+	planeclipleft = x1;
+	planeclipright = x2;
+	// [dorch] ds_color is only used by r_drawflat, which is never drawn
+	// in slices, so it's left alone here.
+	spanfunc = *(void (**)(void))data;
+
+	for (unsigned i = 0; i < PreparedPlanes.Size(); i++)
+	{
+		const FPreparedPlane &prep = PreparedPlanes[i];
+
+		if (prep.pl->minx <= x2 && prep.pl->maxx >= x1)
+		{
+			R_DrawPreparedPlane (prep.pl, prep.tex, prep.pixels, OPAQUE, false, false);
+		}
+	}
+
+	planeclipleft = 0;
+	planeclipright = MAXWIDTH;
+}
+
+//==========================================================================
+//
+// R_DrawPlanesThreaded
+//
+// [dorch] Sky and sloped planes are drawn right away on the main thread.
+// Everything else is drawn in vertical slices by the render threads. The
+// slices don't overlap, so no two threads ever write the same pixel.
+//
+//==========================================================================
+
+static int R_DrawPlanesThreaded ()
+{
+	visplane_t *pl;
+	int i;
+	int vpcount = 0;
+	void (*mainspanfunc)(void) = spanfunc;
+
+	PreparedPlanes.Clear();
+
+	for (i = 0; i < (int)VisplaneBuckets; i++)
+	{
+		for (pl = visplanes[i]; pl; pl = pl->next)
+		{
+			// kg3D - draw only correct planes
+			if(pl->CurrentMirror != CurrentMirror || pl->CurrentSkybox != CurrentSkybox)
+				continue;
+			// kg3D - draw only real planes now
+			if(pl->sky < 0)
+				continue;
+
+			vpcount++;
+			if (pl->minx > pl->maxx)
+				continue;
+
+			if (pl->picnum == skyflatnum)
+			{
+				R_DrawSinglePlane (pl, OPAQUE, false, false);
+				continue;
+			}
+
+			FTexture *tex = R_PreparePlaneTexture (pl);
+			if (tex == NULL)
+				continue;
+
+			if ((pl->height.a == 0 && pl->height.b == 0) && !tilt)
+			{
+				FPreparedPlane prep = { pl, tex, tex->GetPixels () };
+				PreparedPlanes.Push (prep);
+			}
+			else
+			{
+				spanfunc = mainspanfunc;
+				R_DrawPreparedPlane (pl, tex, tex->GetPixels (), OPAQUE, false, false);
+				NetUpdate ();
+			}
+		}
+	}
+
+	if (PreparedPlanes.Size() > 0)
+	{
+		const int numslices = R_GetRenderThreadCount() * RENDER_SLICES_PER_THREAD;
+		R_RunSlices (numslices, R_DrawPlaneSlice, &mainspanfunc);
+		PreparedPlanes.Clear();
+		NetUpdate ();
+	}
+	return vpcount;
+}
+#endif
+
 int R_DrawPlanes ()
 {
 	visplane_t *pl;
 	int i;
 	int vpcount = 0;
+	PROF_ZONE ("R_DrawPlanes");
 
 	ds_color = 3;
 
-	for (i = 0; i < MAXVISPLANES; i++)
+#ifdef R_HAS_THREADS
+	if (!r_drawflat && R_GetRenderThreadCount() > 1)
+	{
+		return R_DrawPlanesThreaded ();
+	}
+#endif
+
+	for (i = 0; i < (int)VisplaneBuckets; i++)
 	{
 		for (pl = visplanes[i]; pl; pl = pl->next)
 		{
@@ -1070,7 +1360,7 @@ void R_DrawHeightPlanes(fixed_t height)
 
 	ds_color = 3;
 
-	for (i = 0; i < MAXVISPLANES; i++)
+	for (i = 0; i < (int)VisplaneBuckets; i++)
 	{
 		for (pl = visplanes[i]; pl; pl = pl->next)
 		{
@@ -1115,39 +1405,72 @@ void R_DrawSinglePlane (visplane_t *pl, fixed_t alpha, bool additive, bool maske
 	}
 	else
 	{ // regular flat
-		FTexture *tex = TexMan(pl->picnum, true);
+		FTexture *tex = R_PreparePlaneTexture (pl);
 
-		if (tex->UseType == FTexture::TEX_Null)
+		if (tex == NULL)
 		{
 			return;
 		}
+		R_DrawPreparedPlane (pl, tex, tex->GetPixels (), alpha, additive, masked);
+	}
+	NetUpdate ();
+}
 
-		if (!masked && !additive)
-		{ // If we're not supposed to see through this plane, draw it opaque.
-			alpha = OPAQUE;
-		}
-		else if (!tex->bMasked)
-		{ // Don't waste time on a masked texture if it isn't really masked.
-			masked = false;
-		}
-		R_SetupSpanBits(tex);
-		pl->xscale = MulScale16 (pl->xscale, tex->xScale);
-		pl->yscale = MulScale16 (pl->yscale, tex->yScale);
-		ds_source = tex->GetPixels ();
+//==========================================================================
+//
+// R_PreparePlaneTexture
+//
+// Looks up a regular flat's texture and applies its scale to the plane.
+// Returns NULL if there is nothing to draw. Main thread only.
+//
+//==========================================================================
 
-		basecolormap = pl->colormap;
-		planeshade = LIGHT2SHADE(pl->lightlevel);
+static FTexture *R_PreparePlaneTexture (visplane_t *pl)
+{
+	FTexture *tex = TexMan(pl->picnum, true);
 
-		if (r_drawflat || ((pl->height.a == 0 && pl->height.b == 0) && !tilt))
-		{
-			R_DrawNormalPlane (pl, alpha, additive, masked);
-		}
-		else
-		{
-			R_DrawTiltedPlane (pl, alpha, additive, masked);
-		}
+	if (tex->UseType == FTexture::TEX_Null)
+	{
+		return NULL;
+	}
+	pl->xscale = MulScale16 (pl->xscale, tex->xScale);
+	pl->yscale = MulScale16 (pl->yscale, tex->yScale);
+	return tex;
+}
+
+//==========================================================================
+//
+// R_DrawPreparedPlane
+//
+// Draws a regular flat whose texture has been prepared by
+// R_PreparePlaneTexture. pixels is the result of tex->GetPixels().
+//
+//==========================================================================
+
+static void R_DrawPreparedPlane (visplane_t *pl, FTexture *tex, const BYTE *pixels, fixed_t alpha, bool additive, bool masked)
+{
+	if (!masked && !additive)
+	{ // If we're not supposed to see through this plane, draw it opaque.
+		alpha = OPAQUE;
+	}
+	else if (!tex->bMasked)
+	{ // Don't waste time on a masked texture if it isn't really masked.
+		masked = false;
+	}
+	R_SetupSpanBits(tex);
+	ds_source = pixels;
+
+	basecolormap = pl->colormap;
+	planeshade = LIGHT2SHADE(pl->lightlevel);
+
+	if (r_drawflat || ((pl->height.a == 0 && pl->height.b == 0) && !tilt))
+	{
+		R_DrawNormalPlane (pl, alpha, additive, masked);
+	}
+	else
+	{
+		R_DrawTiltedPlane (pl, alpha, additive, masked);
 	}
-	NetUpdate ();
 }
 
 //==========================================================================
@@ -1183,7 +1506,7 @@ void R_DrawSkyBoxes ()
 
 	numskyboxes = 0;
 
-	if (visplanes[MAXVISPLANES] == NULL)
+	if (visplanes[VisplaneBuckets] == NULL)
 		return;
 
 	R_3D_EnterSkybox();
@@ -1204,12 +1527,12 @@ void R_DrawSkyBoxes ()
 	int i;
 	visplane_t *pl;
 
-	for (pl = visplanes[MAXVISPLANES]; pl != NULL; pl = visplanes[MAXVISPLANES])
+	for (pl = visplanes[VisplaneBuckets]; pl != NULL; pl = visplanes[VisplaneBuckets])
 	{
 		// Pop the visplane off the list now so that if this skybox adds more
 		// skyboxes to the list, they will be drawn instead of skipped (because
 		// new skyboxes go to the beginning of the list instead of the end).
-		visplanes[MAXVISPLANES] = pl->next;
+		visplanes[VisplaneBuckets] = pl->next;
 		pl->next = NULL;
 
 		if (pl->maxx < pl->minx || !r_skyboxes || numskyboxes == MAX_SKYBOX_PLANES)
@@ -1367,7 +1690,7 @@ void R_DrawSkyBoxes ()
 
 	if(fakeActive) return;
 
-	for (*freehead = visplanes[MAXVISPLANES], visplanes[MAXVISPLANES] = NULL; *freehead; )
+	for (*freehead = visplanes[VisplaneBuckets], visplanes[VisplaneBuckets] = NULL; *freehead; )
 		freehead = &(*freehead)->next;
 }
 
@@ -1378,6 +1701,31 @@ ADD_STAT(skyboxes)
 	return out;
 }
 
+//==========================================================================
+//
+// STAT visplanes
+//
+// [dorch] Visplane count, hash chain lengths and time spent finding and
+// drawing visplanes in the last view. Finding them is only timed while
+// this is shown.
+//
+//==========================================================================
+
+extern cycle_t PlaneCycles;
+
+ADD_STAT(visplanes)
+{
+	FVisplaneStats &stats = LastVisplaneStats;
+	FString out;
+
+	VisplaneStatShown = true;
+	out.Format ("%d planes, %u buckets, chain avg=%.2f max=%d, find=%04.2f ms draw=%04.2f ms",
+		stats.Planes, stats.Buckets,
+		stats.Lookups > 0 ? double(stats.Probes) / stats.Lookups : 0., stats.MaxChain,
+		VisplaneTiming ? stats.FindCycles.TimeMS() : 0., PlaneCycles.TimeMS());
+	return out;
+}
+
 //==========================================================================
 //
 // R_DrawSkyPlane
@@ -1551,7 +1899,7 @@ void R_DrawNormalPlane (visplane_t *pl, fixed_t alpha, bool additive, bool maske
 		ystepscale = (DWORD)(-(SDWORD)ystepscale);
 	}
 
-	int x = pl->maxx - halfviewwidth;
+	int x = MIN (pl->maxx, planeclipright) - halfviewwidth;
 	planeang = (planeang + (ANG90 >> ANGLETOFINESHIFT)) & FINEMASK;
 	basexfrac = FixedMul (xscale, finecosine[planeang]) + x*xstepscale;
 	baseyfrac = FixedMul (yscale, -finesine[planeang]) + x*ystepscale;
@@ -1751,7 +2099,9 @@ void R_DrawTiltedPlane (visplane_t *pl, fixed_t alpha, bool additive, bool maske
 
 void R_MapVisPlane (visplane_t *pl, void (*mapfunc)(int y, int x1))
 {
-	int x = pl->maxx;
+	// [dorch] Only map the columns of the slice being drawn.
+	const int minx = MAX (pl->minx, planeclipleft);
+	int x = MIN (pl->maxx, planeclipright);
 	int t2 = pl->top[x];
 	int b2 = pl->bottom[x];
 
@@ -1760,7 +2110,7 @@ void R_MapVisPlane (visplane_t *pl, void (*mapfunc)(int y, int x1))
 		clearbufshort (spanend+t2, b2-t2, x);
 	}
 
-	for (--x; x >= pl->minx; --x)
+	for (--x; x >= minx; --x)
 	{
 		int t1 = pl->top[x];
 		int b1 = pl->bottom[x];
@@ -1799,7 +2149,7 @@ void R_MapVisPlane (visplane_t *pl, void (*mapfunc)(int y, int x1))
 	// Draw any spans that are still open
 	while (t2 < b2)
 	{
-		mapfunc (--b2, pl->minx);
+		mapfunc (--b2, minx);
 	}
 }
 
@@ -1811,31 +2161,20 @@ void R_MapVisPlane (visplane_t *pl, void (*mapfunc)(int y, int x1))
 
 bool R_PlaneInitData ()
 {
-	int i;
-	visplane_t *pl;
-
 	// Free all visplanes and let them be re-allocated as needed.
-	pl = freetail;
-
-	while (pl)
+	// [dorch] They all live in VisplaneBlocks, so just free those.
+	for (unsigned int i = 0; i < VisplaneBlocks.Size(); i++)
 	{
-		visplane_t *next = pl->next;
-		M_Free (pl);
-		pl = next;
+		M_Free (VisplaneBlocks[i]);
 	}
+	VisplaneBlocks.Clear();
+	VisplaneArenaUsed = 0;
 	freetail = NULL;
 	freehead = &freetail;
 
-	for (i = 0; i < MAXVISPLANES; i++)
+	if (visplanes != NULL)
 	{
-		pl = visplanes[i];
-		visplanes[i] = NULL;
-		while (pl)
-		{
-			visplane_t *next = pl->next;
-			M_Free (pl);
-			pl = next;
-		}
+		memset (visplanes, 0, sizeof(*visplanes) * (VisplaneBuckets + 1));
 	}
 
 	return true;
@@ -69,6 +69,7 @@
 #include "lastmanstanding.h"
 #include "network.h"
 #include "gamemode.h"
+#include "profiler.h"
 
 // [RH] A c-buffer. Used for keeping track of offscreen voxel spans.
 
@@ -2049,6 +2050,8 @@ void R_DrawHeightPlanes(fixed_t height); // kg3D - fake planes
 
 void R_DrawMasked (void)
 {
+	PROF_ZONE ("R_DrawMasked");
+
 	R_SortVisSprites (DrewAVoxel ? sv_compare2d : sv_compare, firstvissprite - vissprites);
 
 	if (height_top == NULL)
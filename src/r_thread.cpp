@@ -0,0 +1,325 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Zandronum Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: r_thread.cpp
+//
+// Description: Worker threads for the software renderer. Work is split into
+// vertical screen slices that are handed out to a small pool of threads.
+//
+//-----------------------------------------------------------------------------
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "r_thread.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "doomstat.h"
+#include "d_player.h"
+#include "i_system.h"
+#include "r_main.h"
+#include "stats.h"
+#include "templates.h"
+#include "v_video.h"
+
+//*****************************************************************************
+//	VARIABLES
+
+// [dorch] Number of threads that draw the software renderer's flats.
+// 1 draws everything on the main thread, 0 uses one thread per CPU.
+CUSTOM_CVAR( Int, r_threads, 1, CVAR_ARCHIVE|CVAR_GLOBALCONFIG )
+{
+	if ( self < 0 )
+		self = 0;
+	else if ( self > MAX_RENDER_THREADS )
+		self = MAX_RENDER_THREADS;
+}
+
+// Overrides r_threads while r_benchthreads or the level precache is running.
+// Negative uses one thread per CPU.
+static	int							g_lRenderThreadOverride = 0;
+
+#ifdef R_HAS_THREADS
+static	std::vector<std::thread>	g_RenderWorkers;
+static	std::mutex					g_RenderJobMutex;
+static	std::condition_variable		g_RenderJobStart;
+static	std::condition_variable		g_RenderJobDone;
+static	bool						g_bRenderWorkersQuit = false;
+static	bool						g_bRenderShutdownRegistered = false;
+
+// The job that is currently being worked on. Only changed by the main thread
+// while it holds g_RenderJobMutex and no worker is inside the job.
+static	unsigned int				g_ulRenderJobGeneration = 0;
+static	renderslicefunc_t			g_pRenderJobFunc = NULL;
+static	void						*g_pRenderJobData = NULL;
+static	int							g_lRenderJobSlices = 0;
+static	std::atomic<int>			g_NextRenderSlice( 0 );
+
+// Slices that haven't been finished yet and workers that are still inside
+// the job. The main thread waits for both to drop to zero so that no worker
+// can pick up a slice index that belongs to the next job.
+static	int							g_lRenderSlicesLeft = 0;
+static	int							g_lRenderWorkersBusy = 0;
+#endif
+
+//*****************************************************************************
+//	FUNCTIONS
+
+int R_GetRenderThreadCount( void )
+{
+#ifdef R_HAS_THREADS
+	int lCount = ( g_lRenderThreadOverride != 0 ) ? g_lRenderThreadOverride : *r_threads;
+
+	if ( lCount <= 0 )
+		lCount = std::thread::hardware_concurrency( );
+
+	return clamp<int>( lCount, 1, MAX_RENDER_THREADS );
+#else
+	return 1;
+#endif
+}
+
+//*****************************************************************************
+//
+void R_SetRenderThreadOverride( int lCount )
+{
+	g_lRenderThreadOverride = lCount;
+}
+
+//*****************************************************************************
+//
+void R_GetSliceBounds( int lSlice, int lNumSlices, int lWidth, int &lX1, int &lX2 )
+{
+	lX1 = lSlice * lWidth / lNumSlices;
+	lX2 = ( lSlice + 1 ) * lWidth / lNumSlices - 1;
+}
+
+#ifdef R_HAS_THREADS
+
+//*****************************************************************************
+//
+// Claims and draws slices of the current job until none are left. Returns the
+// number of slices this thread finished.
+//
+static int r_DoRenderSlices( renderslicefunc_t pFunc, void *pData, int lNumSlices )
+{
+	int lDone = 0;
+	int lSlice;
+
+	while (( lSlice = g_NextRenderSlice.fetch_add( 1 )) < lNumSlices )
+	{
+		pFunc( lSlice, lNumSlices, pData );
+		lDone++;
+	}
+
+	return ( lDone );
+}
+
+//*****************************************************************************
+//
+static void r_RenderWorkerThread( void )
+{
+	unsigned int ulSeenGeneration = 0;
+	std::unique_lock<std::mutex> lock( g_RenderJobMutex );
+
+	while ( true )
+	{
+		g_RenderJobStart.wait( lock, [&ulSeenGeneration] { return g_bRenderWorkersQuit || ( g_ulRenderJobGeneration != ulSeenGeneration ); } );
+		if ( g_bRenderWorkersQuit )
+			break;
+
+		ulSeenGeneration = g_ulRenderJobGeneration;
+
+		// The job has already been finished by the other threads.
+		if ( g_lRenderSlicesLeft == 0 )
+			continue;
+
+		renderslicefunc_t pFunc = g_pRenderJobFunc;
+		void *pData = g_pRenderJobData;
+		const int lNumSlices = g_lRenderJobSlices;
+
+		g_lRenderWorkersBusy++;
+		lock.unlock( );
+		const int lDone = r_DoRenderSlices( pFunc, pData, lNumSlices );
+		lock.lock( );
+		g_lRenderWorkersBusy--;
+		g_lRenderSlicesLeft -= lDone;
+
+		if (( g_lRenderSlicesLeft == 0 ) && ( g_lRenderWorkersBusy == 0 ))
+			g_RenderJobDone.notify_all( );
+	}
+}
+
+//*****************************************************************************
+//
+static void r_StopRenderThreads( void )
+{
+	{
+		std::lock_guard<std::mutex> lock( g_RenderJobMutex );
+		g_bRenderWorkersQuit = true;
+	}
+	g_RenderJobStart.notify_all( );
+
+	for ( unsigned int i = 0; i < g_RenderWorkers.size( ); i++ )
+		g_RenderWorkers[i].join( );
+
+	g_RenderWorkers.clear( );
+	g_bRenderWorkersQuit = false;
+}
+
+//*****************************************************************************
+//
+static void r_StartRenderThreads( int lCount )
+{
+	if ( static_cast<int>( g_RenderWorkers.size( )) == lCount )
+		return;
+
+	r_StopRenderThreads( );
+
+	if ( g_bRenderShutdownRegistered == false )
+	{
+		atterm( r_StopRenderThreads );
+		g_bRenderShutdownRegistered = true;
+	}
+
+	for ( int i = 0; i < lCount; i++ )
+		g_RenderWorkers.push_back( std::thread( r_RenderWorkerThread ));
+}
+
+#endif // R_HAS_THREADS
+
+//*****************************************************************************
+//
+// Calls pFunc for every slice in [0, lNumSlices). The main thread draws slices
+// as well and only returns once all of them are done.
+//
+void R_RunSlices( int lNumSlices, renderslicefunc_t pFunc, void *pData )
+{
+#ifdef R_HAS_THREADS
+	const int lThreads = R_GetRenderThreadCount( );
+
+	if (( lThreads > 1 ) && ( lNumSlices > 1 ))
+	{
+		r_StartRenderThreads( lThreads - 1 );
+
+		{
+			std::lock_guard<std::mutex> lock( g_RenderJobMutex );
+			g_pRenderJobFunc = pFunc;
+			g_pRenderJobData = pData;
+			g_lRenderJobSlices = lNumSlices;
+			g_lRenderSlicesLeft = lNumSlices;
+			g_NextRenderSlice = 0;
+			g_ulRenderJobGeneration++;
+		}
+		g_RenderJobStart.notify_all( );
+
+		const int lDone = r_DoRenderSlices( pFunc, pData, lNumSlices );
+
+		std::unique_lock<std::mutex> lock( g_RenderJobMutex );
+		g_lRenderSlicesLeft -= lDone;
+		g_RenderJobDone.wait( lock, [] { return ( g_lRenderSlicesLeft == 0 ) && ( g_lRenderWorkersBusy == 0 ); } );
+		return;
+	}
+#endif
+
+	for ( int i = 0; i < lNumSlices; i++ )
+		pFunc( i, lNumSlices, pData );
+}
+
+//*****************************************************************************
+//	CONSOLE COMMANDS
+
+// [dorch] Renders the console player's view over and over with every thread
+// count and prints the frame rate of each, like a timedemo without the demo.
+// Usage: r_benchthreads [frames] [width height]
+CCMD( r_benchthreads )
+{
+	if ( R_CanBenchmarkView( "r_benchthreads" ) == false )
+		return;
+
+	const int lFrames = ( argv.argc( ) > 1 ) ? clamp( atoi( argv[1] ), 1, 10000 ) : 100;
+	int lWidth = SCREENWIDTH;
+	int lHeight = SCREENHEIGHT;
+
+	if ( argv.argc( ) > 3 )
+	{
+		lWidth = clamp( atoi( argv[2] ), 320, MAXWIDTH );
+		lHeight = clamp( atoi( argv[3] ), 200, MAXHEIGHT );
+	}
+
+	int lMaxThreads = 1;
+#ifdef R_HAS_THREADS
+	lMaxThreads = clamp<int>( std::thread::hardware_concurrency( ), 1, MAX_RENDER_THREADS );
+	lMaxThreads = MAX( lMaxThreads, R_GetRenderThreadCount( ));
+#endif
+
+	TArray<int> threadCounts;
+	for ( int lCount = 1; lCount < lMaxThreads; lCount *= 2 )
+		threadCounts.Push( lCount );
+	threadCounts.Push( lMaxThreads );
+
+	DSimpleCanvas *pCanvas = new DSimpleCanvas( lWidth, lHeight );
+	double dBaseMS = 0;
+
+	Printf( "Rendering %d frames at %dx%d:\n", lFrames, lWidth, lHeight );
+
+	for ( unsigned int i = 0; i < threadCounts.Size( ); i++ )
+	{
+		double dPlanesMS = 0;
+
+		R_SetRenderThreadOverride( threadCounts[i] );
+		const double dTotalMS = R_BenchmarkView( pCanvas, lFrames, &dPlanesMS );
+
+		if ( i == 0 )
+			dBaseMS = dTotalMS;
+
+		Printf( "%2d thread%s: %7.2f ms/frame (planes %6.2f ms) %7.1f fps %5.2fx\n",
+			threadCounts[i], ( threadCounts[i] == 1 ) ? " " : "s", dTotalMS, dPlanesMS,
+			( dTotalMS > 0 ) ? 1000. / dTotalMS : 0., ( dTotalMS > 0 ) ? dBaseMS / dTotalMS : 0. );
+	}
+
+	R_SetRenderThreadOverride( 0 );
+	pCanvas->Destroy( );
+}
@@ -0,0 +1,86 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Zandronum Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: r_thread.h
+//
+// Description: Worker threads for the software renderer. Work is split into
+// vertical screen slices that are handed out to a small pool of threads.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __R_THREAD_H__
+#define __R_THREAD_H__
+
+// [dorch] Drawer state that is written while drawing flats is thread-local so
+// that several slices of the screen can be drawn at once. The 32-bit x86
+// assembly drawers read that state directly, so those builds stay serial.
+#ifdef X86_ASM
+#define R_THREADLOCAL
+#else
+#define R_THREADLOCAL	thread_local
+#define R_HAS_THREADS
+#endif
+
+//*****************************************************************************
+//	DEFINES
+
+enum
+{
+	// Upper limit for r_threads.
+	MAX_RENDER_THREADS = 32,
+
+	// Slices per thread. More slices even out the work between floors and
+	// ceilings at the cost of splitting more spans.
+	RENDER_SLICES_PER_THREAD = 4,
+};
+
+typedef void (*renderslicefunc_t) (int slice, int numslices, void *data);
+
+//*****************************************************************************
+//	PROTOTYPES
+
+int		R_GetRenderThreadCount (void);
+void	R_SetRenderThreadOverride (int count);
+void	R_RunSlices (int numslices, renderslicefunc_t func, void *data);
+void	R_GetSliceBounds (int slice, int numslices, int width, int &x1, int &x2);
+
+#endif // __R_THREAD_H__
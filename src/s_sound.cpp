@@ -56,6 +56,7 @@
 #include "deathmatch.h"
 #include "network.h"
 #include "sv_commands.h"
+#include "profiler.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -2092,6 +2093,7 @@ void S_UpdateSounds (AActor *listenactor)
 {
 	FVector3 pos, vel;
 	SoundListener listener;
+	PROF_ZONE ("S_UpdateSounds");
 
 	// [BC] Server doesn't use music/sound.
 	if ( NETWORK_GetState( ) == NETSTATE_SERVER )
@@ -14,6 +14,7 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <string>
 #include "doomtype.h"
 #include "i_system.h"
 #include "sc_man.h"
@@ -23,6 +24,8 @@
 #include "templates.h"
 #include "doomstat.h"
 #include "v_text.h"
+#include "sc_thread.h"
+#include "doomerrors.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -40,6 +43,13 @@
 
 // PRIVATE DATA DEFINITIONS ------------------------------------------------
 
+// [dorch] The outermost scanner that is open on a lump, and what it and the
+// lumps opened while it's open have taken so far.
+static FScanner *TimedScanner;
+static double TimedSince;
+static int TimedLumps;
+static int TimedBytes;
+
 // CODE --------------------------------------------------------------------
 
 //==========================================================================
@@ -51,6 +61,7 @@
 FScanner::FScanner()
 {
 	ScriptOpen = false;
+	Pretokenized = NULL;
 }
 
 //==========================================================================
@@ -61,7 +72,7 @@ FScanner::FScanner()
 
 FScanner::~FScanner()
 {
-	// Humm... Nothing to do in here.
+	ReleaseLump();
 }
 
 //==========================================================================
@@ -73,6 +84,7 @@ FScanner::~FScanner()
 FScanner::FScanner(const FScanner &other)
 {
 	ScriptOpen = false;
+	Pretokenized = NULL;
 	*this = other;
 }
 
@@ -85,6 +97,7 @@ FScanner::FScanner(const FScanner &other)
 FScanner::FScanner(int lumpnum)
 {
 	ScriptOpen = false;
+	Pretokenized = NULL;
 	OpenLumpNum(lumpnum);
 }
 
@@ -106,6 +119,10 @@ FScanner &FScanner::operator=(const FScanner &other)
 		return *this;
 	}
 
+	// [dorch] Tokens scanned ahead of time stay with the scanner that opened
+	// the lump, so the copy scans for itself.
+	ReleaseLump();
+
 	// Copy protected members
 	ScriptOpen = true;
 	ScriptName = other.ScriptName;
@@ -214,6 +231,13 @@ void FScanner::OpenMem (const char *name, const char *buffer, int size)
 void FScanner :: OpenLumpNum (int lump)
 {
 	Close ();
+	// [dorch] The lump may have been read and tokenized already.
+	Pretokenized = SC_TakePretokenizedScript(lump);
+	if (Pretokenized != NULL)
+	{
+		ScriptBuffer = Pretokenized->Text;
+	}
+	else
 	{
 		FMemLump mem = Wads.ReadLump(lump);
 		ScriptBuffer = mem.GetString();
@@ -221,6 +245,7 @@ void FScanner :: OpenLumpNum (int lump)
 	ScriptName = Wads.GetLumpFullPath(lump);
 	LumpNum = lump;
 	PrepareScript ();
+	StartTiming ();
 }
 
 //==========================================================================
@@ -233,22 +258,7 @@ void FScanner :: OpenLumpNum (int lump)
 
 void FScanner::PrepareScript ()
 {
-	// The scanner requires the file to end with a '\n', so add one if
-	// it doesn't already.
-	if (ScriptBuffer.Len() == 0 || ScriptBuffer[ScriptBuffer.Len() - 1] != '\n')
-	{
-		// If the last character in the buffer is a null character, change
-		// it to a newline. Otherwise, append a newline to the end.
-		if (ScriptBuffer.Len() > 0 && ScriptBuffer[ScriptBuffer.Len() - 1] == '\0')
-		{
-			ScriptBuffer.LockBuffer()[ScriptBuffer.Len() - 1] = '\n';
-			ScriptBuffer.UnlockBuffer();
-		}
-		else
-		{
-			ScriptBuffer += '\n';
-		}
-	}
+	PrepareText (ScriptBuffer);
 
 	ScriptPtr = &ScriptBuffer[0];
 	ScriptEndPtr = &ScriptBuffer[ScriptBuffer.Len()];
@@ -266,6 +276,35 @@ void FScanner::PrepareScript ()
 	BigStringBuffer = "";
 }
 
+//==========================================================================
+//
+// FScanner :: PrepareText
+//
+// [dorch] The part of PrepareScript that changes the text. Scripts that are
+// tokenized on a worker thread are prepared before they are queued.
+//
+//==========================================================================
+
+void FScanner::PrepareText (FString &text)
+{
+	// The scanner requires the file to end with a '\n', so add one if
+	// it doesn't already.
+	if (text.Len() == 0 || text[text.Len() - 1] != '\n')
+	{
+		// If the last character in the buffer is a null character, change
+		// it to a newline. Otherwise, append a newline to the end.
+		if (text.Len() > 0 && text[text.Len() - 1] == '\0')
+		{
+			text.LockBuffer()[text.Len() - 1] = '\n';
+			text.UnlockBuffer();
+		}
+		else
+		{
+			text += '\n';
+		}
+	}
+}
+
 //==========================================================================
 //
 // FScanner :: Close
@@ -274,6 +313,7 @@ void FScanner::PrepareScript ()
 
 void FScanner::Close ()
 {
+	ReleaseLump ();
 	ScriptOpen = false;
 	ScriptBuffer = "";
 	BigStringBuffer = "";
@@ -281,6 +321,52 @@ void FScanner::Close ()
 	String = StringBuffer;
 }
 
+//==========================================================================
+//
+// FScanner :: StartTiming
+//
+// [dorch] Starts timing the lump if no other scanner is open on a lump, and
+// counts it for the one that is otherwise.
+//
+//==========================================================================
+
+void FScanner::StartTiming ()
+{
+	if (TimedScanner == NULL)
+	{
+		TimedScanner = this;
+		TimedSince = SC_GetTimeMS();
+		TimedLumps = 0;
+		TimedBytes = 0;
+	}
+	TimedLumps++;
+	TimedBytes += int(ScriptBuffer.Len());
+}
+
+//==========================================================================
+//
+// FScanner :: ReleaseLump
+//
+// [dorch] Adds the time this scanner's lump took to the parse times, and
+// frees the tokens that were scanned ahead of time.
+//
+//==========================================================================
+
+void FScanner::ReleaseLump ()
+{
+	if (TimedScanner == this)
+	{
+		char name[9];
+
+		Wads.GetLumpName (name, LumpNum);
+		name[8] = '\0';
+		SC_AddParseTime (name, SC_GetTimeMS() - TimedSince, TimedLumps, TimedBytes);
+		TimedScanner = NULL;
+	}
+	SC_ReleasePretokenizedScript (Pretokenized);
+	Pretokenized = NULL;
+}
+
 //==========================================================================
 //
 // FScanner :: SavePos
@@ -412,6 +498,13 @@ bool FScanner::ScanString (bool tokens)
 	LastGotPtr = ScriptPtr;
 	LastGotLine = Line;
 
+	// [dorch] Take the result from a worker thread that scanned from here.
+	if (Pretokenized != NULL && ReplayToken (tokens, return_val))
+	{
+		LastGotToken = tokens;
+		return return_val;
+	}
+
 	// In case the generated scanner does not use marker, avoid compiler warnings.
 	marker;
 #include "sc_man_scanner.h"
@@ -419,6 +512,269 @@ bool FScanner::ScanString (bool tokens)
 	return return_val;
 }
 
+//==========================================================================
+//
+// FScanner :: ReplayToken
+//
+// [dorch] If a worker thread scanned from the current position in the same
+// mode, puts the scanner in the state that scan left it in and returns
+// true. found is set to what ScanString would return.
+//
+//==========================================================================
+
+bool FScanner::ReplayToken (bool tokens, bool &found)
+{
+	const int mode = tokens ? PRETOKEN_TOKENS : CMode ? PRETOKEN_CSTRINGS : PRETOKEN_STRINGS;
+	const std::vector<PRETOKEN_s> &list = Pretokenized->Tokens[mode];
+	const int offset = int(ScriptPtr - ScriptBuffer.GetChars());
+	unsigned int next = Pretokenized->ulNextToken[mode];
+
+	if (list.empty())
+	{
+		return false;
+	}
+
+	// Usually the parser just asks for the next token. After UnGet,
+	// RestorePos or a change of modes, look it up.
+	if (next >= list.size() || list[next].lStart != offset)
+	{
+		unsigned int min = 0, max = (unsigned int)list.size();
+
+		while (min < max)
+		{
+			unsigned int mid = (min + max) / 2;
+			if (list[mid].lStart < offset)
+			{
+				min = mid + 1;
+			}
+			else
+			{
+				max = mid;
+			}
+		}
+		next = min;
+	}
+
+	if (next >= list.size() || list[next].lStart != offset || (!tokens && list[next].bEscapes))
+	{
+		g_qwRescannedTokens++;
+		return false;
+	}
+
+	const PRETOKEN_s &token = list[next];
+
+	Pretokenized->ulNextToken[mode] = next + 1;
+	g_qwReplayedTokens++;
+
+	ScriptPtr = ScriptBuffer.GetChars() + token.lEnd;
+	Line += token.lLines;
+	Crossed = token.lLines > 0;
+	if (token.lTokenType != PRETOKEN_NOTYPE)
+	{
+		TokenType = token.lTokenType;
+	}
+
+	found = token.bFound;
+	if (found)
+	{
+		const char *text = Pretokenized->TextPool.data() + token.lText;
+
+		StringLen = token.lTextLength;
+		if (StringLen < MAX_STRING_SIZE)
+		{
+			memcpy (StringBuffer, text, StringLen);
+			StringBuffer[StringLen] = '\0';
+			String = StringBuffer;
+		}
+		else
+		{
+			BigStringBuffer = FString(text, StringLen);
+			String = BigStringBuffer.LockBuffer();
+		}
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// FTokenBuffer
+//
+// [dorch] Holds the tokens that don't fit in FPretokenScanner's
+// StringBuffer. FString can't be used on a worker thread, since even an
+// empty one changes the reference count of the shared null string.
+//
+//==========================================================================
+
+struct FTokenBuffer
+{
+	FTokenBuffer () {}
+	FTokenBuffer (const char *text, int len) : Text (text, len) {}
+
+	FTokenBuffer &operator= (const char *text) { Text = text; return *this; }
+	void AppendCStrPart (const char *text, int len) { Text.append (text, len); }
+	bool IsNotEmpty () const { return !Text.empty(); }
+	char *LockBuffer () { return &Text[0]; }
+	size_t Len () const { return Text.size(); }
+
+	std::string Text;
+};
+
+//==========================================================================
+//
+// FPretokenScanner
+//
+// [dorch] Just the members of FScanner that sc_man_scanner.h uses, so that
+// FScanner::Pretokenize can run the same scanner without an FScanner.
+//
+//==========================================================================
+
+struct FPretokenScanner
+{
+	typedef FTokenBuffer FString;
+
+	// Same as FScanner's.
+	static const int MAX_STRING_SIZE = 128;
+
+	bool ScanString (bool tokens);
+
+	// The worker gives up on the script instead. The parser reports the
+	// error when it gets there.
+	void ScriptError (const char *message, ...)
+	{
+		throw CRecoverableError ("Script error");
+	}
+
+	const char *ScriptPtr;
+	const char *ScriptEndPtr;
+	char *String;
+	int StringLen;
+	int TokenType;
+	int Line;
+	bool End;
+	bool Crossed;
+	bool CMode;
+	bool Escape;
+	char StringBuffer[MAX_STRING_SIZE];
+	FString BigStringBuffer;
+};
+
+//==========================================================================
+//
+// FPretokenScanner :: ScanString
+//
+// FScanner::ScanString, without UnGet and the tokens scanned ahead of time.
+//
+//==========================================================================
+
+bool FPretokenScanner::ScanString (bool tokens)
+{
+	const char *marker, *tok;
+	bool return_val;
+
+	Crossed = false;
+	if (ScriptPtr >= ScriptEndPtr)
+	{
+		End = true;
+		return false;
+	}
+
+	// In case the generated scanner does not use marker, avoid compiler warnings.
+	marker;
+#include "sc_man_scanner.h"
+	return return_val;
+}
+
+//==========================================================================
+//
+// FScanner :: Pretokenize
+//
+// [dorch] Scans the whole script in every mode asked for and records each
+// scan. This runs on a worker thread, so it must not touch anything but the
+// script, which only it uses until it's done, and mustn't use FString. The
+// script's text was already prepared by PrepareText.
+//
+//==========================================================================
+
+void FScanner::Pretokenize (PRETOKENIZEDSCRIPT_s &script)
+{
+	FPretokenScanner sc;
+	const char *base = script.Text.GetChars();
+
+	sc.ScriptEndPtr = base + script.Text.Len();
+	sc.String = sc.StringBuffer;
+	sc.StringBuffer[0] = '\0';
+	sc.Escape = true;
+
+	for (int mode = 0; mode < NUM_PRETOKEN_MODES; ++mode)
+	{
+		if (!(script.lModes & (1 << mode)))
+		{
+			continue;
+		}
+
+		std::vector<PRETOKEN_s> &list = script.Tokens[mode];
+		bool include = false;
+
+		sc.ScriptPtr = base;
+		sc.Line = 1;
+		sc.End = false;
+		sc.CMode = (mode == PRETOKEN_CSTRINGS);
+
+		try
+		{
+			for (;;)
+			{
+				const char *start = sc.ScriptPtr;
+				const int line = sc.Line;
+				PRETOKEN_s token;
+
+				sc.TokenType = PRETOKEN_NOTYPE;
+				token.bFound = sc.ScanString (mode == PRETOKEN_TOKENS);
+				if (sc.End)
+				{
+					break;
+				}
+
+				token.lStart = int(start - base);
+				token.lEnd = int(sc.ScriptPtr - base);
+				token.lLines = sc.Line - line;
+				token.lTokenType = sc.TokenType;
+				token.bEscapes = memchr (start, '\\', sc.ScriptPtr - start) != NULL;
+				token.lText = int(script.TextPool.size());
+				token.lTextLength = token.bFound ? sc.StringLen : 0;
+				if (token.bFound)
+				{
+					script.TextPool.insert (script.TextPool.end(), sc.String, sc.String + sc.StringLen);
+				}
+				list.push_back (token);
+
+				// Remember what the script includes, so that the lumps can
+				// be tokenized while this one is parsed.
+				if (token.bFound)
+				{
+					if (include)
+					{
+						script.Includes.push_back (std::string(sc.String, sc.StringLen));
+						include = false;
+					}
+					else if (mode == PRETOKEN_TOKENS)
+					{
+						include = (sc.TokenType == TK_Include);
+					}
+					else
+					{
+						include = (stricmp (sc.String, "#include") == 0 || stricmp (sc.String, "include") == 0);
+					}
+				}
+			}
+		}
+		catch (CRecoverableError &)
+		{
+			// The rest is scanned by the parser.
+		}
+	}
+}
+
 //==========================================================================
 //
 // FScanner :: GetString
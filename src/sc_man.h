@@ -1,6 +1,8 @@
 #ifndef __SC_MAN_H__
 #define __SC_MAN_H__
 
+struct PRETOKENIZEDSCRIPT_s;
+
 class FScanner
 {
 public:
@@ -66,6 +68,11 @@ public:
 	// [AK] Gets the enumeration of the parsed string by searching through a string table, using the given "GetValueFrom" function.
 	int MustGetEnumName(const char *EnumName, const char *FlagPrefix, int (*GetValueFromName) (const char *Name), const bool StringAlreadyParse = false);
 
+	// [dorch] Scans a script on a worker thread and records the results, so
+	// that the parser can reuse them. See sc_thread.cpp.
+	static void Pretokenize(PRETOKENIZEDSCRIPT_s &script);
+	static void PrepareText(FString &text);
+
 	// Members ------------------------------------------------------
 	char *String;
 	int StringLen;
@@ -83,6 +90,9 @@ protected:
 	void PrepareScript();
 	void CheckOpen();
 	bool ScanString(bool tokens);
+	bool ReplayToken(bool tokens, bool &found);
+	void StartTiming();
+	void ReleaseLump();
 
 	// Strings longer than this minus one will be dynamically allocated.
 	static const int MAX_STRING_SIZE = 128;
@@ -100,6 +110,9 @@ protected:
 	int LastGotLine;
 	bool CMode;
 	bool Escape;
+
+	// [dorch] The lump's tokens, if they were scanned ahead of time.
+	PRETOKENIZEDSCRIPT_s *Pretokenized;
 };
 
 enum
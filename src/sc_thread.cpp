@@ -0,0 +1,550 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Zandronum Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+//
+// Filename: sc_thread.cpp
+//
+// Description: Worker threads that tokenize script lumps while the parsers
+// are still busy with earlier ones, and the time spent parsing each kind of
+// script lump.
+//
+// The parsers themselves stay on the main thread, since what they define
+// depends on the order of the lumps. Only FScanner's scanning is done ahead
+// of time, and the parser reuses a scan whenever it starts at the same place
+// in the same mode as one of the workers' scans.
+//
+//-----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "sc_thread.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "i_system.h"
+#include "p_acs.h"
+#include "sc_man.h"
+#include "templates.h"
+#include "w_wad.h"
+
+//*****************************************************************************
+//	DEFINES
+
+// Until a worker has tokenized a script, it's assumed to take this many
+// bytes per byte of text for each mode. The tokens and their text usually
+// take three to five.
+#define	PRETOKENIZE_BYTES_PER_MODE	4
+
+enum
+{
+	PRETOKENIZE_QUEUED,
+	PRETOKENIZE_WORKING,
+	PRETOKENIZE_DONE,
+};
+
+//*****************************************************************************
+//	STRUCTURES
+
+struct DEFERREDLUMP_s
+{
+	int		lLump;
+	int		lModes;
+};
+
+struct PARSETIME_s
+{
+	FString	Name;
+	double	dMS;
+	int		lLumps;
+	int		lBytes;
+};
+
+//*****************************************************************************
+//	VARIABLES
+
+// [dorch] Number of threads that tokenize script lumps at startup. 1 does
+// everything on the main thread, 0 uses one thread per CPU.
+CUSTOM_CVAR( Int, sc_threads, 0, CVAR_ARCHIVE|CVAR_GLOBALCONFIG )
+{
+	if ( self < 0 )
+		self = 0;
+	else if ( self > MAX_SCAN_THREADS )
+		self = MAX_SCAN_THREADS;
+}
+
+// [dorch] How many MB the scripts that were tokenized ahead of time may
+// take before the rest of the lumps wait for the parsers to catch up.
+CUSTOM_CVAR( Int, sc_queuemb, 64, CVAR_ARCHIVE|CVAR_GLOBALCONFIG )
+{
+	if ( self < 1 )
+		self = 1;
+}
+
+QWORD	g_qwReplayedTokens = 0;
+QWORD	g_qwRescannedTokens = 0;
+
+// The lump families that are tokenized at startup, in the order they're
+// parsed, and the modes their parsers scan them in.
+static	const struct
+{
+	const char	*pszLumpName;
+	int			lModes;
+} g_StartupLumps[] =
+{
+	{ "LANGUAGE",	PRETOKENF_CSTRINGS },
+	{ "SNDINFO",	PRETOKENF_STRINGS },
+	{ "MAPINFO",	PRETOKENF_STRINGS|PRETOKENF_CSTRINGS },
+	{ "ZMAPINFO",	PRETOKENF_STRINGS|PRETOKENF_CSTRINGS },
+	{ "TEXTURES",	PRETOKENF_STRINGS|PRETOKENF_CSTRINGS },
+	{ "ANIMDEFS",	PRETOKENF_STRINGS },
+	{ "DECORATE",	PRETOKENF_TOKENS|PRETOKENF_STRINGS },
+};
+
+static	std::vector<std::thread>					g_ScanWorkers;
+static	std::mutex									g_ScanMutex;
+static	std::condition_variable						g_ScanQueued;
+static	std::condition_variable						g_ScanDone;
+static	bool										g_bScanWorkersQuit = false;
+static	bool										g_bScanShutdownRegistered = false;
+
+// Scripts that no worker has started on yet. Guarded by g_ScanMutex, as is
+// the state of every script.
+static	std::deque<PRETOKENIZEDSCRIPT_s *>			g_ScanQueue;
+
+// Memory taken by the queued scripts, from when they're queued until the
+// parser is done with them. Guarded by g_ScanMutex.
+static	size_t										g_ulQueuedBytes = 0;
+
+// Scripts that haven't been opened by a parser yet, every lump that has
+// been queued, and the lumps that wait for the queued ones to fit in
+// sc_queuemb. Only used by the main thread.
+static	std::map<int, PRETOKENIZEDSCRIPT_s *>		g_PretokenizedScripts;
+static	std::set<int>								g_PretokenizedLumps;
+static	std::deque<DEFERREDLUMP_s>					g_DeferredLumps;
+
+static	std::vector<PARSETIME_s>					g_ParseTimes;
+
+//*****************************************************************************
+//	FUNCTIONS
+
+static int sc_GetScanThreadCount( void )
+{
+	int lCount = *sc_threads;
+
+	if ( lCount <= 0 )
+		lCount = std::thread::hardware_concurrency( );
+
+	return clamp<int>( lCount, 1, MAX_SCAN_THREADS );
+}
+
+//*****************************************************************************
+//
+static void sc_ScanWorkerThread( void )
+{
+	std::unique_lock<std::mutex> lock( g_ScanMutex );
+
+	while ( true )
+	{
+		g_ScanQueued.wait( lock, [] { return g_bScanWorkersQuit || ( g_ScanQueue.empty( ) == false ); } );
+		if ( g_bScanWorkersQuit )
+			break;
+
+		PRETOKENIZEDSCRIPT_s *pScript = g_ScanQueue.front( );
+		g_ScanQueue.pop_front( );
+		pScript->lState = PRETOKENIZE_WORKING;
+		lock.unlock( );
+
+		FScanner::Pretokenize( *pScript );
+
+		size_t ulBytes = pScript->Text.Len( ) + pScript->TextPool.capacity( );
+		for ( unsigned int i = 0; i < NUM_PRETOKEN_MODES; i++ )
+			ulBytes += pScript->Tokens[i].capacity( ) * sizeof( PRETOKEN_s );
+
+		// Replace the estimate with what the script really takes.
+		lock.lock( );
+		g_ulQueuedBytes = g_ulQueuedBytes - pScript->ulBytes + ulBytes;
+		pScript->ulBytes = ulBytes;
+		pScript->lState = PRETOKENIZE_DONE;
+		g_ScanDone.notify_all( );
+	}
+}
+
+//*****************************************************************************
+//
+static void sc_StartScanThreads( void )
+{
+	if ( g_ScanWorkers.empty( ) == false )
+		return;
+
+	if ( g_bScanShutdownRegistered == false )
+	{
+		atterm( SC_FinishPretokenizing );
+		g_bScanShutdownRegistered = true;
+	}
+
+	// The main thread is busy parsing, so it doesn't count.
+	const int lCount = MAX( sc_GetScanThreadCount( ) - 1, 1 );
+
+	for ( int i = 0; i < lCount; i++ )
+		g_ScanWorkers.push_back( std::thread( sc_ScanWorkerThread ));
+}
+
+//*****************************************************************************
+//
+static size_t sc_EstimateBytes( int lLump, int lModes )
+{
+	int lNumModes = 0;
+
+	for ( unsigned int i = 0; i < NUM_PRETOKEN_MODES; i++ )
+	{
+		if ( lModes & ( 1 << i ))
+			lNumModes++;
+	}
+
+	return ( static_cast<size_t>( Wads.LumpLength( lLump ) + 1 ) * ( 1 + PRETOKENIZE_BYTES_PER_MODE * lNumModes ));
+}
+
+//*****************************************************************************
+//
+// A lump that takes more than sc_queuemb by itself is still queued when
+// nothing else is.
+//
+static bool sc_QueueHasRoom( size_t ulBytes )
+{
+	std::lock_guard<std::mutex> lock( g_ScanMutex );
+	return (( g_ulQueuedBytes == 0 ) || ( g_ulQueuedBytes + ulBytes <= ( static_cast<size_t>( *sc_queuemb ) << 20 )));
+}
+
+//*****************************************************************************
+//
+static void sc_StartLump( int lLump, int lModes )
+{
+	PRETOKENIZEDSCRIPT_s *pScript = new PRETOKENIZEDSCRIPT_s;
+	pScript->lLump = lLump;
+	pScript->lModes = lModes;
+	pScript->lState = PRETOKENIZE_QUEUED;
+	for ( unsigned int i = 0; i < NUM_PRETOKEN_MODES; i++ )
+		pScript->ulNextToken[i] = 0;
+
+	// Reading lumps isn't thread safe, and neither is FString, so that's
+	// done here.
+	{
+		FMemLump mem = Wads.ReadLump( lLump );
+		pScript->Text = mem.GetString( );
+	}
+	FScanner::PrepareText( pScript->Text );
+	pScript->ulBytes = sc_EstimateBytes( lLump, lModes );
+
+	g_PretokenizedScripts[lLump] = pScript;
+
+	{
+		std::lock_guard<std::mutex> lock( g_ScanMutex );
+		g_ulQueuedBytes += pScript->ulBytes;
+		g_ScanQueue.push_back( pScript );
+	}
+	g_ScanQueued.notify_one( );
+}
+
+//*****************************************************************************
+//
+// Queues the lump, unless it doesn't fit in sc_queuemb with the queued ones.
+// The lump then waits at the given place in g_DeferredLumps (the end if it's
+// negative) and true is returned.
+//
+static bool sc_QueueLump( int lLump, int lModes, int lDeferAt = -1 )
+{
+	if (( lLump < 0 ) || ( g_PretokenizedLumps.insert( lLump ).second == false ))
+		return ( false );
+
+	if ( sc_QueueHasRoom( sc_EstimateBytes( lLump, lModes )) == false )
+	{
+		DEFERREDLUMP_s deferred;
+		deferred.lLump = lLump;
+		deferred.lModes = lModes;
+
+		if ( lDeferAt < 0 )
+			g_DeferredLumps.push_back( deferred );
+		else
+			g_DeferredLumps.insert( g_DeferredLumps.begin( ) + lDeferAt, deferred );
+		return ( true );
+	}
+
+	sc_StartLump( lLump, lModes );
+	return ( false );
+}
+
+//*****************************************************************************
+//
+static void sc_QueueDeferredLumps( void )
+{
+	while ( g_DeferredLumps.empty( ) == false )
+	{
+		const DEFERREDLUMP_s deferred = g_DeferredLumps.front( );
+
+		if ( sc_QueueHasRoom( sc_EstimateBytes( deferred.lLump, deferred.lModes )) == false )
+			break;
+
+		g_DeferredLumps.pop_front( );
+		sc_StartLump( deferred.lLump, deferred.lModes );
+	}
+}
+
+//*****************************************************************************
+//
+// Queues every lump of the startup families for the worker threads.
+//
+void SC_PretokenizeStartupLumps( void )
+{
+	for ( unsigned int i = 0; i < countof( g_StartupLumps ); i++ )
+		SC_PretokenizeLumps( g_StartupLumps[i].pszLumpName, g_StartupLumps[i].lModes );
+}
+
+//*****************************************************************************
+//
+// Queues every lump with the given name to be tokenized in the given modes
+// (PRETOKENF_* flags). Does nothing if sc_threads is 1.
+//
+void SC_PretokenizeLumps( const char *pszLumpName, int lModes )
+{
+	if ( sc_GetScanThreadCount( ) <= 1 )
+		return;
+
+	sc_StartScanThreads( );
+
+	int lLastLump = 0;
+	int lLump;
+
+	while (( lLump = Wads.FindLump( pszLumpName, &lLastLump )) != -1 )
+		sc_QueueLump( lLump, lModes );
+}
+
+//*****************************************************************************
+//
+// Called by FScanner when it opens a lump. Returns the lump's script, which
+// the caller gives back with SC_ReleasePretokenizedScript, or NULL if the
+// lump wasn't queued. Waits for the worker that is tokenizing it, if there
+// is one.
+//
+PRETOKENIZEDSCRIPT_s *SC_TakePretokenizedScript( int lLump )
+{
+	if ( g_PretokenizedScripts.empty( ) && g_DeferredLumps.empty( ))
+		return ( NULL );
+
+	std::map<int, PRETOKENIZEDSCRIPT_s *>::iterator it = g_PretokenizedScripts.find( lLump );
+	if ( it == g_PretokenizedScripts.end( ))
+	{
+		// If the lump is still waiting, the parser gets to it first.
+		for ( std::deque<DEFERREDLUMP_s>::iterator deferred = g_DeferredLumps.begin( ); deferred != g_DeferredLumps.end( ); ++deferred )
+		{
+			if ( deferred->lLump == lLump )
+			{
+				g_DeferredLumps.erase( deferred );
+				break;
+			}
+		}
+		return ( NULL );
+	}
+
+	PRETOKENIZEDSCRIPT_s *pScript = it->second;
+	g_PretokenizedScripts.erase( it );
+
+	{
+		std::unique_lock<std::mutex> lock( g_ScanMutex );
+
+		// No worker got to it yet, so the parser scans it itself.
+		if ( pScript->lState == PRETOKENIZE_QUEUED )
+		{
+			g_ScanQueue.erase( std::find( g_ScanQueue.begin( ), g_ScanQueue.end( ), pScript ));
+			pScript->lState = PRETOKENIZE_DONE;
+		}
+		else
+			g_ScanDone.wait( lock, [pScript] { return pScript->lState == PRETOKENIZE_DONE; } );
+	}
+
+	// The workers can go on with the lumps this one includes while it's
+	// being parsed. If they have to wait, they still go before the lumps
+	// that were waiting already, since they're parsed first.
+	int lDeferAt = 0;
+	for ( unsigned int i = 0; i < pScript->Includes.size( ); i++ )
+	{
+		if ( sc_QueueLump( Wads.CheckNumForFullName( pScript->Includes[i].c_str( ), true ), pScript->lModes, lDeferAt ))
+			lDeferAt++;
+	}
+
+	return ( pScript );
+}
+
+//*****************************************************************************
+//
+// Called by FScanner when it's done with a script it took. Frees it, and
+// queues the lumps that were waiting for the memory.
+//
+void SC_ReleasePretokenizedScript( PRETOKENIZEDSCRIPT_s *pScript )
+{
+	if ( pScript == NULL )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock( g_ScanMutex );
+		g_ulQueuedBytes -= MIN( pScript->ulBytes, g_ulQueuedBytes );
+	}
+	delete pScript;
+
+	sc_QueueDeferredLumps( );
+}
+
+//*****************************************************************************
+//
+// Stops the worker threads and frees the scripts no parser opened.
+//
+void SC_FinishPretokenizing( void )
+{
+	{
+		std::lock_guard<std::mutex> lock( g_ScanMutex );
+		g_bScanWorkersQuit = true;
+	}
+	g_ScanQueued.notify_all( );
+
+	for ( unsigned int i = 0; i < g_ScanWorkers.size( ); i++ )
+		g_ScanWorkers[i].join( );
+
+	g_ScanWorkers.clear( );
+	g_bScanWorkersQuit = false;
+	g_ScanQueue.clear( );
+
+	for ( std::map<int, PRETOKENIZEDSCRIPT_s *>::iterator it = g_PretokenizedScripts.begin( ); it != g_PretokenizedScripts.end( ); ++it )
+		delete it->second;
+
+	g_PretokenizedScripts.clear( );
+	g_PretokenizedLumps.clear( );
+	g_DeferredLumps.clear( );
+	g_ulQueuedBytes = 0;
+}
+
+//*****************************************************************************
+//
+double SC_GetTimeMS( void )
+{
+	return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ).time_since_epoch( )).count( );
+}
+
+//*****************************************************************************
+//
+// Adds to the time spent on one kind of script lump. Lumps that are
+// included by another one count for the kind of the one that included them.
+//
+void SC_AddParseTime( const char *pszName, double dMS, int lLumps, int lBytes )
+{
+	unsigned int ulIdx;
+
+	for ( ulIdx = 0; ulIdx < g_ParseTimes.size( ); ulIdx++ )
+	{
+		if ( g_ParseTimes[ulIdx].Name.CompareNoCase( pszName ) == 0 )
+			break;
+	}
+
+	if ( ulIdx == g_ParseTimes.size( ))
+	{
+		PARSETIME_s parseTime;
+		parseTime.Name = pszName;
+		parseTime.dMS = 0;
+		parseTime.lLumps = 0;
+		parseTime.lBytes = 0;
+		g_ParseTimes.push_back( parseTime );
+	}
+
+	g_ParseTimes[ulIdx].dMS += dMS;
+	g_ParseTimes[ulIdx].lLumps += lLumps;
+	g_ParseTimes[ulIdx].lBytes += lBytes;
+}
+
+//*****************************************************************************
+//
+void SC_PrintParseTimes( void )
+{
+	std::vector<PARSETIME_s> parseTimes = g_ParseTimes;
+	double dTotalMS = 0;
+
+	std::sort( parseTimes.begin( ), parseTimes.end( ), [] ( const PARSETIME_s &a, const PARSETIME_s &b ) { return a.dMS > b.dMS; } );
+
+	Printf( "Script parse times:\n" );
+	for ( unsigned int i = 0; i < parseTimes.size( ); i++ )
+	{
+		Printf( "  %-10s %9.2f ms %5d lump%s %7d KB\n", parseTimes[i].Name.GetChars( ), parseTimes[i].dMS,
+			parseTimes[i].lLumps, ( parseTimes[i].lLumps == 1 ) ? " " : "s", parseTimes[i].lBytes / 1024 );
+		dTotalMS += parseTimes[i].dMS;
+	}
+	Printf( "  %-10s %9.2f ms\n", "Total", dTotalMS );
+
+	const QWORD qwScans = g_qwReplayedTokens + g_qwRescannedTokens;
+	Printf( "%llu of %llu scans were done ahead of time (%d scan thread%s).\n",
+		static_cast<unsigned long long>( g_qwReplayedTokens ), static_cast<unsigned long long>( qwScans ),
+		sc_GetScanThreadCount( ), ( sc_GetScanThreadCount( ) == 1 ) ? "" : "s" );
+}
+
+//*****************************************************************************
+//	CONSOLE COMMANDS
+
+// [dorch] Prints how long each kind of script lump took to parse.
+// Usage: parsetimes [reset]
+CCMD( parsetimes )
+{
+	// [AK] This function may not be used by ConsoleCommand.
+	if ( ACS_IsCalledFromConsoleCommand( ))
+		return;
+
+	if (( argv.argc( ) > 1 ) && ( stricmp( argv[1], "reset" ) == 0 ))
+	{
+		g_ParseTimes.clear( );
+		g_qwReplayedTokens = 0;
+		g_qwRescannedTokens = 0;
+		return;
+	}
+
+	SC_PrintParseTimes( );
+}
@@ -0,0 +1,161 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Zandronum Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+//
+// Filename: sc_thread.h
+//
+// Description: Worker threads that tokenize script lumps while the parsers
+// are still busy with earlier ones, and the time spent parsing each kind of
+// script lump.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __SC_THREAD_H__
+#define __SC_THREAD_H__
+
+#include <string>
+#include <vector>
+#include "doomtype.h"
+#include "zstring.h"
+
+//*****************************************************************************
+//	DEFINES
+
+enum
+{
+	// Upper limit for sc_threads.
+	MAX_SCAN_THREADS = 16,
+
+	// TokenType of a scan that didn't change it.
+	PRETOKEN_NOTYPE = -1,
+};
+
+// The ways a script can be tokenized ahead of time. They match what
+// FScanner::ScanString does for GetToken, for GetString and for GetString in
+// C mode.
+enum PRETOKENMODE_e
+{
+	PRETOKEN_TOKENS,
+	PRETOKEN_STRINGS,
+	PRETOKEN_CSTRINGS,
+
+	NUM_PRETOKEN_MODES
+};
+
+#define	PRETOKENF_TOKENS		( 1 << PRETOKEN_TOKENS )
+#define	PRETOKENF_STRINGS		( 1 << PRETOKEN_STRINGS )
+#define	PRETOKENF_CSTRINGS		( 1 << PRETOKEN_CSTRINGS )
+
+//*****************************************************************************
+//	STRUCTURES
+
+// The outcome of one FScanner::ScanString call, recorded on a worker thread.
+struct PRETOKEN_s
+{
+	// Offsets of the script pointer before and after the scan.
+	int		lStart;
+	int		lEnd;
+
+	// Where the token's text is in the script's text pool.
+	int		lText;
+	int		lTextLength;
+
+	// Number of lines the scan went past.
+	int		lLines;
+
+	// TokenType after the scan, or PRETOKEN_NOTYPE.
+	int		lTokenType;
+
+	// What ScanString returned.
+	bool	bFound;
+
+	// The scanned text has a backslash in it. Quoted strings depend on
+	// FScanner::Escape then, so these are scanned again by the parser.
+	bool	bEscapes;
+};
+
+struct PRETOKENIZEDSCRIPT_s
+{
+	int							lLump;
+	int							lModes;
+	int							lState;
+
+	// The lump's text, prepared by FScanner::PrepareText before the script
+	// is queued. The worker only reads it.
+	FString						Text;
+
+	// The tokens for each mode, sorted by their start offset, and the next
+	// one the parser is expected to ask for.
+	std::vector<PRETOKEN_s>		Tokens[NUM_PRETOKEN_MODES];
+	unsigned int				ulNextToken[NUM_PRETOKEN_MODES];
+	std::vector<char>			TextPool;
+
+	// Memory the script takes, counted against sc_queuemb.
+	size_t						ulBytes;
+
+	// Names of the lumps this one includes. These aren't FStrings, since
+	// the worker thread fills them in.
+	std::vector<std::string>	Includes;
+};
+
+//*****************************************************************************
+//	PROTOTYPES
+
+void	SC_PretokenizeStartupLumps( void );
+void	SC_PretokenizeLumps( const char *pszLumpName, int lModes );
+PRETOKENIZEDSCRIPT_s	*SC_TakePretokenizedScript( int lLump );
+void	SC_ReleasePretokenizedScript( PRETOKENIZEDSCRIPT_s *pScript );
+void	SC_FinishPretokenizing( void );
+
+double	SC_GetTimeMS( void );
+void	SC_AddParseTime( const char *pszName, double dMS, int lLumps, int lBytes );
+void	SC_PrintParseTimes( void );
+
+//*****************************************************************************
+//	EXTERNAL VARIABLES
+
+// Number of scans that were taken from a worker thread, and of scans the
+// parser had to do itself on a pretokenized script.
+extern	QWORD	g_qwReplayedTokens;
+extern	QWORD	g_qwRescannedTokens;
+
+#endif // __SC_THREAD_H__
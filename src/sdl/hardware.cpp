@@ -44,6 +44,7 @@
 #include "c_cvars.h"
 #include "c_dispatch.h"
 #include "sdlvideo.h"
+#include "headlessvideo.h"
 #include "v_text.h"
 #include "doomstat.h"
 #include "m_argv.h"
@@ -124,6 +125,14 @@ void I_InitGraphics ()
 	val.Bool = !!Args->CheckParm ("-devparm");
 	ticker.SetGenericRepDefault (val, CVAR_Bool);
 
+	// [dorch] The headless backend only supports the software renderer.
+	if (HEADLESS_IsEnabled())
+	{
+		currentrenderer = 0;
+		Video = new HeadlessVideo ();
+	}
+	else
+	{
 #ifndef NO_GL
 	//currentrenderer = vid_renderer;
 	if (currentrenderer==1) Video = new SDLGLVideo(0);
@@ -131,6 +140,7 @@ void I_InitGraphics ()
 #else
 	Video = new SDLVideo (0);
 #endif
+	}
 	if (Video == NULL)
 		I_FatalError ("Failed to initialize display");
 
@@ -146,7 +156,7 @@ static void I_DeleteRenderer()
 
 void I_CreateRenderer()
 {
-	currentrenderer = vid_renderer;
+	currentrenderer = HEADLESS_IsEnabled() ? 0 : *vid_renderer;
 	if (Renderer == NULL)
 	{
 #ifndef NO_GL
@@ -0,0 +1,687 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Zandronum Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: headlessvideo.cpp
+//
+// Description: Offscreen video backend for the software renderer. When started with
+// -headless, the game renders into a plain memory canvas and every frame is converted
+// to raw RGB24 or YUV420p and written to a pipe/file (-frameout) or to a shared memory
+// ring (-frameshm), so no window, X server or screen grabber is needed to get video
+// out of a client. Frames are emitted at -framerate frames per second, either paced
+// against the real clock or, with -fixedtimestep, by advancing a virtual clock one
+// frame at a time, which lets demos be converted to video faster than real time.
+//
+//-----------------------------------------------------------------------------
+
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "doomtype.h"
+#include "doomdef.h"
+#include "templates.h"
+#include "i_system.h"
+#include "i_video.h"
+#include "m_argv.h"
+#include "stats.h"
+#include "v_palette.h"
+#include "headlessvideo.h"
+
+//*****************************************************************************
+//	DEFINES
+
+class HeadlessFB : public DFrameBuffer
+{
+	DECLARE_CLASS(HeadlessFB, DFrameBuffer)
+public:
+	HeadlessFB (int width, int height);
+	~HeadlessFB ();
+
+	bool Lock (bool buffer);
+	void Unlock ();
+	bool Relock ();
+	bool IsValid ();
+	void Update ();
+	PalEntry *GetPalette ();
+	void GetFlashedPalette (PalEntry pal[256]);
+	void UpdatePalette ();
+	bool SetGamma (float gamma);
+	bool SetFlash (PalEntry rgb, int amount);
+	void GetFlash (PalEntry &rgb, int &amount);
+	int GetPageCount ();
+	bool IsFullscreen ();
+
+private:
+	PalEntry SourcePalette[256];
+	BYTE GammaTable[3][256];
+	PalEntry Flash;
+	int FlashAmount;
+	float Gamma;
+	bool UpdatePending;
+
+	bool NeedPalUpdate;
+	bool NeedGammaUpdate;
+
+	// Final colors of the current frame, and the same in YCbCr.
+	PalEntry Colors[256];
+	BYTE ColorY[256];
+	BYTE ColorU[256];
+	BYTE ColorV[256];
+
+	void UpdateColors ();
+	void ConvertFrame (BYTE *dest);
+
+	HeadlessFB () {}
+};
+IMPLEMENT_CLASS(HeadlessFB)
+
+//*****************************************************************************
+//	VARIABLES
+
+EXTERN_CVAR (Float, rgamma)
+EXTERN_CVAR (Float, ggamma)
+EXTERN_CVAR (Float, bgamma)
+EXTERN_CVAR (Int, vid_defwidth)
+EXTERN_CVAR (Int, vid_defheight)
+
+static	HEADLESSFORMAT_e		headless_Format = HEADLESSFORMAT_RGB24;
+static	int						headless_FrameRate = TICRATE;
+
+// Pipe or file that receives the frames, if any.
+static	FILE					*headless_pOutFile = NULL;
+
+// Shared memory ring that receives the frames, if any.
+static	FString					headless_ShmName;
+static	HEADLESSSHMHEADER_s		*headless_pShm = NULL;
+static	size_t					headless_ShmSize = 0;
+
+// Scratch buffer the frame is converted into before it's written to the pipe.
+static	std::vector<BYTE>		headless_FrameData;
+
+// When the next frame is due on the real clock.
+static	std::chrono::steady_clock::time_point	headless_NextFrameTime;
+static	bool					headless_bNextFrameTimeValid = false;
+
+static	cycle_t					headless_ConvertCycles;
+static	cycle_t					headless_WriteCycles;
+
+//*****************************************************************************
+//	PROTOTYPES
+
+static	size_t	headless_GetFrameSize( int iWidth, int iHeight );
+static	void	headless_OpenShm( int iWidth, int iHeight );
+static	void	headless_CloseShm( void );
+static	int		headless_GetFramesDue( void );
+static	void	headless_WriteFrame( const BYTE *pbFrame, size_t FrameSize, int iCopies );
+
+//*****************************************************************************
+//	FUNCTIONS
+
+bool HEADLESS_IsEnabled( void )
+{
+	return ( Args->CheckParm( "-headless" ) != 0 );
+}
+
+//*****************************************************************************
+//
+static size_t headless_GetFrameSize( int iWidth, int iHeight )
+{
+	if ( headless_Format == HEADLESSFORMAT_YUV420P )
+		return ( iWidth * iHeight ) + 2 * ((( iWidth + 1 ) / 2 ) * (( iHeight + 1 ) / 2 ));
+
+	return iWidth * iHeight * 3;
+}
+
+//*****************************************************************************
+//
+static void headless_OpenShm( int iWidth, int iHeight )
+{
+	const size_t	HeaderSize = ( sizeof( HEADLESSSHMHEADER_s ) + 63 ) & ~(size_t)63;
+	const size_t	SlotSize = ( headless_GetFrameSize( iWidth, iHeight ) + 63 ) & ~(size_t)63;
+
+	headless_CloseShm( );
+	headless_ShmSize = HeaderSize + SlotSize * HEADLESSSHM_SLOTS;
+
+	const int fd = shm_open( headless_ShmName.GetChars( ), O_CREAT | O_RDWR, 0600 );
+	if ( fd == -1 )
+		I_FatalError( "Could not open shared memory %s: %s", headless_ShmName.GetChars( ), strerror( errno ));
+
+	if ( ftruncate( fd, headless_ShmSize ) == -1 )
+	{
+		close( fd );
+		I_FatalError( "Could not resize shared memory %s: %s", headless_ShmName.GetChars( ), strerror( errno ));
+	}
+
+	void *pMemory = mmap( NULL, headless_ShmSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+	close( fd );
+	if ( pMemory == MAP_FAILED )
+		I_FatalError( "Could not map shared memory %s: %s", headless_ShmName.GetChars( ), strerror( errno ));
+
+	// Clear the magic first, so that readers never see a half initialized header.
+	headless_pShm = static_cast<HEADLESSSHMHEADER_s *>( pMemory );
+	headless_pShm->ulMagic = 0;
+	__atomic_thread_fence( __ATOMIC_SEQ_CST );
+
+	headless_pShm->ulVersion = HEADLESSSHM_VERSION;
+	headless_pShm->ulWidth = iWidth;
+	headless_pShm->ulHeight = iHeight;
+	headless_pShm->ulFormat = headless_Format;
+	headless_pShm->ulFrameRate = headless_FrameRate;
+	headless_pShm->ulSlotCount = HEADLESSSHM_SLOTS;
+	headless_pShm->ulSlotSize = static_cast<DWORD>( SlotSize );
+	headless_pShm->ulHeaderSize = static_cast<DWORD>( HeaderSize );
+	headless_pShm->ulPadding = 0;
+	__atomic_store_n( &headless_pShm->qwFramesWritten, 0, __ATOMIC_RELEASE );
+	__atomic_store_n( &headless_pShm->ulMagic, HEADLESSSHM_MAGIC, __ATOMIC_RELEASE );
+}
+
+//*****************************************************************************
+//
+static void headless_CloseShm( void )
+{
+	if ( headless_pShm == NULL )
+		return;
+
+	munmap( headless_pShm, headless_ShmSize );
+	headless_pShm = NULL;
+	headless_ShmSize = 0;
+}
+
+//*****************************************************************************
+//
+// Returns how many times the current frame has to be emitted. With the fixed
+// timestep this is always once and the virtual clock is advanced by one frame.
+// Otherwise, this waits until the frame is due on the real clock. If the renderer
+// fell behind, the frame is repeated to fill the gap, so that the consumer sees a
+// constant frame rate just like it would when grabbing the screen.
+//
+static int headless_GetFramesDue( void )
+{
+	if ( I_IsFixedTimeStep( ))
+	{
+		I_AdvanceFixedTime( 1000000 / headless_FrameRate );
+		return 1;
+	}
+
+	const std::chrono::steady_clock::duration	FrameTime = std::chrono::microseconds( 1000000 / headless_FrameRate );
+	const std::chrono::steady_clock::time_point	Now = std::chrono::steady_clock::now( );
+
+	if ( headless_bNextFrameTimeValid == false )
+	{
+		headless_NextFrameTime = Now + FrameTime;
+		headless_bNextFrameTimeValid = true;
+		return 1;
+	}
+
+	if ( Now < headless_NextFrameTime )
+		std::this_thread::sleep_until( headless_NextFrameTime );
+
+	int iFrames = 1;
+	while ( Now >= headless_NextFrameTime + FrameTime )
+	{
+		headless_NextFrameTime += FrameTime;
+		iFrames++;
+
+		// Don't try to make up for a long stall (e.g. loading a map).
+		if ( iFrames > headless_FrameRate )
+		{
+			headless_NextFrameTime = Now;
+			break;
+		}
+	}
+
+	headless_NextFrameTime += FrameTime;
+	return iFrames;
+}
+
+//*****************************************************************************
+//
+static void headless_WriteFrame( const BYTE *pbFrame, size_t FrameSize, int iCopies )
+{
+	for ( int i = 0; i < iCopies; i++ )
+	{
+		if ( headless_pOutFile != NULL )
+		{
+			if ( fwrite( pbFrame, FrameSize, 1, headless_pOutFile ) != 1 )
+				I_FatalError( "Could not write frame: %s", strerror( errno ));
+		}
+
+		if ( headless_pShm != NULL )
+		{
+			const QWORD qwFrame = __atomic_load_n( &headless_pShm->qwFramesWritten, __ATOMIC_RELAXED );
+			BYTE *pbSlot = reinterpret_cast<BYTE *>( headless_pShm ) + headless_pShm->ulHeaderSize
+				+ ( qwFrame % headless_pShm->ulSlotCount ) * headless_pShm->ulSlotSize;
+
+			memcpy( pbSlot, pbFrame, FrameSize );
+			__atomic_store_n( &headless_pShm->qwFramesWritten, qwFrame + 1, __ATOMIC_RELEASE );
+		}
+	}
+
+	if ( headless_pOutFile != NULL )
+		fflush( headless_pOutFile );
+}
+
+// Video implementation -----------------------------------------------------
+
+HeadlessVideo::HeadlessVideo ()
+{
+	const char *pszValue;
+
+	// Use the same size V_Init picked, there is no display to choose a mode from.
+	ModeWidth = ModeHeight = 0;
+	if (( pszValue = Args->CheckValue( "-width" )))
+		ModeWidth = atoi( pszValue );
+	if (( pszValue = Args->CheckValue( "-height" )))
+		ModeHeight = atoi( pszValue );
+
+	if ( ModeWidth == 0 )
+	{
+		if ( ModeHeight == 0 )
+		{
+			ModeWidth = vid_defwidth;
+			ModeHeight = vid_defheight;
+		}
+		else
+			ModeWidth = ( ModeHeight * 8 ) / 6;
+	}
+	else if ( ModeHeight == 0 )
+		ModeHeight = ( ModeWidth * 6 ) / 8;
+
+	IteratorDone = true;
+
+	if (( pszValue = Args->CheckValue( "-frameformat" )))
+	{
+		if ( stricmp( pszValue, "yuv420p" ) == 0 )
+			headless_Format = HEADLESSFORMAT_YUV420P;
+		else if ( stricmp( pszValue, "rgb24" ) == 0 )
+			headless_Format = HEADLESSFORMAT_RGB24;
+		else
+			I_FatalError( "Unknown frame format \"%s\", use rgb24 or yuv420p", pszValue );
+	}
+
+	if (( pszValue = Args->CheckValue( "-framerate" )))
+		headless_FrameRate = clamp( atoi( pszValue ), 1, 1000 );
+
+	if (( pszValue = Args->CheckValue( "-frameout" )))
+	{
+		// Report a closed pipe as a write error instead of being killed by it.
+		signal( SIGPIPE, SIG_IGN );
+
+		if ( strcmp( pszValue, "-" ) == 0 )
+		{
+			// Everything printed to stdout would end up between the frames, so move
+			// stdout to stderr and keep the original descriptor for the frames.
+			const int fd = dup( STDOUT_FILENO );
+			fflush( stdout );
+			dup2( STDERR_FILENO, STDOUT_FILENO );
+			headless_pOutFile = ( fd != -1 ) ? fdopen( fd, "wb" ) : NULL;
+		}
+		else
+			headless_pOutFile = fopen( pszValue, "wb" );
+
+		if ( headless_pOutFile == NULL )
+			I_FatalError( "Could not open frame output %s: %s", pszValue, strerror( errno ));
+	}
+
+	if (( pszValue = Args->CheckValue( "-frameshm" )))
+	{
+		headless_ShmName = pszValue;
+		if ( headless_ShmName[0] != '/' )
+			headless_ShmName.Insert( 0, "/" );
+	}
+
+	if ( Args->CheckParm( "-fixedtimestep" ))
+		I_EnableFixedTimeStep( );
+
+	Printf( "Headless video: %dx%d %s at %d fps%s\n", ModeWidth, ModeHeight,
+		( headless_Format == HEADLESSFORMAT_YUV420P ) ? "yuv420p" : "rgb24", headless_FrameRate,
+		I_IsFixedTimeStep( ) ? ", fixed timestep" : "" );
+}
+
+HeadlessVideo::~HeadlessVideo ()
+{
+	headless_CloseShm( );
+	if ( headless_ShmName.IsNotEmpty( ))
+		shm_unlink( headless_ShmName.GetChars( ));
+
+	if ( headless_pOutFile != NULL )
+	{
+		fclose( headless_pOutFile );
+		headless_pOutFile = NULL;
+	}
+}
+
+void HeadlessVideo::StartModeIterator (int bits, bool fs)
+{
+	IteratorDone = ( bits != 8 );
+}
+
+bool HeadlessVideo::NextMode (int *width, int *height, bool *letterbox)
+{
+	if (IteratorDone)
+		return false;
+
+	*width = ModeWidth;
+	*height = ModeHeight;
+	if (letterbox != NULL)
+		*letterbox = false;
+	IteratorDone = true;
+	return true;
+}
+
+DFrameBuffer *HeadlessVideo::CreateFrameBuffer (int width, int height, bool fullscreen, DFrameBuffer *old)
+{
+	PalEntry flashColor;
+	int flashAmount;
+
+	if (old != NULL)
+	{ // Reuse the old framebuffer if its attributes are the same
+		if (old->GetWidth() == width && old->GetHeight() == height)
+		{
+			return old;
+		}
+		old->GetFlash (flashColor, flashAmount);
+		old->ObjectFlags |= OF_YesReallyDelete;
+		if (screen == old) screen = NULL;
+		delete old;
+	}
+	else
+	{
+		flashColor = 0;
+		flashAmount = 0;
+	}
+
+	HeadlessFB *fb = new HeadlessFB (width, height);
+	if (!fb->IsValid ())
+		I_FatalError ("Could not create new screen (%d x %d)", width, height);
+
+	fb->SetFlash (flashColor, flashAmount);
+	return fb;
+}
+
+void HeadlessVideo::SetWindowedScale (float scale)
+{
+}
+
+// FrameBuffer implementation -----------------------------------------------
+
+HeadlessFB::HeadlessFB (int width, int height)
+	: DFrameBuffer (width, height)
+{
+	NeedPalUpdate = false;
+	NeedGammaUpdate = false;
+	UpdatePending = false;
+	FlashAmount = 0;
+	Gamma = 1.f;
+
+	for (int i = 0; i < 256; i++)
+	{
+		GammaTable[0][i] = GammaTable[1][i] = GammaTable[2][i] = i;
+	}
+	memcpy (SourcePalette, GPalette.BaseColors, sizeof(PalEntry)*256);
+	UpdateColors ();
+
+	headless_FrameData.resize (headless_GetFrameSize (width, height));
+	if (headless_ShmName.IsNotEmpty ())
+	{
+		headless_OpenShm (width, height);
+	}
+}
+
+HeadlessFB::~HeadlessFB ()
+{
+}
+
+bool HeadlessFB::IsValid ()
+{
+	return DFrameBuffer::IsValid();
+}
+
+int HeadlessFB::GetPageCount ()
+{
+	return 1;
+}
+
+bool HeadlessFB::Lock (bool buffered)
+{
+	return DSimpleCanvas::Lock ();
+}
+
+bool HeadlessFB::Relock ()
+{
+	return DSimpleCanvas::Lock ();
+}
+
+void HeadlessFB::Unlock ()
+{
+	if (UpdatePending && LockCount == 1)
+	{
+		Update ();
+	}
+	else if (--LockCount <= 0)
+	{
+		Buffer = NULL;
+		LockCount = 0;
+	}
+}
+
+void HeadlessFB::Update ()
+{
+	if (LockCount != 1)
+	{
+		if (LockCount > 0)
+		{
+			UpdatePending = true;
+			--LockCount;
+		}
+		return;
+	}
+
+	DrawRateStuff ();
+
+	Buffer = NULL;
+	LockCount = 0;
+	UpdatePending = false;
+
+	const int frames = headless_GetFramesDue ();
+
+	headless_ConvertCycles.Reset();
+	headless_ConvertCycles.Clock();
+	ConvertFrame (&headless_FrameData[0]);
+	headless_ConvertCycles.Unclock();
+
+	headless_WriteCycles.Reset();
+	headless_WriteCycles.Clock();
+	headless_WriteFrame (&headless_FrameData[0], headless_FrameData.size(), frames);
+	headless_WriteCycles.Unclock();
+
+	if (NeedGammaUpdate)
+	{
+		NeedGammaUpdate = false;
+		CalcGamma ((rgamma == 0.f) ? Gamma : (Gamma * rgamma), GammaTable[0]);
+		CalcGamma ((ggamma == 0.f) ? Gamma : (Gamma * ggamma), GammaTable[1]);
+		CalcGamma ((bgamma == 0.f) ? Gamma : (Gamma * bgamma), GammaTable[2]);
+		NeedPalUpdate = true;
+	}
+
+	if (NeedPalUpdate)
+	{
+		NeedPalUpdate = false;
+		UpdateColors ();
+	}
+}
+
+void HeadlessFB::ConvertFrame (BYTE *dest)
+{
+	if (headless_Format == HEADLESSFORMAT_RGB24)
+	{
+		for (int y = 0; y < Height; ++y)
+		{
+			const BYTE *src = MemBuffer + y*Pitch;
+			for (int x = 0; x < Width; ++x)
+			{
+				const PalEntry color = Colors[src[x]];
+				dest[0] = color.r;
+				dest[1] = color.g;
+				dest[2] = color.b;
+				dest += 3;
+			}
+		}
+		return;
+	}
+
+	// YUV420p: the full resolution luma plane, followed by the U and V planes
+	// averaged over 2x2 blocks.
+	const int chromaWidth = (Width + 1) / 2;
+	const int chromaHeight = (Height + 1) / 2;
+	BYTE *destU = dest + Width*Height;
+	BYTE *destV = destU + chromaWidth*chromaHeight;
+
+	for (int y = 0; y < Height; ++y)
+	{
+		const BYTE *src = MemBuffer + y*Pitch;
+		for (int x = 0; x < Width; ++x)
+		{
+			dest[x] = ColorY[src[x]];
+		}
+		dest += Width;
+	}
+
+	for (int y = 0; y < chromaHeight; ++y)
+	{
+		const BYTE *src0 = MemBuffer + (y*2)*Pitch;
+		const BYTE *src1 = MemBuffer + MIN(y*2 + 1, Height - 1)*Pitch;
+		for (int x = 0; x < chromaWidth; ++x)
+		{
+			const int x0 = x*2;
+			const int x1 = MIN(x0 + 1, Width - 1);
+			destU[x] = (ColorU[src0[x0]] + ColorU[src0[x1]] + ColorU[src1[x0]] + ColorU[src1[x1]] + 2) >> 2;
+			destV[x] = (ColorV[src0[x0]] + ColorV[src0[x1]] + ColorV[src1[x0]] + ColorV[src1[x1]] + 2) >> 2;
+		}
+		destU += chromaWidth;
+		destV += chromaWidth;
+	}
+}
+
+void HeadlessFB::UpdateColors ()
+{
+	for (int i = 0; i < 256; ++i)
+	{
+		Colors[i].r = GammaTable[0][SourcePalette[i].r];
+		Colors[i].g = GammaTable[1][SourcePalette[i].g];
+		Colors[i].b = GammaTable[2][SourcePalette[i].b];
+		Colors[i].a = 255;
+	}
+	if (FlashAmount)
+	{
+		DoBlending (Colors, Colors,
+			256, GammaTable[0][Flash.r], GammaTable[1][Flash.g], GammaTable[2][Flash.b],
+			FlashAmount);
+	}
+
+	// BT.601, limited range, which is what encoders assume for untagged yuv420p.
+	for (int i = 0; i < 256; ++i)
+	{
+		const int r = Colors[i].r, g = Colors[i].g, b = Colors[i].b;
+		ColorY[i] = (( 66*r + 129*g +  25*b + 128) >> 8) + 16;
+		ColorU[i] = ((-38*r -  74*g + 112*b + 128) >> 8) + 128;
+		ColorV[i] = ((112*r -  94*g -  18*b + 128) >> 8) + 128;
+	}
+}
+
+PalEntry *HeadlessFB::GetPalette ()
+{
+	return SourcePalette;
+}
+
+void HeadlessFB::UpdatePalette ()
+{
+	NeedPalUpdate = true;
+}
+
+bool HeadlessFB::SetGamma (float gamma)
+{
+	Gamma = gamma;
+	NeedGammaUpdate = true;
+	return true;
+}
+
+bool HeadlessFB::SetFlash (PalEntry rgb, int amount)
+{
+	Flash = rgb;
+	FlashAmount = amount;
+	NeedPalUpdate = true;
+	return true;
+}
+
+void HeadlessFB::GetFlash (PalEntry &rgb, int &amount)
+{
+	rgb = Flash;
+	amount = FlashAmount;
+}
+
+void HeadlessFB::GetFlashedPalette (PalEntry pal[256])
+{
+	memcpy (pal, SourcePalette, 256*sizeof(PalEntry));
+	if (FlashAmount)
+	{
+		DoBlending (pal, pal, 256, Flash.r, Flash.g, Flash.b, FlashAmount);
+	}
+}
+
+bool HeadlessFB::IsFullscreen ()
+{
+	return false;
+}
+
+ADD_STAT (headless)
+{
+	FString out;
+	out.Format ("convert=%04.1f ms  write=%04.1f ms",
+		headless_ConvertCycles.TimeMS(), headless_WriteCycles.TimeMS());
+	return out;
+}
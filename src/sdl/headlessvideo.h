@@ -0,0 +1,119 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Zandronum Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: headlessvideo.h
+//
+// Description: Offscreen video backend for the software renderer that writes raw
+// frames to a pipe or a shared memory ring instead of opening a window.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __HEADLESSVIDEO_H__
+#define __HEADLESSVIDEO_H__
+
+#include "hardware.h"
+#include "v_video.h"
+
+//*****************************************************************************
+//	DEFINES
+
+// [dorch] Layout of the shared memory ring created with -frameshm. The header is
+// followed by HEADLESSSHM_SLOTS slots of SlotSize bytes each. The writer fills slot
+// ( qwFramesWritten % ulSlotCount ) and only then increments qwFramesWritten, so a
+// reader that sees the counter change can copy the previous slot and re-check the
+// counter afterwards to detect if it was lapped.
+#define	HEADLESSSHM_MAGIC		0x4D52465A	// "ZFRM" in little endian
+#define	HEADLESSSHM_VERSION		1
+#define	HEADLESSSHM_SLOTS		8
+
+enum HEADLESSFORMAT_e
+{
+	HEADLESSFORMAT_RGB24,
+	HEADLESSFORMAT_YUV420P,
+};
+
+//*****************************************************************************
+typedef struct
+{
+	DWORD			ulMagic;
+	DWORD			ulVersion;
+	DWORD			ulWidth;
+	DWORD			ulHeight;
+	DWORD			ulFormat;
+	DWORD			ulFrameRate;
+	DWORD			ulSlotCount;
+	DWORD			ulSlotSize;
+	DWORD			ulHeaderSize;
+	DWORD			ulPadding;
+
+	// Number of frames completely written so far.
+	volatile QWORD	qwFramesWritten;
+
+} HEADLESSSHMHEADER_s;
+
+//*****************************************************************************
+class HeadlessVideo : public IVideo
+{
+ public:
+	HeadlessVideo ();
+	~HeadlessVideo ();
+
+	EDisplayType GetDisplayType () { return DISPLAY_WindowOnly; }
+	void SetWindowedScale (float scale);
+
+	DFrameBuffer *CreateFrameBuffer (int width, int height, bool fs, DFrameBuffer *old);
+
+	void StartModeIterator (int bits, bool fs);
+	bool NextMode (int *width, int *height, bool *letterbox);
+
+private:
+	int ModeWidth;
+	int ModeHeight;
+	bool IteratorDone;
+};
+
+//*****************************************************************************
+//	PROTOTYPES
+
+bool	HEADLESS_IsEnabled( void );
+
+#endif	// __HEADLESSVIDEO_H__
@@ -294,6 +294,12 @@ int main (int argc, char **argv)
 	}
 	else
 	{
+		// [dorch] The headless renderer never opens a window, but SDL's event and
+		// input handling still need a video driver. Use the dummy one, so that no
+		// X server is required.
+		if ( Args->CheckParm( "-headless" ))
+			setenv( "SDL_VIDEODRIVER", "dummy", 1 );
+
 		if (SDL_Init (SDL_INIT_VIDEO|SDL_INIT_TIMER|SDL_INIT_NOPARACHUTE|SDL_INIT_JOYSTICK) == -1)
 		{
 			fprintf (stderr, "Could not initialize SDL:\n%s\n", SDL_GetError());
@@ -145,6 +145,12 @@ static DWORD TicStart;
 static DWORD BaseTime;
 static int TicFrozen;
 
+// [dorch] Virtual clock used by the headless renderer. While enabled, time only
+// advances when a frame is emitted or a tic is waited for, so the game can run
+// faster than real time while still producing frames at a fixed rate.
+static bool FixedTimeStep;
+static QWORD FixedTimeUS;
+
 // Signal based timer.
 static Semaphore timerWait;
 static int tics;
@@ -152,17 +158,26 @@ static DWORD sig_start;
 
 void I_SelectTimer();
 
+// [dorch] Returns either the real or the virtual time in milliseconds.
+static DWORD I_GetTicks (void)
+{
+	if (FixedTimeStep)
+		return (DWORD)(FixedTimeUS / 1000);
+
+	return SDL_GetTicks ();
+}
+
 // [RH] Returns time in milliseconds
 unsigned int I_MSTime (void)
 {
-	unsigned int time = SDL_GetTicks ();
+	unsigned int time = I_GetTicks ();
 	return time - BaseTime;
 }
 
 // Exactly the same thing, but based does no modification to the time.
 unsigned int I_FPSTime()
 {
-	return SDL_GetTicks();
+	return I_GetTicks();
 }
 
 //
@@ -182,7 +197,7 @@ int I_GetTimePolled (bool saveMS)
 		return TicFrozen;
 	}
 
-	DWORD tm = SDL_GetTicks();
+	DWORD tm = I_GetTicks();
 
 	if (saveMS)
 	{
@@ -196,6 +211,23 @@ int I_GetTimePolled (bool saveMS)
 	return Scale(tm - BaseTime, TICRATE, 1000);
 }
 
+// [dorch] Instead of spinning until the next tic arrives, jump the virtual
+// clock to its start.
+int I_WaitForTicFixed (int prevtic)
+{
+	int time;
+
+	assert (TicFrozen == 0);
+	if ((time = I_GetTimePolled(false)) <= prevtic)
+	{
+		const QWORD ticStartMS = BaseTime + ((QWORD)(prevtic + 1) * 1000 + TICRATE - 1) / TICRATE;
+		FixedTimeUS = MAX<QWORD> (FixedTimeUS, ticStartMS * 1000);
+		time = I_GetTimePolled(false);
+	}
+
+	return time;
+}
+
 int I_GetTimeSignaled (bool saveMS)
 {
 	if (saveMS)
@@ -312,7 +344,7 @@ void I_SelectTimer()
 // Returns the fractional amount of a tic passed since the most recent tic
 fixed_t I_GetTimeFrac (uint32 *ms)
 {
-	DWORD now = SDL_GetTicks ();
+	DWORD now = I_GetTicks ();
 	if (ms) *ms = TicStart + (1000 / TICRATE);
 	if (TicStart == 0)
 	{
@@ -329,9 +361,43 @@ void I_WaitVBL (int count)
 {
     // I_WaitVBL is never used to actually synchronize to the
     // vertical blank. Instead, it's used for delay purposes.
+	if (FixedTimeStep)
+	{
+		I_AdvanceFixedTime (1000000 * count / 70);
+		return;
+	}
     usleep (1000000 * count / 70);
 }
 
+//
+// [dorch] I_EnableFixedTimeStep
+// Switches to the virtual clock. It starts at the current real time so that
+// nothing that already sampled the clock sees it jump backwards.
+//
+void I_EnableFixedTimeStep (void)
+{
+	if (FixedTimeStep)
+		return;
+
+	FixedTimeUS = (QWORD)SDL_GetTicks () * 1000;
+	FixedTimeStep = true;
+
+	// The signal based timer runs off the real clock, so use the polled one.
+	I_GetTime = I_GetTimePolled;
+	I_FreezeTime = I_FreezeTimePolled;
+	I_WaitForTic = I_WaitForTicFixed;
+}
+
+bool I_IsFixedTimeStep (void)
+{
+	return FixedTimeStep;
+}
+
+void I_AdvanceFixedTime (unsigned int us)
+{
+	FixedTimeUS += us;
+}
+
 //
 // SetLanguageIDs
 //
@@ -64,6 +64,13 @@ extern void (*I_FreezeTime) (bool frozen);
 
 fixed_t I_GetTimeFrac (uint32 *ms);
 
+// [dorch] Replaces the real clock with one that only advances through
+// I_AdvanceFixedTime() and I_WaitForTic(). Used by the headless renderer to
+// produce frames at a fixed timestep, faster than real time.
+void I_EnableFixedTimeStep (void);
+bool I_IsFixedTimeStep (void);
+void I_AdvanceFixedTime (unsigned int us);
+
 // Return a seed value for the RNG.
 unsigned int I_MakeRNGSeed();
 
@@ -49,6 +49,7 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <chrono>
 
 #include "c_dispatch.h"
 #include "doomstat.h"
@@ -251,7 +252,7 @@ bool SERVERBAN_IsIPMasterBanned( const NETADDRESS_s &Address )
 
 //*****************************************************************************
 //
-IPADDRESSBAN_s *SERVERBAN_GetBanInformation( const IPStringArray &Address )
+const IPADDRESSBAN_s *SERVERBAN_GetBanInformation( const IPStringArray &Address )
 {
 	// [AK] Find an entry comment in one of the ban files that corresponds
 	// to the player's IP address, and include it with the ban reason.
@@ -268,7 +269,7 @@ IPADDRESSBAN_s *SERVERBAN_GetBanInformation( const IPStringArray &Address )
 
 //*****************************************************************************
 //
-IPADDRESSBAN_s *SERVERBAN_GetBanInformation( const NETADDRESS_s &Address )
+const IPADDRESSBAN_s *SERVERBAN_GetBanInformation( const NETADDRESS_s &Address )
 {
 	IPStringArray convertedAddress;
 	convertedAddress.SetFrom( Address );
@@ -629,7 +630,7 @@ static void serverban_KickBannedPlayers( void )
 
 		if ( SERVERBAN_IsIPBanned( SERVER_GetClient( i )->Address ))
 		{
-			IPADDRESSBAN_s *entry = SERVERBAN_GetBanInformation( SERVER_GetClient( i )->Address );
+			const IPADDRESSBAN_s *entry = SERVERBAN_GetBanInformation( SERVER_GetClient( i )->Address );
 			FString reason = "IP is now banned";
 
 			// [AK] Find an entry comment that corresponds to the player's IP
@@ -952,3 +953,117 @@ CCMD( reloadbans )
 
 	serverban_LoadBansAndBanExemptions( );
 }
+
+//*****************************************************************************
+//
+// [dorch] Fills a ban list with random entries and times looking addresses up
+// in it, compared to going through all entries.
+// Usage: sv_benchbanlist [entries] [lookups]
+CCMD( sv_benchbanlist )
+{
+	// This function may not be used by ConsoleCommand.
+	if ( ACS_IsCalledFromConsoleCommand( ))
+		return;
+
+	const unsigned int numEntries = ( argv.argc( ) > 1 ) ? clamp( atoi( argv[1] ), 1, 10000000 ) : 100000;
+	const unsigned int numLookups = ( argv.argc( ) > 2 ) ? clamp( atoi( argv[2] ), 1, 10000000 ) : 100000;
+	DWORD seed = 1;
+	IPList list;
+
+	// Most entries are single addresses, some have wildcards for the last
+	// octets, a few anywhere.
+	for ( unsigned int i = 0; i < numEntries; i++ )
+	{
+		IPADDRESSBAN_s entry;
+		char szAddress[32];
+		int octets[4];
+
+		for ( int j = 0; j < 4; j++ )
+		{
+			seed = seed * 1664525 + 1013904223;
+			octets[j] = ( seed >> 8 ) & 255;
+		}
+
+		seed = seed * 1664525 + 1013904223;
+		switch (( seed >> 8 ) % 10 )
+		{
+		case 0:
+			mysnprintf( szAddress, sizeof( szAddress ), "%d.%d.*.*", octets[0], octets[1] );
+			break;
+		case 1:
+			mysnprintf( szAddress, sizeof( szAddress ), "%d.*.%d.%d", octets[0], octets[2], octets[3] );
+			break;
+		case 2:
+		case 3:
+			mysnprintf( szAddress, sizeof( szAddress ), "%d.%d.%d.*", octets[0], octets[1], octets[2] );
+			break;
+		default:
+			mysnprintf( szAddress, sizeof( szAddress ), "%d.%d.%d.%d", octets[0], octets[1], octets[2], octets[3] );
+			break;
+		}
+
+		entry.szIP.SetFromString( szAddress );
+		entry.szComment[0] = '\0';
+		entry.tExpirationDate = 0;
+		list.push_back( entry );
+	}
+
+	// Look up random addresses, and the addresses of some entries so that
+	// there are hits too.
+	const std::vector<IPADDRESSBAN_s> &entries = list.getVector( );
+	TArray<NETADDRESS_s> addresses;
+	for ( unsigned int i = 0; i < numLookups; i++ )
+	{
+		NETADDRESS_s address;
+		seed = seed * 1664525 + 1013904223;
+
+		if ( seed & 0x100 )
+		{
+			const IPStringArray &ip = entries[( seed >> 9 ) % numEntries].szIP;
+			for ( int j = 0; j < 4; j++ )
+				address.abIP[j] = ( ip[j][0] == '*' ) ? static_cast<BYTE>( seed >> ( 8 + j * 2 )) : static_cast<BYTE>( atoi( ip[j] ));
+		}
+		else
+		{
+			for ( int j = 0; j < 4; j++ )
+				address.abIP[j] = static_cast<BYTE>( seed >> ( 8 + j * 5 ));
+		}
+		addresses.Push( address );
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+	list.getFirstMatchingEntryIndex( addresses[0] );
+	const double dBuildMS = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( );
+
+	unsigned int ulHits = 0;
+	start = std::chrono::steady_clock::now( );
+	for ( unsigned int i = 0; i < numLookups; i++ )
+		ulHits += ( list.getFirstMatchingEntryIndex( addresses[i] ) != list.size( ));
+	const double dMatcherMS = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( );
+
+	// Going through every entry is slow, so only a few lookups are done.
+	const unsigned int numSlowLookups = MAX( numLookups / 100, 1u );
+	unsigned int ulMismatches = 0;
+	start = std::chrono::steady_clock::now( );
+	for ( unsigned int i = 0; i < numSlowLookups; i++ )
+	{
+		IPStringArray ip;
+		ULONG ulIdx;
+
+		ip.SetFrom( addresses[i] );
+		for ( ulIdx = 0; ulIdx < entries.size( ); ulIdx++ )
+		{
+			if ( ip.Matches( entries[ulIdx].szIP ))
+				break;
+		}
+
+		ulMismatches += ( ulIdx != list.getFirstMatchingEntryIndex( addresses[i] ));
+	}
+	const double dLinearMS = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now( ) - start ).count( );
+
+	Printf( "%u entries, building the matcher took %.1f ms.\n", numEntries, dBuildMS );
+	Printf( "Matcher: %.3f us per lookup (%u lookups, %u hits)\n", dMatcherMS * 1000 / numLookups, numLookups, ulHits );
+	Printf( "All entries: %.3f us per lookup (%u lookups)\n", dLinearMS * 1000 / numSlowLookups, numSlowLookups );
+	if ( ulMismatches > 0 )
+		Printf( TEXTCOLOR_RED "%u lookups found different entries!" TEXTCOLOR_NORMAL "\n", ulMismatches );
+}
@@ -62,8 +62,8 @@ bool			SERVERBAN_IsIPBanned( const IPStringArray &Address );
 bool			SERVERBAN_IsIPBanned( const NETADDRESS_s &Address );
 bool			SERVERBAN_IsIPMasterBanned( const IPStringArray &Address );
 bool			SERVERBAN_IsIPMasterBanned( const NETADDRESS_s &Address );
-IPADDRESSBAN_s	*SERVERBAN_GetBanInformation( const IPStringArray &Address );
-IPADDRESSBAN_s	*SERVERBAN_GetBanInformation( const NETADDRESS_s &Address );
+const IPADDRESSBAN_s	*SERVERBAN_GetBanInformation( const IPStringArray &Address );
+const IPADDRESSBAN_s	*SERVERBAN_GetBanInformation( const NETADDRESS_s &Address );
 void			SERVERBAN_ClearBans( unsigned int fileIndex );
 void			SERVERBAN_ReadMasterServerBans( BYTESTREAM_s *pByteStream );
 void			SERVERBAN_ReadMasterServerBanlistPart( BYTESTREAM_s *pByteStream );
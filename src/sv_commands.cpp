@@ -66,6 +66,7 @@
 #include "sbar.h"
 #include "sv_commands.h"
 #include "sv_main.h"
+#include "sv_demo.h"
 #include "team.h"
 #include "survival.h"
 #include "vectors.h"
@@ -87,6 +88,12 @@
 #include "d_netinf.h"
 #include "callvote.h"
 
+//*****************************************************************************
+//	DEFINES
+
+// [dorch] How much further than sv_maxproximityrolloffdist voice is still sent.
+#define	VOICE_RANGE_MARGIN	256.0
+
 CVAR (Bool, sv_showwarnings, false, CVAR_GLOBALCONFIG|CVAR_ARCHIVE)
 
 EXTERN_CVAR( Float, sv_aircontrol )
@@ -258,7 +265,7 @@ void SERVERCOMMANDS_Nothing( ULONG ulPlayer, bool bReliable )
 //
 void SERVERCOMMANDS_BeginSnapshot( ULONG ulPlayer )
 {
-	if ( SERVER_IsValidClient( ulPlayer ) == false )
+	if (( SERVER_IsValidClient( ulPlayer ) == false ) && ( SERVERDEMO_IsRecorderClient( ulPlayer ) == false ))
 		return;
 
 	ServerCommands::BeginSnapshot().sendCommandToClients( ulPlayer, SVCF_ONLYTHISCLIENT );
@@ -268,7 +275,7 @@ void SERVERCOMMANDS_BeginSnapshot( ULONG ulPlayer )
 //
 void SERVERCOMMANDS_EndSnapshot( ULONG ulPlayer )
 {
-	if ( SERVER_IsValidClient( ulPlayer ) == false )
+	if (( SERVER_IsValidClient( ulPlayer ) == false ) && ( SERVERDEMO_IsRecorderClient( ulPlayer ) == false ))
 		return;
 
 	ServerCommands::EndSnapshot().sendCommandToClients( ulPlayer, SVCF_ONLYTHISCLIENT );
@@ -1093,7 +1100,7 @@ void SERVERCOMMANDS_DisconnectPlayer( ULONG ulPlayer, ULONG ulPlayerExtra, Serve
 //
 void SERVERCOMMANDS_SetConsolePlayer( ULONG ulPlayer )
 {
-	if ( SERVER_IsValidClient( ulPlayer ) == false )
+	if (( SERVER_IsValidClient( ulPlayer ) == false ) && ( SERVERDEMO_IsRecorderClient( ulPlayer ) == false ))
 		return;
 
 	ServerCommands::SetConsolePlayer command;
@@ -1281,6 +1288,47 @@ void SERVERCOMMANDS_PrivateSay( ULONG ulSender, ULONG ulReceiver, const char *ps
 	}
 }
 
+//*****************************************************************************
+//
+// [dorch] Checks if a client is too far away from a player to hear them with
+// proximity chat. Clients listen from the eyes of whoever they're spying on.
+//
+static bool servercommands_IsOutOfVoiceRange( ULONG speaker, ULONG listener )
+{
+	if (( sv_proximityvoicechat == false ) || ( gamestate != GS_LEVEL ))
+		return false;
+
+	// [dorch] Spectators' voices aren't played in 3D, so everybody hears them.
+	const AActor *pSpeaker = players[speaker].mo;
+	if (( players[speaker].bSpectating ) || ( pSpeaker == NULL ))
+		return false;
+
+	// [dorch] Whoever watches the demo can spy on anybody.
+	if ( SERVERDEMO_IsRecorderSlot( listener ))
+		return false;
+
+	const ULONG ulDisplayPlayer = SERVER_GetClient( listener )->ulDisplayPlayer;
+	const AActor *pListener = players[listener].camera;
+
+	if (( ulDisplayPlayer != listener ) && ( PLAYER_IsValidPlayer( ulDisplayPlayer )))
+		pListener = players[ulDisplayPlayer].mo;
+	if ( pListener == NULL )
+		pListener = players[listener].mo;
+
+	// [dorch] Players being spied on are played in 2D.
+	if (( pListener == NULL ) || ( pListener == pSpeaker ))
+		return false;
+
+	// [dorch] Leave some room for chasecams and for the positions the client
+	// sees lagging behind ours.
+	const double dRange = sv_maxproximityrolloffdist + VOICE_RANGE_MARGIN;
+	const double dX = FIXED2DBL( pSpeaker->x ) - FIXED2DBL( pListener->x );
+	const double dY = FIXED2DBL( pSpeaker->y ) - FIXED2DBL( pListener->y );
+	const double dZ = FIXED2DBL( pSpeaker->z ) - FIXED2DBL( pListener->z );
+
+	return ( dX * dX + dY * dY + dZ * dZ > dRange * dRange );
+}
+
 //*****************************************************************************
 //
 void SERVERCOMMANDS_PlayerVoIPAudioPacket( ULONG player, unsigned int frame, unsigned char *data, unsigned int length, ULONG playerExtra, ServerCommandFlags flags )
@@ -1292,12 +1340,20 @@ void SERVERCOMMANDS_PlayerVoIPAudioPacket( ULONG player, unsigned int frame, uns
 	const bool forbidVoiceChatToPlayers = GAMEMODE_IsClientForbiddenToChatToPlayers( player, true );
 	const int transmitFilter = players[player].userinfo.GetVoiceTransmitFilter( );
 
+	const NETADDRESS_s address = SERVER_GetClient( player )->Address;
+
 	BufferParameter audio( data, length );
 	ServerCommands::PlayerVoIPAudioPacket command;
 	command.SetPlayerNumber( player );
 	command.SetFrame( frame );
 	command.SetAudio( audio );
 
+	// [dorch] Build the packet only once instead of once for every client. It's
+	// unreliable, so it's sent along with the other unreliable commands at the
+	// end of the tic.
+	NetCommand netCommand = command.BuildNetCommand( );
+	const unsigned int size = netCommand.calcSize( );
+
 	for ( ClientIterator it( playerExtra, flags ); it.notAtEnd( ); ++it )
 	{
 		// [AK] Don't broadcast to the same player that sent the VoIP packet,
@@ -1331,10 +1387,18 @@ void SERVERCOMMANDS_PlayerVoIPAudioPacket( ULONG player, unsigned int frame, uns
 		}
 
 		// [AK] Don't broadcast to anyone that ignored this player's voice.
-		if ( SERVER_GetPlayerIgnoreTic( *it, SERVER_GetClient( player )->Address, true ) != 0 )
+		if ( SERVER_GetPlayerIgnoreTic( *it, address, true ) != 0 )
 			continue;
 
-		command.sendCommandToClients( *it, SVCF_ONLYTHISCLIENT );
+		// [dorch] ...or that muted it, or is too far away to hear it.
+		if (( SERVER_GetVoIPChannelVolume( *it, address ) <= 0.0f ) || ( servercommands_IsOutOfVoiceRange( player, *it )))
+		{
+			SERVER_GetClient( *it )->qwVoiceBytesCulled += size;
+			continue;
+		}
+
+		netCommand.sendCommandToOneClient( *it );
+		SERVER_GetClient( *it )->qwVoiceBytesOut += size;
 	}
 }
 
@@ -0,0 +1,565 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Zandronum Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: sv_demo.cpp
+//
+// Description: Records matches on the server as demos that the client can play back.
+// The server reserves a free player slot for the recorder, which is treated like a
+// connected spectator that is allowed to know everything. Everything the server sends
+// to that slot is written to a regular client demo by a background thread, so the
+// game loop never waits on the disk.
+//
+//-----------------------------------------------------------------------------
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+#include "sv_demo.h"
+#include "c_console.h"
+#include "c_dispatch.h"
+#include "cl_demo.h"
+#include "cmdlib.h"
+#include "doomdata.h"
+#include "g_level.h"
+#include "gamemode.h"
+#include "network.h"
+#include "network_enums.h"
+#include "p_local.h"
+#include "sv_commands.h"
+#include "sv_main.h"
+#include "network/netcommand.h"
+#include "network/servercommands.h"
+
+//*****************************************************************************
+//	DEFINES
+
+enum SERVERDEMOSTATE_e
+{
+	// Nothing is being recorded.
+	SDS_IDLE,
+
+	// Recording, but the recorder still needs a snapshot of the current level.
+	SDS_WAITINGFORLEVEL,
+
+	// Recording, the recorder receives everything a connected client would.
+	SDS_ACTIVE,
+};
+
+//*****************************************************************************
+//	VARIABLES
+
+static	SERVERDEMOSTATE_e		g_RecorderState = SDS_IDLE;
+
+// The player slot reserved for the recorder while recording.
+static	ULONG					g_ulRecorderSlot = MAXPLAYERS;
+
+// The network ID of the recorder's body on the client.
+static	unsigned short			g_usRecorderNetID = 0;
+
+// Was this demo started because of sv_recordmatches?
+static	bool					g_bAutomaticRecording = false;
+
+static	FString					g_DemoName;
+
+// Everything recorded during the current tic, which is handed to the writer as one chunk.
+static	std::vector<BYTE>		g_PendingChunk;
+
+// The writer thread and the chunks it still needs to write.
+static	std::thread				g_WriterThread;
+static	std::mutex				g_WriterMutex;
+static	std::condition_variable	g_WriterCondition;
+static	std::deque<std::vector<BYTE>>	g_WriterQueue;
+static	bool					g_bWriterStop = false;
+static	bool					g_bWriteFailed = false;
+
+//*****************************************************************************
+//	PROTOTYPES
+
+static	void	serverdemo_BeginAutomaticRecording( void );
+
+//*****************************************************************************
+//	CONSOLE VARIABLES
+
+// Automatically record every map into its own demo.
+CUSTOM_CVAR( Bool, sv_recordmatches, false, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+{
+	if ( NETWORK_GetState( ) != NETSTATE_SERVER )
+		return;
+
+	// If we're not in a level yet, the recording starts with the next one.
+	if (( self ) && ( SERVERDEMO_IsRecording( ) == false ) && ( gamestate == GS_LEVEL ))
+		serverdemo_BeginAutomaticRecording( );
+	else if (( self == false ) && ( g_bAutomaticRecording ))
+		SERVERDEMO_FinishRecording( );
+}
+
+// Where automatically named server demos are saved.
+CVAR( String, sv_demodir, "", CVAR_ARCHIVE|CVAR_NOSETBYACS )
+
+//*****************************************************************************
+//	FUNCTIONS
+
+static void serverdemo_PatchLength( FILE *pFile, DWORD dwLength )
+{
+	// The length follows the signature and the CLD_DEMOLENGTH byte, see CLIENTDEMO_WriteHeader.
+	const BYTE abLength[4] = { static_cast<BYTE>( dwLength ), static_cast<BYTE>( dwLength >> 8 ),
+		static_cast<BYTE>( dwLength >> 16 ), static_cast<BYTE>( dwLength >> 24 ) };
+
+	fseek( pFile, 5, SEEK_SET );
+	fwrite( abLength, 1, sizeof( abLength ), pFile );
+	fseek( pFile, 0, SEEK_END );
+	fflush( pFile );
+}
+
+//*****************************************************************************
+//
+static void serverdemo_WriterLoop( FILE *pFile )
+{
+	std::deque<std::vector<BYTE>> chunks;
+	std::chrono::steady_clock::time_point lastPatch = std::chrono::steady_clock::now( );
+	DWORD dwLength = 0;
+	bool bStop = false;
+
+	while ( bStop == false )
+	{
+		{
+			std::unique_lock<std::mutex> lock( g_WriterMutex );
+			g_WriterCondition.wait_for( lock, std::chrono::seconds( 1 ), [] { return g_bWriterStop || ( g_WriterQueue.empty( ) == false ); } );
+			chunks.swap( g_WriterQueue );
+			bStop = g_bWriterStop;
+		}
+
+		for ( const std::vector<BYTE> &chunk : chunks )
+		{
+			if ( fwrite( chunk.data( ), 1, chunk.size( ), pFile ) != chunk.size( ))
+				g_bWriteFailed = true;
+
+			dwLength += static_cast<DWORD>( chunk.size( ));
+		}
+
+		chunks.clear( );
+
+		// Keep the length in the header up to date, so that the demo can still
+		// be played back if the server goes down without finishing it.
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now( );
+		if (( bStop ) || ( now - lastPatch >= std::chrono::seconds( 1 )))
+		{
+			serverdemo_PatchLength( pFile, dwLength );
+			lastPatch = now;
+		}
+	}
+
+	fclose( pFile );
+}
+
+//*****************************************************************************
+//
+static void serverdemo_CommitChunk( void )
+{
+	if ( g_PendingChunk.empty( ))
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock( g_WriterMutex );
+		g_WriterQueue.push_back( std::move( g_PendingChunk ));
+	}
+
+	g_WriterCondition.notify_one( );
+	g_PendingChunk.clear( );
+}
+
+//*****************************************************************************
+//
+static void serverdemo_AppendBuffer( NETBUFFER_s &Buffer )
+{
+	g_PendingChunk.insert( g_PendingChunk.end( ), Buffer.pbData, Buffer.ByteStream.pbStream );
+	Buffer.Clear( );
+}
+
+//*****************************************************************************
+//
+static FString serverdemo_GetAutomaticName( void )
+{
+	FString name = *sv_demodir;
+	const size_t dirlen = name.Len( );
+
+	if (( dirlen > 0 ) && ( name[dirlen-1] != '/' ) && ( name[dirlen-1] != '\\' ))
+		name += '/';
+
+	char szTime[32];
+	const time_t now = time( NULL );
+	strftime( szTime, sizeof( szTime ), "%Y-%m-%d_%H-%M-%S", localtime( &now ));
+	name.AppendFormat( "%s_%s.cld", szTime, level.mapname );
+	return name;
+}
+
+//*****************************************************************************
+//
+static void serverdemo_ReleaseNetID( void )
+{
+	if ( g_usRecorderNetID != 0 )
+	{
+		g_ActorNetIDList.freeID( g_usRecorderNetID );
+		g_usRecorderNetID = 0;
+	}
+}
+
+//*****************************************************************************
+//
+static void serverdemo_BeginAutomaticRecording( void )
+{
+	SERVERDEMO_BeginRecording( NULL );
+	g_bAutomaticRecording = SERVERDEMO_IsRecording( );
+}
+
+//*****************************************************************************
+//
+// Tells the recorder everything it needs to know about the current level, just like
+// SERVER_ConnectNewPlayer does for a client that just authenticated the level.
+//
+static void serverdemo_ConnectRecorder( void )
+{
+	const ULONG ulSlot = g_ulRecorderSlot;
+	CLIENT_s *pClient = SERVER_GetClient( ulSlot );
+
+	g_RecorderState = SDS_ACTIVE;
+	pClient->PacketBuffer.Clear( );
+	pClient->UnreliablePacketBuffer.Clear( );
+	pClient->ulDisplayPlayer = ulSlot;
+
+	// The demo starts out like a connection, the client loads the map from this.
+	pClient->PacketBuffer.ByteStream.WriteByte( SVCC_AUTHENTICATE );
+	pClient->PacketBuffer.ByteStream.WriteString( level.mapname );
+	pClient->PacketBuffer.ByteStream.WriteLong( gametic );
+	pClient->PacketBuffer.ByteStream.WriteByte( SVCC_MAPLOAD );
+	pClient->PacketBuffer.ByteStream.WriteByte( GAMEMODE_GetCurrentMode( ));
+
+	SERVERCOMMANDS_BeginSnapshot( ulSlot );
+	SERVERCOMMANDS_SetConsolePlayer( ulSlot );
+	SERVER_SendGameSettings( ulSlot );
+	SERVER_SendGameModeState( ulSlot );
+
+	// The recorder doesn't have a body on the server, so spawn a spectator for it
+	// by hand at the first start spot. The client needs a camera to look through.
+	const FPlayerStart *pStart = ( deathmatchstarts.Size( ) > 0 ) ? &deathmatchstarts[0] : &playerstarts[0];
+	g_usRecorderNetID = g_ActorNetIDList.getNewID( );
+	g_ActorNetIDList.useID( g_usRecorderNetID, NULL );
+
+	ServerCommands::SpawnPlayer command;
+	command.SetPlayer( &players[ulSlot] );
+	command.SetPriorState( PST_ENTER );
+	command.SetIsBot( false );
+	command.SetIsSpectating( true );
+	command.SetIsDeadSpectator( false );
+	command.SetIsMorphed( false );
+	command.SetNetid( g_usRecorderNetID );
+	command.SetAngle( pStart->angle * ( ANGLE_45 / 45 ));
+	command.SetX( pStart->x );
+	command.SetY( pStart->y );
+	command.SetZ( ONFLOORZ );
+	command.SetPlayerClass( 0 );
+	command.SetMorphStyle( 0 );
+	command.SetMorphedClass( NULL );
+	command.sendCommandToClients( ulSlot, SVCF_ONLYTHISCLIENT );
+
+	SERVER_UpdateLines( ulSlot );
+	SERVER_UpdateSides( ulSlot );
+	SERVER_UpdateSectors( ulSlot );
+	SERVER_UpdateMovers( ulSlot );
+	SERVERCOMMANDS_SyncMapRotation( ulSlot, SVCF_ONLYTHISCLIENT );
+	SERVERCOMMANDS_SetNextMapPosition( ulSlot, SVCF_ONLYTHISCLIENT );
+	SERVER_SendFullUpdate( ulSlot );
+	SERVER_SendArtifactCarriers( ulSlot );
+	SERVERCOMMANDS_EndSnapshot( ulSlot );
+}
+
+//*****************************************************************************
+//
+void SERVERDEMO_Tick( void )
+{
+	if ( g_RecorderState == SDS_IDLE )
+		return;
+
+	if ( g_RecorderState == SDS_WAITINGFORLEVEL )
+	{
+		if ( gamestate != GS_LEVEL )
+			return;
+
+		serverdemo_ConnectRecorder( );
+	}
+
+	// SERVER_WriteCommands only moves players for real clients. The recorder wants
+	// to see everyone move on every tic.
+	if ( gamestate == GS_LEVEL )
+	{
+		for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+		{
+			if (( playeringame[ulIdx] == false ) || ( players[ulIdx].bSpectating ))
+				continue;
+
+			SERVERCOMMANDS_MovePlayer( ulIdx, g_ulRecorderSlot, SVCF_ONLYTHISCLIENT );
+		}
+	}
+
+	SERVERDEMO_FlushClientBuffer( g_ulRecorderSlot, true );
+	SERVERDEMO_FlushClientBuffer( g_ulRecorderSlot, false );
+
+	// Every tic ends with an (empty) ticcmd of the recorder, this is what advances
+	// the playback by one tic.
+	g_PendingChunk.push_back( CLD_TICCMD );
+	g_PendingChunk.insert( g_PendingChunk.end( ), 13, 0 );
+	serverdemo_CommitChunk( );
+}
+
+//*****************************************************************************
+//
+void SERVERDEMO_NewLevel( void )
+{
+	if ( g_RecorderState != SDS_ACTIVE )
+	{
+		// Start recording when the first level is loaded.
+		if (( g_RecorderState == SDS_IDLE ) && ( sv_recordmatches ))
+			serverdemo_BeginAutomaticRecording( );
+
+		return;
+	}
+
+	// Automatic recordings get one demo per level.
+	if ( g_bAutomaticRecording )
+	{
+		SERVERDEMO_FinishRecording( );
+		serverdemo_BeginAutomaticRecording( );
+		return;
+	}
+
+	// Keep whatever was sent on the old level, then wait until we can send a
+	// snapshot of the new one.
+	SERVERDEMO_FlushClientBuffer( g_ulRecorderSlot, true );
+	SERVERDEMO_FlushClientBuffer( g_ulRecorderSlot, false );
+	serverdemo_CommitChunk( );
+	serverdemo_ReleaseNetID( );
+	g_RecorderState = SDS_WAITINGFORLEVEL;
+}
+
+//*****************************************************************************
+//
+void SERVERDEMO_BeginRecording( const char *pszDemoName )
+{
+	if ( g_RecorderState != SDS_IDLE )
+	{
+		Printf( "Already recording \"%s\".\n", g_DemoName.GetChars( ));
+		return;
+	}
+
+	// Use the last free slot, so that the recorder gets in the way of as few
+	// connecting players as possible.
+	ULONG ulSlot = MAXPLAYERS;
+	for ( ULONG ulIdx = MAXPLAYERS; ulIdx-- > 0; )
+	{
+		if (( SERVER_GetClient( ulIdx )->State == CLS_FREE ) && ( playeringame[ulIdx] == false ))
+		{
+			ulSlot = ulIdx;
+			break;
+		}
+	}
+
+	if ( ulSlot == MAXPLAYERS )
+	{
+		Printf( "Can't record a server demo: there are no free player slots.\n" );
+		return;
+	}
+
+	if ( pszDemoName == NULL )
+	{
+		g_DemoName = serverdemo_GetAutomaticName( );
+		CreatePath( ExtractFilePath( g_DemoName ));
+	}
+	else
+	{
+		g_DemoName = pszDemoName;
+		FixPathSeperator( g_DemoName );
+		DefaultExtension( g_DemoName, ".cld" );
+	}
+
+	FILE *pFile = fopen( g_DemoName.GetChars( ), "wb" );
+	if ( pFile == NULL )
+	{
+		Printf( "Can't open \"%s\" for writing.\n", g_DemoName.GetChars( ));
+		return;
+	}
+
+	// Write the same header a client would. The recorder is a spectator with
+	// default settings.
+	NETBUFFER_s Header;
+	Header.Init( MAX_UDP_PACKET * 2, BUFFERTYPE_WRITE );
+	CLIENTDEMO_WriteHeader( &Header.ByteStream );
+	Header.ByteStream.WriteByte( CLD_USERINFO );
+	Header.ByteStream.WriteString( "Server demo" );
+	Header.ByteStream.WriteByte( 0 );
+	Header.ByteStream.WriteByte( -1 );
+	Header.ByteStream.WriteLong( 0 );
+	Header.ByteStream.WriteLong( ANGLE_1 * 35 );
+	Header.ByteStream.WriteString( "base" );
+	Header.ByteStream.WriteLong( 0 );
+	Header.ByteStream.WriteByte( 0 );
+	Header.ByteStream.WriteByte( 1 );
+	Header.ByteStream.WriteByte( 1 );
+	Header.ByteStream.WriteByte( 0 );
+	Header.ByteStream.WriteString( PlayerClasses[0].Type->Meta.GetMetaString( APMETA_DisplayName ));
+	Header.ByteStream.WriteByte( CLD_BODYSTART );
+
+	g_PendingChunk.clear( );
+	serverdemo_AppendBuffer( Header );
+	Header.Free( );
+
+	g_ulRecorderSlot = ulSlot;
+	SERVER_GetClient( ulSlot )->PacketBuffer.Clear( );
+	SERVER_GetClient( ulSlot )->UnreliablePacketBuffer.Clear( );
+	g_bAutomaticRecording = false;
+	g_bWriterStop = false;
+	g_bWriteFailed = false;
+	g_RecorderState = SDS_WAITINGFORLEVEL;
+	serverdemo_CommitChunk( );
+	g_WriterThread = std::thread( serverdemo_WriterLoop, pFile );
+
+	Printf( "Recording server demo \"%s\".\n", g_DemoName.GetChars( ));
+}
+
+//*****************************************************************************
+//
+void SERVERDEMO_FinishRecording( void )
+{
+	if ( g_RecorderState == SDS_IDLE )
+		return;
+
+	if ( g_RecorderState == SDS_ACTIVE )
+	{
+		SERVERDEMO_FlushClientBuffer( g_ulRecorderSlot, true );
+		SERVERDEMO_FlushClientBuffer( g_ulRecorderSlot, false );
+		serverdemo_ReleaseNetID( );
+	}
+
+	g_PendingChunk.push_back( CLD_DEMOEND );
+	serverdemo_CommitChunk( );
+
+	{
+		std::lock_guard<std::mutex> lock( g_WriterMutex );
+		g_bWriterStop = true;
+	}
+
+	g_WriterCondition.notify_one( );
+	g_WriterThread.join( );
+
+	g_RecorderState = SDS_IDLE;
+	g_ulRecorderSlot = MAXPLAYERS;
+	g_bAutomaticRecording = false;
+
+	if ( g_bWriteFailed )
+		Printf( "Error writing server demo \"%s\"!\n", g_DemoName.GetChars( ));
+	else
+		Printf( "Server demo \"%s\" successfully recorded!\n", g_DemoName.GetChars( ));
+}
+
+//*****************************************************************************
+//
+bool SERVERDEMO_IsRecording( void )
+{
+	return ( g_RecorderState != SDS_IDLE );
+}
+
+//*****************************************************************************
+//
+bool SERVERDEMO_IsRecorderSlot( ULONG ulClient )
+{
+	return (( g_RecorderState != SDS_IDLE ) && ( ulClient == g_ulRecorderSlot ));
+}
+
+//*****************************************************************************
+//
+bool SERVERDEMO_IsRecorderClient( ULONG ulClient )
+{
+	return (( g_RecorderState == SDS_ACTIVE ) && ( ulClient == g_ulRecorderSlot ));
+}
+
+//*****************************************************************************
+//
+void SERVERDEMO_FlushClientBuffer( ULONG ulClient, bool bReliable )
+{
+	CLIENT_s *pClient = SERVER_GetClient( ulClient );
+	if ( pClient == NULL )
+		return;
+
+	// The demo doesn't distinguish between reliable and unreliable commands.
+	serverdemo_AppendBuffer( bReliable ? pClient->PacketBuffer : pClient->UnreliablePacketBuffer );
+}
+
+//*****************************************************************************
+//	CONSOLE COMMANDS
+
+CCMD( serverdemo_record )
+{
+	if ( NETWORK_GetState( ) != NETSTATE_SERVER )
+	{
+		Printf( "Only servers can record server demos.\n" );
+		return;
+	}
+
+	SERVERDEMO_BeginRecording(( argv.argc( ) > 1 ) ? argv[1] : NULL );
+}
+
+//*****************************************************************************
+//
+CCMD( serverdemo_stop )
+{
+	if ( SERVERDEMO_IsRecording( ) == false )
+	{
+		Printf( "Not recording a server demo.\n" );
+		return;
+	}
+
+	SERVERDEMO_FinishRecording( );
+}
@@ -120,6 +120,7 @@
 #include "survival.h"
 #include "sv_commands.h"
 #include "sv_save.h"
+#include "sv_demo.h"
 #include "sv_rcon.h"
 #include "gamemode.h"
 #include "domination.h"
@@ -138,6 +139,9 @@
 #include "p_lnspec.h"
 #include "unlagged.h"
 #include "scoreboard.h"
+#include "profiler.h"
+#include "sv_watchdog.h"
+#include "sv_metrics.h"
 
 //*****************************************************************************
 //	MISC CRAP THAT SHOULDN'T BE HERE BUT HAS TO BE BECAUSE OF SLOPPY CODING
@@ -1123,6 +1127,7 @@ void SERVER_Construct( void )
 	SERVER_MASTER_Construct( );
 	SERVER_SAVE_Construct( );
 	SERVER_RCON_Construct( );
+	SERVERMETRICS_Construct( );
 
 	for (int i = 0; i < MAXPLAYERS; i++)
 	{
@@ -1146,6 +1151,9 @@ void SERVER_Destruct( void )
 	dorch_stop_reporter( );
 #endif
 
+	// [dorch] Finish the server demo, if we're recording one.
+	SERVERDEMO_FinishRecording( );
+
 	// Free the clients' buffers.
 	for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
 	{
@@ -1263,8 +1271,18 @@ void SERVER_Tick( void )
 	{
 		//DObject::BeginFrame ();
 
+		// [dorch] Each tic is one frame of the profiler. This collects the
+		// zones of the previous tic, before this one's zone starts.
+		PROF_Frame( );
+		PROF_ZONE( "Server tic" );
+
+		// [dorch] Time the parts of the tic and report it if it's too slow.
+		SERVERWATCHDOG_BeginTic( );
+
 		// Recieve packets.
+		SERVERWATCHDOG_SetPhase( WDP_RECEIVE );
 		SERVER_GetPackets( );
+		SERVERWATCHDOG_SetPhase( WDP_OTHER );
 
 		// [AK] After receiving packets, check if we didn't receive a movement
 		// command from an in-game players during this gametic. If that's the
@@ -1281,7 +1299,10 @@ void SERVER_Tick( void )
 				// commands to arrive (i.e. their last move tick is still zero),
 				// don't treat it as a missing packet.
 				if (( g_aClients[i].lLastMoveTick != 0 ) && ( g_aClients[i].lLastMoveTick != gametic ))
+				{
 					g_aClients[i].numMissingPackets++;
+					g_aClients[i].totalMissingPackets++;
+				}
 			}
 		}
 
@@ -1289,7 +1310,9 @@ void SERVER_Tick( void )
 		// [BB] Tick the unlagged module.
 		UNLAGGED_Tick( );
 
+		SERVERWATCHDOG_SetPhase( WDP_TICKER );
 		G_Ticker ();
+		SERVERWATCHDOG_SetPhase( WDP_OTHER );
 
 		// However we need to spawn the unlagged debug actors here i.e. after having processed their
 		// movement commands which updated their last server gametic.
@@ -1334,10 +1357,16 @@ void SERVER_Tick( void )
 		SERVER_CheckTimeouts( );
 
 		// Send out player's true position, etc.
+		SERVERWATCHDOG_SetPhase( WDP_WRITECOMMANDS );
 		SERVER_WriteCommands( );
 
 		// Check everyone's PacketBuffer for anything that needs to be sent.
+		SERVERWATCHDOG_SetPhase( WDP_SEND );
 		SERVER_SendOutPackets( );
+		SERVERWATCHDOG_SetPhase( WDP_OTHER );
+
+		// [dorch] Write everything the demo recorder received during this tic.
+		SERVERDEMO_Tick( );
 
 #ifdef SERVER_ONLY
 		// Publish a fresh snapshot without blocking.
@@ -1348,6 +1377,7 @@ void SERVER_Tick( void )
 #endif
 
 		// [BB] Send out sheduled packets, respecting sv_maxpacketspertick.
+		SERVERWATCHDOG_SetPhase( WDP_SEND );
 		for ( unsigned int i = 0; i < MAXPLAYERS; i++ )
 		{
 			if ( g_aClients[i].State == CLS_FREE )
@@ -1356,17 +1386,23 @@ void SERVER_Tick( void )
 			SERVER_GetClient ( i )->SavedPackets.Tick ( );
 		}
 
-		// Potentially send an update to the master server.
-		SERVER_MASTER_Tick( );
+		{
+			PROF_ZONE( "Master, RCON and bans" );
+			SERVERWATCHDOG_SetPhase( WDP_MASTER );
 
-		// Time out any old RCON sessions.
-		SERVER_RCON_Tick( );
+			// Potentially send an update to the master server.
+			SERVER_MASTER_Tick( );
 
-		// Broadcast the server signal so it can be detected on a LAN.
-		SERVER_MASTER_Broadcast( );
+			// Time out any old RCON sessions.
+			SERVER_RCON_Tick( );
 
-		// Potentially re-parse the banfile.
-		SERVERBAN_Tick( );
+			// Broadcast the server signal so it can be detected on a LAN.
+			SERVER_MASTER_Broadcast( );
+
+			// Potentially re-parse the banfile.
+			SERVERBAN_Tick( );
+			SERVERWATCHDOG_SetPhase( WDP_OTHER );
+		}
 
 		// Print stats and get out.
 		FStat::PrintStat( );
@@ -1423,6 +1459,9 @@ void SERVER_Tick( void )
 			SERVERCONSOLE_UpdateStatistics( );
 		}
 
+		SERVERWATCHDOG_EndTic( );
+		SERVERMETRICS_Tick( SERVERWATCHDOG_GetLastTicMS( ));
+
 		//DObject::EndFrame ();
 	}
 /*
@@ -1468,6 +1507,7 @@ void SERVER_Tick( void )
 void SERVER_SendOutPackets( void )
 {
 	ULONG	ulIdx;
+	PROF_ZONE( "Net send" );
 
 	for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
 	{
@@ -1494,6 +1534,13 @@ void SERVER_SendClientPacket( ULONG ulClient, bool bReliable )
 	if ( pClient == NULL )
 		return;
 
+	// [dorch] Packets for the server's demo recorder go to the demo.
+	if ( SERVERDEMO_IsRecorderSlot( ulClient ))
+	{
+		SERVERDEMO_FlushClientBuffer( ulClient, bReliable );
+		return;
+	}
+
 	if ( bReliable )
 	{
 		pClient->SavedPackets.ScheduleUnsentPacket( pClient->PacketBuffer );
@@ -1568,6 +1615,10 @@ LONG SERVER_FindFreeClientSlot( void )
 	// Look for a free player slot.
 	for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
 	{
+		// [dorch] Skip the slot used by the server's demo recorder.
+		if ( SERVERDEMO_IsRecorderSlot( ulIdx ))
+			continue;
+
 		if (( g_aClients[ulIdx].State == CLS_FREE ) && ( playeringame[ulIdx] == false ))
 			return ( ulIdx );
 	}
@@ -1726,6 +1777,7 @@ CVAR( Bool, sv_emulatepacketloss, false, 0 )
 void SERVER_GetPackets( void )
 {
 	BYTESTREAM_s	*pByteStream;
+	PROF_ZONE( "Net receive" );
 
 	while ( NETWORK_GetPackets( ) > 0 )
 	{
@@ -1978,9 +2030,6 @@ void SERVER_ConnectNewPlayer( BYTESTREAM_s *pByteStream )
 {
 	LONG								lCommand;
 	ULONG								ulIdx;
-	ULONG								ulState;
-	ULONG								ulCountdownTicks;
-	AInventory							*pInventory;
 
 	// If the client hasn't authenticated his level, don't accept this connection.
 	if ( g_aClients[g_lCurrentClient].State < CLS_AUTHENTICATED )
@@ -2045,37 +2094,8 @@ void SERVER_ConnectNewPlayer( BYTESTREAM_s *pByteStream )
 	// Send consoleplayer number.
 	SERVERCOMMANDS_SetConsolePlayer( g_lCurrentClient );
 
-	// [AK] Send the name of the server.
-	SERVERCOMMANDS_SetCVar( sv_hostname, g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-
-	// Send dmflags.
-	SERVERCOMMANDS_SetGameDMFlags( g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-
-	// Send skill level.
-	SERVERCOMMANDS_SetGameSkill( g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-
-	// Send special settings like teamplay and deathmatch.
-	SERVERCOMMANDS_SetGameMode( g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-
-	// Send timelimit, fraglimit, etc.
-	SERVERCOMMANDS_SetGameModeLimits( g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-
-	// If this is LMS, send the allowed weapons.
-	if ( lastmanstanding || teamlms )
-		SERVERCOMMANDS_SetLMSAllowedWeapons( g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-
-	// [BB] Due to ZADF_ALWAYS_APPLY_LMS_SPECTATORSETTINGS, this is necessary in all game modes.
-	SERVERCOMMANDS_SetLMSSpectatorSettings( g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-
-	// If this is CTF or ST, tell the client whether or not we're in simple mode.
-	if ( GAMEMODE_GetCurrentFlags() & GMF_USETEAMITEM )
-		SERVERCOMMANDS_SetSimpleCTFSTMode( g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-/*
-	// Send the map name, and have the client load it.
-	SERVERCOMMANDS_MapLoad( g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-*/
-	// Send the map music.
-	SERVERCOMMANDS_SetMapMusic( SERVER_GetMapMusic( ), SERVER_GetMapMusicOrder( ), g_lCurrentClient, SVCF_ONLYTHISCLIENT );
+	// Send the server name, the game settings and the map music.
+	SERVER_SendGameSettings( g_lCurrentClient );
 
 	// Send the message of the day.
 	FString motd = *sv_motd;
@@ -2097,43 +2117,7 @@ void SERVER_ConnectNewPlayer( BYTESTREAM_s *pByteStream )
 		SERVERCOMMANDS_ClearVote( g_lCurrentClient, SVCF_ONLYTHISCLIENT );
 
 	// If we're in a duel or LMS mode, tell him the state of the game mode.
-	if ( duel || lastmanstanding || teamlms || possession || teampossession || survival || invasion )
-	{
-		if ( duel )
-		{
-			ulState = DUEL_GetState( );
-			ulCountdownTicks = DUEL_GetCountdownTicks( );
-		}
-		else if ( survival )
-		{
-			ulState = SURVIVAL_GetState( );
-			ulCountdownTicks = SURVIVAL_GetCountdownTicks( );
-		}
-		else if ( invasion )
-		{
-			ulState = INVASION_GetState( );
-			ulCountdownTicks = INVASION_GetCountdownTicks( );
-		}
-		else if ( possession || teampossession )
-		{
-			ulState = POSSESSION_GetState( );
-			if ( ulState == (PSNSTATE_e)PSNS_ARTIFACTHELD )
-				ulCountdownTicks = POSSESSION_GetArtifactHoldTicks( );
-			else
-				ulCountdownTicks = POSSESSION_GetCountdownTicks( );
-		}
-		else
-		{
-			ulState = LASTMANSTANDING_GetState( );
-			ulCountdownTicks = LASTMANSTANDING_GetCountdownTicks( );
-		}
-
-		SERVERCOMMANDS_SetGameModeState( ulState, ulCountdownTicks, g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-
-		// Also, if we're in invasion mode, tell the client what wave we're on.
-		if ( invasion )
-			SERVERCOMMANDS_SetInvasionWave( g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-	}
+	SERVER_SendGameModeState( g_lCurrentClient );
 
 	// In a game mode that involves teams, potentially decide a team for him.
 	if ( GAMEMODE_GetCurrentFlags() & GMF_PLAYERSONTEAMS )
@@ -2209,65 +2193,8 @@ void SERVER_ConnectNewPlayer( BYTESTREAM_s *pByteStream )
 		g_aClients[g_lCurrentClient].bRunEnterScripts = false;
 	}
 
-	if ( GAMEMODE_GetCurrentFlags() & GMF_USETEAMITEM )
-	{
-		// In ST/CTF games, let the incoming player know who has flags/skulls.
-		for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
-		{
-			if ( SERVER_IsValidClient( ulIdx ) == false )
-				continue;
-
-			// Player shouldn't have a flag/skull if he's not on a team...
-			if (( players[ulIdx].bOnTeam == false ) || ( players[ulIdx].mo == NULL ))
-				continue;
-
-			// See if this player is carrying the opponents flag/skull.
-			pInventory = TEAM_FindOpposingTeamsItemInPlayersInventory ( &players[ulIdx] );
-			if ( pInventory )
-				SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-
-			// See if the player is carrying the white flag in OFCTF.
-			pInventory = players[ulIdx].mo->FindInventory( PClass::FindClass( "WhiteFlag" ), true );
-			if (( oneflagctf ) && ( pInventory ))
-				SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-		}
-
-		// Also let the client know if flags/skulls are on the ground.
-		for ( ulIdx = 0; ulIdx < teams.Size( ); ulIdx++ )
-			SERVERCOMMANDS_SetTeamReturnTicks( ulIdx, TEAM_GetReturnTicks( ulIdx ), g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-
-		SERVERCOMMANDS_SetTeamReturnTicks( teams.Size( ), TEAM_GetReturnTicks( teams.Size( ) ), g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-	}
-
-	// If we're playing terminator, potentially tell the client who's holding the terminator
-	// artifact.
-	if ( terminator )
-	{
-		for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
-		{
-			if (( playeringame[ulIdx] == false ) || ( players[ulIdx].mo == NULL ))
-				continue;
-
-			pInventory = players[ulIdx].mo->FindInventory( PClass::FindClass( "PowerTerminatorArtifact" ));
-			if ( pInventory )
-				SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-		}
-	}
-
-	// If we're playing possession/team possession, potentially tell the client who's holding
-	// the possession artifact.
-	if ( possession || teampossession )
-	{
-		for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
-		{
-			if (( playeringame[ulIdx] == false ) || ( players[ulIdx].mo == NULL ))
-				continue;
-
-			pInventory = players[ulIdx].mo->FindInventory( PClass::FindClass( "PowerPossessionArtifact" ));
-			if ( pInventory )
-				SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, g_lCurrentClient, SVCF_ONLYTHISCLIENT );
-		}
-	}
+	// Let the client know who is carrying flags, skulls and other artifacts.
+	SERVER_SendArtifactCarriers( g_lCurrentClient );
 
 	// Check and see if this is a disconnected player. If so, restore his fragcount.
 	SavedPlayerInfo *savedInfo = SERVER_SAVE_GetSavedInfo( players[g_lCurrentClient].userinfo.GetName( ), g_aClients[g_lCurrentClient].Address );
@@ -2739,6 +2666,10 @@ void SERVER_SetupNewConnection( BYTESTREAM_s *pByteStream, bool bNewPlayer )
 	g_aClients[lClient].bSuspicious = false;
 	g_aClients[lClient].ulNumConsistencyWarnings = 0;
 	g_aClients[lClient].numMissingPackets = 0;
+	g_aClients[lClient].totalMissingPackets = 0;
+	g_aClients[lClient].qwVoiceBytesIn = 0;
+	g_aClients[lClient].qwVoiceBytesOut = 0;
+	g_aClients[lClient].qwVoiceBytesCulled = 0;
 	g_aClients[lClient].skinName = "";
 	g_aClients[lClient].commRules.clear( );
 	g_aClients[lClient].ScreenWidth = 0;
@@ -3075,7 +3006,7 @@ void SERVER_ClientError( ULONG ulClient, ULONG ulErrorCode )
 		break;
 	case NETWORK_ERRORCODE_BANNED:
 		{
-			IPADDRESSBAN_s *entry = SERVERBAN_GetBanInformation( g_aClients[ulClient].Address );
+			const IPADDRESSBAN_s *entry = SERVERBAN_GetBanInformation( g_aClients[ulClient].Address );
 			FString banReason = (( entry != nullptr ) && ( strlen( entry->szComment ) > 0 )) ? entry->szComment : "";
 
 			if ( banReason.IsNotEmpty() )
@@ -3132,6 +3063,163 @@ void SERVER_ClientError( ULONG ulClient, ULONG ulErrorCode )
 	SERVER_DisconnectClient( ulClient, false, false, LEAVEREASON_ERROR );
 }
 
+//*****************************************************************************
+//
+// [dorch] Sends the server name, the game settings and the map music to a client.
+//
+void SERVER_SendGameSettings( ULONG ulClient )
+{
+	// [AK] Send the name of the server.
+	SERVERCOMMANDS_SetCVar( sv_hostname, ulClient, SVCF_ONLYTHISCLIENT );
+
+	// Send dmflags.
+	SERVERCOMMANDS_SetGameDMFlags( ulClient, SVCF_ONLYTHISCLIENT );
+
+	// Send skill level.
+	SERVERCOMMANDS_SetGameSkill( ulClient, SVCF_ONLYTHISCLIENT );
+
+	// Send special settings like teamplay and deathmatch.
+	SERVERCOMMANDS_SetGameMode( ulClient, SVCF_ONLYTHISCLIENT );
+
+	// Send timelimit, fraglimit, etc.
+	SERVERCOMMANDS_SetGameModeLimits( ulClient, SVCF_ONLYTHISCLIENT );
+
+	// If this is LMS, send the allowed weapons.
+	if ( lastmanstanding || teamlms )
+		SERVERCOMMANDS_SetLMSAllowedWeapons( ulClient, SVCF_ONLYTHISCLIENT );
+
+	// [BB] Due to ZADF_ALWAYS_APPLY_LMS_SPECTATORSETTINGS, this is necessary in all game modes.
+	SERVERCOMMANDS_SetLMSSpectatorSettings( ulClient, SVCF_ONLYTHISCLIENT );
+
+	// If this is CTF or ST, tell the client whether or not we're in simple mode.
+	if ( GAMEMODE_GetCurrentFlags() & GMF_USETEAMITEM )
+		SERVERCOMMANDS_SetSimpleCTFSTMode( ulClient, SVCF_ONLYTHISCLIENT );
+/*
+	// Send the map name, and have the client load it.
+	SERVERCOMMANDS_MapLoad( ulClient, SVCF_ONLYTHISCLIENT );
+*/
+	// Send the map music.
+	SERVERCOMMANDS_SetMapMusic( SERVER_GetMapMusic( ), SERVER_GetMapMusicOrder( ), ulClient, SVCF_ONLYTHISCLIENT );
+}
+
+//*****************************************************************************
+//
+// [dorch] Tells a client the state of the current game mode (e.g. duel countdown).
+//
+void SERVER_SendGameModeState( ULONG ulClient )
+{
+	ULONG	ulState;
+	ULONG	ulCountdownTicks;
+
+	if ( duel || lastmanstanding || teamlms || possession || teampossession || survival || invasion )
+	{
+		if ( duel )
+		{
+			ulState = DUEL_GetState( );
+			ulCountdownTicks = DUEL_GetCountdownTicks( );
+		}
+		else if ( survival )
+		{
+			ulState = SURVIVAL_GetState( );
+			ulCountdownTicks = SURVIVAL_GetCountdownTicks( );
+		}
+		else if ( invasion )
+		{
+			ulState = INVASION_GetState( );
+			ulCountdownTicks = INVASION_GetCountdownTicks( );
+		}
+		else if ( possession || teampossession )
+		{
+			ulState = POSSESSION_GetState( );
+			if ( ulState == (PSNSTATE_e)PSNS_ARTIFACTHELD )
+				ulCountdownTicks = POSSESSION_GetArtifactHoldTicks( );
+			else
+				ulCountdownTicks = POSSESSION_GetCountdownTicks( );
+		}
+		else
+		{
+			ulState = LASTMANSTANDING_GetState( );
+			ulCountdownTicks = LASTMANSTANDING_GetCountdownTicks( );
+		}
+
+		SERVERCOMMANDS_SetGameModeState( ulState, ulCountdownTicks, ulClient, SVCF_ONLYTHISCLIENT );
+
+		// Also, if we're in invasion mode, tell the client what wave we're on.
+		if ( invasion )
+			SERVERCOMMANDS_SetInvasionWave( ulClient, SVCF_ONLYTHISCLIENT );
+	}
+}
+
+//*****************************************************************************
+//
+// [dorch] Tells a client who is carrying team items and the terminator/possession artifacts.
+//
+void SERVER_SendArtifactCarriers( ULONG ulClient )
+{
+	ULONG		ulIdx;
+	AInventory	*pInventory;
+
+	if ( GAMEMODE_GetCurrentFlags() & GMF_USETEAMITEM )
+	{
+		// In ST/CTF games, let the incoming player know who has flags/skulls.
+		for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+		{
+			if ( SERVER_IsValidClient( ulIdx ) == false )
+				continue;
+
+			// Player shouldn't have a flag/skull if he's not on a team...
+			if (( players[ulIdx].bOnTeam == false ) || ( players[ulIdx].mo == NULL ))
+				continue;
+
+			// See if this player is carrying the opponents flag/skull.
+			pInventory = TEAM_FindOpposingTeamsItemInPlayersInventory ( &players[ulIdx] );
+			if ( pInventory )
+				SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, ulClient, SVCF_ONLYTHISCLIENT );
+
+			// See if the player is carrying the white flag in OFCTF.
+			pInventory = players[ulIdx].mo->FindInventory( PClass::FindClass( LITERAL_NAME( "WhiteFlag", true )), true );
+			if (( oneflagctf ) && ( pInventory ))
+				SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, ulClient, SVCF_ONLYTHISCLIENT );
+		}
+
+		// Also let the client know if flags/skulls are on the ground.
+		for ( ulIdx = 0; ulIdx < teams.Size( ); ulIdx++ )
+			SERVERCOMMANDS_SetTeamReturnTicks( ulIdx, TEAM_GetReturnTicks( ulIdx ), ulClient, SVCF_ONLYTHISCLIENT );
+
+		SERVERCOMMANDS_SetTeamReturnTicks( teams.Size( ), TEAM_GetReturnTicks( teams.Size( ) ), ulClient, SVCF_ONLYTHISCLIENT );
+	}
+
+	// If we're playing terminator, potentially tell the client who's holding the terminator
+	// artifact.
+	if ( terminator )
+	{
+		for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+		{
+			if (( playeringame[ulIdx] == false ) || ( players[ulIdx].mo == NULL ))
+				continue;
+
+			pInventory = players[ulIdx].mo->FindInventory( PClass::FindClass( LITERAL_NAME( "PowerTerminatorArtifact", true )));
+			if ( pInventory )
+				SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, ulClient, SVCF_ONLYTHISCLIENT );
+		}
+	}
+
+	// If we're playing possession/team possession, potentially tell the client who's holding
+	// the possession artifact.
+	if ( possession || teampossession )
+	{
+		for ( ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
+		{
+			if (( playeringame[ulIdx] == false ) || ( players[ulIdx].mo == NULL ))
+				continue;
+
+			pInventory = players[ulIdx].mo->FindInventory( PClass::FindClass( LITERAL_NAME( "PowerPossessionArtifact", true )));
+			if ( pInventory )
+				SERVERCOMMANDS_GiveInventory( ulIdx, pInventory, ulClient, SVCF_ONLYTHISCLIENT );
+		}
+	}
+}
+
 //*****************************************************************************
 //
 void SERVER_SendFullUpdate( ULONG ulClient )
@@ -3342,8 +3430,8 @@ void SERVER_SendFullUpdate( ULONG ulClient )
 		// Don't spawn players, items about to be deleted, inventory items
 		// that have an owner, or items that the client spawns himself.
 		if (( pActor->IsKindOf( RUNTIME_CLASS( APlayerPawn ))) ||
-			( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HoldAndDestroy") ) ||	// S_HOLDANDDESTROY
-			( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("Held") ) || // S_HELD
+			( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState( LITERAL_NAME( "HoldAndDestroy", false )) ) ||	// S_HOLDANDDESTROY
+			( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState( LITERAL_NAME( "Held", false )) ) || // S_HELD
 			( pActor->NetworkFlags & NETFL_ALLOWCLIENTSPAWN ))
 		{
 			continue;
@@ -3353,7 +3441,7 @@ void SERVER_SendFullUpdate( ULONG ulClient )
 		// The clients don't need them at all, since the server will tell
 		// them to spawn a new actor during GAME_ResetMap anyway.
 		if ( !( pActor->IsKindOf( RUNTIME_CLASS( AInventory ) ) )
-		     && ( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HideIndefinitely") ) // S_HIDEINDEFINITELY 
+		     && ( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState( LITERAL_NAME( "HideIndefinitely", false )) ) // S_HIDEINDEFINITELY 
 		   )
 		{
 			continue;
@@ -3445,7 +3533,7 @@ void SERVER_SendFullUpdate( ULONG ulClient )
 			// [BB] Clients need to know the SectorAction specials to predict them.
 			// [EP] Spectators need to know the allowed specials to use them.
 			if ( ( NETWORK_IsClientPredictedSpecial ( pActor->special ) || GAMEMODE_IsSpectatorAllowedSpecial ( pActor->special ) )
-				&& pActor->IsKindOf( PClass::FindClass( "SectorAction" ) ) )
+				&& pActor->IsKindOf( PClass::FindClass( LITERAL_NAME( "SectorAction", true )) ) )
 				SERVERCOMMANDS_SetThingSpecial ( pActor, ulClient, SVCF_ONLYTHISCLIENT );
 
 			// [BB] Some things like AMovingCamera rely on the AActor tid.
@@ -3460,9 +3548,9 @@ void SERVER_SendFullUpdate( ULONG ulClient )
 
 			// This item has been picked up, and is in its hidden, respawn state. Let
 			// the client know that.
-			if (( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HideDoomish") ) ||	// S_HIDEDOOMISH
-				( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HideSpecial") ) ||	// S_HIDESPECIAL
-				( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState("HideIndefinitely") ))
+			if (( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState( LITERAL_NAME( "HideDoomish", false )) ) ||	// S_HIDEDOOMISH
+				( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState( LITERAL_NAME( "HideSpecial", false )) ) ||	// S_HIDESPECIAL
+				( pActor->state == RUNTIME_CLASS ( AInventory )->ActorInfo->FindState( LITERAL_NAME( "HideIndefinitely", false )) ))
 			{
 				SERVERCOMMANDS_HideThing( pActor, ulClient, SVCF_ONLYTHISCLIENT );
 			}
@@ -3472,7 +3560,7 @@ void SERVER_SendFullUpdate( ULONG ulClient )
 				SERVERCOMMANDS_ThingDeactivate( pActor, NULL, ulClient, SVCF_ONLYTHISCLIENT );
 
 			// [BB] Active ActorMovers need to be synced with the client.
-			if ( pActor->IsKindOf( PClass::FindClass( "ActorMover" ) ) && pActor->IsActive( ) )
+			if ( pActor->IsKindOf( PClass::FindClass( LITERAL_NAME( "ActorMover", true )) ) && pActor->IsActive( ) )
 			{
 				static_cast<APathFollower *> ( pActor )->SyncWithClient ( ulClient );
 				SERVERCOMMANDS_ThingActivate( pActor, NULL, ulClient, SVCF_ONLYTHISCLIENT );
@@ -3488,7 +3576,7 @@ void SERVER_SendFullUpdate( ULONG ulClient )
 			// If any of this actor's flags have changed during the course of the level, notify
 			// the client.
 			// [BB] InterpolationPoint abuses the MF_AMBUSH flag, so we have to exclude this class here.
-			if ( pActor->IsKindOf( PClass::FindClass( "InterpolationPoint" ) ) == false )
+			if ( pActor->IsKindOf( PClass::FindClass( LITERAL_NAME( "InterpolationPoint", true )) ) == false )
 				SERVERCOMMANDS_UpdateThingFlagsNotAtDefaults( pActor, ulClient, SVCF_ONLYTHISCLIENT );
 
 			// [BB] Now that the ammo amount from weapon pickups is handled on the server
@@ -3584,19 +3672,19 @@ void SERVER_SendFullUpdate( ULONG ulClient )
 			const PlayerValue DefaultVal = pair->Value.GetDefaultValue( );
 
 			// [AK] First, tell them to reset everyone's values to default.
-			SERVERCOMMANDS_ResetCustomPlayerValue( pair->Value, MAXPLAYERS, g_lCurrentClient, SVCF_ONLYTHISCLIENT );
+			SERVERCOMMANDS_ResetCustomPlayerValue( pair->Value, MAXPLAYERS, ulClient, SVCF_ONLYTHISCLIENT );
 
 			for ( ULONG ulIdx = 0; ulIdx < MAXPLAYERS; ulIdx++ )
 			{
 				// [AK] Ignore the client themselves, or invalid players.
-				if (( ulIdx == static_cast<ULONG>( g_lCurrentClient )) || ( PLAYER_IsValidPlayer( ulIdx ) == false ))
+				if (( ulIdx == ulClient ) || ( PLAYER_IsValidPlayer( ulIdx ) == false ))
 					continue;
 
 				// [AK] Don't bother sending out values that are already equal to the default value.
 				if ( pair->Value.GetValue( ulIdx ) == DefaultVal )
 					continue;
 
-				SERVERCOMMANDS_SetCustomPlayerValue( pair->Value, ulIdx, g_lCurrentClient, SVCF_ONLYTHISCLIENT );
+				SERVERCOMMANDS_SetCustomPlayerValue( pair->Value, ulIdx, ulClient, SVCF_ONLYTHISCLIENT );
 			}
 		}
 	}
@@ -3606,6 +3694,8 @@ void SERVER_SendFullUpdate( ULONG ulClient )
 //
 void SERVER_WriteCommands( void )
 {
+	PROF_ZONE( "SERVER_WriteCommands" );
+
 	// Ping clients and stuff.
 	SERVER_SendHeartBeat( );
 
@@ -4022,7 +4112,7 @@ void SERVER_UpdateSectors( ULONG ulClient )
 	TThinkerIterator<DPhased>		PhasedIterator;
 	DPhased							*pPhased;
 
-	if ( SERVER_IsValidClient( ulClient ) == false )
+	if (( SERVER_IsValidClient( ulClient ) == false ) && ( SERVERDEMO_IsRecorderClient( ulClient ) == false ))
 		return;
 
 	// [BB] Set all existing sector links.
@@ -4226,7 +4316,7 @@ void SERVER_UpdateLines( ULONG ulClient )
 {
 	ULONG		ulLine;
 
-	if ( SERVER_IsValidClient( ulClient ) == false )
+	if (( SERVER_IsValidClient( ulClient ) == false ) && ( SERVERDEMO_IsRecorderClient( ulClient ) == false ))
 		return;
 
 	for ( ulLine = 0; ulLine < (ULONG)numlines; ulLine++ )
@@ -4272,7 +4362,7 @@ void SERVER_UpdateSides( ULONG ulClient )
 {
 	ULONG		ulSide;
 
-	if ( SERVER_IsValidClient( ulClient ) == false )
+	if (( SERVER_IsValidClient( ulClient ) == false ) && ( SERVERDEMO_IsRecorderClient( ulClient ) == false ))
 		return;
 
 	for ( ulSide = 0; ulSide < (ULONG)numsides; ulSide++ )
@@ -4291,7 +4381,7 @@ void SERVER_UpdateActorProperties( AActor *pActor, ULONG ulClient )
 	if ( !pActor )
 		return;
 
-	if ( SERVER_IsValidClient( ulClient ) == false )
+	if (( SERVER_IsValidClient( ulClient ) == false ) && ( SERVERDEMO_IsRecorderClient( ulClient ) == false ))
 		return;
 
 	// Update the actor's speed if it's changed.
@@ -4614,6 +4704,10 @@ bool SERVER_IsPlayerAllowedToKnowHealth( ULONG ulPlayer, ULONG ulPlayer2 )
 	if ( ( ulPlayer >= MAXPLAYERS ) || ( ulPlayer2 >= MAXPLAYERS ) )
 		return ( false );
 
+	// [dorch] The server's demo recorder may watch anyone, so it needs to know everything.
+	if ( SERVERDEMO_IsRecorderClient( ulPlayer ))
+		return ( players[ulPlayer2].mo != NULL );
+
 	// No bodies? Definitely not!
 	if (( players[ulPlayer].mo == NULL ) || ( players[ulPlayer2].mo == NULL ))
 		return ( false );
@@ -4659,6 +4753,24 @@ LONG SERVER_GetPlayerIgnoreTic( const unsigned int player, NETADDRESS_s address,
 	return 0;
 }
 
+//*****************************************************************************
+//
+// [dorch] Returns the volume this player set for the voice of the player at
+// this address. Players who didn't change it are heard at full volume.
+//
+float SERVER_GetVoIPChannelVolume( const unsigned int player, NETADDRESS_s address )
+{
+	const std::list<ClientCommRule> &list = SERVER_GetClient( player )->commRules;
+
+	for ( std::list<ClientCommRule>::const_iterator i = list.begin( ); i != list.end( ); i++ )
+	{
+		if ( i->address.CompareNoPort( address ))
+			return i->VoIPChannelVolume;
+	}
+
+	return 1.0f;
+}
+
 //*****************************************************************************
 //
 LONG SERVER_AdjustDoorDirection( LONG lDirection )
@@ -4794,7 +4906,7 @@ void SERVER_ResetInventory( ULONG ulClient, const bool bChangeClientWeapon, bool
 		// [Dusk] Weapon holders need special treatment. While the server manages
 		// weapon pieces, holders need to be synced as the client uses it for
 		// weapon piece HUD display.
-		if ( pInventory->IsKindOf( PClass::FindClass( "WeaponHolder" )) )
+		if ( pInventory->IsKindOf( PClass::FindClass( LITERAL_NAME( "WeaponHolder", true ))) )
 		{
 			SERVERCOMMANDS_GiveWeaponHolder( ulClient, static_cast<AWeaponHolder *>( pInventory ), ulClient, SVCF_ONLYTHISCLIENT );
 			// [BB] This item was taken care of, move to the next.
@@ -4804,8 +4916,8 @@ void SERVER_ResetInventory( ULONG ulClient, const bool bChangeClientWeapon, bool
 		if ( pInventory->IsKindOf( RUNTIME_CLASS( APowerup )))
 		{
 			// [BB] All clients need to be informed about some special iventory kinds.
-			if ( pInventory->IsKindOf( PClass::FindClass( "PowerTerminatorArtifact" ))
-				 || pInventory->IsA( PClass::FindClass( "PowerPossessionArtifact" )) )
+			if ( pInventory->IsKindOf( PClass::FindClass( LITERAL_NAME( "PowerTerminatorArtifact", true )))
+				 || pInventory->IsA( PClass::FindClass( LITERAL_NAME( "PowerPossessionArtifact", true ))) )
 				SERVERCOMMANDS_GivePowerup( ulClient, static_cast<APowerup *>( pInventory ) );
 			else
 				SERVERCOMMANDS_GivePowerup( ulClient, static_cast<APowerup *>( pInventory ), ulClient, SVCF_ONLYTHISCLIENT );
@@ -5173,6 +5285,13 @@ void SERVER_IgnoreIP( NETADDRESS_s Address )
 	g_floodProtectionIPQueue.addAddress( Address, g_GameTime / 1000 );
 }
 
+//*****************************************************************************
+//
+unsigned int SERVER_GetNumIgnoredPackets( void )
+{
+	return ( g_floodProtectionIPQueue.getNumRejected( ));
+}
+
 //*****************************************************************************
 //
 void SERVER_KillCheat( const char* what )
@@ -5382,6 +5501,8 @@ void SERVER_STATISTIC_AddToOutboundDataTransfer( ULONG ulNumBytes )
 {
 	g_qwTotalOutboundDataTransferred += ulNumBytes;
 	g_lCurrentOutboundDataTransfer += ulNumBytes;
+	SERVERWATCHDOG_CountPacket( true, ulNumBytes );
+	SERVERMETRICS_CountPacket( true, ulNumBytes );
 
 	SERVERCONSOLE_UpdateStatistics( );
 }
@@ -5413,6 +5534,8 @@ void SERVER_STATISTIC_AddToInboundDataTransfer( ULONG ulNumBytes )
 {
 	g_qwTotalInboundDataTransferred += ulNumBytes;
 	g_lCurrentInboundDataTransfer += ulNumBytes;
+	SERVERWATCHDOG_CountPacket( false, ulNumBytes );
+	SERVERMETRICS_CountPacket( false, ulNumBytes );
 
 	SERVERCONSOLE_UpdateStatistics( );
 }
@@ -5904,6 +6027,7 @@ bool SERVER_ProcessCommand( LONG lCommand, BYTESTREAM_s *pByteStream )
 			unsigned char *data = new unsigned char[length];
 
 			pByteStream->ReadBuffer( data, length );
+			g_aClients[g_lCurrentClient].qwVoiceBytesIn += length;
 
 			// [AK] Only send out the VoIP audio packet if the player isn't ignored.
 			if ( players[g_lCurrentClient].ignoreVoice.enabled == false )
@@ -6719,6 +6843,7 @@ static bool server_MissingPacket( BYTESTREAM_s *pByteStream )
 
 	// [AK] Increment the number of missing packets for this client.
 	g_aClients[g_lCurrentClient].numMissingPackets++;
+	g_aClients[g_lCurrentClient].totalMissingPackets++;
 
 	// Mark this client as having requested missing packets.
 	g_aClients[g_lCurrentClient].lLastPacketLossTick = gametic;
@@ -8498,6 +8623,42 @@ CCMD( forcerename )
 	Printf( "Unknown player: %s\n", argv[1] );
 }
 
+//*****************************************************************************
+// [dorch] Prints how much voice chat traffic every client caused since it connected.
+CCMD( voicestats )
+{
+	// [AK] This function may not be used by ConsoleCommand.
+	if ( ACS_IsCalledFromConsoleCommand( ))
+		return;
+
+	if ( NETWORK_GetState( ) != NETSTATE_SERVER )
+		return;
+
+	QWORD qwTotalOut = 0, qwTotalCulled = 0;
+
+	Printf( "idx  %-10s %10s %10s %10s\n", "name", "in", "out", "culled" );
+
+	for ( ULONG idx = 0; idx < MAXPLAYERS; idx++ )
+	{
+		if ( SERVER_IsValidClient( idx ) == false )
+			continue;
+
+		FString playerName = players[idx].userinfo.GetName();
+		V_RemoveColorCodes( playerName );
+
+		Printf( "%-4u %-10.10s %10llu %10llu %10llu\n", static_cast<unsigned int>( idx ), playerName.GetChars(),
+			static_cast<unsigned long long>( g_aClients[idx].qwVoiceBytesIn ),
+			static_cast<unsigned long long>( g_aClients[idx].qwVoiceBytesOut ),
+			static_cast<unsigned long long>( g_aClients[idx].qwVoiceBytesCulled ));
+
+		qwTotalOut += g_aClients[idx].qwVoiceBytesOut;
+		qwTotalCulled += g_aClients[idx].qwVoiceBytesCulled;
+	}
+
+	if ( qwTotalOut + qwTotalCulled > 0 )
+		Printf( "%.1f%% of the voice traffic wasn't sent.\n", 100.0 * qwTotalCulled / ( qwTotalOut + qwTotalCulled ));
+}
+
 //*****************************************************************************
 #ifdef	_DEBUG
 CCMD( testchecksum )
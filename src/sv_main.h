@@ -157,8 +157,6 @@
 
 #define SQF2_ALL					( SQF2_PWAD_HASHES|SQF2_COUNTRY|SQF2_GAMEMODE_NAME|SQF2_GAMEMODE_SHORTNAME|SQF2_VOICECHAT )
 
-#define	MAX_STORED_QUERY_IPS		512
-
 //*****************************************************************************
 enum CLIENTSTATE_e
 {
@@ -207,17 +205,6 @@ enum LEAVEREASON_e
 //*****************************************************************************
 //	STRUCTURES
 
-struct STORED_QUERY_IP_s
-{
-	// Address of the person who queried us.
-	NETADDRESS_s	Address;
-
-	// Gametic when we allow another query.
-	LONG			lNextAllowedGametic;
-
-};
-
-//*****************************************************************************
 struct CLIENT_MOVE_COMMAND_s
 {
 	ticcmd_t		cmd;
@@ -457,6 +444,16 @@ struct CLIENT_s
 	// [AK] The number of times a client's packet (e.g. CLC_CLIENTMOVE) was missing.
 	unsigned int	numMissingPackets;
 
+	// [dorch] The same, but never reset while the client is connected.
+	unsigned int	totalMissingPackets;
+
+	// [dorch] Voice chat traffic: bytes of audio the client sent us, bytes of
+	// voice packets we relayed to it, and bytes we didn't relay because it
+	// couldn't hear the speaker (out of range or muted).
+	QWORD			qwVoiceBytesIn;
+	QWORD			qwVoiceBytesOut;
+	QWORD			qwVoiceBytesCulled;
+
 	// What is the name of the client's skin?
 	FString			skinName;
 
@@ -566,6 +563,9 @@ void		SERVER_ConnectNewPlayer( BYTESTREAM_s *pByteStream );
 bool		SERVER_GetUserInfo( BYTESTREAM_s *pByteStream, bool bAllowKick, bool bEnforceRequired = false );
 void		SERVER_ConnectionError( NETADDRESS_s Address, const char *pszMessage, ULONG ulErrorCode );
 void		SERVER_ClientError( ULONG ulClient, ULONG ulErrorCode );
+void		SERVER_SendGameSettings( ULONG ulClient );
+void		SERVER_SendGameModeState( ULONG ulClient );
+void		SERVER_SendArtifactCarriers( ULONG ulClient );
 void		SERVER_SendFullUpdate( ULONG ulClient );
 void		SERVER_WriteCommands( void );
 bool		SERVER_IsValidClient( ULONG ulClient );
@@ -591,6 +591,7 @@ void		SERVER_AddCommand( const char *pszCommand );
 void		SERVER_DeleteCommand( void );
 bool		SERVER_IsEveryoneReadyToGoOn( void );
 LONG		SERVER_GetPlayerIgnoreTic( const unsigned int player, NETADDRESS_s address, const bool doVoice ); // [RC/AK]
+float		SERVER_GetVoIPChannelVolume( const unsigned int player, NETADDRESS_s address );
 bool		SERVER_IsPlayerVisible( ULONG ulPlayer, ULONG ulPlayer2 );
 bool		SERVER_IsPlayerAllowedToKnowHealth( ULONG ulPlayer, ULONG ulPlayer2 );
 LONG		SERVER_AdjustDoorDirection( LONG lDirection );
@@ -622,6 +623,7 @@ void		SERVER_GiveInventoryToPlayer( const player_t *player, AInventory *pInvento
 void		SERVER_HandleWeaponStateJump( ULONG ulPlayer, FState *pState, LONG lPosition );
 void		SERVER_SetThingNonZeroAngleAndVelocity( AActor *pActor );
 void		SERVER_IgnoreIP( NETADDRESS_s Address );
+unsigned int	SERVER_GetNumIgnoredPackets( void );
 IPList		*SERVER_GetAdminList( void );
 const FString& SERVER_GetMasterBanlistVerificationString( void );
 void		SERVER_UpdateThingVelocity( AActor *pActor, bool updateZ, bool updateXY = true );
@@ -639,6 +641,7 @@ void		SERVER_MASTER_Destruct( void );
 void		SERVER_MASTER_Tick( void );
 void		SERVER_MASTER_Broadcast( void );
 void		SERVER_MASTER_SendServerInfo( NETADDRESS_s Address, ULONG ulFlags, ULONG ulTime, ULONG ulFlags2, bool bBroadcasting, bool bSegmentedResponse );
+unsigned int	SERVER_MASTER_GetNumIgnoredQueries( void );
 const char	*SERVER_MASTER_GetGameName( void );
 NETADDRESS_s SERVER_MASTER_GetMasterAddress( void );
 void		SERVER_MASTER_HandleVerificationRequest( BYTESTREAM_s *pByteStream );
@@ -100,10 +100,8 @@ static	NETBUFFER_s			g_SegmentBuffer;
 static	USHORT				g_usMasterPort;
 
 // List of IP address that this server has been queried by recently.
-static	STORED_QUERY_IP_s	g_StoredQueryIPs[MAX_STORED_QUERY_IPS];
+static	QueryIPQueue		g_QueryIPQueue( TICRATE * 10 );
 
-static	LONG				g_lStoredQueryIPHead;
-static	LONG				g_lStoredQueryIPTail;
 static	TArray<int>			g_OptionalWadIndices;
 
 extern	NETADDRESS_s		g_LocalAddress;
@@ -113,6 +111,10 @@ FString g_VersionWithOS;
 //*****************************************************************************
 //	CONSOLE VARIABLES
 
+// [dorch] How many times in a row a launcher can query the server before it
+// has to wait sv_queryignoretime seconds for every further query.
+CVAR( Int, sv_queryburst, 1, CVAR_ARCHIVE )
+
 //--------------------------------------------------------------------------------------------------------------------------------------------------
 //-- FUNCTIONS -------------------------------------------------------------------------------------------------------------------------------------
 //--------------------------------------------------------------------------------------------------------------------------------------------------
@@ -565,9 +567,6 @@ void SERVER_MASTER_Construct( void )
 	else 
 	   g_usMasterPort = DEFAULT_MASTER_PORT;
 
-	g_lStoredQueryIPHead = 0;
-	g_lStoredQueryIPTail = 0;
-
 #ifndef _WIN32
 	struct utsname u_name;
 	if ( uname(&u_name) < 0 )
@@ -599,11 +598,8 @@ void SERVER_MASTER_Destruct( void )
 //
 void SERVER_MASTER_Tick( void )
 {
-	while (( g_lStoredQueryIPHead != g_lStoredQueryIPTail ) && ( gametic >= g_StoredQueryIPs[g_lStoredQueryIPHead].lNextAllowedGametic ))
-	{
-		g_lStoredQueryIPHead++;
-		g_lStoredQueryIPHead = g_lStoredQueryIPHead % MAX_STORED_QUERY_IPS;
-	}
+	g_QueryIPQueue.setLimits( TICRATE * sv_queryignoretime, sv_queryburst );
+	g_QueryIPQueue.adjustHead( gametic );
 
 	// Send an update to the master server every 30 seconds.
 	if ( gametic % ( TICRATE * 30 ))
@@ -714,35 +710,23 @@ void SERVER_MASTER_SendServerInfo( NETADDRESS_s Address, ULONG ulFlags, ULONG ul
 	if ( bBroadcasting == false )
 	{
 		// First, check to see if we've been queried by this address recently.
-		if ( g_lStoredQueryIPHead != g_lStoredQueryIPTail )
+		// If so, ignore it, since it queried us less than 10 seconds ago.
+		if ( g_QueryIPQueue.addressInQueue( Address ))
 		{
-			ulIdx = g_lStoredQueryIPHead;
-			while ( ulIdx != (ULONG)g_lStoredQueryIPTail )
-			{
-				// Check to see if this IP exists in our stored query IP list. If it does, then
-				// ignore it, since it queried us less than 10 seconds ago.
-				if ( Address.CompareNoPort( g_StoredQueryIPs[ulIdx].Address ))
-				{
-					// Write our header.
-					g_MasterServerBuffer.ByteStream.WriteLong( SERVER_LAUNCHER_IGNORING );
-
-					// Send the time the launcher sent to us.
-					g_MasterServerBuffer.ByteStream.WriteLong( ulTime );
+			// Write our header.
+			g_MasterServerBuffer.ByteStream.WriteLong( SERVER_LAUNCHER_IGNORING );
 
-					// Send the packet.
-	//				NETWORK_LaunchPacket( &g_MasterServerBuffer, Address, true );
-					NETWORK_LaunchPacket( &g_MasterServerBuffer, Address );
+			// Send the time the launcher sent to us.
+			g_MasterServerBuffer.ByteStream.WriteLong( ulTime );
 
-					if ( sv_showlauncherqueries )
-						Printf( "Ignored IP launcher challenge.\n" );
+			// Send the packet.
+			NETWORK_LaunchPacket( &g_MasterServerBuffer, Address );
 
-					// Nothing more to do here.
-					return;
-				}
+			if ( sv_showlauncherqueries )
+				Printf( "Ignored IP launcher challenge.\n" );
 
-				ulIdx++;
-				ulIdx = ulIdx % MAX_STORED_QUERY_IPS;
-			}
+			// Nothing more to do here.
+			return;
 		}
 	
 		// Now, check to see if this IP has been banend from this server.
@@ -767,13 +751,9 @@ void SERVER_MASTER_SendServerInfo( NETADDRESS_s Address, ULONG ulFlags, ULONG ul
 
 		// This IP didn't exist in the list. and it wasn't banned. 
 		// So, add it, and keep it there for 10 seconds.
-		g_StoredQueryIPs[g_lStoredQueryIPTail].Address = Address;
-		g_StoredQueryIPs[g_lStoredQueryIPTail].lNextAllowedGametic = gametic + ( TICRATE * ( sv_queryignoretime ));
-
-		g_lStoredQueryIPTail++;
-		g_lStoredQueryIPTail = g_lStoredQueryIPTail % MAX_STORED_QUERY_IPS;
-		if ( g_lStoredQueryIPTail == g_lStoredQueryIPHead )
-			Printf( "SERVER_MASTER_SendServerInfo: WARNING! g_lStoredQueryIPTail == g_lStoredQueryIPHead\n" );
+		if ( g_QueryIPQueue.isFull( ))
+			Printf( "SERVER_MASTER_SendServerInfo: WARNING! The launcher query queue is full.\n" );
+		g_QueryIPQueue.addAddress( Address, gametic );
 	}
 
 	// Write our header.
@@ -921,6 +901,13 @@ void SERVER_MASTER_SendServerInfo( NETADDRESS_s Address, ULONG ulFlags, ULONG ul
 	}
 }
 
+//*****************************************************************************
+//
+unsigned int SERVER_MASTER_GetNumIgnoredQueries( void )
+{
+	return ( g_QueryIPQueue.getNumRejected( ));
+}
+
 //*****************************************************************************
 //
 const char *SERVER_MASTER_GetGameName( void )
@@ -0,0 +1,660 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Zandronum Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: sv_metrics.cpp
+//
+// Description: Serves the server's statistics to metric scrapers over HTTP,
+// in the Prometheus text format.
+//
+// The game thread only stores numbers: counters that change every tic or
+// packet are atomics, everything else is copied into a snapshot once a
+// second. The listener thread never touches the game state itself.
+//
+//-----------------------------------------------------------------------------
+
+#include "networkheaders.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "sv_metrics.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "d_player.h"
+#include "doomstat.h"
+#include "dthinker.h"
+#include "g_level.h"
+#include "i_system.h"
+#include "network.h"
+#include "sv_main.h"
+#include "templates.h"
+#include "v_text.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+//*****************************************************************************
+//	DEFINES
+
+enum
+{
+	// How long the listener waits for the stop flag and for a request, in ms.
+	METRICS_POLL_TIME = 250,
+	METRICS_REQUEST_TIMEOUT = 2000,
+
+	// Longest request that is read, the rest is ignored.
+	METRICS_MAX_REQUEST = 4096,
+};
+
+//*****************************************************************************
+struct MetricsClient
+{
+	bool	bValid;
+	bool	bSpectating;
+	bool	bLagging;
+	DWORD	ulPing;
+	DWORD	ulMissingPackets;
+	DWORD	ulTotalMissingPackets;
+	QWORD	qwVoiceBytes[3];
+	char	szName[MAXPLAYERNAMEBUFFER + 1];
+};
+
+//*****************************************************************************
+struct MetricsSnapshot
+{
+	MetricsClient	Clients[MAXPLAYERS];
+	DWORD			ulThinkers;
+	DWORD			ulActors;
+	QWORD			qwObjectBytes;
+	QWORD			qwObjectPoolBytes;
+	GC::FStats		GCStats;
+	DWORD			ulIgnoredQueries;
+	DWORD			ulIgnoredPackets;
+	int				lGametic;
+	char			szMapName[9];
+};
+
+//*****************************************************************************
+//	VARIABLES
+
+// Upper bounds of the tic time histogram, in seconds. One tic is 28.57 ms.
+static	const double	g_dTicBuckets[] = { 0.001, 0.0025, 0.005, 0.01, 0.02, 1. / TICRATE, 0.05, 0.1, 0.25, 1 };
+
+// Written by the game thread.
+static	std::atomic<QWORD>		g_qwTicBucketCounts[countof( g_dTicBuckets ) + 1];
+static	std::atomic<QWORD>		g_qwTicCount( 0 );
+static	std::atomic<QWORD>		g_qwTicTimeNS( 0 );
+static	std::atomic<float>		g_fLastTicMS( 0 );
+static	std::atomic<QWORD>		g_qwPackets[2];
+static	std::atomic<QWORD>		g_qwBytes[2];
+
+static	std::mutex				g_SnapshotMutex;
+static	MetricsSnapshot			g_Snapshot;
+
+// The listener.
+static	bool					g_bMetricsConstructed = false;
+static	std::thread				g_MetricsThread;
+static	std::atomic<bool>		g_bMetricsStop( false );
+static	SOCKET					g_MetricsSocket = INVALID_SOCKET;
+
+//*****************************************************************************
+//	PROTOTYPES
+
+static	void	metrics_Restart( void );
+
+//*****************************************************************************
+//	CONSOLE VARIABLES
+
+// [dorch] Port to serve the metrics on, 0 turns the listener off.
+CUSTOM_CVAR( Int, sv_metricsport, 0, CVAR_ARCHIVE|CVAR_NOSETBYACS|CVAR_SENSITIVESERVERSETTING )
+{
+	if (( self < 0 ) || ( self > 65535 ))
+		self = 0;
+	else
+		metrics_Restart( );
+}
+
+// Address the metrics listener binds to. Only local scrapers can reach it by
+// default.
+CUSTOM_CVAR( String, sv_metricsaddress, "127.0.0.1", CVAR_ARCHIVE|CVAR_NOSETBYACS|CVAR_SENSITIVESERVERSETTING )
+{
+	metrics_Restart( );
+}
+
+//*****************************************************************************
+//	FUNCTIONS
+
+void SERVERMETRICS_CountPacket( bool bOutbound, ULONG ulNumBytes )
+{
+	g_qwPackets[bOutbound].fetch_add( 1, std::memory_order_relaxed );
+	g_qwBytes[bOutbound].fetch_add( ulNumBytes, std::memory_order_relaxed );
+}
+
+//*****************************************************************************
+//
+static void metrics_TakeSnapshot( void )
+{
+	MetricsSnapshot snapshot;
+
+	memset( &snapshot, 0, sizeof( snapshot ));
+
+	for ( unsigned int i = 0; i < MAXPLAYERS; i++ )
+	{
+		if ( SERVER_IsValidClient( i ) == false )
+			continue;
+
+		MetricsClient &client = snapshot.Clients[i];
+		CLIENT_s *const pClient = SERVER_GetClient( i );
+		FString name = players[i].userinfo.GetName( );
+
+		V_RemoveColorCodes( name );
+		strncpy( client.szName, name.GetChars( ), MAXPLAYERNAMEBUFFER );
+
+		client.bValid = true;
+		client.bSpectating = players[i].bSpectating;
+		client.bLagging = !!( players[i].statuses & PLAYERSTATUS_LAGGING );
+		client.ulPing = players[i].ulPing;
+		client.ulMissingPackets = pClient->numMissingPackets;
+		client.ulTotalMissingPackets = pClient->totalMissingPackets;
+		client.qwVoiceBytes[0] = pClient->qwVoiceBytesIn;
+		client.qwVoiceBytes[1] = pClient->qwVoiceBytesOut;
+		client.qwVoiceBytes[2] = pClient->qwVoiceBytesCulled;
+	}
+
+	TThinkerIterator<DThinker> iterator;
+	DThinker *pThinker;
+
+	while (( pThinker = iterator.Next( )) != NULL )
+	{
+		snapshot.ulThinkers++;
+		if ( pThinker->IsKindOf( RUNTIME_CLASS( AActor )))
+			snapshot.ulActors++;
+	}
+
+	snapshot.qwObjectBytes = GC::AllocBytes;
+	snapshot.qwObjectPoolBytes = ObjectPool::GetReservedBytes( );
+	snapshot.GCStats = GC::Stats;
+	snapshot.ulIgnoredQueries = SERVER_MASTER_GetNumIgnoredQueries( );
+	snapshot.ulIgnoredPackets = SERVER_GetNumIgnoredPackets( );
+	snapshot.lGametic = gametic;
+	if ( gamestate == GS_LEVEL )
+		strncpy( snapshot.szMapName, level.mapname, 8 );
+
+	std::lock_guard<std::mutex> lock( g_SnapshotMutex );
+	g_Snapshot = snapshot;
+}
+
+//*****************************************************************************
+//
+// Called after every tic with the time the tic took.
+//
+void SERVERMETRICS_Tick( float fTicMS )
+{
+	const double dSeconds = fTicMS * 1e-3;
+	unsigned int ulBucket = 0;
+
+	while (( ulBucket < countof( g_dTicBuckets )) && ( dSeconds > g_dTicBuckets[ulBucket] ))
+		ulBucket++;
+
+	g_qwTicBucketCounts[ulBucket].fetch_add( 1, std::memory_order_relaxed );
+	g_qwTicTimeNS.fetch_add( static_cast<QWORD>( fTicMS * 1e6 ), std::memory_order_relaxed );
+	g_qwTicCount.fetch_add( 1, std::memory_order_relaxed );
+	g_fLastTicMS.store( fTicMS, std::memory_order_relaxed );
+
+	// Nobody is reading the rest, so don't bother to collect it.
+	if ( g_MetricsSocket == INVALID_SOCKET )
+		return;
+
+	if (( gametic % TICRATE ) == 0 )
+		metrics_TakeSnapshot( );
+}
+
+//*****************************************************************************
+//
+// Reads the memory use of the process. Returns false if the system can't
+// tell.
+//
+static bool metrics_GetMemoryUsage( QWORD &qwResident, QWORD &qwVirtual )
+{
+#ifdef __linux__
+	FILE *pFile = fopen( "/proc/self/statm", "r" );
+	unsigned long long ullVirtual, ullResident;
+	bool bRead = false;
+
+	if ( pFile == NULL )
+		return ( false );
+
+	if ( fscanf( pFile, "%llu %llu", &ullVirtual, &ullResident ) == 2 )
+	{
+		const QWORD qwPageSize = sysconf( _SC_PAGESIZE );
+
+		qwVirtual = ullVirtual * qwPageSize;
+		qwResident = ullResident * qwPageSize;
+		bRead = true;
+	}
+
+	fclose( pFile );
+	return ( bRead );
+#else
+	return ( false );
+#endif
+}
+
+//*****************************************************************************
+//
+static void metrics_AppendLabel( FString &out, const char *pszValue )
+{
+	for ( const char *p = pszValue; *p != '\0'; p++ )
+	{
+		if ( *p == '\\' )
+			out += "\\\\";
+		else if ( *p == '"' )
+			out += "\\\"";
+		else if ( *p == '\n' )
+			out += "\\n";
+		else
+			out += *p;
+	}
+}
+
+//*****************************************************************************
+//
+static void metrics_AppendHeader( FString &out, const char *pszName, const char *pszType, const char *pszHelp )
+{
+	out.AppendFormat( "# HELP %s %s\n# TYPE %s %s\n", pszName, pszHelp, pszName, pszType );
+}
+
+//*****************************************************************************
+//
+static void metrics_AppendClientMetric( FString &out, const MetricsSnapshot &snapshot, const char *pszName,
+	const char *pszType, const char *pszHelp, DWORD MetricsClient::*pValue )
+{
+	metrics_AppendHeader( out, pszName, pszType, pszHelp );
+
+	for ( unsigned int i = 0; i < MAXPLAYERS; i++ )
+	{
+		if ( snapshot.Clients[i].bValid == false )
+			continue;
+
+		out.AppendFormat( "%s{client=\"%u\",name=\"", pszName, i );
+		metrics_AppendLabel( out, snapshot.Clients[i].szName );
+		out.AppendFormat( "\"} %u\n", static_cast<unsigned int>( snapshot.Clients[i].*pValue ));
+	}
+}
+
+//*****************************************************************************
+//
+static FString metrics_Render( void )
+{
+	MetricsSnapshot snapshot;
+	FString out;
+
+	{
+		std::lock_guard<std::mutex> lock( g_SnapshotMutex );
+		snapshot = g_Snapshot;
+	}
+
+	// Tic times.
+	const QWORD qwTics = g_qwTicCount.load( std::memory_order_relaxed );
+	QWORD qwCumulative = 0;
+
+	metrics_AppendHeader( out, "zandronum_tic_duration_seconds", "histogram", "Time the server took to run a tic." );
+	for ( unsigned int i = 0; i < countof( g_dTicBuckets ); i++ )
+	{
+		qwCumulative += g_qwTicBucketCounts[i].load( std::memory_order_relaxed );
+		out.AppendFormat( "zandronum_tic_duration_seconds_bucket{le=\"%g\"} %llu\n", g_dTicBuckets[i], static_cast<unsigned long long>( qwCumulative ));
+	}
+	qwCumulative += g_qwTicBucketCounts[countof( g_dTicBuckets )].load( std::memory_order_relaxed );
+	out.AppendFormat( "zandronum_tic_duration_seconds_bucket{le=\"+Inf\"} %llu\n", static_cast<unsigned long long>( qwCumulative ));
+	out.AppendFormat( "zandronum_tic_duration_seconds_sum %.6f\n", g_qwTicTimeNS.load( std::memory_order_relaxed ) * 1e-9 );
+	out.AppendFormat( "zandronum_tic_duration_seconds_count %llu\n", static_cast<unsigned long long>( qwTics ));
+
+	metrics_AppendHeader( out, "zandronum_tic_last_duration_seconds", "gauge", "Time the last tic took." );
+	out.AppendFormat( "zandronum_tic_last_duration_seconds %.6f\n", g_fLastTicMS.load( std::memory_order_relaxed ) * 1e-3 );
+
+	metrics_AppendHeader( out, "zandronum_gametic", "gauge", "The current game tic." );
+	out.AppendFormat( "zandronum_gametic %d\n", snapshot.lGametic );
+
+	metrics_AppendHeader( out, "zandronum_map_info", "gauge", "The map that is being played." );
+	out += "zandronum_map_info{map=\"";
+	metrics_AppendLabel( out, snapshot.szMapName );
+	out += "\"} 1\n";
+
+	// Network traffic.
+	static const char *const s_pszDirections[2] = { "in", "out" };
+
+	metrics_AppendHeader( out, "zandronum_network_packets_total", "counter", "Packets the server received and sent." );
+	for ( unsigned int i = 0; i < 2; i++ )
+		out.AppendFormat( "zandronum_network_packets_total{direction=\"%s\"} %llu\n", s_pszDirections[i], static_cast<unsigned long long>( g_qwPackets[i].load( std::memory_order_relaxed )));
+
+	metrics_AppendHeader( out, "zandronum_network_bytes_total", "counter", "Bytes the server received and sent." );
+	for ( unsigned int i = 0; i < 2; i++ )
+		out.AppendFormat( "zandronum_network_bytes_total{direction=\"%s\"} %llu\n", s_pszDirections[i], static_cast<unsigned long long>( g_qwBytes[i].load( std::memory_order_relaxed )));
+
+	metrics_AppendHeader( out, "zandronum_network_ignored_packets_total", "counter", "Packets from IPs that were sending too many." );
+	out.AppendFormat( "zandronum_network_ignored_packets_total{type=\"launcher\"} %u\n", snapshot.ulIgnoredQueries );
+	out.AppendFormat( "zandronum_network_ignored_packets_total{type=\"connection\"} %u\n", snapshot.ulIgnoredPackets );
+
+	// Clients.
+	DWORD ulClients = 0, ulPlayers = 0, ulLagging = 0;
+
+	for ( unsigned int i = 0; i < MAXPLAYERS; i++ )
+	{
+		if ( snapshot.Clients[i].bValid == false )
+			continue;
+
+		ulClients++;
+		if ( snapshot.Clients[i].bSpectating == false )
+			ulPlayers++;
+		if ( snapshot.Clients[i].bLagging )
+			ulLagging++;
+	}
+
+	metrics_AppendHeader( out, "zandronum_clients", "gauge", "Connected clients, by whether they are playing, spectating or lagging." );
+	out.AppendFormat( "zandronum_clients{state=\"playing\"} %u\n", ulPlayers );
+	out.AppendFormat( "zandronum_clients{state=\"spectating\"} %u\n", ulClients - ulPlayers );
+	out.AppendFormat( "zandronum_clients{state=\"lagging\"} %u\n", ulLagging );
+
+	metrics_AppendClientMetric( out, snapshot, "zandronum_client_ping_milliseconds", "gauge",
+		"Average round trip time of the client.", &MetricsClient::ulPing );
+	metrics_AppendClientMetric( out, snapshot, "zandronum_client_missing_packets", "gauge",
+		"Packets the client missed since its last ping update.", &MetricsClient::ulMissingPackets );
+	metrics_AppendClientMetric( out, snapshot, "zandronum_client_missing_packets_total", "counter",
+		"Packets the client missed since it connected.", &MetricsClient::ulTotalMissingPackets );
+
+	static const char *const s_pszVoiceDirections[3] = { "in", "out", "culled" };
+
+	metrics_AppendHeader( out, "zandronum_client_voice_bytes_total", "counter",
+		"Voice chat bytes the client sent, that were relayed to it, and that weren't because it couldn't hear the speaker." );
+	for ( unsigned int i = 0; i < MAXPLAYERS; i++ )
+	{
+		if ( snapshot.Clients[i].bValid == false )
+			continue;
+
+		for ( unsigned int j = 0; j < 3; j++ )
+		{
+			out.AppendFormat( "zandronum_client_voice_bytes_total{client=\"%u\",name=\"", i );
+			metrics_AppendLabel( out, snapshot.Clients[i].szName );
+			out.AppendFormat( "\",direction=\"%s\"} %llu\n", s_pszVoiceDirections[j], static_cast<unsigned long long>( snapshot.Clients[i].qwVoiceBytes[j] ));
+		}
+	}
+
+	// The game world.
+	metrics_AppendHeader( out, "zandronum_thinkers", "gauge", "Thinkers in the level." );
+	out.AppendFormat( "zandronum_thinkers %u\n", snapshot.ulThinkers );
+	metrics_AppendHeader( out, "zandronum_actors", "gauge", "Actors in the level." );
+	out.AppendFormat( "zandronum_actors %u\n", snapshot.ulActors );
+
+	// Memory.
+	QWORD qwResident, qwVirtual;
+
+	metrics_AppendHeader( out, "zandronum_object_bytes", "gauge", "Memory used by objects the garbage collector tracks." );
+	out.AppendFormat( "zandronum_object_bytes %llu\n", static_cast<unsigned long long>( snapshot.qwObjectBytes ));
+	metrics_AppendHeader( out, "zandronum_object_pool_bytes", "gauge", "Memory reserved for objects, including blocks that aren't used right now." );
+	out.AppendFormat( "zandronum_object_pool_bytes %llu\n", static_cast<unsigned long long>( snapshot.qwObjectPoolBytes ));
+	if ( metrics_GetMemoryUsage( qwResident, qwVirtual ))
+	{
+		metrics_AppendHeader( out, "process_resident_memory_bytes", "gauge", "Resident memory size in bytes." );
+		out.AppendFormat( "process_resident_memory_bytes %llu\n", static_cast<unsigned long long>( qwResident ));
+		metrics_AppendHeader( out, "process_virtual_memory_bytes", "gauge", "Virtual memory size in bytes." );
+		out.AppendFormat( "process_virtual_memory_bytes %llu\n", static_cast<unsigned long long>( qwVirtual ));
+	}
+
+	// Garbage collector.
+	static const char *const s_pszGCStates[4] = { "markroots", "propagate", "sweep", "finalize" };
+	const GC::FStats &gc = snapshot.GCStats;
+
+	metrics_AppendHeader( out, "zandronum_gc_seconds_total", "counter", "Time the garbage collector spent in each of its states, and in full collections." );
+	for ( unsigned int i = 0; i < 4; i++ )
+		out.AppendFormat( "zandronum_gc_seconds_total{state=\"%s\"} %.6f\n", s_pszGCStates[i], gc.StateMS[i] * 1e-3 );
+	out.AppendFormat( "zandronum_gc_seconds_total{state=\"full\"} %.6f\n", gc.FullMS * 1e-3 );
+
+	metrics_AppendHeader( out, "zandronum_gc_steps_total", "counter", "Incremental garbage collector steps, and steps put off because the tic budget was used up." );
+	out.AppendFormat( "zandronum_gc_steps_total{type=\"run\"} %llu\n", static_cast<unsigned long long>( gc.Steps ));
+	out.AppendFormat( "zandronum_gc_steps_total{type=\"deferred\"} %llu\n", static_cast<unsigned long long>( gc.DeferredSteps ));
+	metrics_AppendHeader( out, "zandronum_gc_cycles_total", "counter", "Finished garbage collection cycles." );
+	out.AppendFormat( "zandronum_gc_cycles_total{type=\"incremental\"} %llu\n", static_cast<unsigned long long>( gc.Cycles ));
+	out.AppendFormat( "zandronum_gc_cycles_total{type=\"full\"} %llu\n", static_cast<unsigned long long>( gc.FullCollections ));
+	metrics_AppendHeader( out, "zandronum_gc_freed_objects_total", "counter", "Objects the garbage collector freed." );
+	out.AppendFormat( "zandronum_gc_freed_objects_total %llu\n", static_cast<unsigned long long>( gc.FreedObjects ));
+	metrics_AppendHeader( out, "zandronum_gc_freed_bytes_total", "counter", "Bytes the garbage collector freed." );
+	out.AppendFormat( "zandronum_gc_freed_bytes_total %llu\n", static_cast<unsigned long long>( gc.FreedBytes ));
+	metrics_AppendHeader( out, "zandronum_gc_step_max_seconds", "gauge", "Longest garbage collector step." );
+	out.AppendFormat( "zandronum_gc_step_max_seconds %.6f\n", gc.MaxStepMS * 1e-3 );
+	metrics_AppendHeader( out, "zandronum_gc_tic_last_seconds", "gauge", "Time the garbage collector ran in the last tic it ran in." );
+	out.AppendFormat( "zandronum_gc_tic_last_seconds %.6f\n", gc.LastTicMS * 1e-3 );
+	metrics_AppendHeader( out, "zandronum_gc_tic_max_seconds", "gauge", "Longest time the garbage collector ran in one tic." );
+	out.AppendFormat( "zandronum_gc_tic_max_seconds %.6f\n", gc.MaxTicMS * 1e-3 );
+
+	return ( out );
+}
+
+//*****************************************************************************
+//
+// Waits until the socket can be read. Returns false on a timeout or error.
+//
+static bool metrics_WaitForData( SOCKET Socket, int lTimeoutMS )
+{
+	fd_set readSet;
+	struct timeval timeout;
+
+	FD_ZERO( &readSet );
+	FD_SET( Socket, &readSet );
+	timeout.tv_sec = lTimeoutMS / 1000;
+	timeout.tv_usec = ( lTimeoutMS % 1000 ) * 1000;
+
+	return ( select( static_cast<int>( Socket ) + 1, &readSet, NULL, NULL, &timeout ) > 0 );
+}
+
+//*****************************************************************************
+//
+static void metrics_Send( SOCKET Socket, const char *pszData, size_t ulLength )
+{
+	while ( ulLength > 0 )
+	{
+		const int lSent = send( Socket, pszData, static_cast<int>( ulLength ), MSG_NOSIGNAL );
+
+		if ( lSent <= 0 )
+			return;
+
+		pszData += lSent;
+		ulLength -= lSent;
+	}
+}
+
+//*****************************************************************************
+//
+static void metrics_HandleConnection( SOCKET Socket )
+{
+	char szRequest[METRICS_MAX_REQUEST + 1];
+	int lLength = 0;
+
+	// Read the request line and the headers. The body of a GET is empty.
+	while (( lLength < METRICS_MAX_REQUEST ) && metrics_WaitForData( Socket, METRICS_REQUEST_TIMEOUT ))
+	{
+		const int lRead = recv( Socket, szRequest + lLength, METRICS_MAX_REQUEST - lLength, 0 );
+
+		if ( lRead <= 0 )
+			break;
+
+		lLength += lRead;
+		szRequest[lLength] = '\0';
+		if ( strstr( szRequest, "\r\n\r\n" ) || strstr( szRequest, "\n\n" ))
+			break;
+	}
+	szRequest[lLength] = '\0';
+
+	const char *pszStatus = "200 OK";
+	FString body;
+
+	if (( strncmp( szRequest, "GET /metrics ", 13 ) == 0 ) || ( strncmp( szRequest, "GET / ", 6 ) == 0 ))
+		body = metrics_Render( );
+	else if ( strncmp( szRequest, "GET ", 4 ) == 0 )
+	{
+		pszStatus = "404 Not Found";
+		body = "Not found\n";
+	}
+	else
+	{
+		pszStatus = "405 Method Not Allowed";
+		body = "Only GET is supported\n";
+	}
+
+	FString header;
+	header.Format( "HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+		pszStatus, static_cast<unsigned int>( body.Len( )));
+
+	metrics_Send( Socket, header.GetChars( ), header.Len( ));
+	metrics_Send( Socket, body.GetChars( ), body.Len( ));
+}
+
+//*****************************************************************************
+//
+static void metrics_ListenerThread( SOCKET ListenSocket )
+{
+	while ( g_bMetricsStop.load( std::memory_order_acquire ) == false )
+	{
+		if ( metrics_WaitForData( ListenSocket, METRICS_POLL_TIME ) == false )
+			continue;
+
+		SOCKET Socket = accept( ListenSocket, NULL, NULL );
+		if ( Socket == INVALID_SOCKET )
+			continue;
+
+		// Scrapers ask rarely, so they are simply served one at a time.
+		metrics_HandleConnection( Socket );
+		closesocket( Socket );
+	}
+}
+
+//*****************************************************************************
+//
+static void metrics_Stop( void )
+{
+	if ( g_MetricsSocket == INVALID_SOCKET )
+		return;
+
+	g_bMetricsStop.store( true, std::memory_order_release );
+	if ( g_MetricsThread.joinable( ))
+		g_MetricsThread.join( );
+
+	closesocket( g_MetricsSocket );
+	g_MetricsSocket = INVALID_SOCKET;
+}
+
+//*****************************************************************************
+//
+static void metrics_Start( void )
+{
+	struct sockaddr_in address;
+	int lReuse = 1;
+
+	memset( &address, 0, sizeof( address ));
+	address.sin_family = AF_INET;
+	address.sin_port = htons( static_cast<USHORT>( *sv_metricsport ));
+	address.sin_addr.s_addr = ( strlen( sv_metricsaddress ) > 0 ) ? inet_addr( sv_metricsaddress ) : htonl( INADDR_ANY );
+
+	if ( address.sin_addr.s_addr == INADDR_NONE )
+	{
+		Printf( "SERVERMETRICS: Invalid address \"%s\".\n", *sv_metricsaddress );
+		return;
+	}
+
+	SOCKET Socket = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+	if ( Socket == INVALID_SOCKET )
+	{
+		Printf( "SERVERMETRICS: Couldn't allocate a socket.\n" );
+		return;
+	}
+
+	setsockopt( Socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>( &lReuse ), sizeof( lReuse ));
+
+	if (( bind( Socket, reinterpret_cast<struct sockaddr *>( &address ), sizeof( address )) == SOCKET_ERROR )
+		|| ( listen( Socket, 8 ) == SOCKET_ERROR ))
+	{
+		Printf( "SERVERMETRICS: Couldn't listen on %s:%d.\n", *sv_metricsaddress, *sv_metricsport );
+		closesocket( Socket );
+		return;
+	}
+
+	// Don't serve an empty snapshot until the next second.
+	g_MetricsSocket = Socket;
+	metrics_TakeSnapshot( );
+
+	g_bMetricsStop.store( false, std::memory_order_release );
+	g_MetricsThread = std::thread( metrics_ListenerThread, Socket );
+
+	Printf( "Serving metrics on http://%s:%d/metrics\n", *sv_metricsaddress, *sv_metricsport );
+}
+
+//*****************************************************************************
+//
+static void metrics_Restart( void )
+{
+	if ( g_bMetricsConstructed == false )
+		return;
+
+	metrics_Stop( );
+	if ( sv_metricsport > 0 )
+		metrics_Start( );
+}
+
+//*****************************************************************************
+//
+void SERVERMETRICS_Construct( void )
+{
+	g_bMetricsConstructed = true;
+	metrics_Restart( );
+
+	// Call SERVERMETRICS_Destruct() when Skulltag closes.
+	atterm( SERVERMETRICS_Destruct );
+}
+
+//*****************************************************************************
+//
+void SERVERMETRICS_Destruct( void )
+{
+	metrics_Stop( );
+	g_bMetricsConstructed = false;
+}
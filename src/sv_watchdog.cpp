@@ -0,0 +1,446 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Zandronum Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: sv_watchdog.cpp
+//
+// Description: Times every server tic, keeps rolling statistics and reports
+// what the server was doing when a tic ran over its budget.
+//
+//-----------------------------------------------------------------------------
+
+#include <chrono>
+#include <stdlib.h>
+
+#include "sv_watchdog.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "dthinker.h"
+#include "g_level.h"
+#include "i_system.h"
+#include "network.h"
+#include "p_acs.h"
+#include "sv_main.h"
+#include "templates.h"
+#include "v_text.h"
+
+//*****************************************************************************
+//	DEFINES
+
+enum
+{
+	// Tics the rolling statistics cover.
+	WATCHDOG_WINDOW = TICRATE * 60,
+
+	// Classes and scripts listed in a report.
+	WATCHDOG_REPORT_LINES = 10,
+};
+
+//*****************************************************************************
+struct WatchdogTic
+{
+	float	fTotalMS;
+	float	fPhaseMS[NUM_WATCHDOGPHASES];
+};
+
+//*****************************************************************************
+struct WatchdogScript
+{
+	int		lScript;
+	DWORD	ulRuns;
+	QWORD	qwTime;
+};
+
+//*****************************************************************************
+struct WatchdogClassCount
+{
+	const PClass	*pType;
+	DWORD			ulCount;
+};
+
+//*****************************************************************************
+//	VARIABLES
+
+static	const char	*g_pszWatchdogPhaseNames[NUM_WATCHDOGPHASES] =
+{
+	"receive",
+	"G_Ticker",
+	"write commands",
+	"send",
+	"master/RCON/bans",
+	"other",
+};
+
+// The tic that is running.
+static	bool					g_bWatchdogInTic = false;
+static	QWORD					g_qwTicStart;
+static	QWORD					g_qwPhaseStart;
+static	WATCHDOGPHASE_e			g_CurrentPhase;
+static	QWORD					g_qwPhaseTime[NUM_WATCHDOGPHASES];
+static	TArray<WatchdogScript>	g_TicScripts;
+
+// Packets since the end of the last tic. This includes the ones read while
+// the server waited for the tic to start.
+static	DWORD					g_ulPacketsIn, g_ulPacketsOut;
+static	DWORD					g_ulBytesIn, g_ulBytesOut;
+
+// The last WATCHDOG_WINDOW tics.
+static	WatchdogTic				g_TicWindow[WATCHDOG_WINDOW];
+static	DWORD					g_ulWindowPos = 0;
+static	DWORD					g_ulWindowSize = 0;
+
+static	QWORD					g_qwTotalTics = 0;
+static	QWORD					g_qwTotalSlowTics = 0;
+static	float					g_fWorstTicMS = 0;
+static	int						g_lWorstTic = 0;
+static	QWORD					g_qwLastReport = 0;
+static	DWORD					g_ulUnreportedSlowTics = 0;
+
+//*****************************************************************************
+//	CONSOLE VARIABLES
+
+// [dorch] A tic that takes longer than this many ms is reported in the log.
+// One tic is 28.57 ms. 0 turns the reports off.
+CUSTOM_CVAR( Float, sv_slowticthreshold, 28.57f, CVAR_ARCHIVE )
+{
+	if ( self < 0 )
+		self = 0;
+}
+
+// Least number of seconds between two slow tic reports. The slow tics in
+// between are only counted.
+CUSTOM_CVAR( Int, sv_slowticreportinterval, 10, CVAR_ARCHIVE )
+{
+	if ( self < 0 )
+		self = 0;
+}
+
+//*****************************************************************************
+//	FUNCTIONS
+
+static QWORD watchdog_Now( void )
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now( ).time_since_epoch( )).count( );
+}
+
+//*****************************************************************************
+//
+void SERVERWATCHDOG_BeginTic( void )
+{
+	g_bWatchdogInTic = true;
+	g_qwTicStart = g_qwPhaseStart = watchdog_Now( );
+	g_CurrentPhase = WDP_OTHER;
+	memset( g_qwPhaseTime, 0, sizeof( g_qwPhaseTime ));
+}
+
+//*****************************************************************************
+//
+// Ends the phase that is running and starts timing the next one.
+//
+void SERVERWATCHDOG_SetPhase( WATCHDOGPHASE_e Phase )
+{
+	if ( g_bWatchdogInTic == false )
+		return;
+
+	const QWORD qwNow = watchdog_Now( );
+
+	g_qwPhaseTime[g_CurrentPhase] += qwNow - g_qwPhaseStart;
+	g_qwPhaseStart = qwNow;
+	g_CurrentPhase = Phase;
+}
+
+//*****************************************************************************
+//
+QWORD SERVERWATCHDOG_BeginScript( void )
+{
+	return g_bWatchdogInTic ? watchdog_Now( ) : 0;
+}
+
+//*****************************************************************************
+//
+void SERVERWATCHDOG_EndScript( int lScript, QWORD qwStart )
+{
+	if ( qwStart == 0 )
+		return;
+
+	const QWORD qwTime = watchdog_Now( ) - qwStart;
+
+	for ( unsigned int i = 0; i < g_TicScripts.Size( ); i++ )
+	{
+		if ( g_TicScripts[i].lScript == lScript )
+		{
+			g_TicScripts[i].ulRuns++;
+			g_TicScripts[i].qwTime += qwTime;
+			return;
+		}
+	}
+
+	WatchdogScript script = { lScript, 1, qwTime };
+	g_TicScripts.Push( script );
+}
+
+//*****************************************************************************
+//
+void SERVERWATCHDOG_CountPacket( bool bOutbound, ULONG ulNumBytes )
+{
+	if ( bOutbound )
+	{
+		g_ulPacketsOut++;
+		g_ulBytesOut += ulNumBytes;
+	}
+	else
+	{
+		g_ulPacketsIn++;
+		g_ulBytesIn += ulNumBytes;
+	}
+}
+
+//*****************************************************************************
+//
+static int watchdog_CompareScripts( const void *pA, const void *pB )
+{
+	const QWORD qwA = static_cast<const WatchdogScript *>( pA )->qwTime;
+	const QWORD qwB = static_cast<const WatchdogScript *>( pB )->qwTime;
+
+	return ( qwA < qwB ) - ( qwA > qwB );
+}
+
+//*****************************************************************************
+//
+static int watchdog_CompareClassCounts( const void *pA, const void *pB )
+{
+	const DWORD ulA = static_cast<const WatchdogClassCount *>( pA )->ulCount;
+	const DWORD ulB = static_cast<const WatchdogClassCount *>( pB )->ulCount;
+
+	return ( ulA < ulB ) - ( ulA > ulB );
+}
+
+//*****************************************************************************
+//
+static void watchdog_Report( const WatchdogTic &tic )
+{
+	FString phases;
+
+	for ( int i = 0; i < NUM_WATCHDOGPHASES; i++ )
+		phases.AppendFormat( "%s%s %.2f ms", ( i > 0 ) ? ", " : "", g_pszWatchdogPhaseNames[i], tic.fPhaseMS[i] );
+
+	Printf( TEXTCOLOR_RED "*** Slow tic %d on %s: %.2f ms (threshold %.2f ms)" TEXTCOLOR_NORMAL "\n",
+		gametic, level.mapname, tic.fTotalMS, static_cast<float>( sv_slowticthreshold ));
+	if ( g_ulUnreportedSlowTics > 0 )
+		Printf( "  %u more slow tics since the last report.\n", g_ulUnreportedSlowTics );
+	Printf( "  %s\n", phases.GetChars( ));
+	Printf( "  packets: %u in (%u bytes), %u out (%u bytes)\n", g_ulPacketsIn, g_ulBytesIn, g_ulPacketsOut, g_ulBytesOut );
+
+	// The scripts that took the longest.
+	if ( g_TicScripts.Size( ) > 0 )
+	{
+		DWORD ulRuns = 0;
+		for ( unsigned int i = 0; i < g_TicScripts.Size( ); i++ )
+			ulRuns += g_TicScripts[i].ulRuns;
+
+		qsort( &g_TicScripts[0], g_TicScripts.Size( ), sizeof( WatchdogScript ), watchdog_CompareScripts );
+
+		Printf( "  ACS: %u scripts ran %u times\n", g_TicScripts.Size( ), ulRuns );
+		for ( unsigned int i = 0; i < MIN<unsigned int>( g_TicScripts.Size( ), WATCHDOG_REPORT_LINES ); i++ )
+		{
+			Printf( "    %-32s %4u runs %8.3f ms\n", FBehavior::RepresentScript( g_TicScripts[i].lScript ).GetChars( ),
+				g_TicScripts[i].ulRuns, g_TicScripts[i].qwTime * 1e-6 );
+		}
+	}
+	else
+		Printf( "  ACS: no scripts ran\n" );
+
+	// The thinker classes with the most instances.
+	TMap<const PClass *, DWORD> counts;
+	TThinkerIterator<DThinker> iterator;
+	DThinker *pThinker;
+	DWORD ulThinkers = 0;
+
+	while (( pThinker = iterator.Next( )) != NULL )
+	{
+		counts[pThinker->GetClass( )]++;
+		ulThinkers++;
+	}
+
+	TArray<WatchdogClassCount> classes;
+	TMap<const PClass *, DWORD>::Iterator it( counts );
+	TMap<const PClass *, DWORD>::Pair *pPair;
+
+	while ( it.NextPair( pPair ))
+	{
+		WatchdogClassCount count = { pPair->Key, pPair->Value };
+		classes.Push( count );
+	}
+
+	if ( classes.Size( ) > 0 )
+		qsort( &classes[0], classes.Size( ), sizeof( WatchdogClassCount ), watchdog_CompareClassCounts );
+
+	FString line;
+	for ( unsigned int i = 0; i < MIN<unsigned int>( classes.Size( ), WATCHDOG_REPORT_LINES ); i++ )
+		line.AppendFormat( "%s%s %u", ( i > 0 ) ? ", " : "", classes[i].pType->TypeName.GetChars( ), classes[i].ulCount );
+	Printf( "  thinkers: %u in %u classes; %s\n", ulThinkers, classes.Size( ), line.GetChars( ));
+}
+
+//*****************************************************************************
+//
+void SERVERWATCHDOG_EndTic( void )
+{
+	if ( g_bWatchdogInTic == false )
+		return;
+
+	SERVERWATCHDOG_SetPhase( WDP_OTHER );
+	g_bWatchdogInTic = false;
+
+	const QWORD qwNow = watchdog_Now( );
+	WatchdogTic &tic = g_TicWindow[g_ulWindowPos];
+
+	tic.fTotalMS = static_cast<float>(( qwNow - g_qwTicStart ) * 1e-6 );
+	for ( int i = 0; i < NUM_WATCHDOGPHASES; i++ )
+		tic.fPhaseMS[i] = static_cast<float>( g_qwPhaseTime[i] * 1e-6 );
+
+	g_ulWindowPos = ( g_ulWindowPos + 1 ) % WATCHDOG_WINDOW;
+	g_ulWindowSize = MIN<DWORD>( g_ulWindowSize + 1, WATCHDOG_WINDOW );
+	g_qwTotalTics++;
+
+	if ( tic.fTotalMS > g_fWorstTicMS )
+	{
+		g_fWorstTicMS = tic.fTotalMS;
+		g_lWorstTic = gametic;
+	}
+
+	if (( sv_slowticthreshold > 0 ) && ( tic.fTotalMS > sv_slowticthreshold ))
+	{
+		g_qwTotalSlowTics++;
+
+		if (( g_qwLastReport == 0 ) || ( qwNow - g_qwLastReport >= static_cast<QWORD>( *sv_slowticreportinterval ) * 1000000000 ))
+		{
+			watchdog_Report( tic );
+			g_qwLastReport = qwNow;
+			g_ulUnreportedSlowTics = 0;
+		}
+		else
+			g_ulUnreportedSlowTics++;
+	}
+
+	g_TicScripts.Clear( );
+	g_ulPacketsIn = g_ulPacketsOut = 0;
+	g_ulBytesIn = g_ulBytesOut = 0;
+}
+
+//*****************************************************************************
+//
+float SERVERWATCHDOG_GetLastTicMS( void )
+{
+	if ( g_ulWindowSize == 0 )
+		return ( 0 );
+
+	return ( g_TicWindow[( g_ulWindowPos + WATCHDOG_WINDOW - 1 ) % WATCHDOG_WINDOW].fTotalMS );
+}
+
+//*****************************************************************************
+//
+static int watchdog_CompareFloats( const void *pA, const void *pB )
+{
+	const float fA = *static_cast<const float *>( pA );
+	const float fB = *static_cast<const float *>( pB );
+
+	return ( fA > fB ) - ( fA < fB );
+}
+
+//*****************************************************************************
+//
+static void watchdog_PrintStats( const char *pszName, TArray<float> &times )
+{
+	double dSum = 0;
+
+	qsort( &times[0], times.Size( ), sizeof( float ), watchdog_CompareFloats );
+	for ( unsigned int i = 0; i < times.Size( ); i++ )
+		dSum += times[i];
+
+	const unsigned int ulLast = times.Size( ) - 1;
+	Printf( "%-16s %8.3f %8.3f %8.3f %8.3f %8.3f\n", pszName, dSum / times.Size( ),
+		times[ulLast / 2], times[ulLast * 95 / 100], times[ulLast * 99 / 100], times[ulLast] );
+}
+
+//*****************************************************************************
+//	CONSOLE COMMANDS
+
+// [dorch] Prints how long the tics of the last minute took, in ms.
+CCMD( sv_ticstats )
+{
+	if ( NETWORK_GetState( ) != NETSTATE_SERVER )
+	{
+		Printf( "sv_ticstats can only be used on a server.\n" );
+		return;
+	}
+	if ( g_ulWindowSize == 0 )
+	{
+		Printf( "No tics have run yet.\n" );
+		return;
+	}
+
+	TArray<float> times;
+	DWORD ulSlow = 0;
+
+	times.Resize( g_ulWindowSize );
+
+	Printf( "The last %u tics:\n", g_ulWindowSize );
+	Printf( "%-16s %8s %8s %8s %8s %8s\n", "", "mean", "p50", "p95", "p99", "max" );
+
+	for ( unsigned int i = 0; i < g_ulWindowSize; i++ )
+	{
+		times[i] = g_TicWindow[i].fTotalMS;
+		if (( sv_slowticthreshold > 0 ) && ( times[i] > sv_slowticthreshold ))
+			ulSlow++;
+	}
+	watchdog_PrintStats( "tic", times );
+
+	for ( int phase = 0; phase < NUM_WATCHDOGPHASES; phase++ )
+	{
+		for ( unsigned int i = 0; i < g_ulWindowSize; i++ )
+			times[i] = g_TicWindow[i].fPhaseMS[phase];
+		watchdog_PrintStats( g_pszWatchdogPhaseNames[phase], times );
+	}
+
+	Printf( "%u slow tics in the last %u, %llu of %llu since the server started.\n", ulSlow, g_ulWindowSize,
+		static_cast<unsigned long long>( g_qwTotalSlowTics ), static_cast<unsigned long long>( g_qwTotalTics ));
+	Printf( "The slowest tic was %d at %.2f ms.\n", g_lWorstTic, g_fWorstTicMS );
+}
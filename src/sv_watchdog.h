@@ -0,0 +1,82 @@
+//-----------------------------------------------------------------------------
+//
+// Zandronum Source
+// Copyright (C) 2026 Zandronum Development Team
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice,
+//    this list of conditions and the following disclaimer.
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 3. Neither the name of the Zandronum Development Team nor the names of its
+//    contributors may be used to endorse or promote products derived from this
+//    software without specific prior written permission.
+// 4. Redistributions in any form must be accompanied by information on how to
+//    obtain complete source code for the software and any accompanying
+//    software that uses the software. The source code must either be included
+//    in the distribution or be available for no more than the cost of
+//    distribution plus a nominal fee, and must be freely redistributable
+//    under reasonable conditions. For an executable file, complete source
+//    code means the source code for all modules it contains. It does not
+//    include source code for modules or files that typically accompany the
+//    major components of the operating system on which the executable file
+//    runs.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+//
+//
+//
+// Filename: sv_watchdog.h
+//
+// Description: Times every server tic, keeps rolling statistics and reports
+// what the server was doing when a tic ran over its budget.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __SV_WATCHDOG_H__
+#define __SV_WATCHDOG_H__
+
+#include "doomtype.h"
+
+//*****************************************************************************
+//	DEFINES
+
+// The parts of a server tic that are timed separately.
+enum WATCHDOGPHASE_e
+{
+	WDP_RECEIVE,
+	WDP_TICKER,
+	WDP_WRITECOMMANDS,
+	WDP_SEND,
+	WDP_MASTER,
+	WDP_OTHER,
+
+	NUM_WATCHDOGPHASES
+};
+
+//*****************************************************************************
+//	PROTOTYPES
+
+void		SERVERWATCHDOG_BeginTic( void );
+void		SERVERWATCHDOG_SetPhase( WATCHDOGPHASE_e Phase );
+void		SERVERWATCHDOG_EndTic( void );
+float		SERVERWATCHDOG_GetLastTicMS( void );
+QWORD		SERVERWATCHDOG_BeginScript( void );
+void		SERVERWATCHDOG_EndScript( int lScript, QWORD qwStart );
+void		SERVERWATCHDOG_CountPacket( bool bOutbound, ULONG ulNumBytes );
+
+#endif // __SV_WATCHDOG_H__
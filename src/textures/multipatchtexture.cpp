@@ -162,6 +162,8 @@ public:
 	virtual void SetFrontSkyLayer ();
 
 	int CopyTrueColorPixels(FBitmap *bmp, int x, int y, int rotate, FCopyInfo *inf = NULL);
+	bool PrecachePrepare ();
+	void PrecacheCompose ();
 	int GetSourceLump() { return DefinitionLump; }
 	FTexture *GetRedirect(bool wantwarped);
 	FTexture *GetRawTexture();
@@ -544,6 +546,51 @@ void FMultiPatchTexture::MakeTexture ()
 	}
 }
 
+//==========================================================================
+//
+// FMultiPatchTexture :: PrecachePrepare
+//
+// [dorch] Loads every patch so that MakeTexture only has to copy them.
+// Translucent patches are composed in true color, which may read lumps
+// again, and warped or camera patches change by themselves, so textures
+// with any of those are left to the main thread.
+//
+//==========================================================================
+
+bool FMultiPatchTexture::PrecachePrepare ()
+{
+	if (bRedirect || Pixels != NULL)
+	{
+		return false;
+	}
+	for (int i = 0; i < NumParts; ++i)
+	{
+		if (Parts[i].op != OP_COPY || Parts[i].Texture->bHasCanvas || Parts[i].Texture->bWarped)
+		{
+			return false;
+		}
+	}
+	for (int i = 0; i < NumParts; ++i)
+	{
+		Parts[i].Texture->GetPixels ();
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// FMultiPatchTexture :: PrecacheCompose
+//
+//==========================================================================
+
+void FMultiPatchTexture::PrecacheCompose ()
+{
+	if (Pixels == NULL)
+	{
+		MakeTexture ();
+	}
+}
+
 //===========================================================================
 //
 // FMultipatchTexture::CopyTrueColorPixels
@@ -215,6 +215,15 @@ void FTexture::HackHack (int newheight)
 {
 }
 
+bool FTexture::PrecachePrepare ()
+{
+	return false;
+}
+
+void FTexture::PrecacheCompose ()
+{
+}
+
 FTexture::Span **FTexture::CreateSpans (const BYTE *pixels) const
 {
 	Span **spans, *span;
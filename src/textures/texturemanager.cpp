@@ -53,6 +53,8 @@
 #include "r_renderer.h"
 #include "r_sky.h"
 #include "textures/textures.h"
+#include "r_thread.h"
+#include "stats.h"
 // [BB] New #includes.
 #include "cl_demo.h"
 
@@ -1216,6 +1218,46 @@ int FTextureManager::CountLumpTextures (int lumpnum)
 	return 0;
 }
 
+//===========================================================================
+//
+// Level precaching
+//
+// [dorch] Multipatch textures are composed on the render threads before
+// the rest is precached one by one, and the total size of what gets
+// precached can be limited.
+//
+//===========================================================================
+
+// Threads composing textures. 0 uses one per CPU.
+CUSTOM_CVAR (Int, precache_threads, 0, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+{
+	if (self < 0)
+	{
+		self = 0;
+	}
+	else if (self > MAX_RENDER_THREADS)
+	{
+		self = MAX_RENDER_THREADS;
+	}
+}
+
+// Limit in megabytes for the pixels of precached textures. 0 means no limit.
+CUSTOM_CVAR (Int, precache_maxmemory, 256, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+{
+	if (self < 0)
+	{
+		self = 0;
+	}
+}
+
+static TArray<FTexture *> PrecacheJobs;
+static FString PrecacheReport;
+
+static void PrecacheComposeSlice (int slice, int numslices, void *data)
+{
+	PrecacheJobs[slice]->PrecacheCompose ();
+}
+
 //===========================================================================
 //
 // R_PrecacheLevel
@@ -1229,6 +1271,7 @@ void FTextureManager::PrecacheLevel (void)
 {
 	BYTE *hitlist;
 	int cnt = NumTextures();
+	int i;
 
 	// [BC] The server doesn't need to precache the level.
 	if ( NETWORK_GetState( ) == NETSTATE_SERVER )
@@ -1238,19 +1281,117 @@ void FTextureManager::PrecacheLevel (void)
 	if (demoplayback || CLIENTDEMO_IsPlaying( ))
 		return;
 
+	cycle_t totaltime, composetime;
+	totaltime.Reset();
+	composetime.Reset();
+	totaltime.Clock();
+
 	hitlist = new BYTE[cnt];
 	memset (hitlist, 0, cnt);
 
 	screen->GetHitlist(hitlist);
-	for (int i = cnt - 1; i >= 0; i--)
+
+	// [dorch] Free what isn't needed first, then pick the textures to keep
+	// until the memory limit is reached. Walls and flats come before
+	// sprites, so those are what is left to load on demand.
+	const size_t limit = precache_maxmemory > 0 ? size_t(*precache_maxmemory) << 20 : ~size_t(0);
+	size_t total = 0;
+	int numcached = 0, numskipped = 0;
+	int numthreads = 1;
+
+	for (i = cnt - 1; i >= 0; i--)
+	{
+		if (hitlist[i] == 0)
+		{
+			Renderer->PrecacheTexture(ByIndex(i), 0);
+		}
+	}
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (i = cnt - 1; i >= 0; i--)
+		{
+			FTexture *tex = ByIndex(i);
+			if (hitlist[i] == 0 || tex == NULL)
+			{
+				continue;
+			}
+			const bool sprite = tex->UseType == FTexture::TEX_Sprite || tex->UseType == FTexture::TEX_SkinSprite;
+			if (sprite != (pass == 1))
+			{
+				continue;
+			}
+			const size_t size = size_t(tex->GetWidth()) * tex->GetHeight();
+			if (total + size > limit)
+			{
+				hitlist[i] = 0;
+				numskipped++;
+			}
+			else
+			{
+				total += size;
+				numcached++;
+			}
+		}
+	}
+
+	// [dorch] The software renderer uses the composed 8-bit pixels, so make
+	// those in parallel. Everything they are built from is loaded here first,
+	// since reading lumps is not thread-safe. Spans are allocated with
+	// M_Malloc, so they are left to PrecacheTexture below.
+	if (currentrenderer == 0)
 	{
-		Renderer->PrecacheTexture(ByIndex(i), hitlist[i]);
+		PrecacheJobs.Clear();
+		for (i = cnt - 1; i >= 0; i--)
+		{
+			FTexture *tex = ByIndex(i);
+			if (hitlist[i] != 0 && tex != NULL && tex->PrecachePrepare())
+			{
+				PrecacheJobs.Push (tex);
+			}
+		}
+		if (PrecacheJobs.Size() > 0)
+		{
+			composetime.Clock();
+			R_SetRenderThreadOverride (precache_threads > 0 ? *precache_threads : -1);
+			numthreads = R_GetRenderThreadCount();
+			R_RunSlices (PrecacheJobs.Size(), PrecacheComposeSlice, NULL);
+			R_SetRenderThreadOverride (0);
+			composetime.Unclock();
+		}
+	}
+
+	for (i = cnt - 1; i >= 0; i--)
+	{
+		if (hitlist[i] != 0)
+		{
+			Renderer->PrecacheTexture(ByIndex(i), hitlist[i]);
+		}
 	}
 
 	delete[] hitlist;
-}
 
+	totaltime.Unclock();
+	PrecacheReport.Format ("Precached %d textures (%.1f MB) in %.1f ms, composed %u of them in %.1f ms on %d threads",
+		numcached, total / 1048576., totaltime.TimeMS(), PrecacheJobs.Size(), composetime.TimeMS(), numthreads);
+	if (numskipped > 0)
+	{
+		PrecacheReport.AppendFormat (", %d left out over precache_maxmemory", numskipped);
+	}
+	PrecacheJobs.Clear();
+	DPrintf ("%s\n", PrecacheReport.GetChars());
+}
 
+CCMD (precachestats)
+{
+	if (PrecacheReport.IsEmpty())
+	{
+		Printf ("No level has been precached yet.\n");
+	}
+	else
+	{
+		Printf ("%s.\n", PrecacheReport.GetChars());
+	}
+}
 
 
 //==========================================================================
@@ -302,6 +302,12 @@ public:
 
 	virtual void HackHack (int newheight);	// called by FMultipatchTexture to discover corrupt patches.
 
+	// [dorch] Level precaching. PrecachePrepare loads everything the texture
+	// is built from and returns true if PrecacheCompose may then be called on
+	// a worker thread, at the same time as for other prepared textures.
+	virtual bool PrecachePrepare ();
+	virtual void PrecacheCompose ();
+
 protected:
 	WORD Width, Height, WidthMask;
 	static BYTE GrayMap[256];
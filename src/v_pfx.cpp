@@ -32,10 +32,42 @@
 **
 */
 
+#include <string.h>
+#include <stdlib.h>
+
 #include "doomtype.h"
 #include "i_system.h"
 #include "v_palette.h"
 #include "v_pfx.h"
+#include "v_text.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "templates.h"
+#include "stats.h"
+#include "x86.h"
+
+// [dorch] SSE2 and AVX2 versions of Convert32. They are picked at run time
+// from what the CPU supports and produce the same pixels as the C version.
+#if defined(__SSE2__) || defined(_M_X64)
+#define PFX_SIMD
+#include <emmintrin.h>
+#include <immintrin.h>
+
+// The AVX2 functions are compiled for AVX2 regardless of the compiler flags
+// and are only called when CPUID says the CPU has it.
+#if defined(__GNUC__) || defined(__clang__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+#endif
+
+enum
+{
+	PFX_SIMD_NONE,
+	PFX_SIMD_SSE2,
+	PFX_SIMD_AVX2,
+};
 
 extern "C"
 {
@@ -67,6 +99,80 @@ static void Convert24 (BYTE *src, int srcpitch,
 static void Convert32 (BYTE *src, int srcpitch,
 	void *destin, int destpitch, int destwidth, int destheight,
 	fixed_t xstep, fixed_t ystep, fixed_t xfrac, fixed_t yfrac);
+#ifdef PFX_SIMD
+static void Convert32_SSE2 (BYTE *src, int srcpitch,
+	void *destin, int destpitch, int destwidth, int destheight,
+	fixed_t xstep, fixed_t ystep, fixed_t xfrac, fixed_t yfrac);
+static void Convert32_AVX2 (BYTE *src, int srcpitch,
+	void *destin, int destpitch, int destwidth, int destheight,
+	fixed_t xstep, fixed_t ystep, fixed_t xfrac, fixed_t yfrac);
+#endif
+
+typedef void (*PfxConvertFunc) (BYTE *src, int srcpitch,
+	void *destin, int destpitch, int destwidth, int destheight,
+	fixed_t xstep, fixed_t ystep, fixed_t xfrac, fixed_t yfrac);
+
+// Convert32 for each PFX_SIMD_ level.
+static const PfxConvertFunc Convert32Levels[] =
+{
+	Convert32,
+#ifdef PFX_SIMD
+	Convert32_SSE2,
+	Convert32_AVX2,
+#else
+	Convert32,
+	Convert32,
+#endif
+};
+static const char *const PfxSIMDNames[] = { "C", "SSE2", "AVX2" };
+
+static PfxConvertFunc GetConvert32 ();
+
+// [dorch] Highest instruction set the 8 to 32-bit conversion may use:
+// 0 = plain C, 1 = SSE2, 2 = AVX2 (falls back to SSE2 if the CPU doesn't
+// have it).
+CUSTOM_CVAR (Int, vid_simdconvert, PFX_SIMD_AVX2, CVAR_ARCHIVE|CVAR_GLOBALCONFIG|CVAR_NOINITCALL)
+{
+	if (self < PFX_SIMD_NONE)
+	{
+		self = PFX_SIMD_NONE;
+	}
+	else if (self > PFX_SIMD_AVX2)
+	{
+		self = PFX_SIMD_AVX2;
+	}
+	else
+	{
+		for (unsigned int i = 0; i < countof(Convert32Levels); ++i)
+		{
+			if (GPfx.Convert == Convert32Levels[i])
+			{
+				GPfx.Convert = GetConvert32 ();
+				break;
+			}
+		}
+	}
+}
+
+static int GetPfxSIMDLevel ()
+{
+#ifdef PFX_SIMD
+	int level = vid_simdconvert;
+
+	if (level >= PFX_SIMD_AVX2 && !CPU.bAVX2)
+	{
+		level = PFX_SIMD_SSE2;
+	}
+	return level;
+#else
+	return PFX_SIMD_NONE;
+#endif
+}
+
+static PfxConvertFunc GetConvert32 ()
+{
+	return Convert32Levels[GetPfxSIMDLevel ()];
+}
 
 void PfxState::SetFormat (int bits, uint32 redMask, uint32 greenMask, uint32 blueMask)
 {
@@ -131,7 +237,7 @@ void PfxState::SetFormat (int bits, uint32 redMask, uint32 greenMask, uint32 blu
 		{
 			SetPalette = Palette32Generic;
 		}
-		Convert = Convert32;
+		Convert = GetConvert32 ();
 		Masks.Bits32.Red = redMask;
 		Masks.Bits32.Green = greenMask;
 		Masks.Bits32.Blue = blueMask;
@@ -689,3 +795,309 @@ static void Convert32 (BYTE *src, int srcpitch,
 		}
 	}
 }
+
+#ifdef PFX_SIMD
+
+// SIMD Convert32 ----------------------------------------------------------
+//
+// Besides the 1:1 copy, these handle integer scaling: xstep == ystep ==
+// FRACUNIT / n with no starting fraction. Only powers of two divide
+// FRACUNIT, so n is 2, 4, 8, etc. Every destination pixel is then
+// Pal32[src[x / n]] and each source row covers n destination rows, so one
+// row is expanded and the others are copies of it. Everything else goes
+// through the C version.
+
+typedef void (*PfxConvertRow) (const BYTE *src, DWORD *dest, int width);
+typedef void (*PfxScaleRow) (const BYTE *src, DWORD *dest, int width, int scale);
+
+static void ScaleRow32_C (const BYTE *src, DWORD *dest, int width, int scale, int x)
+{
+	for (; x < width; ++x)
+	{
+		dest[x] = GPfxPal.Pal32[src[x / scale]];
+	}
+}
+
+static inline void Convert32Rows (PfxConvertRow convertrow, PfxScaleRow scalerow,
+	BYTE *src, int srcpitch,
+	void *destin, int destpitch, int destwidth, int destheight,
+	fixed_t xstep, fixed_t ystep, fixed_t xfrac, fixed_t yfrac)
+{
+	if ((destwidth | destheight) == 0)
+	{
+		return;
+	}
+
+	BYTE *dest = (BYTE *)destin;
+	int y;
+
+	if (xstep == FRACUNIT && ystep == FRACUNIT)
+	{
+		for (y = destheight; y != 0; y--)
+		{
+			convertrow (src, (DWORD *)dest, destwidth);
+			src += srcpitch;
+			dest += destpitch;
+		}
+	}
+	else if (xstep == ystep && xfrac == 0 && yfrac == 0 &&
+		xstep > 0 && xstep < FRACUNIT && FRACUNIT % xstep == 0)
+	{
+		const int scale = FRACUNIT / xstep;
+		const size_t rowsize = destwidth * sizeof(DWORD);
+
+		for (y = 0; y < destheight; y += scale)
+		{
+			scalerow (src, (DWORD *)dest, destwidth, scale);
+			for (int i = 1; i < scale && y + i < destheight; ++i)
+			{
+				memcpy (dest + i * destpitch, dest, rowsize);
+			}
+			src += srcpitch;
+			dest += scale * destpitch;
+		}
+	}
+	else
+	{
+		Convert32 (src, srcpitch, destin, destpitch, destwidth, destheight, xstep, ystep, xfrac, yfrac);
+	}
+}
+
+// SSE2 has no gather, so the lookups stay scalar and only the stores and
+// the pixel doubling are vectorized.
+
+static inline __m128i Lookup4_SSE2 (const BYTE *src)
+{
+	const DWORD *pal = GPfxPal.Pal32;
+	return _mm_setr_epi32 (pal[src[0]], pal[src[1]], pal[src[2]], pal[src[3]]);
+}
+
+static void ConvertRow32_SSE2 (const BYTE *src, DWORD *dest, int width)
+{
+	int x;
+
+	for (x = 0; x + 8 <= width; x += 8)
+	{
+		_mm_storeu_si128 ((__m128i *)(dest + x), Lookup4_SSE2 (src + x));
+		_mm_storeu_si128 ((__m128i *)(dest + x + 4), Lookup4_SSE2 (src + x + 4));
+	}
+	for (; x < width; ++x)
+	{
+		dest[x] = GPfxPal.Pal32[src[x]];
+	}
+}
+
+static void ScaleRow32_SSE2 (const BYTE *src, DWORD *dest, int width, int scale)
+{
+	int x = 0;
+
+	if (scale == 2)
+	{
+		for (; x + 8 <= width; x += 8, src += 4)
+		{
+			__m128i c = Lookup4_SSE2 (src);
+			_mm_storeu_si128 ((__m128i *)(dest + x), _mm_unpacklo_epi32 (c, c));
+			_mm_storeu_si128 ((__m128i *)(dest + x + 4), _mm_unpackhi_epi32 (c, c));
+		}
+		ScaleRow32_C (src - x / 2, dest, width, scale, x);
+	}
+	else if (scale == 4)
+	{
+		for (; x + 16 <= width; x += 16, src += 4)
+		{
+			__m128i c = Lookup4_SSE2 (src);
+			_mm_storeu_si128 ((__m128i *)(dest + x), _mm_shuffle_epi32 (c, _MM_SHUFFLE(0,0,0,0)));
+			_mm_storeu_si128 ((__m128i *)(dest + x + 4), _mm_shuffle_epi32 (c, _MM_SHUFFLE(1,1,1,1)));
+			_mm_storeu_si128 ((__m128i *)(dest + x + 8), _mm_shuffle_epi32 (c, _MM_SHUFFLE(2,2,2,2)));
+			_mm_storeu_si128 ((__m128i *)(dest + x + 12), _mm_shuffle_epi32 (c, _MM_SHUFFLE(3,3,3,3)));
+		}
+		ScaleRow32_C (src - x / 4, dest, width, scale, x);
+	}
+	else
+	{
+		ScaleRow32_C (src, dest, width, scale, 0);
+	}
+}
+
+static void Convert32_SSE2 (BYTE *src, int srcpitch,
+	void *destin, int destpitch, int destwidth, int destheight,
+	fixed_t xstep, fixed_t ystep, fixed_t xfrac, fixed_t yfrac)
+{
+	Convert32Rows (ConvertRow32_SSE2, ScaleRow32_SSE2, src, srcpitch,
+		destin, destpitch, destwidth, destheight, xstep, ystep, xfrac, yfrac);
+}
+
+// AVX2 looks up eight pixels at once with a gather. The palette is only 1K,
+// so it stays in L1 and the gather beats eight scalar loads.
+
+static inline AVX2_TARGET __m256i Lookup8_AVX2 (const BYTE *src)
+{
+	__m256i index = _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i *)src));
+	return _mm256_i32gather_epi32 ((const int *)GPfxPal.Pal32, index, 4);
+}
+
+static AVX2_TARGET void ConvertRow32_AVX2 (const BYTE *src, DWORD *dest, int width)
+{
+	int x;
+
+	for (x = 0; x + 16 <= width; x += 16)
+	{
+		_mm256_storeu_si256 ((__m256i *)(dest + x), Lookup8_AVX2 (src + x));
+		_mm256_storeu_si256 ((__m256i *)(dest + x + 8), Lookup8_AVX2 (src + x + 8));
+	}
+	for (; x < width; ++x)
+	{
+		dest[x] = GPfxPal.Pal32[src[x]];
+	}
+}
+
+static AVX2_TARGET void ScaleRow32_AVX2 (const BYTE *src, DWORD *dest, int width, int scale)
+{
+	if (scale > 8)
+	{
+		ScaleRow32_C (src, dest, width, scale, 0);
+		return;
+	}
+
+	// Eight looked up pixels make 8*scale destination pixels. Output
+	// vector k holds pixels (8k + j) / scale.
+	__m256i spread[8];
+	int x, k;
+
+	for (k = 0; k < scale; ++k)
+	{
+		int index[8];
+		for (int j = 0; j < 8; ++j)
+		{
+			index[j] = (8 * k + j) / scale;
+		}
+		spread[k] = _mm256_loadu_si256 ((const __m256i *)index);
+	}
+	for (x = 0; x + 8 * scale <= width; x += 8 * scale, src += 8)
+	{
+		__m256i c = Lookup8_AVX2 (src);
+		for (k = 0; k < scale; ++k)
+		{
+			_mm256_storeu_si256 ((__m256i *)(dest + x + 8 * k), _mm256_permutevar8x32_epi32 (c, spread[k]));
+		}
+	}
+	ScaleRow32_C (src - x / scale, dest, width, scale, x);
+}
+
+static AVX2_TARGET void Convert32_AVX2 (BYTE *src, int srcpitch,
+	void *destin, int destpitch, int destwidth, int destheight,
+	fixed_t xstep, fixed_t ystep, fixed_t xfrac, fixed_t yfrac)
+{
+	Convert32Rows (ConvertRow32_AVX2, ScaleRow32_AVX2, src, srcpitch,
+		destin, destpitch, destwidth, destheight, xstep, ystep, xfrac, yfrac);
+}
+
+#endif // PFX_SIMD
+
+//==========================================================================
+//
+// CCMD vid_benchconvert
+//
+// [dorch] Times the 8 to 32-bit conversion with each instruction set at
+// the usual capture sizes, 1:1 and scaled up 2x and 4x, and checks that
+// the SIMD versions match the C one.
+//
+//==========================================================================
+
+CCMD (vid_benchconvert)
+{
+	static const struct { int Width, Height; } sizes[] =
+	{
+		{ 480, 320 },
+		{ 1920, 1080 },
+		{ 3840, 2160 },
+	};
+	static const int scales[] = { 1, 2, 4 };
+
+	// The iteration count is for 1080p and is scaled for the other sizes,
+	// so each one converts about the same number of pixels.
+	const int iterations = argv.argc() > 1 ? clamp (atoi (argv[1]), 1, 10000) : 50;
+#ifdef PFX_SIMD
+	const int numlevels = CPU.bAVX2 ? 3 : 2;
+#else
+	const int numlevels = 1;
+#endif
+	const PfxUnion savedpal = GPfxPal;
+	DWORD seed = 0x5c2f6a13;
+	int i;
+
+	// Random but repeatable inputs.
+	for (i = 0; i < 256; ++i)
+	{
+		GPfxPal.Pal32[i] = seed = seed * 1664525 + 1013904223;
+	}
+
+	Printf ("Converting 8 to 32 bits, %d iterations at 1080p:\n", iterations);
+	for (unsigned int s = 0; s < countof(sizes); ++s)
+	{
+		const int width = sizes[s].Width;
+		const int height = sizes[s].Height;
+		const int reps = MAX (1, int(iterations * (1920. * 1080.) / (width * height)));
+		DWORD *dest = new DWORD[width * height];
+		DWORD *result = new DWORD[width * height];
+
+		for (unsigned int sc = 0; sc < countof(scales); ++sc)
+		{
+			const int scale = scales[sc];
+			const int srcwidth = (width + scale - 1) / scale;
+			const int srcheight = (height + scale - 1) / scale;
+			const fixed_t step = FRACUNIT / scale;
+			BYTE *src = new BYTE[srcwidth * srcheight];
+			FString line;
+			double basems = 0;
+
+			for (i = 0; i < srcwidth * srcheight; ++i)
+			{
+				src[i] = (seed = seed * 1664525 + 1013904223) >> 24;
+			}
+
+			line.Format ("%4dx%-4d %dx", width, height, scale);
+			for (int level = 0; level < numlevels; ++level)
+			{
+				PfxConvertFunc convert = Convert32Levels[level];
+				cycle_t cycles;
+				bool match = true;
+
+				convert (src, srcwidth, dest, width * 4, width, height, step, step, 0, 0);
+				if (level == 0)
+				{
+					memcpy (result, dest, width * height * sizeof(DWORD));
+				}
+				else
+				{
+					match = memcmp (result, dest, width * height * sizeof(DWORD)) == 0;
+				}
+
+				cycles.Reset ();
+				cycles.Clock ();
+				for (i = 0; i < reps; ++i)
+				{
+					convert (src, srcwidth, dest, width * 4, width, height, step, step, 0, 0);
+				}
+				cycles.Unclock ();
+
+				const double ms = cycles.TimeMS () / reps;
+				if (level == 0)
+				{
+					basems = ms;
+				}
+				line.AppendFormat ("  %s %7.3f ms %5.0f Mpix/s", PfxSIMDNames[level], ms,
+					ms > 0 ? width * height / (ms * 1000.) : 0.);
+				if (level > 0)
+				{
+					line.AppendFormat (" (%.2fx)%s", ms > 0 ? basems / ms : 0., match ? "" : TEXTCOLOR_RED " MISMATCH" TEXTCOLOR_NORMAL);
+				}
+			}
+			Printf ("%s\n", line.GetChars());
+			delete[] src;
+		}
+		delete[] dest;
+		delete[] result;
+	}
+	GPfxPal = savedpal;
+}
@@ -1229,9 +1229,28 @@ void DFrameBuffer::GetHitlist(BYTE *hitlist)
 	{
 		AActor *actor;
 		TThinkerIterator<AActor> iterator;
+		TMap<const PClass *, bool> seenclasses;
 
 		while ( (actor = iterator.Next ()) )
+		{
 			spritelist[actor->sprite] = 1;
+
+			// [dorch] Also every sprite the actor's states use, so that things
+			// like its pain and death frames don't have to be loaded the first
+			// time they are seen.
+			const PClass *type = actor->GetClass();
+			if (seenclasses.CheckKey(type) != NULL)
+				continue;
+			seenclasses[type] = true;
+			for (; type != NULL && type->ActorInfo != NULL; type = type->ParentClass)
+			{
+				const FActorInfo *info = type->ActorInfo;
+				for (int j = 0; j < info->NumOwnedStates; j++)
+				{
+					spritelist[info->OwnedStates[j].sprite] = 1;
+				}
+			}
+		}
 	}
 
 	for (i = (int)(sprites.Size () - 1); i >= 0; i--)
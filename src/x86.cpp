@@ -35,16 +35,39 @@ void DumpCPUInfo(const CPUInfo *cpu)
 						 "xchgl\t%%ebx, %1\n\t" \
 		: "=a" ((output)[0]), "=r" ((output)[1]), "=c" ((output)[2]), "=d" ((output)[3]) \
 		: "a" (func));
+#define __cpuidex(output, func, sub) \
+	__asm__ __volatile__("xchgl\t%%ebx, %1\n\t" \
+						 "cpuid\n\t" \
+						 "xchgl\t%%ebx, %1\n\t" \
+		: "=a" ((output)[0]), "=r" ((output)[1]), "=c" ((output)[2]), "=d" ((output)[3]) \
+		: "a" (func), "c" (sub));
 #else
 #define __cpuid(output, func) __asm__ __volatile__("cpuid" : "=a" ((output)[0]),\
 	"=b" ((output)[1]), "=c" ((output)[2]), "=d" ((output)[3]) : "a" (func));
+#define __cpuidex(output, func, sub) __asm__ __volatile__("cpuid" : "=a" ((output)[0]),\
+	"=b" ((output)[1]), "=c" ((output)[2]), "=d" ((output)[3]) : "a" (func), "c" (sub));
 #endif
 #endif
 
+// [dorch] Reads the OS-enabled register state mask (XCR0). Only call this if
+// CPUID reports OSXSAVE.
+static unsigned int GetXCR0()
+{
+#ifdef _MSC_VER
+	return (unsigned int)_xgetbv(0);
+#else
+	unsigned int eax, edx;
+	// xgetbv, spelled out for assemblers that don't know it.
+	__asm__ __volatile__(".byte 0x0f, 0x01, 0xd0" : "=a" (eax), "=d" (edx) : "c" (0));
+	return eax;
+#endif
+}
+
 void CheckCPUID(CPUInfo *cpu)
 {
 	int foo[4];
 	unsigned int maxext;
+	unsigned int maxbasic;
 
 	memset(cpu, 0, sizeof(*cpu));
 
@@ -96,6 +119,7 @@ haveid:
 
 	// Get vendor ID
 	__cpuid(foo, 0);
+	maxbasic = (unsigned int)foo[0];
 	cpu->dwVendorID[0] = foo[1];
 	cpu->dwVendorID[1] = foo[3];
 	cpu->dwVendorID[2] = foo[2];
@@ -132,6 +156,17 @@ haveid:
 		cpu->Model |= (foo[0] >> 12) & 0xF0;
 	}
 
+	// [dorch] AVX2 also needs the OS to save the YMM registers (OSXSAVE and
+	// the SSE/AVX bits of XCR0) before it can be used.
+	if (maxbasic >= 7 && (cpu->FeatureFlags[1] & (1 << 27)) && (cpu->FeatureFlags[1] & (1 << 28)))
+	{
+		if ((GetXCR0() & 6) == 6)
+		{
+			__cpuidex(foo, 7, 0);
+			cpu->bAVX2 = (foo[1] >> 5) & 1;
+		}
+	}
+
 	// Check for extended functions.
 	__cpuid(foo, 0x80000000);
 	maxext = (unsigned int)foo[0];
@@ -221,6 +256,7 @@ void DumpCPUInfo(const CPUInfo *cpu)
 		if (cpu->bSSSE3)		Printf(" SSSE3");
 		if (cpu->bSSE41)		Printf(" SSE4.1");
 		if (cpu->bSSE42)		Printf(" SSE4.2");
+		if (cpu->bAVX2)			Printf(" AVX2");
 		if (cpu->b3DNow)		Printf(" 3DNow!");
 		if (cpu->b3DNowPlus)	Printf(" 3DNow!+");
 		Printf ("\n");
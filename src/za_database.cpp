@@ -49,7 +49,16 @@
 #include "i_system.h"
 #include "g_game.h"
 #include "p_acs.h"
+#include "templates.h"
 #include <sqlite3.h>
+#include <stdarg.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
 
 //*****************************************************************************
 //	DEFINES
@@ -58,6 +67,26 @@
 
 #define TIMEQUERY "SELECT (julianday('now') - 2440587.5)*86400.0"
 
+// [dorch] The statements the write-behind queue uses.
+#define UPSERTQUERY "INSERT INTO " TABLENAME " VALUES(?1,?2,?3,(" TIMEQUERY ")) ON CONFLICT(Namespace,KeyName) DO UPDATE SET Value=excluded.Value,Timestamp=excluded.Timestamp"
+#define ENTRYQUERY "SELECT * FROM " TABLENAME " WHERE Namespace=?1 AND KeyName=?2"
+#define DELETEQUERY "DELETE FROM " TABLENAME " WHERE Namespace=?1 AND KeyName=?2"
+
+// [dorch] The read cache is dropped once it holds this many entries.
+#define MAX_CACHED_ENTRIES 65536
+
+// [dorch] How many entries of a namespace are loaded into its rank index
+// every tic.
+#define RANKINDEX_ROWS_PER_TIC 1024
+
+//*****************************************************************************
+//	PROTOTYPES
+
+static	void	database_StartWriter ( void );
+static	void	database_StopWriter ( void );
+static	void	database_Error ( const char *Format, ... ) GCCPRINTF(1,2);
+static	void	database_ClearRankIndexes ( void );
+
 //*****************************************************************************
 //	VARIABLES
 
@@ -77,23 +106,149 @@ CUSTOM_CVAR( Int, database_maxpagecount, 32768, CVAR_ARCHIVE|CVAR_NOSETBYACS )
 		DATABASE_SetMaxPageCount ( self );
 }
 
-//*****************************************************************************
-//	PROTOTYPES
+// [dorch] Writes entries from a background thread, batched into transactions,
+// instead of waiting for the disk on the game thread. Writes that are still
+// queued are lost if the game crashes.
+CUSTOM_CVAR( Bool, database_writebehind, true, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+{
+	if ( self )
+		database_StartWriter ( );
+	else
+		database_StopWriter ( );
+}
+
+// [dorch] How long the writer collects writes before it commits them, in ms.
+CUSTOM_CVAR( Int, database_writeinterval, 1000, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+{
+	if ( self < 0 )
+		self = 0;
+}
+
+// [dorch] Most entries that may wait to be written. When more are queued, the
+// game waits for the writer.
+CUSTOM_CVAR( Int, database_maxqueue, 4096, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+{
+	if ( self < 1 )
+		self = 1;
+}
+
+// [dorch] Namespaces with more entries than this are ranked by SQLite instead
+// of in memory. 0 always uses SQLite. A namespace is loaded into memory over
+// several tics the first time it's ranked or sorted, RANKINDEX_ROWS_PER_TIC
+// entries per tic, and SQLite is used until it's done. Every entry costs
+// about a hundred bytes.
+CUSTOM_CVAR( Int, database_rankindexlimit, 2000000, CVAR_ARCHIVE|CVAR_NOSETBYACS )
+{
+	if ( self < 0 )
+		self = 0;
+	database_ClearRankIndexes ( );
+}
 
+// [dorch] Guards g_db and the prepared statements. The writer holds it while
+// it commits a batch.
+static	std::recursive_mutex	g_DatabaseMutex;
+
+// [dorch] A prepared statement that is kept until the database is closed.
+struct DataBaseStatement
+{
+	sqlite3_stmt	*Stmt;
+	bool			bInUse;
+};
+
+// [dorch] The writer thread prepares statements too, so this can't be a TMap,
+// which allocates with M_Malloc.
+static	std::unordered_map<std::string, DataBaseStatement>	g_Statements;
+
+// [dorch] The last known state of the entries the game has looked up or
+// written. Only used by the game thread. Every entry with a queued write is
+// in here, so the database only has to be asked about the others.
+struct DataBaseCacheEntry
+{
+	FString		Value;
+	bool		bExists;
+};
+
+static	TMap<FString, DataBaseCacheEntry>	g_EntryCache;
+
+// [dorch] An entry that waits to be written. Deleted entries have no value.
+// These are handed over to the writer thread, so they don't use the
+// reference counted FString.
+struct DataBasePendingWrite
+{
+	std::string		Namespace;
+	std::string		EntryName;
+	std::string		Value;
+	bool			bDelete;
+};
+
+typedef std::unordered_map<std::string, DataBasePendingWrite> DataBaseWriteQueue;
+
+// [dorch] The write-behind queue, guarded by g_QueueMutex.
+static	std::thread					g_WriterThread;
+static	std::mutex					g_QueueMutex;
+static	std::condition_variable		g_QueueChanged;
+static	std::condition_variable		g_QueueWritten;
+static	DataBaseWriteQueue			g_WriteQueue;
+static	bool						g_bWriterRunning = false;
+static	bool						g_bWriterQuit = false;
+static	bool						g_bFlushRequested = false;
+static	bool						g_bWriterBusy = false;
+static	std::string					g_WriterErrors;
+static	thread_local bool			g_bIsWriterThread = false;
+
+// [dorch] Statistics for db_stats.
+static	unsigned int				g_ulCacheHits = 0;
+static	unsigned int				g_ulCacheMisses = 0;
+static	unsigned int				g_ulQueuedWrites = 0;
+static	unsigned int				g_ulWrittenEntries = 0;
+static	unsigned int				g_ulWrittenBatches = 0;
+static	unsigned int				g_ulQueueStalls = 0;
+
+//*****************************************************************************
+//
 /**
  * \brief Handles the preparation, binding and execution of an SQLite command.
  *
+ * [dorch] Statements are prepared once and reused until the database is
+ * closed. The command holds the database lock while it exists.
+ *
  * \author Benjamin Berkels
  */
 class DataBaseCommand
 {
+	std::lock_guard<std::recursive_mutex> _lock;
 	sqlite3_stmt *_stmt;
+	DataBaseStatement *_cached;
 public:
-	DataBaseCommand ( const char *Command ) : _stmt ( NULL )
+	DataBaseCommand ( const char *Command ) : _lock ( g_DatabaseMutex ), _stmt ( NULL ), _cached ( NULL )
 	{
-		int error = sqlite3_prepare ( g_db, Command, -1, &_stmt, NULL );
+		std::unordered_map<std::string, DataBaseStatement>::iterator it = g_Statements.find ( Command );
+		DataBaseStatement *cached = ( it != g_Statements.end() ) ? &it->second : NULL;
+
+		// [dorch] A statement can't be stepped by two commands at once, so
+		// a nested command with the same query gets its own one.
+		if ( cached && ( cached->bInUse == false ) )
+		{
+			_cached = cached;
+			_cached->bInUse = true;
+			_stmt = _cached->Stmt;
+			return;
+		}
+
+		int error = sqlite3_prepare_v2 ( g_db, Command, -1, &_stmt, NULL );
 		if ( error != SQLITE_OK )
-			Printf ( "Could not prepare statement. Error: %s\n", sqlite3_errmsg ( g_db ) );
+		{
+			database_Error ( "Could not prepare statement. Error: %s\n", sqlite3_errmsg ( g_db ) );
+			return;
+		}
+
+		if ( cached == NULL )
+		{
+			DataBaseStatement &statement = g_Statements[Command];
+			statement.Stmt = _stmt;
+			statement.bInUse = true;
+			_cached = &statement;
+		}
 	}
 
 	~DataBaseCommand ( )
@@ -105,31 +260,44 @@ public:
 	{
 		int error = sqlite3_bind_text ( _stmt, Index, String, -1, SQLITE_STATIC );
 		if ( error != SQLITE_OK )
-			Printf ( "Could not bind text. Error: %s\n", sqlite3_errmsg ( g_db ) );
+			database_Error ( "Could not bind text. Error: %s\n", sqlite3_errmsg ( g_db ) );
 	}
 
 	void bindInt ( const int Index, const int IntValue )
 	{
 		int error = sqlite3_bind_int ( _stmt, Index, IntValue );
 		if ( error != SQLITE_OK )
-			Printf ( "Could not bind integer. Error: %s\n", sqlite3_errmsg ( g_db ) );
+			database_Error ( "Could not bind integer. Error: %s\n", sqlite3_errmsg ( g_db ) );
 	}
 
 	void finalize ( )
 	{
-		if ( _stmt != NULL )
+		if ( _stmt == NULL )
+			return;
+
+		// [dorch] Cached statements are only reset, so they can be used again.
+		if ( _cached != NULL )
 		{
-			sqlite3_finalize ( _stmt );
-			_stmt = NULL;
+			sqlite3_reset ( _stmt );
+			sqlite3_clear_bindings ( _stmt );
+			_cached->bInUse = false;
+			_cached = NULL;
 		}
+		else
+			sqlite3_finalize ( _stmt );
+
+		_stmt = NULL;
 	}
 
 	bool step ( )
 	{
+		if ( _stmt == NULL )
+			return false;
+
 		const int result = sqlite3_step ( _stmt );
 		if ( ( result != SQLITE_ROW ) && ( result != SQLITE_DONE ) )
 		{
-			Printf ( "Could not step statement. Error: %s\n", sqlite3_errmsg ( g_db ) );
+			database_Error ( "Could not step statement. Error: %s\n", sqlite3_errmsg ( g_db ) );
 			finalize ( );
 		}
 
@@ -138,23 +306,26 @@ public:
 
 	void exec ( )
 	{
+		if ( _stmt == NULL )
+			return;
+
 		const int result = sqlite3_step ( _stmt );
 		if ( result == SQLITE_ROW )
-			Printf ( "Executing statement did not finish, sqlite3_step() has another row ready.\n" );
+			database_Error ( "Executing statement did not finish, sqlite3_step() has another row ready.\n" );
 		else if ( result != SQLITE_DONE )
-			Printf ( "Could not execute statement. Error: %s\n", sqlite3_errmsg ( g_db ) );
+			database_Error ( "Could not execute statement. Error: %s\n", sqlite3_errmsg ( g_db ) );
 
 		finalize();
 	}
 
 	const unsigned char *getText ( const int ColumnIndex )
 	{
-		return sqlite3_column_text ( _stmt, ColumnIndex );
+		return _stmt ? sqlite3_column_text ( _stmt, ColumnIndex ) : NULL;
 	}
 
 	int getInteger ( const int ColumnIndex )
 	{
-		return sqlite3_column_int ( _stmt, ColumnIndex );
+		return _stmt ? sqlite3_column_int ( _stmt, ColumnIndex ) : 0;
 	}
 
 	void iterateAndGetReturnedEntries ( TArray<std::pair<FString, FString> > &Entries )
@@ -170,13 +341,670 @@ public:
 	}
 };
 
+//*****************************************************************************
+//
+/**
+ * \brief An order statistics tree of the entries of one namespace.
+ *
+ * [dorch] The entries are kept in a treap ordered by the integer value of
+ * the entry (like CAST(Value AS INTEGER)) and then by name. Every node knows
+ * the size of its subtree, so ranks and the n-th entry are found in
+ * logarithmic time.
+ */
+class DataBaseRankIndex
+{
+	struct Node
+	{
+		FString		Name;
+		long long	Value;
+		DWORD		Priority;
+		DWORD		Left;
+		DWORD		Right;
+		DWORD		Size;
+	};
+
+	// Nodes[0] is the empty tree.
+	TArray<Node>			_nodes;
+	TArray<DWORD>			_freeNodes;
+	TMap<FString, DWORD>	_nodeOfName;
+	DWORD					_root;
+	DWORD					_seed;
+
+	DWORD randomPriority ( )
+	{
+		_seed = _seed * 1664525 + 1013904223;
+		return _seed;
+	}
+
+	int compare ( const DWORD Index, const long long Value, const char *Name ) const
+	{
+		const Node &node = _nodes[Index];
+		if ( node.Value != Value )
+			return ( node.Value < Value ) ? -1 : 1;
+		return strcmp ( node.Name.GetChars(), Name );
+	}
+
+	void updateSize ( const DWORD Index )
+	{
+		Node &node = _nodes[Index];
+		node.Size = 1 + _nodes[node.Left].Size + _nodes[node.Right].Size;
+	}
+
+	// Splits the tree into the nodes before the key and the rest.
+	void split ( const DWORD Tree, const long long Value, const char *Name, DWORD &Before, DWORD &After )
+	{
+		if ( Tree == 0 )
+		{
+			Before = After = 0;
+			return;
+		}
+
+		if ( compare ( Tree, Value, Name ) < 0 )
+		{
+			split ( _nodes[Tree].Right, Value, Name, _nodes[Tree].Right, After );
+			Before = Tree;
+		}
+		else
+		{
+			split ( _nodes[Tree].Left, Value, Name, Before, _nodes[Tree].Left );
+			After = Tree;
+		}
+		updateSize ( Tree );
+	}
+
+	DWORD merge ( const DWORD Before, const DWORD After )
+	{
+		if ( Before == 0 )
+			return After;
+		if ( After == 0 )
+			return Before;
+
+		if ( _nodes[Before].Priority > _nodes[After].Priority )
+		{
+			_nodes[Before].Right = merge ( _nodes[Before].Right, After );
+			updateSize ( Before );
+			return Before;
+		}
+		else
+		{
+			_nodes[After].Left = merge ( Before, _nodes[After].Left );
+			updateSize ( After );
+			return After;
+		}
+	}
+
+	DWORD erase ( const DWORD Tree, const DWORD Index )
+	{
+		const int cmp = compare ( Tree, _nodes[Index].Value, _nodes[Index].Name.GetChars() );
+		if ( cmp == 0 )
+			return merge ( _nodes[Tree].Left, _nodes[Tree].Right );
+
+		if ( cmp < 0 )
+			_nodes[Tree].Right = erase ( _nodes[Tree].Right, Index );
+		else
+			_nodes[Tree].Left = erase ( _nodes[Tree].Left, Index );
+		updateSize ( Tree );
+		return Tree;
+	}
+
+	void insert ( const DWORD Index )
+	{
+		DWORD before, after;
+		Node &node = _nodes[Index];
+		node.Left = node.Right = 0;
+		node.Size = 1;
+		node.Priority = randomPriority ( );
+		split ( _root, node.Value, node.Name.GetChars(), before, after );
+		_root = merge ( merge ( before, Index ), after );
+	}
+
+public:
+	// [dorch] Room is made for the given number of entries up front, so that
+	// loading doesn't stop to copy the nodes every time there are twice as
+	// many.
+	DataBaseRankIndex ( const unsigned int Capacity ) : _nodeOfName ( Capacity + 1 ), _root ( 0 ), _seed ( 0x9e3779b9 )
+	{
+		_nodes.Grow ( Capacity + 1 );
+		Node &empty = _nodes[_nodes.Reserve ( 1 )];
+		empty.Value = 0;
+		empty.Priority = 0;
+		empty.Left = empty.Right = empty.Size = 0;
+	}
+
+	unsigned int size ( ) const
+	{
+		return _nodes[_root].Size;
+	}
+
+	void set ( const char *Name, const long long Value )
+	{
+		DWORD *existing = _nodeOfName.CheckKey ( Name );
+		DWORD index;
+
+		if ( existing )
+		{
+			index = *existing;
+			if ( _nodes[index].Value == Value )
+				return;
+			_root = erase ( _root, index );
+		}
+		else
+		{
+			if ( _freeNodes.Pop ( index ) == false )
+				index = _nodes.Reserve ( 1 );
+			_nodes[index].Name = Name;
+			_nodeOfName[_nodes[index].Name] = index;
+		}
+
+		_nodes[index].Value = Value;
+		insert ( index );
+	}
+
+	void remove ( const char *Name )
+	{
+		DWORD *existing = _nodeOfName.CheckKey ( Name );
+		if ( existing == NULL )
+			return;
+
+		const DWORD index = *existing;
+		_root = erase ( _root, index );
+		_nodeOfName.Remove ( Name );
+		_nodes[index].Name = "";
+		_freeNodes.Push ( index );
+	}
+
+	bool find ( const char *Name, long long &Value ) const
+	{
+		const DWORD *existing = _nodeOfName.CheckKey ( Name );
+		if ( existing == NULL )
+			return false;
+
+		Value = _nodes[*existing].Value;
+		return true;
+	}
+
+	// Number of entries with a value below (or, if OrEqual, not above) the given one.
+	unsigned int countBelow ( const long long Value, const bool OrEqual ) const
+	{
+		unsigned int count = 0;
+		DWORD tree = _root;
+
+		while ( tree != 0 )
+		{
+			const Node &node = _nodes[tree];
+			if ( ( node.Value < Value ) || ( OrEqual && ( node.Value == Value ) ) )
+			{
+				count += _nodes[node.Left].Size + 1;
+				tree = node.Right;
+			}
+			else
+				tree = node.Left;
+		}
+
+		return count;
+	}
+
+	// Name of the entry at the given position, counted from the lowest value.
+	const FString &nth ( unsigned int Position ) const
+	{
+		DWORD tree = _root;
+
+		while ( true )
+		{
+			const Node &node = _nodes[tree];
+			const unsigned int leftSize = _nodes[node.Left].Size;
+
+			if ( Position < leftSize )
+				tree = node.Left;
+			else if ( Position == leftSize )
+				return node.Name;
+			else
+			{
+				Position -= leftSize + 1;
+				tree = node.Right;
+			}
+		}
+	}
+};
+
+//*****************************************************************************
+//
+// [dorch] The rank indexes of the namespaces that were ranked or sorted. They
+// are kept up to date by every write, so they are only loaded once.
+static	TMap<FString, DataBaseRankIndex *>	g_RankIndexes;
+
+// [dorch] Namespaces that were too big for database_rankindexlimit.
+static	TMap<FString, bool>					g_UnindexedNamespaces;
+
+// [dorch] The rank index that is being loaded, a few entries every tic, in
+// the order of their names. Writes to entries that were loaded already go to
+// the index, the others are read from the database later.
+struct DataBaseRankIndexLoad
+{
+	FString				Namespace;
+	DataBaseRankIndex	*Index;
+	FString				LastName;
+	bool				bStarted;
+};
+
+static	DataBaseRankIndexLoad				g_RankIndexLoad = { "", NULL, "", false };
+
 //*****************************************************************************
 //	FUNCTIONS
 
+//*****************************************************************************
+//
+// [dorch] The console may only be used by the game thread. Errors of the
+// writer thread are printed the next time the game uses the database.
+//
+static void database_Error ( const char *Format, ... )
+{
+	char message[1024];
+	va_list argptr;
+
+	va_start ( argptr, Format );
+	myvsnprintf ( message, sizeof ( message ), Format, argptr );
+	va_end ( argptr );
+
+	if ( g_bIsWriterThread )
+	{
+		std::lock_guard<std::mutex> lock ( g_QueueMutex );
+		g_WriterErrors += message;
+	}
+	else
+		Printf ( "%s", message );
+}
+
+//*****************************************************************************
+//
+static void database_PrintWriterErrors ( void )
+{
+	std::string errors;
+	{
+		std::lock_guard<std::mutex> lock ( g_QueueMutex );
+		errors.swap ( g_WriterErrors );
+	}
+
+	if ( errors.empty() == false )
+		Printf ( "%s", errors.c_str() );
+}
+
+//*****************************************************************************
+//
+void database_ClearStatements ( void )
+{
+	std::lock_guard<std::recursive_mutex> lock ( g_DatabaseMutex );
+	for ( std::unordered_map<std::string, DataBaseStatement>::iterator it = g_Statements.begin(); it != g_Statements.end(); ++it )
+		sqlite3_finalize ( it->second.Stmt );
+
+	g_Statements.clear();
+}
+
+//*****************************************************************************
+//
+// [dorch] Namespaces and entry names may contain anything, so the key starts
+// with the length of the namespace.
+//
+static FString database_CacheKey ( const char *Namespace, const char *EntryName )
+{
+	FString key;
+	key.Format ( "%u:%s%s", static_cast<unsigned int> ( strlen ( Namespace ) ), Namespace, EntryName );
+	return key;
+}
+
+//*****************************************************************************
+//
+// [dorch] Reads the leading integer of a value like CAST(Value AS INTEGER).
+// Anything that isn't a number is 0.
+//
+static long long database_ValueToInteger ( const char *Value )
+{
+	return strtoll ( Value, NULL, 10 );
+}
+
+//*****************************************************************************
+//
+static void database_CancelRankIndexLoad ( void )
+{
+	delete g_RankIndexLoad.Index;
+	g_RankIndexLoad.Index = NULL;
+	g_RankIndexLoad.Namespace = "";
+	g_RankIndexLoad.LastName = "";
+}
+
+//*****************************************************************************
+//
+static void database_ClearRankIndexes ( void )
+{
+	database_CancelRankIndexLoad ( );
+
+	TMap<FString, DataBaseRankIndex *>::Iterator it ( g_RankIndexes );
+	TMap<FString, DataBaseRankIndex *>::Pair *pair;
+
+	while ( it.NextPair ( pair ) )
+		delete pair->Value;
+
+	g_RankIndexes.Clear();
+	g_UnindexedNamespaces.Clear();
+}
+
+//*****************************************************************************
+//
+static void database_DropRankIndex ( const char *Namespace )
+{
+	if ( ( g_RankIndexLoad.Index != NULL ) && ( g_RankIndexLoad.Namespace.Compare ( Namespace ) == 0 ) )
+		database_CancelRankIndexLoad ( );
+
+	DataBaseRankIndex **index = g_RankIndexes.CheckKey ( Namespace );
+	if ( index != NULL )
+	{
+		delete *index;
+		g_RankIndexes.Remove ( Namespace );
+	}
+	g_UnindexedNamespaces.Remove ( Namespace );
+}
+
+//*****************************************************************************
+//
+// [dorch] Loads the next entries into the rank index that is being loaded,
+// and keeps the index once all entries are in.
+//
+static void database_ContinueRankIndexLoad ( void )
+{
+	if ( g_RankIndexLoad.Index == NULL )
+		return;
+
+	// [dorch] The entries that weren't loaded yet are only written to the
+	// database.
+	DATABASE_Flush ( );
+
+	unsigned int rows = 0;
+	{
+		DataBaseCommand cmd ( g_RankIndexLoad.bStarted
+			? "SELECT KeyName,Value FROM " TABLENAME " WHERE Namespace=?1 AND KeyName>?2 ORDER BY KeyName LIMIT ?3"
+			: "SELECT KeyName,Value FROM " TABLENAME " WHERE Namespace=?1 ORDER BY KeyName LIMIT ?3" );
+		cmd.bindString ( 1, g_RankIndexLoad.Namespace.GetChars() );
+		if ( g_RankIndexLoad.bStarted )
+			cmd.bindString ( 2, g_RankIndexLoad.LastName.GetChars() );
+		cmd.bindInt ( 3, RANKINDEX_ROWS_PER_TIC );
+
+		while ( cmd.step( ) )
+		{
+			g_RankIndexLoad.LastName = reinterpret_cast<const char *> ( cmd.getText(0) );
+			g_RankIndexLoad.Index->set ( g_RankIndexLoad.LastName.GetChars(), database_ValueToInteger ( reinterpret_cast<const char *> ( cmd.getText(1) ) ) );
+			rows++;
+		}
+	}
+	g_RankIndexLoad.bStarted = true;
+
+	if ( rows < RANKINDEX_ROWS_PER_TIC )
+	{
+		g_RankIndexes[g_RankIndexLoad.Namespace] = g_RankIndexLoad.Index;
+		g_RankIndexLoad.Index = NULL;
+		database_CancelRankIndexLoad ( );
+	}
+}
+
+//*****************************************************************************
+//
+// [dorch] Returns the rank index of a namespace. The first time, the index
+// starts to load, and NULL is returned until it's done, so that SQLite is
+// used meanwhile. Also returns NULL if the namespace is too big.
+//
+static DataBaseRankIndex *database_GetRankIndex ( const char *Namespace )
+{
+	DataBaseRankIndex **existing = g_RankIndexes.CheckKey ( Namespace );
+	if ( existing != NULL )
+		return *existing;
+
+	if ( ( database_rankindexlimit == 0 ) || g_UnindexedNamespaces.CheckKey ( Namespace ) )
+		return NULL;
+
+	// [dorch] One namespace is loaded at a time. The others are loaded when
+	// they're used again after that.
+	if ( g_RankIndexLoad.Index != NULL )
+		return NULL;
+
+	DATABASE_Flush ( );
+
+	unsigned int count;
+	{
+		DataBaseCommand cmd ( "SELECT COUNT(*) FROM " TABLENAME " WHERE Namespace=?1" );
+		cmd.bindString ( 1, Namespace );
+		cmd.step( );
+		count = static_cast<unsigned int> ( cmd.getInteger(0) );
+	}
+
+	if ( count > static_cast<unsigned int> ( *database_rankindexlimit ) )
+	{
+		g_UnindexedNamespaces[Namespace] = true;
+		return NULL;
+	}
+
+	g_RankIndexLoad.Namespace = Namespace;
+	g_RankIndexLoad.Index = new DataBaseRankIndex ( count );
+	g_RankIndexLoad.bStarted = false;
+
+	// [dorch] Small namespaces are loaded right away.
+	database_ContinueRankIndexLoad ( );
+
+	existing = g_RankIndexes.CheckKey ( Namespace );
+	return ( existing != NULL ) ? *existing : NULL;
+}
+
+//*****************************************************************************
+//
+// [dorch] Writes one entry. The caller holds the database lock.
+//
+static void database_WriteEntry ( const char *Namespace, const char *EntryName, const char *EntryValue, const bool Delete )
+{
+	if ( Delete )
+	{
+		DataBaseCommand cmd ( DELETEQUERY );
+		cmd.bindString ( 1, Namespace );
+		cmd.bindString ( 2, EntryName );
+		cmd.exec ( );
+	}
+	else
+	{
+		DataBaseCommand cmd ( UPSERTQUERY );
+		cmd.bindString ( 1, Namespace );
+		cmd.bindString ( 2, EntryName );
+		cmd.bindString ( 3, EntryValue );
+		cmd.exec ( );
+	}
+}
+
+//*****************************************************************************
+//
+// [dorch] Commits the queued writes in one transaction whenever the write
+// interval has passed or the game asks for a flush.
+//
+static void database_WriterThread ( void )
+{
+	g_bIsWriterThread = true;
+
+	std::unique_lock<std::mutex> lock ( g_QueueMutex );
+
+	while ( true )
+	{
+		g_QueueChanged.wait ( lock, [] { return g_bWriterQuit || g_bFlushRequested || ( g_WriteQueue.empty() == false ); } );
+
+		// [dorch] Give the game some time to write more entries, or to write
+		// the same ones again.
+		if ( ( g_bWriterQuit == false ) && ( g_bFlushRequested == false ) )
+			g_QueueChanged.wait_for ( lock, std::chrono::milliseconds ( *database_writeinterval ), [] { return g_bWriterQuit || g_bFlushRequested; } );
+
+		DataBaseWriteQueue batch;
+		batch.swap ( g_WriteQueue );
+		g_bFlushRequested = false;
+		g_bWriterBusy = true;
+		lock.unlock();
+
+		if ( batch.empty() == false )
+		{
+			std::lock_guard<std::recursive_mutex> dblock ( g_DatabaseMutex );
+
+			sqlite3_exec ( g_db, "BEGIN TRANSACTION", NULL, NULL, NULL );
+			for ( DataBaseWriteQueue::const_iterator it = batch.begin(); it != batch.end(); ++it )
+				database_WriteEntry ( it->second.Namespace.c_str(), it->second.EntryName.c_str(), it->second.Value.c_str(), it->second.bDelete );
+			if ( sqlite3_exec ( g_db, "COMMIT TRANSACTION", NULL, NULL, NULL ) != SQLITE_OK )
+			{
+				database_Error ( "Could not commit database writes. Error: %s\n", sqlite3_errmsg ( g_db ) );
+				sqlite3_exec ( g_db, "ROLLBACK TRANSACTION", NULL, NULL, NULL );
+			}
+		}
+
+		lock.lock();
+		g_ulWrittenEntries += static_cast<unsigned int> ( batch.size() );
+		g_ulWrittenBatches += ( batch.empty() == false );
+		g_bWriterBusy = false;
+		g_QueueWritten.notify_all();
+
+		if ( g_bWriterQuit && g_WriteQueue.empty() )
+			break;
+	}
+}
+
+//*****************************************************************************
+//
+static void database_StartWriter ( void )
+{
+	if ( g_bWriterRunning || ( g_db == NULL ) || ( database_writebehind == false ) )
+		return;
+
+	g_bWriterQuit = false;
+	g_bFlushRequested = false;
+	g_bWriterRunning = true;
+	g_WriterThread = std::thread ( database_WriterThread );
+}
+
+//*****************************************************************************
+//
+static void database_StopWriter ( void )
+{
+	if ( g_bWriterRunning == false )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock ( g_QueueMutex );
+		g_bWriterQuit = true;
+	}
+	g_QueueChanged.notify_all();
+	g_WriterThread.join();
+	g_bWriterRunning = false;
+
+	database_PrintWriterErrors ( );
+}
+
+//*****************************************************************************
+//
+// [dorch] Remembers the new state of an entry and writes it to the database,
+// either right away or through the writer thread.
+//
+static void database_QueueWrite ( const char *Namespace, const char *EntryName, const char *EntryValue, const bool Delete )
+{
+	DataBaseCacheEntry &entry = g_EntryCache[database_CacheKey ( Namespace, EntryName )];
+	entry.bExists = ( Delete == false );
+	entry.Value = Delete ? "" : EntryValue;
+
+	DataBaseRankIndex **existing = g_RankIndexes.CheckKey ( Namespace );
+	DataBaseRankIndex *index = ( existing != NULL ) ? *existing : NULL;
+
+	if ( ( g_RankIndexLoad.Index != NULL ) && g_RankIndexLoad.bStarted && ( g_RankIndexLoad.Namespace.Compare ( Namespace ) == 0 )
+		&& ( strcmp ( EntryName, g_RankIndexLoad.LastName.GetChars() ) <= 0 ) )
+	{
+		index = g_RankIndexLoad.Index;
+	}
+
+	if ( index != NULL )
+	{
+		if ( Delete )
+			index->remove ( EntryName );
+		else
+			index->set ( EntryName, database_ValueToInteger ( EntryValue ) );
+	}
+
+	if ( g_bWriterRunning == false )
+	{
+		std::lock_guard<std::recursive_mutex> lock ( g_DatabaseMutex );
+		database_WriteEntry ( Namespace, EntryName, EntryValue, Delete );
+		return;
+	}
+
+	std::string key ( Namespace );
+	key += '\0';
+	key += EntryName;
+
+	bool full;
+	{
+		std::lock_guard<std::mutex> lock ( g_QueueMutex );
+		DataBasePendingWrite &write = g_WriteQueue[key];
+		write.Namespace = Namespace;
+		write.EntryName = EntryName;
+		write.Value = Delete ? "" : EntryValue;
+		write.bDelete = Delete;
+		full = ( g_WriteQueue.size() >= static_cast<size_t> ( *database_maxqueue ) );
+		g_ulQueuedWrites++;
+	}
+	g_QueueChanged.notify_one();
+
+	// [dorch] Don't let the queue grow without a bound when the disk can't
+	// keep up.
+	if ( full )
+	{
+		g_ulQueueStalls++;
+		DATABASE_Flush ( false );
+	}
+}
+
+//*****************************************************************************
+//
+// [dorch] Looks an entry up in the cache, or in the database if it isn't
+// cached yet.
+//
+static const DataBaseCacheEntry &database_LookUpEntry ( const char *Namespace, const char *EntryName )
+{
+	const FString key = database_CacheKey ( Namespace, EntryName );
+	DataBaseCacheEntry *cached = g_EntryCache.CheckKey ( key );
+
+	if ( cached != NULL )
+	{
+		g_ulCacheHits++;
+		return *cached;
+	}
+
+	g_ulCacheMisses++;
+
+	// [dorch] Drop the cache when it gets too big. The queue must be written
+	// first, since the cache is the only place the game can read it from.
+	if ( g_EntryCache.CountUsed() >= MAX_CACHED_ENTRIES )
+		DATABASE_Flush ( true );
+
+	DataBaseCacheEntry entry;
+	{
+		DataBaseCommand cmd ( ENTRYQUERY );
+		cmd.bindString ( 1, Namespace );
+		cmd.bindString ( 2, EntryName );
+		entry.bExists = cmd.step( );
+		if ( entry.bExists )
+			entry.Value.Format ( "%s", cmd.getText(2) );
+	}
+
+	return ( g_EntryCache[key] = entry );
+}
+
+//*****************************************************************************
+//
 void database_ClearHandle ( void )
 {
+	database_StopWriter ( );
+	g_EntryCache.Clear();
+	database_ClearRankIndexes ( );
+
 	if ( g_db != NULL )
 	{
+		database_ClearStatements ( );
 		sqlite3_close ( g_db );
 		g_db = NULL;
 	}
@@ -186,6 +1014,7 @@ void database_ClearHandle ( void )
 //
 void database_ExecuteCommand ( const char *Command, int (*Callback)(void*,int,char**,char**) = NULL, void *Data = NULL )
 {
+	std::lock_guard<std::recursive_mutex> lock ( g_DatabaseMutex );
 	int error = sqlite3_exec ( g_db, Command, Callback, Data, 0);
 	if ( error != SQLITE_OK )
 		Printf ( "Error: %s\n", sqlite3_errmsg ( g_db ) );
@@ -238,6 +1067,38 @@ void DATABASE_Init ( void )
 
 	// [BB] Now that the database is ready, we can set the max page count.
 	DATABASE_SetMaxPageCount ( database_maxpagecount );
+
+	database_StartWriter ( );
+}
+
+//*****************************************************************************
+//
+// [dorch] Waits until all queued writes are in the database. Dropping the
+// cache makes the game see changes that other programs made to the file.
+//
+void DATABASE_Flush ( const bool ClearCache )
+{
+	if ( g_bWriterRunning )
+	{
+		std::unique_lock<std::mutex> lock ( g_QueueMutex );
+		g_bFlushRequested = true;
+		g_QueueChanged.notify_one();
+		g_QueueWritten.wait ( lock, [] { return ( g_bFlushRequested == false ) && ( g_bWriterBusy == false ) && g_WriteQueue.empty(); } );
+	}
+
+	database_PrintWriterErrors ( );
+
+	if ( ClearCache )
+		g_EntryCache.Clear();
+}
+
+//*****************************************************************************
+//
+// [dorch] Keeps loading the rank index that is being loaded.
+//
+void DATABASE_Tick ( void )
+{
+	database_ContinueRankIndexLoad ( );
 }
 
 //*****************************************************************************
@@ -269,6 +1130,11 @@ void DATABASE_BeginTransaction ( void )
 	if ( DATABASE_IsAvailable ( "DATABASE_BeginTransaction" ) == false )
 		return;
 
+	// [dorch] The writer thread already batches the writes into transactions
+	// and would clash with another one.
+	if ( g_bWriterRunning )
+		return;
+
 	database_ExecuteCommand ( "BEGIN TRANSACTION" );
 }
 
@@ -279,6 +1145,9 @@ void DATABASE_EndTransaction ( void )
 	if ( DATABASE_IsAvailable ( "DATABASE_EndTransaction" ) == false )
 		return;
 
+	if ( g_bWriterRunning )
+		return;
+
 	database_ExecuteCommand ( "END TRANSACTION" );
 }
 
@@ -290,6 +1159,9 @@ void DATABASE_CreateTable ( )
 		return;
 
 	database_ExecuteCommand ( "CREATE TABLE if not exists " TABLENAME "(Namespace text, KeyName text, Value text, Timestamp text, PRIMARY KEY (Namespace, KeyName))" );
+	// [dorch] Lets SQLite rank and sort the namespaces that are too big to be
+	// ranked in memory without scanning them.
+	database_ExecuteCommand ( "CREATE INDEX if not exists " TABLENAME "Values ON " TABLENAME "(Namespace, CAST(Value AS INTEGER))" );
 }
 
 //*****************************************************************************
@@ -299,6 +1171,8 @@ void DATABASE_ClearTable ( )
 	if ( DATABASE_IsAvailable ( "DATABASE_ClearTable" ) == false )
 		return;
 
+	DATABASE_Flush ( true );
+	database_ClearRankIndexes ( );
 	database_ExecuteCommand ( "DELETE FROM " TABLENAME );
 }
 
@@ -309,6 +1183,8 @@ void DATABASE_DeleteTable ( )
 	if ( DATABASE_IsAvailable ( "DATABASE_DeleteTable" ) == false )
 		return;
 
+	DATABASE_Flush ( true );
+	database_ClearRankIndexes ( );
 	database_ExecuteCommand ( "DROP TABLE " TABLENAME );
 }
 
@@ -330,6 +1206,7 @@ void DATABASE_DumpTable ( )
 	if ( DATABASE_IsAvailable ( "DATABASE_DumpTable" ) == false )
 		return;
 
+	DATABASE_Flush ( );
 	Printf ( "Dumping table \"%s\"\n", TABLENAME );
 	database_ExecuteCommand ( "SELECT * from " TABLENAME, database_DumpTableCallback );
 }
@@ -361,6 +1238,7 @@ void DATABASE_DumpNamespace ( const char *Namespace )
 	if ( DATABASE_IsAvailable ( "DATABASE_DumpNamespace" ) == false )
 		return;
 
+	DATABASE_Flush ( );
 	Printf ( "Dumping namespace \"%s\"\n", Namespace );
 	DataBaseCommand cmd ( "SELECT * from " TABLENAME " WHERE Namespace=?1" );
 	cmd.bindString ( 1, Namespace );
@@ -376,6 +1254,12 @@ void DATABASE_AddEntry ( const char *Namespace, const char *EntryName, const cha
 	if ( DATABASE_IsAvailable ( "DATABASE_AddEntry" ) == false )
 		return;
 
+	// [dorch] Write queued entries first, so that this one doesn't get
+	// overwritten by an older value.
+	DATABASE_Flush ( );
+	g_EntryCache.Remove ( database_CacheKey ( Namespace, EntryName ) );
+	database_DropRankIndex ( Namespace );
+
 	DataBaseCommand cmd ( "INSERT INTO " TABLENAME " VALUES(?1,?2,?3,(" TIMEQUERY "))" );
 	cmd.bindString ( 1, Namespace );
 	cmd.bindString ( 2, EntryName );
@@ -390,6 +1274,10 @@ void DATABASE_SetEntry ( const char *Namespace, const char *EntryName, const cha
 	if ( DATABASE_IsAvailable ( "DATABASE_SetEntry" ) == false )
 		return;
 
+	DATABASE_Flush ( );
+	g_EntryCache.Remove ( database_CacheKey ( Namespace, EntryName ) );
+	database_DropRankIndex ( Namespace );
+
 	DataBaseCommand cmd ( "UPDATE " TABLENAME " SET Value=?3,Timestamp=(" TIMEQUERY ") WHERE Namespace=?1 AND KeyName=?2" );
 	cmd.bindString ( 1, Namespace );
 	cmd.bindString ( 2, EntryName );
@@ -404,15 +1292,7 @@ FString DATABASE_GetEntry ( const char *Namespace, const char *EntryName )
 	if ( DATABASE_IsAvailable ( "DATABASE_GetEntry" ) == false )
 		return "";
 
-	DataBaseCommand cmd ( "SELECT * FROM " TABLENAME " WHERE Namespace=?1 AND KeyName=?2" );
-	cmd.bindString ( 1, Namespace );
-	cmd.bindString ( 2, EntryName );
-	cmd.step( );
-	FString value;
-	value.AppendFormat ( "%s", cmd.getText(2) );
-	// [BB] We assume that the query will return exactly one row. So we finish stepping now.
-	cmd.exec( );
-	return value;
+	return database_LookUpEntry ( Namespace, EntryName ).Value;
 }
 
 //*****************************************************************************
@@ -422,11 +1302,7 @@ bool DATABASE_EntryExists ( const char *Namespace, const char *EntryName )
 	if ( DATABASE_IsAvailable ( "DATABASE_GetEntry" ) == false )
 		return "";
 
-	DataBaseCommand cmd ( "SELECT * FROM " TABLENAME " WHERE Namespace=?1 AND KeyName=?2" );
-	cmd.bindString ( 1, Namespace );
-	cmd.bindString ( 2, EntryName );
-	// [BB] The destructor of DataBaseCommand calls finalize.
-	return ( cmd.step( ) );
+	return database_LookUpEntry ( Namespace, EntryName ).bExists;
 }
 
 //*****************************************************************************
@@ -436,10 +1312,7 @@ void DATABASE_DeleteEntry ( const char *Namespace, const char *EntryName )
 	if ( DATABASE_IsAvailable ( "DATABASE_DeleteEntry" ) == false )
 		return;
 
-	DataBaseCommand cmd ( "DELETE FROM " TABLENAME " WHERE Namespace=?1 AND KeyName=?2" );
-	cmd.bindString ( 1, Namespace );
-	cmd.bindString ( 2, EntryName );
-	cmd.exec ( );
+	database_QueueWrite ( Namespace, EntryName, NULL, true );
 }
 
 //*****************************************************************************
@@ -449,17 +1322,12 @@ void DATABASE_SaveSetEntry ( const char *Namespace, const char *EntryName, const
 	if ( DATABASE_IsAvailable ( "DATABASE_SaveSetEntry" ) == false )
 		return;
 
-	if ( DATABASE_EntryExists ( Namespace, EntryName ) )
-	{
-		// [BB] Setting an entry to the empty string deletes the entry.
-		if ( EntryValue && ( strlen ( EntryValue ) > 0 ) )
-			DATABASE_SetEntry ( Namespace, EntryName, EntryValue );
-		else
-			DATABASE_DeleteEntry ( Namespace, EntryName );
-	}
+	// [BB] Setting an entry to the empty string deletes the entry.
+	if ( EntryValue && ( strlen ( EntryValue ) > 0 ) )
+		database_QueueWrite ( Namespace, EntryName, EntryValue, false );
 	// [BB] Don't store empty string entries.
-	else if ( EntryValue && ( strlen ( EntryValue ) > 0 ) )
-		DATABASE_AddEntry ( Namespace, EntryName, EntryValue );
+	else if ( DATABASE_EntryExists ( Namespace, EntryName ) )
+		database_QueueWrite ( Namespace, EntryName, NULL, true );
 }
 
 //*****************************************************************************
@@ -478,10 +1346,8 @@ FString DATABASE_SaveGetEntry ( const char *Namespace, const char *EntryName )
 	if ( DATABASE_IsAvailable ( "DATABASE_SaveGetEntry" ) == false )
 		return "";
 
-	if ( DATABASE_EntryExists ( Namespace, EntryName ) )
-		return DATABASE_GetEntry ( Namespace, EntryName );
-	else
-		return "";
+	const DataBaseCacheEntry &entry = database_LookUpEntry ( Namespace, EntryName );
+	return entry.bExists ? entry.Value : FString ( "" );
 }
 
 //*****************************************************************************
@@ -491,21 +1357,14 @@ void DATABASE_SaveIncrementEntryInt ( const char *Namespace, const char *EntryNa
 	if ( DATABASE_IsAvailable ( "DATABASE_SaveIncrementEntryInt" ) == false )
 		return;
 
+	// [dorch] The old value comes from the cache now. Like CAST(Value AS
+	// INTEGER), this reads the leading number and treats anything else as 0.
+	const DataBaseCacheEntry &entry = database_LookUpEntry ( Namespace, EntryName );
+	const long long oldVal = entry.bExists ? database_ValueToInteger ( entry.Value.GetChars() ) : 0;
+
 	FString newVal;
-	if ( DATABASE_EntryExists ( Namespace, EntryName ) )
-	{
-		// [BB] Get the old value and set the incremented value in a single query.
-		DataBaseCommand cmd ( "UPDATE " TABLENAME " SET Value=(SELECT CAST(Value AS INTEGER) FROM " TABLENAME " WHERE Namespace=?1 AND KeyName=?2)+?3,Timestamp=(" TIMEQUERY ") WHERE Namespace=?1 AND KeyName=?2" );
-		cmd.bindString ( 1, Namespace );
-		cmd.bindString ( 2, EntryName );
-		cmd.bindInt ( 3, Increment );
-		cmd.exec ( );
-	}
-	else
-	{
-		newVal.AppendFormat ( "%d", Increment );
-		DATABASE_AddEntry ( Namespace, EntryName, newVal.GetChars() );
-	}
+	newVal.Format ( "%lld", oldVal + Increment );
+	database_QueueWrite ( Namespace, EntryName, newVal.GetChars(), false );
 }
 
 //*****************************************************************************
@@ -515,8 +1374,24 @@ int DATABASE_GetEntryRank ( const char *Namespace, const char *EntryName, const
 	if ( DATABASE_IsAvailable ( "DATABASE_GetEntryRank" ) == false )
 		return -1;
 
+	DataBaseRankIndex *index = database_GetRankIndex ( Namespace );
+	if ( index != NULL )
+	{
+		long long value;
+		if ( index->find ( EntryName, value ) == false )
+			return -1;
+
+		if ( Descending )
+			return index->size() - index->countBelow ( value, true ) + 1;
+		else
+			return index->countBelow ( value, false ) + 1;
+	}
+
 	if ( DATABASE_EntryExists ( Namespace, EntryName ) )
 	{
+		// [dorch] The ranking needs every entry of the namespace on disk.
+		DATABASE_Flush ( );
+
 		// [BB] To get the rank of a certain entry, we get the value of the entry,
 		// count how many values are lower (or higher) than the value and return
 		// the count + 1.
@@ -548,6 +1423,27 @@ int DATABASE_GetSortedEntries ( const char *Namespace, const int N, const int Of
 		return 0;
 	}
 
+	DataBaseRankIndex *index = database_GetRankIndex ( Namespace );
+	if ( index != NULL )
+	{
+		// [dorch] Like LIMIT and OFFSET, a negative count means all entries
+		// and a negative offset is ignored.
+		const unsigned int size = index->size();
+		const unsigned int first = static_cast<unsigned int> ( MAX ( Offset, 0 ) );
+		const unsigned int end = ( N < 0 ) ? size : MIN ( size, first + static_cast<unsigned int> ( N ) );
+
+		for ( unsigned int i = first; i < end; ++i )
+		{
+			std::pair<FString, FString> value;
+			value.first = index->nth ( Descending ? size - 1 - i : i );
+			value.second = database_LookUpEntry ( Namespace, value.first.GetChars() ).Value;
+			Entries.Push ( value );
+		}
+		return Entries.Size();
+	}
+
+	DATABASE_Flush ( );
+
 	FString commandString;
 	commandString.Format ( "SELECT * from " TABLENAME " WHERE Namespace=?1 ORDER BY CAST(Value AS INTEGER) " );
 	commandString += Descending ? "DESC" : "ASC";
@@ -570,6 +1466,8 @@ int DATABASE_GetEntries ( const char *Namespace, TArray<std::pair<FString, FStri
 		return 0;
 	}
 
+	DATABASE_Flush ( );
+
 	DataBaseCommand cmd ( "SELECT * from " TABLENAME " WHERE Namespace=?1" );
 	cmd.bindString ( 1, Namespace );
 	cmd.iterateAndGetReturnedEntries ( Entries );
@@ -584,6 +1482,147 @@ CCMD ( dumpdb )
 	DATABASE_DumpTable();
 }
 
+// [dorch] Shows how well the cache and the write-behind queue work.
+CCMD ( db_stats )
+{
+	if ( DATABASE_IsAvailable ( "db_stats" ) == false )
+		return;
+
+	// [dorch] The writer adds to g_Statements while it holds the database
+	// lock, and takes the queue lock after it.
+	std::lock_guard<std::recursive_mutex> dblock ( g_DatabaseMutex );
+	std::lock_guard<std::mutex> lock ( g_QueueMutex );
+	Printf ( "Cache: %u entries, %u hits, %u misses\n", static_cast<unsigned int> ( g_EntryCache.CountUsed() ), g_ulCacheHits, g_ulCacheMisses );
+	Printf ( "Statements: %u prepared\n", static_cast<unsigned int> ( g_Statements.size() ) );
+	if ( g_bWriterRunning )
+	{
+		Printf ( "Writer: %u writes queued, %u entries written in %u transactions, %u waiting\n",
+			g_ulQueuedWrites, g_ulWrittenEntries, g_ulWrittenBatches, static_cast<unsigned int> ( g_WriteQueue.size() ) );
+		Printf ( "The game waited %u times for a full queue.\n", g_ulQueueStalls );
+	}
+	else
+		Printf ( "Writer: off, entries are written immediately.\n" );
+}
+
+// [dorch] Times ranking and sorting a namespace with the given number of
+// entries the old way (scanning the table), with the value index and in
+// memory. The entries are deleted again afterwards.
+// Usage: db_benchrank [entries] [queries]
+CCMD ( db_benchrank )
+{
+	// [BB] This function may not be used by ConsoleCommand.
+	if ( ACS_IsCalledFromConsoleCommand( ))
+		return;
+
+	if ( DATABASE_IsAvailable ( "db_benchrank" ) == false )
+		return;
+
+	const char *Namespace = "db_benchrank";
+	const unsigned int numEntries = ( argv.argc() > 1 ) ? clamp ( atoi ( argv[1] ), 1, 10000000 ) : 1000000;
+	const unsigned int numQueries = ( argv.argc() > 2 ) ? clamp ( atoi ( argv[2] ), 1, 100000 ) : 1000;
+	DWORD seed = 1;
+	FString name, value;
+
+	DATABASE_Flush ( true );
+	database_DropRankIndex ( Namespace );
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	{
+		std::lock_guard<std::recursive_mutex> lock ( g_DatabaseMutex );
+		sqlite3_exec ( g_db, "BEGIN TRANSACTION", NULL, NULL, NULL );
+		for ( unsigned int i = 0; i < numEntries; ++i )
+		{
+			seed = seed * 1664525 + 1013904223;
+			name.Format ( "player%u", i );
+			value.Format ( "%u", ( seed >> 8 ) % 1000000 );
+			database_WriteEntry ( Namespace, name.GetChars(), value.GetChars(), false );
+		}
+		sqlite3_exec ( g_db, "COMMIT TRANSACTION", NULL, NULL, NULL );
+	}
+	Printf ( "Wrote %u entries in %.0f ms.\n", numEntries,
+		std::chrono::duration<double, std::milli> ( std::chrono::steady_clock::now() - start ).count() );
+
+	// [dorch] Full scans take long, so they get fewer queries.
+	const char *const methods[3] = { "table scan", "value index", "in memory" };
+	for ( int method = 0; method < 3; ++method )
+	{
+		const unsigned int queries = ( method == 0 ) ? MAX ( numQueries / 100, 1u ) : numQueries;
+		double rankMS = 0, sortMS = 0;
+		int checksum = 0;
+
+		if ( method == 2 )
+		{
+			unsigned int tics = 1;
+			double longestMS = 0;
+			database_CancelRankIndexLoad ( );
+			start = std::chrono::steady_clock::now();
+			database_GetRankIndex ( Namespace );
+			longestMS = std::chrono::duration<double, std::milli> ( std::chrono::steady_clock::now() - start ).count();
+			while ( g_RankIndexLoad.Index != NULL )
+			{
+				const std::chrono::steady_clock::time_point ticStart = std::chrono::steady_clock::now();
+				DATABASE_Tick ( );
+				longestMS = MAX ( longestMS, std::chrono::duration<double, std::milli> ( std::chrono::steady_clock::now() - ticStart ).count() );
+				tics++;
+			}
+			Printf ( "Loading the rank index took %.0f ms over %u tics, at most %.1f ms per tic.\n",
+				std::chrono::duration<double, std::milli> ( std::chrono::steady_clock::now() - start ).count(), tics, longestMS );
+		}
+
+		FString rankQuery, sortQuery;
+		rankQuery.Format ( "SELECT COUNT(*) from " TABLENAME "%s WHERE Namespace=?1 AND CAST(Value AS INTEGER)>(SELECT CAST(Value AS INTEGER) FROM " TABLENAME " WHERE Namespace=?1 AND KeyName=?2)",
+			( method == 0 ) ? " NOT INDEXED" : "" );
+		sortQuery.Format ( "SELECT * from " TABLENAME "%s WHERE Namespace=?1 ORDER BY CAST(Value AS INTEGER) DESC LIMIT 10 OFFSET ?2",
+			( method == 0 ) ? " NOT INDEXED" : "" );
+
+		// [dorch] Every method ranks the same entries, so the checksums of the
+		// ones with as many queries must match.
+		seed = 1;
+		for ( unsigned int i = 0; i < queries; ++i )
+		{
+			seed = seed * 1664525 + 1013904223;
+			name.Format ( "player%u", ( seed >> 8 ) % numEntries );
+
+			start = std::chrono::steady_clock::now();
+			if ( method < 2 )
+			{
+				DataBaseCommand cmd ( rankQuery.GetChars() );
+				cmd.bindString ( 1, Namespace );
+				cmd.bindString ( 2, name.GetChars() );
+				cmd.step( );
+				checksum += cmd.getInteger(0) + 1;
+			}
+			else
+				checksum += DATABASE_GetEntryRank ( Namespace, name.GetChars(), true );
+			rankMS += std::chrono::duration<double, std::milli> ( std::chrono::steady_clock::now() - start ).count();
+
+			TArray<std::pair<FString, FString> > entries;
+			start = std::chrono::steady_clock::now();
+			if ( method < 2 )
+			{
+				DataBaseCommand cmd ( sortQuery.GetChars() );
+				cmd.bindString ( 1, Namespace );
+				cmd.bindInt ( 2, i % 100 );
+				cmd.iterateAndGetReturnedEntries ( entries );
+			}
+			else
+				DATABASE_GetSortedEntries ( Namespace, 10, i % 100, true, entries );
+			sortMS += std::chrono::duration<double, std::milli> ( std::chrono::steady_clock::now() - start ).count();
+		}
+
+		Printf ( "%-12s rank %9.4f ms, top 10 %9.4f ms (%u queries, checksum %d)\n", methods[method],
+			rankMS / queries, sortMS / queries, queries, checksum );
+	}
+
+	{
+		DataBaseCommand cmd ( "DELETE FROM " TABLENAME " WHERE Namespace=?1" );
+		cmd.bindString ( 1, Namespace );
+		cmd.exec ( );
+	}
+	DATABASE_Flush ( true );
+	database_DropRankIndex ( Namespace );
+}
+
 CCMD ( db_enable_wal )
 {
 	// [BB] This function may not be used by ConsoleCommand.
@@ -55,6 +55,8 @@
 void	DATABASE_Construct ( void );
 void	DATABASE_Destruct ( void );
 void	DATABASE_Init ( void );
+void	DATABASE_Flush ( const bool ClearCache = false );
+void	DATABASE_Tick ( void );
 bool	DATABASE_IsAvailable ( const char *CallingFunction = NULL );
 void	DATABASE_SetMaxPageCount ( const unsigned int MaxPageCount );
 void	DATABASE_BeginTransaction ( void );